@@ -34,6 +34,7 @@
 using namespace	triangle_stripper;
 #endif
 #include <utility>
+#include <string.h>
 using std::pair;
 
 
@@ -81,12 +82,106 @@ void			DSFSharedPointPool::AddPoolDirect(DSFTuple& minFrac, DSFTuple& maxFrac)
 	mPools.back().mScale = submax - submin;
 }
 
+#define MIN_INDEX_SLOTS 256
+
+// Quantizes the point the same way WritePoolAtoms always did - encode, then truncate to 16 bits.
+bool	DSFSharedPointPool::SharedSubPool::encode(const DSFTuple& inPoint, uint16_t outKey[]) const
+{
+	DSFTuple	point(inPoint);
+	if (!point.encode(mOffset, mScale))
+		return false;
+	for (int n = 0; n < point.size(); ++n)
+		outKey[n] = point[n];
+	return true;
+}
+
+static inline uint32_t	hash_key(const uint16_t key[], int depth)
+{
+	uint32_t h = depth;
+	for (int n = 0; n < depth; ++n)
+	{
+		h ^= key[n];
+		h *= 0x9E3779B1u;
+		h ^= h >> 15;
+	}
+	h ^= h >> 13;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+int		DSFSharedPointPool::SharedSubPool::find_slot(const uint16_t key[]) const
+{
+	int depth = mScale.size();
+	uint32_t mask = mPointsIndex.size() - 1;
+	uint32_t slot = hash_key(key, depth) & mask;
+	while (mPointsIndex[slot] >= 0 && memcmp(&mPoints[mPointsIndex[slot] * depth], key, depth * sizeof(uint16_t)) != 0)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+int		DSFSharedPointPool::SharedSubPool::find(const uint16_t key[]) const
+{
+	if (mPointsIndex.empty())
+		return -1;
+	return mPointsIndex[find_slot(key)];
+}
+
+int		DSFSharedPointPool::SharedSubPool::append(const uint16_t key[])
+{
+	int depth = mScale.size();
+	int our_pos = size();
+	mPoints.insert(mPoints.end(), key, key + depth);
+
+	if (2 * (mIndexed + 1) > mPointsIndex.size())
+		rehash(max(MIN_INDEX_SLOTS, (int) mPointsIndex.size() * 2));
+	int slot = find_slot(key);
+	if (mPointsIndex[slot] < 0)
+	{
+		mPointsIndex[slot] = our_pos;
+		++mIndexed;
+	}
+	return our_pos;
+}
+
+void	DSFSharedPointPool::SharedSubPool::rehash(int slots)
+{
+	vector<int> old;
+	old.swap(mPointsIndex);
+	mPointsIndex.assign(slots, -1);
+	for (vector<int>::iterator i = old.begin(); i != old.end(); ++i)
+	if (*i >= 0)
+		mPointsIndex[find_slot(&mPoints[*i * mScale.size()])] = *i;
+}
+
+void	DSFSharedPointPool::SharedSubPool::stats(int& slots, double& avg_probe, int& max_probe) const
+{
+	slots = mPointsIndex.size();
+	avg_probe = 0.0;
+	max_probe = 0;
+	if (mIndexed == 0)
+		return;
+
+	int depth = mScale.size();
+	uint32_t mask = slots - 1;
+	long long total = 0;
+	for (int s = 0; s < slots; ++s)
+	if (mPointsIndex[s] >= 0)
+	{
+		int home = hash_key(&mPoints[mPointsIndex[s] * depth], depth) & mask;
+		int probe = ((s - home) & mask) + 1;
+		total += probe;
+		max_probe = max(max_probe, probe);
+	}
+	avg_probe = (double) total / mIndexed;
+}
+
 bool			DSFSharedPointPool::CanBeContiguous(const DSFTupleVector& inPoints)
 {
-	for (list<SharedSubPool>::iterator p = mPools.begin(); p != mPools.end(); ++p)
+	for (vector<SharedSubPool>::iterator p = mPools.begin(); p != mPools.end(); ++p)
 	{
 		// 65535?  yes, really.  The damn cross pool primitive uses [) notation, so it loses 1 unit capacity.
-		if((p->mPoints.size() + inPoints.size()) > 65535)
+		if((p->size() + inPoints.size()) > 65535)
 			continue;
 		bool ok = true;
 		for (int n = 0; n < inPoints.size(); ++n)
@@ -109,24 +204,21 @@ bool			DSFSharedPointPool::CanBeContiguous(const DSFTupleVector& inPoints)
 pair<int, int>	DSFSharedPointPool::AcceptContiguous(const DSFTupleVector& inPoints)
 {
 	int n;
-	DSFTupleVector	encoded;
+	uint16_t	key[MAX_TUPLE_LEN];
 	int	first_ok_pool = -1;
-	int p = 0;
-	SharedSubPool * found = NULL;
 
-	for (list <SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool, ++p)
+	for (int p = 0; p < mPools.size(); ++p)
 	{
-		if((pool->mPoints.size() + inPoints.size()) > 65535)
+		SharedSubPool& pool = mPools[p];
+		if((pool.size() + inPoints.size()) > 65535)
 		{
-			//printf("Skipping full pool, pool has %d, we need to sink %d.\n", pool->mPoints.size(), inPoints.size());
+			//printf("Skipping full pool, pool has %d, we need to sink %d.\n", pool.size(), inPoints.size());
 			continue;
 		}
 		bool ok = true;
-		encoded.clear();
 		for (n = 0; n < inPoints.size(); ++n)
 		{
-			encoded.push_back(inPoints[n]);
-			if (!encoded.back().encode(pool->mOffset, pool->mScale))
+			if (!pool.encode(inPoints[n], key))
 			{
 				ok = false;
 				break;
@@ -136,34 +228,31 @@ pair<int, int>	DSFSharedPointPool::AcceptContiguous(const DSFTupleVector& inPoin
 		{
 			// This is the first pool we've found where we at least could
 			// all fit.  Check for sharing.
-			for (n = 0; n < encoded.size(); ++n)
+			for (n = 0; n < inPoints.size(); ++n)
 			{
-				if (pool->mPointsIndex.find(encoded[n]) !=
-					pool->mPointsIndex.end())
+				pool.encode(inPoints[n], key);
+				if (pool.find(key) != -1)
 				{
 					return pair<int,int>(-1,-1);
 				}
 			}
-			found = &*pool;
 			first_ok_pool = p;
 		}
 	}
 	if (first_ok_pool != -1)
-		return AcceptContiguousPool(first_ok_pool, found, inPoints);
+		return AcceptContiguousPool(first_ok_pool, inPoints);
 	return pair<int,int>(-1, -1);
 }
 
-pair<int, int>	DSFSharedPointPool::AcceptContiguousPool(int p, SharedSubPool * pool, const DSFTupleVector& inPoints)
+pair<int, int>	DSFSharedPointPool::AcceptContiguousPool(int p, const DSFTupleVector& inPoints)
 {
-	int n;
-	pair<int,int> retval(p, (int)pool->mPoints.size());
-	for (n = 0; n < inPoints.size(); ++n)
+	SharedSubPool& pool = mPools[p];
+	uint16_t	key[MAX_TUPLE_LEN];
+	pair<int,int> retval(p, pool.size());
+	for (int n = 0; n < inPoints.size(); ++n)
 	{
-		DSFTuple	pt(inPoints[n]);
-		pt.encode(pool->mOffset,pool->mScale);
-		pool->mPointsIndex.insert(hash_map<DSFTuple, int>::value_type(
-					pt, (int)pool->mPoints.size()));
-		pool->mPoints.push_back(pt);
+		pool.encode(inPoints[n], key);
+		pool.append(key);
 	}
 	return retval;
 }
@@ -171,16 +260,15 @@ pair<int, int>	DSFSharedPointPool::AcceptContiguousPool(int p, SharedSubPool * p
 int	DSFSharedPointPool::CountShared(const DSFTupleVector& inPoints)
 {
 	int c = 0;
+	uint16_t	key[MAX_TUPLE_LEN];
 	for(int n = 0; n < inPoints.size(); ++n)
 	{
 		// First check every scale for the point already existing.
-		for (list<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
+		for (vector<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
 		{
-			DSFTuple	point(inPoints[n]);
-			if (point.encode(pool->mOffset, pool->mScale))
+			if (pool->encode(inPoints[n], key))
 			{
-				hash_map<DSFTuple,int>::iterator iter = pool->mPointsIndex.find(point);
-				if (iter != pool->mPointsIndex.end())
+				if (pool->find(key) != -1)
 					++c;
 			}
 		}
@@ -190,55 +278,44 @@ int	DSFSharedPointPool::CountShared(const DSFTupleVector& inPoints)
 
 pair<int, int>	DSFSharedPointPool::AcceptShared(const DSFTuple& inPoint)
 {
-	int p = 0;
+	uint16_t	key[MAX_TUPLE_LEN];
+	int p;
 	// First check every scale for the point already existing.
-	for (list<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool, ++p)
+	for (p = 0; p < mPools.size(); ++p)
 	{
-		DSFTuple	point(inPoint);
-		if (point.encode(pool->mOffset, pool->mScale))
+		if (mPools[p].encode(inPoint, key))
 		{
-			hash_map<DSFTuple,int>::iterator iter = pool->mPointsIndex.find(point);
-			if (iter != pool->mPointsIndex.end())
-				return pair<int,int>(p, iter->second);
+			int idx = mPools[p].find(key);
+			if (idx != -1)
+				return pair<int,int>(p, idx);
 		}
 	}
 	// Hrm...doesn't exist.  Try to add it.
-	p = 0;
-	
-	list<SharedSubPool>::iterator exemplar = mPools.end();
-	for (list<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool, ++p)
+	int exemplar = -1;
+	for (p = 0; p < mPools.size(); ++p)
 	{
-		DSFTuple	point(inPoint);
-		if (point.encode(pool->mOffset, pool->mScale))
+		if (mPools[p].encode(inPoint, key))
 		{
-			if(pool->mPoints.size() < 65535)
+			if(mPools[p].size() < 65535)
 			{
-				int our_pos = pool->mPoints.size();
-				pool->mPoints.push_back(point);
-				pool->mPointsIndex.insert(hash_map<DSFTuple, int>::value_type(point, our_pos));
-				return pair<int, int>(p, our_pos);
+				return pair<int, int>(p, mPools[p].append(key));
 			}
-			else if(exemplar == mPools.end())
-				exemplar = pool;
+			else if(exemplar == -1)
+				exemplar = p;
 		}
 	}
 	
-	if(exemplar != mPools.end())
+	if(exemplar != -1)
 	{
-		DSFTuple	point(inPoint);
-		if (!point.encode(exemplar->mOffset, exemplar->mScale))
-			Assert(!"Failure to re-encode into copied pool. This should never happen.");
-
-		mPools.push_back(SharedSubPool());
-		mPools.back().mOffset = exemplar->mOffset;
-		mPools.back().mScale = exemplar->mScale;
+		SharedSubPool	overflow;
+		overflow.mOffset = mPools[exemplar].mOffset;
+		overflow.mScale = mPools[exemplar].mScale;
+		mPools.push_back(overflow);
 
-		exemplar = mPools.end();
-		--exemplar;
+		if (!mPools.back().encode(inPoint, key))
+			Assert(!"Failure to re-encode into copied pool. This should never happen.");
 
-		int our_pos = exemplar->mPoints.size();
-		exemplar->mPoints.push_back(point);
-		exemplar->mPointsIndex.insert(hash_map<DSFTuple, int>::value_type(point, our_pos));
+		int our_pos = mPools.back().append(key);
 		return pair<int, int>((int)mPools.size()-1, our_pos);
 	}
 
@@ -248,15 +325,15 @@ pair<int, int>	DSFSharedPointPool::AcceptShared(const DSFTuple& inPoint)
 
 void			DSFSharedPointPool::Trim(void)
 {
-	for (list<SharedSubPool>::iterator i = mPools.begin(); i != mPools.end(); ++i)
+	for (vector<SharedSubPool>::iterator i = mPools.begin(); i != mPools.end(); ++i)
 		trim(i->mPoints);
 }
 
 int				DSFSharedPointPool::Count() const
 {
 	int t = 0;
-	for (list<SharedSubPool>::const_iterator i = mPools.begin(); i != mPools.end(); ++i)
-		t += (i->mPoints.size());
+	for (vector<SharedSubPool>::const_iterator i = mPools.begin(); i != mPools.end(); ++i)
+		t += (i->size());
 	return t;
 }
 
@@ -264,31 +341,21 @@ int				DSFSharedPointPool::Count() const
 void			DSFSharedPointPool::ProcessPoints(void)
 {
 	int new_p = 0;
-	for (list<SharedSubPool>::iterator i = mPools.begin(); i != mPools.end(); )
+	vector<SharedSubPool>	used;
+	used.reserve(mPools.size());
+	for (vector<SharedSubPool>::iterator i = mPools.begin(); i != mPools.end(); ++i)
 	{
-/*
-		map<int, int> counts;
-		for (hash_map<DSFTuple, int>::const_iterator c = i->mPointsIndex.begin(); c != i->mPointsIndex.end(); ++c)
-		{
-			counts[i->mPointsIndex.collision(c)]++;
-		}
-		printf("32 bit pool buckets = %d pts = %d\n", i->mPointsIndex.bucket_count(), i->mPointsIndex.size());
-		for (map<int, int>::iterator j = counts.begin(); j != counts.end(); ++j)
-		{
-			printf("   %d loading     %d times\n", j->first, j->second);
-		}
-*/
-
 		if (i->mPoints.empty())
 		{
-			i = mPools.erase(i);
 			mUsageMapping.push_back(-1);
 		} else {
 			mUsageMapping.push_back(new_p);
-			++i;
+			used.push_back(SharedSubPool());
+			swap(used.back(), *i);
 			++new_p;
 		}
 	}
+	mPools.swap(used);
 }
 
 int				DSFSharedPointPool::MapPoolNumber(int n)
@@ -303,26 +370,24 @@ int			DSFSharedPointPool::WritePoolAtoms(FILE * fi, int32_t id)
 		StFileSizeDebugger how_big(fi,"shared point pool total");
 	#endif
 
-	for (list<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
+	for (vector<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
 	{
+		#if DSF_WRITE_STATS
+			int slots, max_probe;
+			double avg_probe;
+			pool->stats(slots, avg_probe, max_probe);
+			printf("  %d points, %d index slots, load %.2f, probes avg %.2f max %d\n",
+				pool->size(), slots, slots ? (double) pool->mIndexed / slots : 0.0, avg_probe, max_probe);
+		#endif
 		StAtomWriter	poolAtom(fi, id, true);
-		vector<uint16_t>	shorts;
-		for (DSFTupleVector::iterator i = pool->mPoints.begin();
-			i != pool->mPoints.end(); ++i)
-		{
-			for (int j = 0; j < i->size(); ++j)
-			{
-				shorts.push_back((*i)[j]);
-			}
-		}
-		WritePlanarNumericAtomShort(fi, pool->mScale.size(), pool->mPoints.size(), xpna_Mode_RLE_Differenced, 1, (int16_t *) &*shorts.begin());
+		WritePlanarNumericAtomShort(fi, pool->mScale.size(), pool->size(), xpna_Mode_RLE_Differenced, 1, (int16_t *) &*pool->mPoints.begin());
 	}
 	return mPools.size();
 }
 
 int			DSFSharedPointPool::WriteScaleAtoms(FILE * fi, int32_t id)
 {
-	for (list<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
+	for (vector<SharedSubPool>::iterator pool = mPools.begin(); pool != mPools.end(); ++pool)
 	{
 		StAtomWriter	scaleAtom(fi, id, true);
 		for (int d = 0; d < pool->mScale.size(); ++d)
@@ -113,7 +113,13 @@ typedef list<DSFTupleVector>		DSFTupleVectorVector;
 /* A shared point pool.  Every point is pooled, and the
  * points are sorted spatially.  The shared point pool
  * is really N sub-point-pools, so each point ends up
- * with a pair of indices. */
+ * with a pair of indices.
+ *
+ * Each sub-pool stores its points already quantized to the
+ * 16 bit values that go into the file, back to back, and
+ * finds existing points with an open-addressing hash table
+ * of point indices - so sharing a point costs no allocation
+ * and two points are the same if they write the same. */
 
 typedef	pair<int, int>	DSFPointPoolLoc;
 typedef vector<DSFPointPoolLoc>	DSFPointPoolLocVector;
@@ -169,15 +175,27 @@ private:
 		DSFTuple					mOffset;
 		DSFTuple					mScale;
 
-		DSFTupleVector				mPoints;			// These are our points
-		hash_map<DSFTuple, int>		mPointsIndex;		// This is used to see if we already have a point.
+		vector<uint16_t>			mPoints;			// These are our points, mScale.size() shorts each
+		vector<int>					mPointsIndex;		// Hash table of point indices, -1 = empty.  This is used to see if we already have a point.
+		int							mIndexed;
+
+		SharedSubPool() : mIndexed(0) { }
+
+		int		size() const { return mScale.size() ? mPoints.size() / mScale.size() : 0; }
+		bool	encode(const DSFTuple& inPoint, uint16_t outKey[]) const;
+		int		find(const uint16_t key[]) const;		// Index of the point, or -1
+		int		append(const uint16_t key[]);			// Adds the point even if we have it - the index keeps the first one
+		void	stats(int& slots, double& avg_probe, int& max_probe) const;
 
+	private:
+		int		find_slot(const uint16_t key[]) const;
+		void	rehash(int slots);
 	};
 
-	list<SharedSubPool>			mPools;
+	vector<SharedSubPool>		mPools;
 	vector<int>					mUsageMapping;
 
-	DSFPointPoolLoc	AcceptContiguousPool(int pp, SharedSubPool * pool, const DSFTupleVector& inPoints);
+	DSFPointPoolLoc	AcceptContiguousPool(int pp, const DSFTupleVector& inPoints);
 
 };
 
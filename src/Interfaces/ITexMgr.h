@@ -32,6 +32,8 @@ class	ITexMgr : public virtual IBase {
 public:
 
 	virtual	TexRef		LookupTexture(const char * path, bool is_absolute, int flags)=0;
+	// Same, but never waits for the file: returns NULL until the texture is loaded in the background.
+	virtual	TexRef		RequestTexture(const char * path, bool is_absolute, int flags)=0;
 
 	virtual	int			GetTexID(TexRef ref)=0;
 	virtual	void		GetTexInfo(
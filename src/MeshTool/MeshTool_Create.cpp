@@ -185,7 +185,7 @@ void MT_MakeDSF(rf_region region, const char * dump, const char * out_dsf)
 	DeriveDEMs(*the_map, sDem,sApts, sAptIndex, true, ConsoleProgressFunc);
 
 	// -zoning
-	ZoneManMadeAreas(*the_map, sDem[dem_Elevation], sDem[dem_LandUse], sDem[dem_ForestType], sDem[dem_ParkType],  sDem[dem_Slope],sApts,Pmwx::Face_handle(),ConsoleProgressFunc);
+	ZoneManMadeAreas(*the_map, sDem[dem_Elevation], sDem[dem_LandUse], sDem[dem_ForestType], sDem[dem_ParkType],  sDem[dem_Slope],sApts,sAptIndex,Pmwx::Face_handle(),ConsoleProgressFunc);
 
 	// -calcmesh
 	TriangulateMesh(*the_map, sMesh, sDem, dump, ConsoleProgressFunc);
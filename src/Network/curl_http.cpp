@@ -14,10 +14,13 @@
 
 #include "curl/curl.h"
 #include "AssertUtils.h"
-#if !IBM
-#include <pthread.h>
-#endif
 #include <errno.h>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#if WED
+#include "WED_Version.h"
+#endif
 
 int atomic_load(volatile int * a) { return *a; }
 void atomic_store(volatile int * a, int v) { *a = v; }
@@ -27,6 +30,15 @@ void atomic_store(volatile int * a, int v) { *a = v; }
 
 const time_t TIMEOUT_SEC = (30);
 
+#define HTTP_MAX_HOST_CONNECTIONS	6		// like the browsers do
+#define HTTP_MAX_CONNECTIONS		16
+#define HTTP_POLL_MS				50		// how long the download thread sleeps when nothing happens on the net
+
+// curl_multi_poll can be woken up from another thread, so new requests start right away instead of
+// waiting out the poll.  Older curls only have curl_multi_wait, which returns at once when there is no
+// socket to wait on - there the thread naps on a condition variable instead of spinning.
+#define HTTP_HAS_WAKEUP				(LIBCURL_VERSION_NUM >= 0x074400)
+
 void	UTL_http_encode_url(string& io_url)
 {
 	string::size_type p;
@@ -42,6 +54,8 @@ curl_http_get_file::curl_http_get_file(
 	m_progress(-1),
 	m_status(in_progress),
 	m_halt(0),
+	m_curl(NULL),
+	m_headers(NULL),
 	m_dest_path(outDestFile),
 	m_url(inURL),
 	m_dest_buffer(NULL),
@@ -56,11 +70,7 @@ curl_http_get_file::curl_http_get_file(
 		strncmp(inURL.c_str(),"http://",7) == 0 ||
 		strncmp(inURL.c_str(),"https://",8) == 0);
 	
-	#if IBM
-	m_thread = CreateThread(NULL,0,thread_proc,this,0,NULL);
-	#else
-	pthread_create(&m_thread, NULL, thread_proc, this);
-	#endif
+	start();
 
 }
 
@@ -71,6 +81,8 @@ curl_http_get_file::curl_http_get_file(
 	m_progress(-1),
 	m_status(in_progress),
 	m_halt(0),
+	m_curl(NULL),
+	m_headers(NULL),
 	m_url(inURL),
 	m_dest_buffer(outDestBuffer),
 	m_errcode(0),
@@ -84,11 +96,7 @@ curl_http_get_file::curl_http_get_file(
 		strncmp(inURL.c_str(),"http://",7) == 0 ||
 		strncmp(inURL.c_str(),"https://",8) == 0);
 	
-	#if IBM
-	m_thread = CreateThread(NULL,0,thread_proc,this,0,NULL);
-	#else
-	pthread_create(&m_thread, NULL, thread_proc, this);
-	#endif
+	start();
 
 }
 curl_http_get_file::curl_http_get_file(
@@ -100,10 +108,14 @@ curl_http_get_file::curl_http_get_file(
 	m_progress(-1),
 	m_status(in_progress),
 	m_halt(0),
+	m_curl(NULL),
+	m_headers(NULL),
 	m_url(inURL),
 	m_post(post_data ? *post_data : string()),
 	m_put(put_data ? *put_data : string()),
 	m_dest_buffer(outBuffer),
+	m_errcode(0),
+	m_last_dl_amount(0.0),
 	m_cert(inCert)
 {
 	UTL_http_encode_url(m_url);
@@ -113,25 +125,171 @@ curl_http_get_file::curl_http_get_file(
 		strncmp(inURL.c_str(),"http://",7) == 0 ||
 		strncmp(inURL.c_str(),"https://",8) == 0);
 	 
-	#if IBM
-	m_thread = CreateThread(NULL,0,thread_proc,this,0,NULL);
-	#else
-	pthread_create(&m_thread, NULL, thread_proc, this);
-	#endif
+	start();
 }
 
 				
+/*
+ * curl_http_service - the one download thread.  Requests are handed to it under its lock and added to the
+ * multi handle from the download thread itself, since a multi handle must only be used by one thread.
+ * Canceling works the same way: the request is queued for removal and the caller waits until it is gone.
+ *
+ * The service is never destroyed.  Requests can outlive main - e.g. the ones held by the global file cache - and
+ * their destructors still need the lock and the thread.  A function-local static would be torn down before them.
+ */
+class curl_http_service {
+public:
+
+	static	curl_http_service&	get(void)
+	{
+		static curl_http_service * the_service = new curl_http_service;
+		return *the_service;
+	}
+
+	void	add(curl_http_get_file * req)
+	{
+		{
+			lock_guard<mutex> guard(m_lock);
+			m_to_add.push_back(req);
+			m_active.insert(req);
+			if(!m_thread.joinable())
+				m_thread = std::thread(&curl_http_service::run, this);
+		}
+		wake();
+	}
+
+	// Blocks until the download thread let go of req - it is either done or canceled then.
+	void	remove(curl_http_get_file * req)
+	{
+		unique_lock<mutex> guard(m_lock);
+		auto pending = find(m_to_add.begin(), m_to_add.end(), req);
+		if(pending != m_to_add.end())
+		{
+			m_to_add.erase(pending);
+			m_active.erase(req);
+			return;
+		}
+		if(m_active.count(req))
+		{
+			m_to_remove.push_back(req);
+			wake();
+			while(m_active.count(req))
+				m_done.wait(guard);
+		}
+	}
+
+private:
+
+	curl_http_service()
+	{
+		m_multi = curl_multi_init();
+		curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) HTTP_MAX_HOST_CONNECTIONS);
+		curl_multi_setopt(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) HTTP_MAX_CONNECTIONS);
+#if LIBCURL_VERSION_NUM >= 0x072B00
+		curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);	// share connections on HTTP/2 servers
+#endif
+	}
+
+	void	run(void)
+	{
+		vector<curl_http_get_file *>	adds, removes;
+		while(true)
+		{
+			{
+				lock_guard<mutex> guard(m_lock);
+				adds.swap(m_to_add);
+				removes.swap(m_to_remove);
+			}
+
+			for(auto r : removes)
+			{
+				// The request may have finished meanwhile - then it's already out of the multi handle.
+				if(r->m_curl)
+				{
+					curl_multi_remove_handle(m_multi, r->m_curl);
+					r->finish(CURLE_OPERATION_TIMEDOUT);
+				}
+			}
+			for(auto a : adds)
+			{
+				a->setup_handle();
+				curl_multi_add_handle(m_multi, a->m_curl);
+			}
+			if(!removes.empty())
+			{
+				lock_guard<mutex> guard(m_lock);
+				for(auto r : removes)
+					m_active.erase(r);
+				m_done.notify_all();
+			}
+			adds.clear();
+			removes.clear();
+
+			int running, msgs_left;
+			curl_multi_perform(m_multi, &running);
+
+			CURLMsg * msg;
+			while((msg = curl_multi_info_read(m_multi, &msgs_left)) != NULL)
+			if(msg->msg == CURLMSG_DONE)
+			{
+				curl_http_get_file * req = NULL;
+				curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &req);
+				curl_multi_remove_handle(m_multi, msg->easy_handle);
+				req->finish(msg->data.result);
+
+				lock_guard<mutex> guard(m_lock);
+				m_active.erase(req);
+				m_to_remove.erase(std::remove(m_to_remove.begin(), m_to_remove.end(), req), m_to_remove.end());	// too late to cancel
+				m_done.notify_all();
+			}
+
+#if HTTP_HAS_WAKEUP
+			curl_multi_poll(m_multi, NULL, 0, HTTP_POLL_MS, NULL);
+#else
+			int numfds = 0;
+			curl_multi_wait(m_multi, NULL, 0, HTTP_POLL_MS, &numfds);
+			if(numfds == 0)
+			{
+				unique_lock<mutex> guard(m_lock);
+				m_wakeup.wait_for(guard, chrono::milliseconds(HTTP_POLL_MS),
+					[this] { return !m_to_add.empty() || !m_to_remove.empty(); });
+			}
+#endif
+		}
+	}
+
+	// Kicks the download thread out of its poll - safe to call from any thread, with or without m_lock.
+	void	wake(void)
+	{
+#if HTTP_HAS_WAKEUP
+		curl_multi_wakeup(m_multi);
+#else
+		m_wakeup.notify_one();
+#endif
+	}
+
+	CURLM *							m_multi;
+	std::thread						m_thread;
+	mutex							m_lock;			// guards everything below
+	condition_variable				m_done;
+#if !HTTP_HAS_WAKEUP
+	condition_variable				m_wakeup;
+#endif
+	vector<curl_http_get_file *>	m_to_add;
+	vector<curl_http_get_file *>	m_to_remove;
+	set<curl_http_get_file *>		m_active;		// handed to the service and not finished yet
+};
+
+void	curl_http_get_file::start(void)
+{
+	m_last_data_time = 0;			// the clock starts once curl gets to us, not while we wait for a connection
+	curl_http_service::get().add(this);
+}
+
 curl_http_get_file::~curl_http_get_file()
 {
 	atomic_store(&m_halt,1);
-
-	#if IBM
-	WaitForSingleObject(m_thread,INFINITE);
-	CloseHandle(m_thread);
-	#else
-	void * ret;
-	pthread_join(m_thread, &ret);
-	#endif
+	curl_http_service::get().remove(this);
 }
 	
 float		curl_http_get_file::get_progress(void)
@@ -212,6 +370,9 @@ int			curl_http_get_file::progress_cb(void* ptr, double TotalToDownload, double
 
 	time_t now = time(NULL);
 
+	if(me->m_last_data_time == 0)
+		me->m_last_data_time = now;
+
 	if(NowDownloaded > me->m_last_dl_amount)
 	{
 		me->m_last_dl_amount = NowDownloaded;
@@ -238,22 +399,15 @@ int			curl_http_get_file::progress_cb(void* ptr, double TotalToDownload, double
 	return 0;
 }
 
-#if IBM
-DWORD WINAPI
-#else
-void *
-#endif
-curl_http_get_file::thread_proc(void * param)
+// Runs on the download thread, right before the request joins the multi handle.
+void	curl_http_get_file::setup_handle(void)
 {
-	curl_http_get_file * me = (curl_http_get_file *) param;
-
-	struct  curl_slist * chunk = NULL;	
-
-	me->m_last_data_time = time(NULL);
-	
+	void * param = this;
 	CURL *	curl = curl_easy_init();
+	m_curl = curl;
 
-	curl_easy_setopt(curl, CURLOPT_URL, me->m_url.c_str());
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, param);
+	curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);	// Required because we do a redirect to protect against URL/Server changes breaking URLs
 
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
@@ -265,7 +419,6 @@ curl_http_get_file::thread_proc(void * param)
 	
 	curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");  // empty string is expanded into all methods supported by this version of curl.
 #if WED
-#include "WED_Version.h"
 	curl_easy_setopt(curl,  CURLOPT_USERAGENT, "WorldEditor/" WED_VERSION_STRING_SHORT );  // OSM tile server requires a referer string
 #endif
 #if DEV	
@@ -273,27 +426,35 @@ curl_http_get_file::thread_proc(void * param)
 #endif	
 //	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 0);
 	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 60.0);
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);			// rather wait for a connection we can share than open a new one
+#endif
 
-	if(!me->m_cert.empty())
-		curl_easy_setopt(curl, CURLOPT_CAINFO, me->m_cert.c_str());
+	if(!m_cert.empty())
+		curl_easy_setopt(curl, CURLOPT_CAINFO, m_cert.c_str());
 
 
-	if(!me->m_post.empty())
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, me->m_post.c_str());
+	if(!m_post.empty())
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, m_post.c_str());
 	
-	if(!me->m_put.empty())
+	if(!m_put.empty())
 	{
-		chunk = curl_slist_append(chunk, "Content-Type: application/json");
+		m_headers = curl_slist_append(m_headers, "Content-Type: application/json");
 		
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);	
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers);	
 		curl_easy_setopt(curl, CURLOPT_UPLOAD, 1);
 		curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_cb);
 		curl_easy_setopt(curl, CURLOPT_READDATA, param);
-		curl_easy_setopt(curl, CURLOPT_INFILESIZE, me->m_put.size());
+		curl_easy_setopt(curl, CURLOPT_INFILESIZE, m_put.size());
 	}
-	
-	CURLcode res = curl_easy_perform(curl);
-	
+}
+
+// Runs on the download thread once the transfer is over and out of the multi handle.
+void	curl_http_get_file::finish(int result)
+{
+	CURL * curl = m_curl;
+	CURLcode res = (CURLcode) result;
+
 	// A note on thread safety: we need to ensure that writes to memory of our error code or data go out BEFORE
 	// we flip the bit to say we are done.  So we use
 		
@@ -304,8 +465,8 @@ curl_http_get_file::thread_proc(void * param)
 
 	if(res != CURLE_OK)
 	{
-		me->m_errcode = res;
-		atomic_store(&me->m_status, done_error);
+		m_errcode = res;
+		atomic_store(&m_status, done_error);
 	}
 	else
 	{
@@ -316,44 +477,44 @@ curl_http_get_file::thread_proc(void * param)
 		{
 			DebugAssert(http_code != 0);
 			
-			me->m_errcode = http_code;
-			atomic_store(&me->m_status, done_error);
+			m_errcode = http_code;
+			atomic_store(&m_status, done_error);
 		}
 		else
 		{
-			if(me->m_dest_buffer)
+			if(m_dest_buffer)
 			{
-				me->m_dest_buffer->swap(me->m_dl_buffer);
-				atomic_store(&me->m_status, done_OK);
+				m_dest_buffer->swap(m_dl_buffer);
+				atomic_store(&m_status, done_OK);
 			}
 			else
 			{
-				FILE * fi = fopen(me->m_dest_path.c_str(),"wb");
+				FILE * fi = fopen(m_dest_path.c_str(),"wb");
 				if(fi == NULL)
 				{
-					me->m_errcode = errno;
+					m_errcode = errno;
 				} 
 				else
 				{
-					size_t ws = fwrite(&me->m_dl_buffer[0], 0, me->m_dl_buffer.size(), fi);
-					if(ws != me->m_dl_buffer.size())
+					size_t ws = fwrite(&m_dl_buffer[0], 0, m_dl_buffer.size(), fi);
+					if(ws != m_dl_buffer.size())
 					{
-						me->m_errcode = ferror(fi);
+						m_errcode = ferror(fi);
 					}
 					fclose(fi);
 				}
-				atomic_store(&me->m_status, me->m_errcode == 0 ? done_OK : done_error);
+				atomic_store(&m_status, m_errcode == 0 ? done_OK : done_error);
 			
 			}
 		}
 	}
 
 	/* always cleanup */ 
-	if(chunk)
-		curl_slist_free_all(chunk);
+	if(m_headers)
+		curl_slist_free_all(m_headers);
+	m_headers = NULL;
 	curl_easy_cleanup(curl);
-
-	return NULL;
+	m_curl = NULL;
 }
 
 bool	UTL_http_is_error_bad_net(int err)
@@ -8,9 +8,6 @@
 
 #if HAS_GATEWAY
 
-#if !IBM
-#include <pthread.h>
-#endif
 
 /*
  * curl_http_get_file
@@ -18,8 +15,10 @@
  * curl_http_get_file runs a single asynchronous HTTP request for one file.  It provides delivery
  * in memory or on disk, and can unzip a delivery to disk.  
  *
- * Operation is truly async - a worker thread is spawned, and the worker thread blocks on network
- * I/O; the worker is destroyed once the connection is completed.
+ * Operation is truly async - all requests are run by one shared download thread that drives a curl
+ * multi handle.  That way connections (and their TLS handshakes) are kept alive and reused between
+ * requests to the same host, and no more than HTTP_MAX_HOST_CONNECTIONS connections go to any one
+ * host - requests beyond that simply wait their turn.
  *
  * Asynchronous progress can be queried from any thread via get_status and get_progress; a request to
  * abort is made by deleting the file.  Note that deleting the file is a -blocking- operation until
@@ -77,22 +76,19 @@ private:
 		volatile	int			m_status;
 		volatile	int			m_halt;
 		volatile	int			m_errcode;
-		
-		#if IBM
-		HANDLE					m_thread;
-		#else
-		pthread_t				m_thread;
-		#endif
-		
+
+		friend class curl_http_service;
+
+		void *					m_curl;			// CURL easy handle, owned by the download thread
+		struct curl_slist *		m_headers;
+
+				void		start(void);
+				void		setup_handle(void);
+				void		finish(int res);
+
 		static	size_t		write_cb(void *contents, size_t size, size_t nmemb, void *userp);
 		static	size_t		read_cb(void *contents, size_t size, size_t nmemb, void *userp);
 		static	int			progress_cb(void* ptr, double TotalToDownload, double NowDownloaded, double TotalToUpload, double NowUploaded);
-
-		#if IBM
-		static	DWORD WINAPI	thread_proc(void * param);
-		#else
-		static	void *		thread_proc(void * param);
-		#endif
 	
 		vector<char>			m_dl_buffer;
 		vector<char>*			m_dest_buffer;
@@ -29,7 +29,9 @@
 using std::min;
 using std::max;
 
-ObjPointPool::ObjPointPool() : mDepth(8)
+#define MIN_INDEX_SLOTS 64
+
+ObjPointPool::ObjPointPool() : mIndexCount(0), mDepth(8)
 {
 }
 
@@ -41,6 +43,7 @@ void	ObjPointPool::clear(int depth)
 {
 	mData.clear();
 	mIndex.clear();
+	mIndexCount = 0;
 	mDepth = depth;
 }
 
@@ -48,13 +51,26 @@ void	ObjPointPool::resize(int pts)
 {
 	mData.resize(pts * mDepth);
 	mIndex.clear();
+	mIndexCount = 0;
+}
+
+void	ObjPointPool::assign(const float pts[], int count)
+{
+	mData.assign(pts, pts + count * mDepth);
+	mIndex.clear();
+	mIndexCount = 0;
+	for (int n = 0; n < count; ++n)
+		index_pt(n);
 }
 
 int		ObjPointPool::accumulate(const float pt[])
 {
-	index_type::iterator iter = mIndex.find(key_type(pt, pt + mDepth));
-	if (iter != mIndex.end())
-		return iter->second;
+	if (!mIndex.empty())
+	{
+		int slot = find_slot(pt);
+		if (mIndex[slot] >= 0)
+			return mIndex[slot];
+	}
 	return append(pt);
 }
 
@@ -62,14 +78,79 @@ int		ObjPointPool::append(const float pt[])
 {
 	int ret = mData.size() / mDepth;
 	mData.insert(mData.end(), pt, pt + mDepth);
-	mIndex.insert(index_type::value_type(key_type(pt,pt+mDepth), ret));
+	index_pt(ret);
 	return ret;
 }
 
 void	ObjPointPool::set(int n, float pt[])
 {
 	memcpy(&mData[n*mDepth], pt, mDepth * sizeof(float));
-	mIndex.insert(index_type::value_type(key_type(pt,pt+mDepth), n));
+	index_pt(n);
+}
+
+// Murmur3-style mixing of the bits of the floats.  The mixing matters: typical coordinates differ in their
+// high (exponent/mantissa) bits only, and we index the table with the low bits of the hash.
+unsigned int	ObjPointPool::hash_pt(const float pt[]) const
+{
+	unsigned int h = 0;
+	for (int i = 0; i < mDepth; ++i)
+	{
+		unsigned int k;
+		memcpy(&k, pt + i, sizeof(k));
+		k *= 0xcc9e2d51u;
+		k = (k << 15) | (k >> 17);
+		k *= 0x1b873593u;
+		h ^= k;
+		h = (h << 13) | (h >> 19);
+		h = h * 5 + 0xe6546b64u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+int		ObjPointPool::find_slot(const float pt[]) const
+{
+	unsigned int mask = mIndex.size() - 1;
+	unsigned int slot = hash_pt(pt) & mask;
+	while (mIndex[slot] >= 0 && memcmp(&mData[mIndex[slot] * mDepth], pt, mDepth * sizeof(float)) != 0)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+void	ObjPointPool::index_pt(int n)
+{
+	if (2 * (mIndexCount + 1) > (int) mIndex.size())
+		rehash(max(MIN_INDEX_SLOTS, (int) mIndex.size() * 2));
+
+	int slot = find_slot(&mData[n * mDepth]);
+	if (mIndex[slot] < 0)
+	{
+		mIndex[slot] = n;
+		++mIndexCount;
+	}
+}
+
+void	ObjPointPool::rehash(int slots)
+{
+	vector<int> old;
+	old.swap(mIndex);
+	mIndex.assign(slots, -1);
+	mIndexCount = 0;
+	for (vector<int>::iterator i = old.begin(); i != old.end(); ++i)
+	if (*i >= 0)
+	{
+		// set() can overwrite a point with the same data as another one - the two entries collapse into one then.
+		int slot = find_slot(&mData[*i * mDepth]);
+		if (mIndex[slot] < 0)
+		{
+			mIndex[slot] = *i;
+			++mIndexCount;
+		}
+	}
 }
 
 int		ObjPointPool::count(void) const
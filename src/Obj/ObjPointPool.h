@@ -25,19 +25,18 @@
 
 #include <vector>
 #include <map>
-#include <functional>
 
 using std::map;
 using std::vector;
-using std::binary_function;
 
-template <class T>
-struct lex_compare_vector : public binary_function<vector<T>, vector<T>, bool> {
+/*
+	ObjPointPool - a vertex pool that can share identical vertices.
 
-	bool operator()(const vector<T>& lhs, const vector<T>& rhs) const {
-		return lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
-	}
-};
+	accumulate() looks a point up in an open-addressing hash table that holds nothing but point indices - the
+	key is the bit pattern of the point's floats in mData, so no key copies are made.  The first index stored
+	for a given point wins, just like when this was a map<vector<float>, int>.  Note that matching by bits means
+	0.0 and -0.0 are different points.
+*/
 
 class ObjPointPool {
 public:
@@ -46,6 +45,7 @@ public:
 
 	void	clear(int depth);	// Set zero points and number of floats per pt
 	void	resize(int pts);	// Set a lot of pts
+	void	assign(const float pts[], int count);	// Replace all pts, same as resize + set on each
 
 	int		accumulate(const float pt[]);	// Add a pt, extend if needed
 	int		append(const float pt[]);		// Add a pt to the end
@@ -59,11 +59,14 @@ public:
 
 private:
 
-	typedef	vector<float>									key_type;
-	typedef map<key_type, int, lex_compare_vector<float> >	index_type;
+	unsigned int	hash_pt(const float pt[]) const;
+	int				find_slot(const float pt[]) const;	// slot holding pt, or the empty slot where it belongs
+	void			index_pt(int n);					// first wins - does nothing if the point is indexed already
+	void			rehash(int slots);
 
 	vector<float>	mData;
-	index_type		mIndex;
+	vector<int>		mIndex;			// point indices, -1 = empty slot.  Size is 0 or a power of 2.
+	int				mIndexCount;
 	int				mDepth;
 
 };
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ObjPointPool.h"
+#include "AssertUtils.h"
+
+/*
+	The pool used to be a map<vector<float>, int> keyed by copies of the points - RefPointPool below is that
+	pool, kept as the reference the hashed index has to agree with.  The timings live in OneOffs/pointpool_bench.
+*/
+
+struct lex_less_floats {
+	bool operator()(const vector<float>& lhs, const vector<float>& rhs) const {
+		return lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+};
+
+class RefPointPool {
+public:
+	RefPointPool(int depth) : mDepth(depth) { }
+
+	int		accumulate(const float pt[])
+	{
+		map<vector<float>, int, lex_less_floats>::iterator i = mIndex.find(vector<float>(pt, pt + mDepth));
+		if (i != mIndex.end())
+			return i->second;
+		return append(pt);
+	}
+
+	int		append(const float pt[])
+	{
+		int ret = mData.size() / mDepth;
+		mData.insert(mData.end(), pt, pt + mDepth);
+		mIndex.insert(make_pair(vector<float>(pt, pt + mDepth), ret));
+		return ret;
+	}
+
+private:
+	vector<float>								mData;
+	map<vector<float>, int, lex_less_floats>	mIndex;
+	int											mDepth;
+};
+
+// splitmix64 - every input gives a different output, and nothing repeats the way a small modulus does.
+static unsigned long long	mix64(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// Points of a typical OBJ vertex - xyz, normal, st - picked from 'distinct' different ones, so a lot of them repeat.
+// Each coordinate is 24 random bits, which a float holds exactly.  Returns how many different points were picked.
+static int	make_points(vector<float>& pts, int count, int distinct, int depth)
+{
+	pts.resize(count * depth);
+	set<unsigned long long>	picked;
+	for (int n = 0; n < count; ++n)
+	{
+		unsigned long long which = mix64(n) % distinct;
+		picked.insert(which);
+		for (int d = 0; d < depth; ++d)
+			pts[n * depth + d] = (float) (mix64((1ULL << 63) | (which << 8) | d) >> 40) / 4096.0f - 2048.0f;
+	}
+	return picked.size();
+}
+
+static void	TEST_PoolMatchesReference(int count, int distinct)
+{
+	const int depth = 8;
+	vector<float> pts;
+	int picked = make_points(pts, count, distinct, depth);
+
+	vector<int>	ref_idx(count), idx(count);
+	RefPointPool ref(depth);
+	for (int n = 0; n < count; ++n)
+		ref_idx[n] = ref.accumulate(&pts[n * depth]);
+
+	ObjPointPool pool;
+	pool.clear(depth);
+	for (int n = 0; n < count; ++n)
+		idx[n] = pool.accumulate(&pts[n * depth]);
+
+	TEST_Run(idx == ref_idx);
+	TEST_Run(pool.count() == picked);
+}
+
+void	TEST_ObjPointPool(void)
+{
+	// Basics: sharing, first index wins, set() and assign() keep the index current.
+	ObjPointPool pool;
+	pool.clear(3);
+	float a[3] = { 1, 2, 3 }, b[3] = { 4, 5, 6 }, c[3] = { 7, 8, 9 };
+	TEST_Run(pool.accumulate(a) == 0);
+	TEST_Run(pool.accumulate(b) == 1);
+	TEST_Run(pool.accumulate(a) == 0);
+	TEST_Run(pool.append(a) == 2);
+	TEST_Run(pool.accumulate(a) == 0);
+	TEST_Run(pool.count() == 3);
+
+	pool.set(1, c);
+	TEST_Run(pool.accumulate(c) == 1);
+	TEST_Run(pool.get(1)[2] == 9);
+
+	float abc[9] = { 1, 2, 3, 4, 5, 6, 1, 2, 3 };
+	pool.assign(abc, 3);
+	TEST_Run(pool.count() == 3);
+	TEST_Run(pool.accumulate(b) == 1);
+	TEST_Run(pool.accumulate(a) == 0);
+	TEST_Run(pool.accumulate(c) == 3);
+
+	// Same indices as the old map-based pool, with sparse and heavily shared points.
+	TEST_PoolMatchesReference(50000, 40000);
+	TEST_PoolMatchesReference(50000, 500);
+}
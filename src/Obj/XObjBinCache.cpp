@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XObjBinCache.h"
+#include "XObjReadWrite.h"
+#include "FileUtils.h"
+#include "PlatformUtils.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <time.h>
+
+#define XOBJ_CACHE_FORMAT	1
+#define XOBJ_CACHE_MAGIC	0x38424F58		// "XOB8"
+#define XOBJ_CACHE_EXT		".xobj8"
+#define XOBJ_CACHE_TMP_AGE	(24 * 60 * 60)	// seconds until XObjBinCache_Init treats a temp file as left over
+
+static string				sCacheFolder;
+
+/************************************************************************************************************************
+ * SERIALIZATION
+ ************************************************************************************************************************/
+
+struct xobj_cache_writer {
+	vector<char>	buf;
+
+	void	put(const void * p, int len)	{ buf.insert(buf.end(), (const char *) p, (const char *) p + len); }
+	void	put_int(int v)					{ put(&v, sizeof(v)); }
+	void	put_flt(float v)				{ put(&v, sizeof(v)); }
+	void	put_str(const string& s)		{ put_int(s.size()); put(s.data(), s.size()); }
+
+	// Only for plain structs - no strings or vectors inside!
+	template <typename T>
+	void	put_vec(const vector<T>& v)		{ put_int(v.size()); if(!v.empty()) put(&v[0], v.size() * sizeof(T)); }
+
+	void	put_pool(const ObjPointPool& p, int depth)
+	{
+		put_int(p.count());
+		if(p.count())
+			put(p.get(0), p.count() * depth * sizeof(float));
+	}
+};
+
+// Reading past the end never crashes - it hands out zeros and fails the whole read.
+struct xobj_cache_reader {
+	const char *	p;
+	const char *	e;
+	bool			ok;
+
+	xobj_cache_reader(const char * b, const char * end) : p(b), e(end), ok(true) { }
+
+	const char *	take(int len)
+	{
+		if(!ok || len < 0 || e - p < len) { ok = false; return NULL; }
+		const char * r = p;
+		p += len;
+		return r;
+	}
+	void	get(void * d, int len)		{ const char * s = take(len); if(s) memcpy(d, s, len); else memset(d, 0, len); }
+	int		get_int(void)				{ int v;   get(&v, sizeof(v)); return v; }
+	float	get_flt(void)				{ float v; get(&v, sizeof(v)); return v; }
+	void	get_str(string& s)			{ int n = get_int(); const char * c = take(n); if(c) s.assign(c, n); else s.clear(); }
+
+	template <typename T>
+	void	get_vec(vector<T>& v)
+	{
+		int n = get_int();
+		if(n < 0 || (e - p) / (long long) sizeof(T) < n) { ok = false; v.clear(); return; }
+		v.resize(n);
+		if(n) get(&v[0], n * sizeof(T));
+	}
+
+	void	get_pool(ObjPointPool& pool, int depth)
+	{
+		pool.clear(depth);
+		int n = get_int();
+		const char * pts = (n >= 0 && n <= (e - p) / (long long) (depth * sizeof(float))) ? take(n * depth * sizeof(float)) : NULL;
+		if(pts == NULL) { ok = false; return; }
+		// The image has no alignment guarantees, so go through a copy.
+		vector<float> tmp(n * depth);
+		if(n) memcpy(&tmp[0], pts, n * depth * sizeof(float));
+		pool.assign(n ? &tmp[0] : NULL, n);
+	}
+};
+
+static void	cache_write_obj(xobj_cache_writer& w, const XObj8& obj)
+{
+	w.put_str(obj.texture);
+	w.put_str(obj.texture_normal_map);
+	w.put_str(obj.texture_lit);
+	w.put_str(obj.texture_draped);
+	w.put_int(obj.use_metalness);
+	w.put_int(obj.glass_blending);
+	w.put_str(obj.particle_system);
+	w.put_vec(obj.regions);
+	w.put_vec(obj.indices);
+	w.put_pool(obj.geo_tri, 8);
+	w.put_pool(obj.geo_lines, 6);
+	w.put_pool(obj.geo_lights, 6);
+
+	w.put_int(obj.animation.size());
+	for(vector<XObjAnim8>::const_iterator a = obj.animation.begin(); a != obj.animation.end(); ++a)
+	{
+		w.put_int(a->cmd);
+		w.put_str(a->dataref);
+		w.put(a->axis, sizeof(a->axis));
+		w.put_flt(a->loop);
+		w.put_vec(a->keyframes);
+	}
+
+	w.put_int(obj.manips.size());
+	for(vector<XObjManip8>::const_iterator m = obj.manips.begin(); m != obj.manips.end(); ++m)
+	{
+		w.put_str(m->dataref1);
+		w.put_str(m->dataref2);
+		w.put(m->centroid, sizeof(m->centroid));
+		w.put(m->axis, sizeof(m->axis));
+		w.put_flt(m->angle_min);
+		w.put_flt(m->angle_max);
+		w.put_flt(m->lift);
+		w.put_flt(m->v1_min);
+		w.put_flt(m->v1_max);
+		w.put_flt(m->v2_min);
+		w.put_flt(m->v2_max);
+		w.put_str(m->cursor);
+		w.put_str(m->tooltip);
+		w.put_flt(m->mouse_wheel_delta);
+		w.put_vec(m->rotation_key_frames);
+		w.put_vec(m->detents);
+	}
+
+	w.put_int(obj.emitters.size());
+	for(vector<XObjEmitter8>::const_iterator e = obj.emitters.begin(); e != obj.emitters.end(); ++e)
+	{
+		w.put_str(e->name);
+		w.put_str(e->dataref);
+		w.put_flt(e->x);	w.put_flt(e->y);	w.put_flt(e->z);
+		w.put_flt(e->psi);	w.put_flt(e->the);	w.put_flt(e->phi);
+		w.put_flt(e->v_min);
+		w.put_flt(e->v_max);
+	}
+
+	w.put_int(obj.lods.size());
+	for(vector<XObjLOD8>::const_iterator l = obj.lods.begin(); l != obj.lods.end(); ++l)
+	{
+		w.put_flt(l->lod_near);
+		w.put_flt(l->lod_far);
+		w.put_int(l->cmds.size());
+		for(vector<XObjCmd8>::const_iterator c = l->cmds.begin(); c != l->cmds.end(); ++c)
+		{
+			w.put_int(c->cmd);
+			w.put(c->params, sizeof(c->params));
+			w.put_str(c->name);
+			w.put_int(c->idx_offset);
+			w.put_int(c->idx_count);
+		}
+	}
+
+	w.put(obj.xyz_min, sizeof(obj.xyz_min));
+	w.put(obj.xyz_max, sizeof(obj.xyz_max));
+	w.put_flt(obj.fixed_heading);
+}
+
+// Counts come from the image, so they are checked against what is left of it before anything is allocated.
+static bool	cache_count_ok(xobj_cache_reader& r, int n)
+{
+	if(n < 0 || n > r.e - r.p)
+		r.ok = false;
+	return r.ok;
+}
+
+static bool	cache_read_obj(xobj_cache_reader& r, XObj8& obj)
+{
+	r.get_str(obj.texture);
+	r.get_str(obj.texture_normal_map);
+	r.get_str(obj.texture_lit);
+	r.get_str(obj.texture_draped);
+	obj.use_metalness = r.get_int();
+	obj.glass_blending = r.get_int();
+	r.get_str(obj.particle_system);
+	r.get_vec(obj.regions);
+	r.get_vec(obj.indices);
+	r.get_pool(obj.geo_tri, 8);
+	r.get_pool(obj.geo_lines, 6);
+	r.get_pool(obj.geo_lights, 6);
+
+	int n = r.get_int();
+	if(!cache_count_ok(r, n)) return false;
+	obj.animation.resize(n);
+	for(vector<XObjAnim8>::iterator a = obj.animation.begin(); a != obj.animation.end(); ++a)
+	{
+		a->cmd = r.get_int();
+		r.get_str(a->dataref);
+		r.get(a->axis, sizeof(a->axis));
+		a->loop = r.get_flt();
+		r.get_vec(a->keyframes);
+	}
+
+	n = r.get_int();
+	if(!cache_count_ok(r, n)) return false;
+	obj.manips.resize(n);
+	for(vector<XObjManip8>::iterator m = obj.manips.begin(); m != obj.manips.end(); ++m)
+	{
+		r.get_str(m->dataref1);
+		r.get_str(m->dataref2);
+		r.get(m->centroid, sizeof(m->centroid));
+		r.get(m->axis, sizeof(m->axis));
+		m->angle_min = r.get_flt();
+		m->angle_max = r.get_flt();
+		m->lift = r.get_flt();
+		m->v1_min = r.get_flt();
+		m->v1_max = r.get_flt();
+		m->v2_min = r.get_flt();
+		m->v2_max = r.get_flt();
+		r.get_str(m->cursor);
+		r.get_str(m->tooltip);
+		m->mouse_wheel_delta = r.get_flt();
+		r.get_vec(m->rotation_key_frames);
+		r.get_vec(m->detents);
+	}
+
+	n = r.get_int();
+	if(!cache_count_ok(r, n)) return false;
+	obj.emitters.resize(n);
+	for(vector<XObjEmitter8>::iterator e = obj.emitters.begin(); e != obj.emitters.end(); ++e)
+	{
+		r.get_str(e->name);
+		r.get_str(e->dataref);
+		e->x = r.get_flt();		e->y = r.get_flt();		e->z = r.get_flt();
+		e->psi = r.get_flt();	e->the = r.get_flt();	e->phi = r.get_flt();
+		e->v_min = r.get_flt();
+		e->v_max = r.get_flt();
+	}
+
+	n = r.get_int();
+	if(!cache_count_ok(r, n)) return false;
+	obj.lods.resize(n);
+	for(vector<XObjLOD8>::iterator l = obj.lods.begin(); l != obj.lods.end(); ++l)
+	{
+		l->lod_near = r.get_flt();
+		l->lod_far = r.get_flt();
+		n = r.get_int();
+		if(!cache_count_ok(r, n)) return false;
+		l->cmds.resize(n);
+		for(vector<XObjCmd8>::iterator c = l->cmds.begin(); c != l->cmds.end(); ++c)
+		{
+			c->cmd = r.get_int();
+			r.get(c->params, sizeof(c->params));
+			r.get_str(c->name);
+			c->idx_offset = r.get_int();
+			c->idx_count = r.get_int();
+		}
+	}
+
+	r.get(obj.xyz_min, sizeof(obj.xyz_min));
+	r.get(obj.xyz_max, sizeof(obj.xyz_max));
+	obj.fixed_heading = r.get_flt();
+	return r.ok;
+}
+
+/************************************************************************************************************************
+ * CACHE FILES
+ ************************************************************************************************************************/
+
+// FNV-1a style, but eight bytes at a time with a murmur finalizer on each word - hashing byte by byte
+// would cost a good part of what the cache saves.
+static unsigned long long	hash_text(const char * p, int len)
+{
+	unsigned long long h = 14695981039346656037ULL ^ len;
+	int n = 0;
+	for(; n + 8 <= len; n += 8)
+	{
+		unsigned long long k;
+		memcpy(&k, p + n, sizeof(k));
+		k ^= k >> 33;
+		k *= 0xff51afd7ed558ccdULL;
+		k ^= k >> 33;
+		h = (h ^ k) * 1099511628211ULL;
+	}
+	for(; n < len; ++n)
+		h = (h ^ (unsigned char) p[n]) * 1099511628211ULL;
+	return h;
+}
+
+static bool	read_whole_file(const string& path, vector<char>& out)
+{
+	FILE * fi = fopen(path.c_str(), "rb");
+	if(fi == NULL) return false;
+	fseek(fi, 0L, SEEK_END);
+	long len = ftell(fi);
+	fseek(fi, 0L, SEEK_SET);
+	bool ok = len >= 0;
+	if(ok)
+	{
+		out.resize(len);
+		ok = len == 0 || fread(&out[0], 1, len, fi) == len;
+	}
+	fclose(fi);
+	return ok;
+}
+
+static bool	load_cache_entry(const string& path, unsigned long long hash, int text_len, XObj8& outObj)
+{
+	vector<char>	image;
+	if(!read_whole_file(path, image) || image.empty())
+		return false;
+
+	xobj_cache_reader r(&image[0], &image[0] + image.size());
+	int magic = r.get_int();
+	int format = r.get_int();
+	int len = r.get_int();
+	unsigned long long h;
+	r.get(&h, sizeof(h));
+
+	if(!r.ok || magic != XOBJ_CACHE_MAGIC || format != XOBJ_CACHE_FORMAT || len != text_len || h != hash)
+		return false;
+
+	return cache_read_obj(r, outObj) && r.p == r.e;
+}
+
+static void	save_cache_entry(const string& path, unsigned long long hash, int text_len, const XObj8& obj)
+{
+	xobj_cache_writer w;
+	w.put_int(XOBJ_CACHE_MAGIC);
+	w.put_int(XOBJ_CACHE_FORMAT);
+	w.put_int(text_len);
+	w.put(&hash, sizeof(hash));
+	cache_write_obj(w, obj);
+
+	string tmp_path;
+	FILE * fo = FILE_create_temp_beside(path, tmp_path);
+	if(fo == NULL) return;
+	bool ok = fwrite(&w.buf[0], 1, w.buf.size(), fo) == w.buf.size();
+	ok = fclose(fo) == 0 && ok;
+
+	// If someone else got the same OBJ in first, theirs is just as good as ours.
+	if(!ok || FILE_rename_file(tmp_path.c_str(), path.c_str()) != 0)
+		FILE_delete_file(tmp_path.c_str(), false);
+}
+
+void	XObjBinCache_Init(const string& folder, int max_mb)
+{
+	sCacheFolder.clear();
+	if(folder.empty() || FILE_make_dir_exist(folder.c_str()) != 0)
+		return;
+	sCacheFolder = folder;
+
+	vector<string>	files;
+	if(FILE_get_directory(folder, &files, NULL) <= 0)
+		return;
+
+	// Other programs sharing the folder may be writing temp files right now - only old ones are orphans.
+	time_t	stale_tmp = time(NULL) - XOBJ_CACHE_TMP_AGE;
+
+	vector<pair<time_t, string> >	entries;
+	long long						total = 0;
+	for(vector<string>::iterator f = files.begin(); f != files.end(); ++f)
+	{
+		string path = folder + DIR_STR + *f;
+		struct stat info;
+		if(FILE_get_file_meta_data(path, info) != 0)
+			continue;
+		// Temp files left over from a crash are never going to be renamed.
+		if(f->size() > 4 && f->compare(f->size() - 4, 4, ".tmp") == 0)
+		{
+			if(info.st_mtime < stale_tmp)
+				FILE_delete_file(path.c_str(), false);
+		}
+		else
+		{
+			entries.push_back(make_pair(info.st_mtime, path));
+			total += info.st_size;
+		}
+	}
+
+	// Oldest first, until we are back at 3/4 of the limit, so we don't trim on every start.
+	long long limit = (long long) max_mb * 1024 * 1024;
+	if(total > limit)
+	{
+		sort(entries.begin(), entries.end());
+		for(vector<pair<time_t, string> >::iterator e = entries.begin(); e != entries.end() && total > limit / 4 * 3; ++e)
+		{
+			struct stat info;
+			if(FILE_get_file_meta_data(e->second, info) == 0 && FILE_delete_file(e->second.c_str(), false) == 0)
+				total -= info.st_size;
+		}
+	}
+}
+
+bool	XObj8ReadCached(const char * inFile, XObj8& outObj)
+{
+	if(sCacheFolder.empty())
+		return XObj8Read(inFile, outObj);
+
+	vector<char>	text;
+	if(!read_whole_file(inFile, text))
+		return false;
+	if(text.empty())
+		return false;
+
+	unsigned long long hash = hash_text(&text[0], text.size());
+	char name[48];
+	snprintf(name, sizeof(name), "%016llx_%x" XOBJ_CACHE_EXT, hash, (unsigned int) text.size());
+	string path = sCacheFolder + DIR_STR + name;
+
+	if(load_cache_entry(path, hash, text.size(), outObj))
+		return true;
+	outObj = XObj8();		// a stale or broken entry may have left half an object behind
+
+	if(!XObj8ReadMem(&text[0], text.size(), outObj))
+		return false;
+
+	save_cache_entry(path, hash, text.size(), outObj);
+	return true;
+}
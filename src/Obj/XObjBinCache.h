@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XObjBinCache_H
+#define XObjBinCache_H
+
+/*
+
+	XObjBinCache - THEORY OF OPERATION
+
+	Opening a big airport parses thousands of OBJ8 text files, and the same ones again every time.
+	XObj8ReadCached keeps the parsed XObj8 of every OBJ it reads in a cache folder, as a flat binary
+	image that is read back with one fread and a few memcpys.
+
+	Cache entries are named after a 64 bit hash and the size of the OBJ's text, so an edited OBJ simply
+	misses the cache, no matter what its time stamp says, and identical OBJs in different packages share
+	one entry.  The parsed XObj8 only names its textures, so texture edits do not affect the cache.
+
+	The images are raw native-endian dumps and are only meant for the machine that wrote them.  They are
+	not laid out to be mapped and used in place - strings and arrays are length-prefixed and get copied
+	out into a regular XObj8.  Bump XOBJ_CACHE_FORMAT in the .cpp whenever XObj8 or what XObj8Read
+	produces changes.
+
+	Entries are written to an exclusively created temp file, named after the process, and renamed into
+	place, so several threads (or programs) may read and fill the cache at once.  XObjBinCache_Init trims
+	the oldest entries once the folder gets too big, and removes temp files that are a day old - younger
+	ones may still belong to another program.
+
+*/
+
+#include "XObjDefs.h"
+
+// Sets up the cache in the given folder, creating it if needed.  Without a call to this, or with
+// an empty folder name, XObj8ReadCached just calls XObj8Read.
+void	XObjBinCache_Init(const string& folder, int max_mb);
+
+// Same as XObj8Read, but served from the cache whenever the OBJ has been parsed before.
+bool	XObj8ReadCached(const char * inFile, XObj8& outObj);
+
+#endif /* XObjBinCache_H */
@@ -129,24 +129,38 @@ inline xflt TXT_MAP_flt_scan(xbyt*& c,const xbyt* c_max, bool go_next_line)
 		TXT_MAP_space(c) ||
 		(go_next_line && TXT_MAP_eoln(c))))	++c;
 
-	xflt ret_val	=0;
-	xint decimals	=0;
-	xint negative	=xfals;
-	xint has_decimal=xfals;
+	// Digits are gathered in an integer and scaled once at the end - no pow() per number, no rounding
+	// error piling up in a float, and no locale dependency like atof/strtod would bring.
+	static const double k_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+									  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+	static const xint	k_pow10_count = sizeof(k_pow10) / sizeof(k_pow10[0]);
+
+	long long	mantissa	=0;
+	xint		decimals	=0;
+	xint		dropped		=0;
+	xint		negative	=xfals;
+	xint		has_decimal	=xfals;
 
 	while(c<c_max && !TXT_MAP_space(c) && !TXT_MAP_eoln(c))
 	{
 			 if(*c=='-')negative	=xtrue;
 		else if(*c=='+')negative	=xfals;
 		else if(*c=='.')has_decimal	=xtrue;
-		else
+		else if(mantissa < 100000000000000000LL)		// 17 digits is all a double can hold anyway
 		{
-			ret_val=(10*ret_val)+*c-'0';
+			mantissa=(10*mantissa)+*c-'0';
 			if(has_decimal)decimals++;
 		}
+		else if(!has_decimal)
+			dropped++;
 		++c;
 	}
-	return ret_val/pow((xflt)10,(xflt)decimals)*((negative)?-1.0:1.0);
+	double ret_val = mantissa;
+	if(dropped)
+		ret_val *= pow(10.0, dropped);
+	if(decimals)
+		ret_val /= decimals < k_pow10_count ? k_pow10[decimals] : pow(10.0, decimals);
+	return negative ? -ret_val : ret_val;
 }
 
 inline xint TXT_MAP_int_scan(xbyt*& c,const xbyt* c_max, bool go_next_line)
@@ -522,26 +536,230 @@ bool	XObjWrite(const char * inFile, const XObj& inObj)
 }
 
 /****************************************************************************************
- * OBJ 8 READ
+ * OBJ 8 KEYWORDS
  ****************************************************************************************/
-bool	XObj8Read(const char * inFile, XObj8& outObj)
+
+// Every command XObj8Read handles itself has an ID.  The first word of each line is looked up once in
+// a small open-addressing hash table, rather than being compared against each keyword in turn.
+// eol_ok is true for commands that take no arguments and may thus be followed by the end of the line.
+enum obj8_keyword {
+	kw_none = 0,
+	kw_TEXTURE,
+	kw_TEXTURE_LIT,
+	kw_TEXTURE_NORMAL,
+	kw_TEXTURE_DRAPED,
+	kw_POINT_COUNTS,
+	kw_VT,
+	kw_VLINE,
+	kw_VLIGHT,
+	kw_IDX,
+	kw_IDX10,
+	kw_TRIS,
+	kw_LINES,
+	kw_LIGHTS,
+	kw_ATTR_LOD,
+	kw_ANIM_rotate,
+	kw_ANIM_trans,
+	kw_ANIM_begin,
+	kw_ANIM_end,
+	kw_LIGHT_CUSTOM,
+	kw_LIGHT_NAMED,
+	kw_LIGHT_PARAM,
+	kw_ATTR_layer_group,
+	kw_ATTR_hard,
+	kw_ATTR_hard_deck,
+	kw_ATTR_no_blend,
+	kw_ANIM_hide,
+	kw_ANIM_show,
+	kw_ANIM_rotate_begin,
+	kw_ANIM_trans_begin,
+	kw_ANIM_rotate_key,
+	kw_ANIM_trans_key,
+	kw_ANIM_rotate_end,
+	kw_ANIM_trans_end,
+	kw_ANIM_keyframe_loop,
+	kw_COCKPIT_REGION,
+	kw_ATTR_manip_none,
+	kw_ATTR_manip_drag_xy,
+	kw_ATTR_manip_drag_axis,
+	kw_ATTR_manip_command,
+	kw_ATTR_manip_command_axis,
+	kw_ATTR_manip_noop,
+	kw_ATTR_light_level,
+	kw_ATTR_manip_push,
+	kw_ATTR_manip_radio,
+	kw_ATTR_manip_toggle,
+	kw_ATTR_manip_delta,
+	kw_ATTR_manip_wrap,
+	kw_ATTR_manip_wheel,
+	kw_ATTR_manip_drag_axis_pix,
+	kw_ATTR_manip_command_knob,
+	kw_ATTR_manip_command_switch_up_down,
+	kw_ATTR_manip_command_switch_left_right,
+	kw_ATTR_manip_axis_knob,
+	kw_ATTR_manip_axis_switch_up_down,
+	kw_ATTR_manip_axis_switch_left_right,
+	kw_PARTICLE_SYSTEM,
+	kw_EMITTER,
+	kw_ATTR_cockpit_device,
+	kw_NORMAL_METALNESS,
+	kw_BLEND_GLASS,
+	kw_ATTR_axis_detented,
+	kw_ATTR_manip_drag_rotate,
+	kw_ATTR_manip_keyframe,
+	kw_ATTR_axis_detent_range,
+	kw_ATTR_manip_command_switch_left_right2,
+	kw_ATTR_manip_command_switch_up_down2,
+	kw_ATTR_manip_command_knob2,
+	kw_MAGNET,
+	kw_fixed_heading,
+	kw_count
+};
+
+struct obj8_keyword_info {
+	const char *	name;
+	obj8_keyword	kw;
+	bool			eol_ok;
+};
+
+static const obj8_keyword_info k_obj8_keywords[] = {
+	{ "TEXTURE",                                 kw_TEXTURE,                                 false },
+	{ "TEXTURE_LIT",                             kw_TEXTURE_LIT,                             false },
+	{ "TEXTURE_NORMAL",                          kw_TEXTURE_NORMAL,                          false },
+	{ "TEXTURE_DRAPED",                          kw_TEXTURE_DRAPED,                          false },
+	{ "POINT_COUNTS",                            kw_POINT_COUNTS,                            false },
+	{ "VT",                                      kw_VT,                                      false },
+	{ "VLINE",                                   kw_VLINE,                                   false },
+	{ "VLIGHT",                                  kw_VLIGHT,                                  false },
+	{ "IDX",                                     kw_IDX,                                     false },
+	{ "IDX10",                                   kw_IDX10,                                   false },
+	{ "TRIS",                                    kw_TRIS,                                    false },
+	{ "LINES",                                   kw_LINES,                                   false },
+	{ "LIGHTS",                                  kw_LIGHTS,                                  false },
+	{ "ATTR_LOD",                                kw_ATTR_LOD,                                true },
+	{ "ANIM_rotate",                             kw_ANIM_rotate,                             false },
+	{ "ANIM_trans",                              kw_ANIM_trans,                              false },
+	{ "ANIM_begin",                              kw_ANIM_begin,                              false },
+	{ "ANIM_end",                                kw_ANIM_end,                                false },
+	{ "LIGHT_CUSTOM",                            kw_LIGHT_CUSTOM,                            false },
+	{ "LIGHT_NAMED",                             kw_LIGHT_NAMED,                             false },
+	{ "LIGHT_PARAM",                             kw_LIGHT_PARAM,                             false },
+	{ "ATTR_layer_group",                        kw_ATTR_layer_group,                        false },
+	{ "ATTR_hard",                               kw_ATTR_hard,                               true },
+	{ "ATTR_hard_deck",                          kw_ATTR_hard_deck,                          true },
+	{ "ATTR_no_blend",                           kw_ATTR_no_blend,                           true },
+	{ "ANIM_hide",                               kw_ANIM_hide,                               false },
+	{ "ANIM_show",                               kw_ANIM_show,                               false },
+	{ "ANIM_rotate_begin",                       kw_ANIM_rotate_begin,                       false },
+	{ "ANIM_trans_begin",                        kw_ANIM_trans_begin,                        false },
+	{ "ANIM_rotate_key",                         kw_ANIM_rotate_key,                         false },
+	{ "ANIM_trans_key",                          kw_ANIM_trans_key,                          false },
+	{ "ANIM_rotate_end",                         kw_ANIM_rotate_end,                         true },
+	{ "ANIM_trans_end",                          kw_ANIM_trans_end,                          true },
+	{ "ANIM_keyframe_loop",                      kw_ANIM_keyframe_loop,                      false },
+	{ "COCKPIT_REGION",                          kw_COCKPIT_REGION,                          false },
+	{ "ATTR_manip_none",                         kw_ATTR_manip_none,                         true },
+	{ "ATTR_manip_drag_xy",                      kw_ATTR_manip_drag_xy,                      false },
+	{ "ATTR_manip_drag_axis",                    kw_ATTR_manip_drag_axis,                    false },
+	{ "ATTR_manip_command",                      kw_ATTR_manip_command,                      false },
+	{ "ATTR_manip_command_axis",                 kw_ATTR_manip_command_axis,                 false },
+	{ "ATTR_manip_noop",                         kw_ATTR_manip_noop,                         true },
+	{ "ATTR_light_level",                        kw_ATTR_light_level,                        false },
+	{ "ATTR_manip_push",                         kw_ATTR_manip_push,                         false },
+	{ "ATTR_manip_radio",                        kw_ATTR_manip_radio,                        false },
+	{ "ATTR_manip_toggle",                       kw_ATTR_manip_toggle,                       false },
+	{ "ATTR_manip_delta",                        kw_ATTR_manip_delta,                        false },
+	{ "ATTR_manip_wrap",                         kw_ATTR_manip_wrap,                         false },
+	{ "ATTR_manip_wheel",                        kw_ATTR_manip_wheel,                        false },
+	{ "ATTR_manip_drag_axis_pix",                kw_ATTR_manip_drag_axis_pix,                false },
+	{ "ATTR_manip_command_knob",                 kw_ATTR_manip_command_knob,                 false },
+	{ "ATTR_manip_command_switch_up_down",       kw_ATTR_manip_command_switch_up_down,       false },
+	{ "ATTR_manip_command_switch_left_right",    kw_ATTR_manip_command_switch_left_right,    false },
+	{ "ATTR_manip_axis_knob",                    kw_ATTR_manip_axis_knob,                    false },
+	{ "ATTR_manip_axis_switch_up_down",          kw_ATTR_manip_axis_switch_up_down,          false },
+	{ "ATTR_manip_axis_switch_left_right",       kw_ATTR_manip_axis_switch_left_right,       false },
+	{ "PARTICLE_SYSTEM",                         kw_PARTICLE_SYSTEM,                         false },
+	{ "EMITTER",                                 kw_EMITTER,                                 false },
+	{ "ATTR_cockpit_device",                     kw_ATTR_cockpit_device,                     false },
+	{ "NORMAL_METALNESS",                        kw_NORMAL_METALNESS,                        true },
+	{ "BLEND_GLASS",                             kw_BLEND_GLASS,                             true },
+	{ "ATTR_axis_detented",                      kw_ATTR_axis_detented,                      false },
+	{ "ATTR_manip_drag_rotate",                  kw_ATTR_manip_drag_rotate,                  false },
+	{ "ATTR_manip_keyframe",                     kw_ATTR_manip_keyframe,                     false },
+	{ "ATTR_axis_detent_range",                  kw_ATTR_axis_detent_range,                  false },
+	{ "ATTR_manip_command_switch_left_right2",   kw_ATTR_manip_command_switch_left_right2,   false },
+	{ "ATTR_manip_command_switch_up_down2",      kw_ATTR_manip_command_switch_up_down2,      false },
+	{ "ATTR_manip_command_knob2",                kw_ATTR_manip_command_knob2,                false },
+	{ "MAGNET",                                  kw_MAGNET,                                  false },
+	{ "#fixed_heading",                          kw_fixed_heading,                           false },
+};
+static const int k_obj8_keyword_count = sizeof(k_obj8_keywords) / sizeof(k_obj8_keywords[0]);
+
+#define KEYWORD_SLOTS	256		// power of 2, keeps the table well under half full
+
+static unsigned int	keyword_hash(const xbyt * c, const xbyt * e)
 {
-		int 	n;
+	unsigned int h = 2166136261u;		// FNV-1a
+	while(c < e)
+		h = (h ^ *c++) * 16777619u;
+	return h;
+}
 
-	outObj.texture.clear();
-	outObj.texture_lit.clear();
-	outObj.texture_normal_map.clear();
-//	outObj.texture_nrm.clear();
-	outObj.indices.clear();
-	outObj.geo_tri.clear(8);
-	outObj.geo_lines.clear(6);
-	outObj.geo_lights.clear(6);
-	outObj.animation.clear();
-	outObj.lods.clear();
-	outObj.use_metalness = 0;
-	outObj.glass_blending = 0;
-	outObj.fixed_heading = -1.0;
+struct obj8_keyword_table {
+	const obj8_keyword_info *	slots[KEYWORD_SLOTS];
+
+	obj8_keyword_table()
+	{
+		memset(slots, 0, sizeof(slots));
+		for(int n = 0; n < k_obj8_keyword_count; ++n)
+		{
+			const xbyt * k = (const xbyt *) k_obj8_keywords[n].name;
+			unsigned int h = keyword_hash(k, k + strlen(k_obj8_keywords[n].name));
+			while(slots[h & (KEYWORD_SLOTS-1)])
+				++h;
+			slots[h & (KEYWORD_SLOTS-1)] = k_obj8_keywords + n;
+		}
+	}
 
+	const obj8_keyword_info * find(const xbyt * c, const xbyt * e) const
+	{
+		int len = e - c;
+		for(unsigned int h = keyword_hash(c, e); slots[h & (KEYWORD_SLOTS-1)]; ++h)
+		{
+			const obj8_keyword_info * k = slots[h & (KEYWORD_SLOTS-1)];
+			if(strncmp(k->name, (const char *) c, len) == 0 && k->name[len] == 0)
+				return k;
+		}
+		return NULL;
+	}
+};
+
+// Same contract as TXT_MAP_str_match_space for every keyword at once: on a match we are left right
+// after the keyword, otherwise at the start of the word so the generic attribute code can have it.
+inline obj8_keyword TXT_MAP_keyword_scan(xbyt*& c,const xbyt* c_max)
+{
+	static const obj8_keyword_table	table;		// thread-safe init - the library preview loads OBJs on several threads
+
+	while(c<c_max && TXT_MAP_space(c)) ++c;
+
+	xbyt* c1=c;
+	while(c<c_max && !TXT_MAP_space(c) && !TXT_MAP_eoln(c)) ++c;
+
+	const obj8_keyword_info * k = table.find(c1, c);
+	if(k)
+	{
+		if(c<c_max && TXT_MAP_space(c)) return k->kw;
+		if(k->eol_ok && (c==c_max || TXT_MAP_eoln(c))) return k->kw;
+	}
+	c=c1;
+	return kw_none;
+}
+
+/****************************************************************************************
+ * OBJ 8 READ
+ ****************************************************************************************/
+bool	XObj8Read(const char * inFile, XObj8& outObj)
+{
 	/*********************************************************************
 	 * READ FILE INTO MEM
 	 *********************************************************************/
@@ -559,12 +777,36 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 	}
 	fclose(objFile);
 
+	bool ok = XObj8ReadMem((const char *) mem_buf, filesize, outObj);
+	free(mem_buf);
+	return ok;
+}
+
+bool	XObj8ReadMem(const char * inBuf, int inLen, XObj8& outObj)
+{
+		int 	n;
+
+	outObj.texture.clear();
+	outObj.texture_lit.clear();
+	outObj.texture_normal_map.clear();
+//	outObj.texture_nrm.clear();
+	outObj.indices.clear();
+	outObj.geo_tri.clear(8);
+	outObj.geo_lines.clear(6);
+	outObj.geo_lights.clear(6);
+	outObj.animation.clear();
+	outObj.lods.clear();
+	outObj.use_metalness = 0;
+	outObj.glass_blending = 0;
+	outObj.fixed_heading = -1.0;
+
 	/*********************************************************************
 	 * READ HEADER
 	 *********************************************************************/
 
-	unsigned char *	cur_ptr = mem_buf;
-	unsigned char *	end_ptr = mem_buf + filesize;
+	// The scanners never write through these - they are only non-const to share them with the OBJ7 reader.
+	unsigned char *	cur_ptr = (unsigned char *) inBuf;
+	unsigned char *	end_ptr = cur_ptr + inLen;
 
 	// LINE 1: A/I - who cares?!?
 	TXT_MAP_str_scan_eoln(cur_ptr, end_ptr, NULL);
@@ -580,10 +822,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 
 	// If we don't have a good version, bail.
 	if (vers != 800)
-	{
-		free(mem_buf);
 		return false;
-	}
 
 	/************************************************************
 	 * READ GEOMETRIC COMMANDS
@@ -604,27 +843,28 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 	while (!stop && TXT_MAP_continue(cur_ptr, end_ptr))
 	{
 		bool ate_eoln = false;
+		obj8_keyword kw = TXT_MAP_keyword_scan(cur_ptr, end_ptr);
 		// TEXTURE <tex>
-		if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "TEXTURE", xfals))
+		if (kw == kw_TEXTURE)
 		{
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &outObj.texture);
 		}
 		// TEXTURE_LIT <tex>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "TEXTURE_LIT", xfals))
+		else if (kw == kw_TEXTURE_LIT)
 		{
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &outObj.texture_lit);
 		}
 		// TEXTURE_NORMAL <tex>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "TEXTURE_NORMAL", xfals))
+		else if (kw == kw_TEXTURE_NORMAL)
 		{
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &outObj.texture_normal_map);
 		}
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "TEXTURE_DRAPED", xfals))
+		else if (kw == kw_TEXTURE_DRAPED)
 		{
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &outObj.texture_draped);
 		}
 		// POINT_COUNTS tris lines lites geo indices
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "POINT_COUNTS", xfals))
+		else if (kw == kw_POINT_COUNTS)
 		{
 			trimax = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 			linemax = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -640,21 +880,21 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.geo_lights.resize(lightmax);
 		}
 		// VT <x> <y> <z> <nx> <ny> <nz> <s> <t>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "VT", xfals))
-		{
-			if (tricount >= trimax) break;
-			stdat[0] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[1] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[2] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[3] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[4] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[5] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[6] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			stdat[7] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
-			outObj.geo_tri.set(tricount++, stdat);
+		// Vertices and indices come in long runs - eat the whole run here instead of
+		// going back through the keyword lookup for every line.
+		else if (kw == kw_VT)
+		{
+			do {
+				if (tricount >= trimax) { stop = true; break; }
+				for (n = 0; n < 8; ++n)
+					stdat[n] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
+				outObj.geo_tri.set(tricount++, stdat);
+				TXT_MAP_str_scan_eoln(cur_ptr, end_ptr, NULL);
+			} while (TXT_MAP_str_match_space(cur_ptr, end_ptr, "VT", xfals));
+			ate_eoln = true;
 		}
 		// VLINE <x> <y> <z> <r> <g> <b>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "VLINE", xfals))
+		else if (kw == kw_VLINE)
 		{
 			if (linecount >= linemax) break;
 			stdat[0] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -666,7 +906,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.geo_lines.set(linecount++, stdat);
 		}
 		// VLIGHT <x> <y> <z> <r> <g> <b>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "VLIGHT", xfals))
+		else if (kw == kw_VLIGHT)
 		{
 			if (lightcount >= lightmax) break;
 			stdat[0] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -678,20 +918,28 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.geo_lights.set(lightcount++, stdat);
 		}
 		// IDX <n>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "IDX", xfals))
+		else if (kw == kw_IDX)
 		{
-			if (idxcount >= idxmax) break;
-			outObj.indices[idxcount++] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
+			do {
+				if (idxcount >= idxmax) { stop = true; break; }
+				outObj.indices[idxcount++] = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
+				TXT_MAP_str_scan_eoln(cur_ptr, end_ptr, NULL);
+			} while (TXT_MAP_str_match_space(cur_ptr, end_ptr, "IDX", xfals));
+			ate_eoln = true;
 		}
 		// IDX10 <n> x 10
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "IDX10", xfals))
+		else if (kw == kw_IDX10)
 		{
-			if (idxcount >= idxmax) break;
-			for (n = 0; n < 10; ++n)
-				outObj.indices[idxcount++] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
+			do {
+				if (idxcount + 10 > idxmax) { stop = true; break; }
+				for (n = 0; n < 10; ++n)
+					outObj.indices[idxcount++] = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
+				TXT_MAP_str_scan_eoln(cur_ptr, end_ptr, NULL);
+			} while (TXT_MAP_str_match_space(cur_ptr, end_ptr, "IDX10", xfals));
+			ate_eoln = true;
 		}
 		// TRIS offset count
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "TRIS", xfals))
+		else if (kw == kw_TRIS)
 		{
 			cmd.cmd = obj8_Tris;
 			cmd.idx_offset = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
@@ -699,7 +947,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// LINES offset count
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "LINES", xfals))
+		else if (kw == kw_LINES)
 		{
 			cmd.cmd = obj8_Lines;
 			cmd.idx_offset = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
@@ -707,7 +955,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// LIGHTS offset count
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "LIGHTS", xfals))
+		else if (kw == kw_LIGHTS)
 		{
 			cmd.cmd = obj8_Lights;
 			cmd.idx_offset = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
@@ -715,14 +963,14 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ATTR_LOD near far
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_LOD", xtrue))
+		else if (kw == kw_ATTR_LOD)
 		{
 			if (outObj.lods.back().lod_far != 0)	outObj.lods.push_back(XObjLOD8());
 			outObj.lods.back().lod_near = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 			outObj.lods.back().lod_far = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 		}
 		// ANIM_rotate x y z r1 r2 v1 v2 dref
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ANIM_rotate", xfals))
+		else if (kw == kw_ANIM_rotate)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Rotate;
@@ -744,7 +992,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.push_back(animation);
 		}
 		// ANIM_trans x1 y1 z1 x2 y2 z2 v1 v2 dref
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ANIM_trans", xfals))
+		else if (kw == kw_ANIM_trans)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Translate;
@@ -767,20 +1015,20 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.push_back(animation);
 		}
 		// ANIM_begin
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ANIM_begin", xfals))
+		else if (kw == kw_ANIM_begin)
 		{
 			cmd.cmd = anim_Begin;
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ANIM_end
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ANIM_end", xfals))
+		else if (kw == kw_ANIM_end)
 		{
 			cmd.cmd = anim_End;
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 /******************************************************************************************************************************/
 		// LIGHT_CUSTOM <x> <y> <z> <r> <g> <b> <a> <s><s1> <t1> <s2> <t2> <dataref>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"LIGHT_CUSTOM", xfals))
+		else if (kw == kw_LIGHT_CUSTOM)
 		{
 			cmd.cmd = obj8_LightCustom;
 			for (n = 0; n < 12; ++n)
@@ -789,7 +1037,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// LIGHT_NAMED <name> <x> <y> <z>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"LIGHT_NAMED", xfals))
+		else if (kw == kw_LIGHT_NAMED)
 		{
 			cmd.cmd = obj8_LightNamed;
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&cmd.name);
@@ -799,7 +1047,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);			
 		}
 		// LIGHT_PARAM <name> <x> <y> <z>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"LIGHT_PARAM", xfals))
+		else if (kw == kw_LIGHT_PARAM)
 		{
 			cmd.cmd = obj8_LightNamed;
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&cmd.name);
@@ -817,7 +1065,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);			
 		}
 		// ATTR_layer_group <group name> <offset>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_layer_group", xfals))
+		else if (kw == kw_ATTR_layer_group)
 		{
 			cmd.cmd = attr_Layer_Group;
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&cmd.name);
@@ -825,7 +1073,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ATTR_hard [<type>]
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_hard", xtrue))
+		else if (kw == kw_ATTR_hard)
 		{
 			cmd.cmd = attr_Hard;
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&cmd.name);
@@ -833,7 +1081,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ATTR_hard_deck [<type>]
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_hard_deck", xtrue))
+		else if (kw == kw_ATTR_hard_deck)
 		{
 			cmd.cmd = attr_Hard_Deck;
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&cmd.name);
@@ -841,7 +1089,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ATTR_no_blend <level>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_no_blend", xtrue))
+		else if (kw == kw_ATTR_no_blend)
 		{
 			cmd.cmd = attr_No_Blend;
 			cmd.params[0] = TXT_MAP_flt_scan(cur_ptr,end_ptr,xfals);
@@ -849,7 +1097,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ANIM_hide <v1> <v2> <dataref>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_hide", xfals))
+		else if (kw == kw_ANIM_hide)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Hide;
@@ -866,7 +1114,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.push_back(animation);
 		}
 		// ANIM_show <v1> <v2> <dataref>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_show", xfals))
+		else if (kw == kw_ANIM_show)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Show;
@@ -884,7 +1132,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		}
 /******************************************************************************************************************************/
 		// ANIM_rotate_begin x y z dref
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_rotate_begin", xfals))
+		else if (kw == kw_ANIM_rotate_begin)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Rotate;
@@ -900,7 +1148,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.push_back(animation);
 		}
 		// ANIM_trans_begin dref
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_trans_begin", xfals))
+		else if (kw == kw_ANIM_trans_begin)
 		{
 			animation.keyframes.clear();
 			animation.cmd = anim_Translate;
@@ -913,14 +1161,14 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.push_back(animation);
 		}
 		// ANIM_rotate_key v r
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_rotate_key", xfals))
+		else if (kw == kw_ANIM_rotate_key)
 		{
 			outObj.animation.back().keyframes.push_back(XObjKey());
 			outObj.animation.back().keyframes.back().key = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 			outObj.animation.back().keyframes.back().v[0] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 		}
 		// ANIM_trans_key v x y z
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_trans_key", xfals))
+		else if (kw == kw_ANIM_trans_key)
 		{
 			outObj.animation.back().keyframes.push_back(XObjKey());
 			outObj.animation.back().keyframes.back().key = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -929,22 +1177,22 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.animation.back().keyframes.back().v[2] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 		}
 		// ANIM_rotate_end
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_rotate_end", xtrue))
+		else if (kw == kw_ANIM_rotate_end)
 		{
 		}
 		// ANIM_trans_end
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_trans_end", xtrue))
+		else if (kw == kw_ANIM_trans_end)
 		{
 		}
 		// ANIM_keyframe_loop <loop>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ANIM_keyframe_loop", xfals))
+		else if (kw == kw_ANIM_keyframe_loop)
 		{
 			outObj.animation.back().loop = TXT_MAP_flt_scan(cur_ptr,end_ptr, xfals);
 		}
 /******************************************************************************************************************************/
 		// COCKPIT_REGION
 /******************************************************************************************************************************/
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"COCKPIT_REGION", false))
+		else if (kw == kw_COCKPIT_REGION)
 		{
 			outObj.regions.push_back(XObjPanelRegion8());
 			outObj.regions.back().left   = TXT_MAP_int_scan(cur_ptr, end_ptr, xfals);
@@ -956,13 +1204,13 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		// MANIPS (920)
 /******************************************************************************************************************************/
 		// ATTR_manip_none
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_none", true))
+		else if (kw == kw_ATTR_manip_none)
 		{
 			cmd.cmd = attr_Manip_None;
 			outObj.lods.back().cmds.push_back(cmd);
 		}
 		// ATTR_manip_drag_xy <cursor> <dx> <dy> <v1min> <v1max> <v2min> <v2max> <dref1> <dref> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_drag_xy", false))
+		else if (kw == kw_ATTR_manip_drag_xy)
 		{
 			cmd.cmd = attr_Manip_Drag_2d;
 			cmd.idx_offset = outObj.manips.size();
@@ -983,7 +1231,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_drag_axis <cursor> <dx> <dy> <dz> <v1> <v2> <dataref> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_drag_axis", false))
+		else if (kw == kw_ATTR_manip_drag_axis)
 		{
 			cmd.cmd = attr_Manip_Drag_Axis;
 			cmd.idx_offset = outObj.manips.size();
@@ -1002,7 +1250,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command <currsor> <cmnd> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_command", false))
+		else if (kw == kw_ATTR_manip_command)
 		{
 			cmd.cmd = attr_Manip_Command;
 			cmd.idx_offset = outObj.manips.size();
@@ -1016,7 +1264,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_axis <cursor> <dx> <dy> <dz> <positive cmnd> <negative cmnd> <tool tip>
-		else if(TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_command_axis",false))
+		else if(kw == kw_ATTR_manip_command_axis)
 		{
 			cmd.cmd = attr_Manip_Command_Axis;
 			cmd.idx_offset = outObj.manips.size();
@@ -1034,7 +1282,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_noop
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_noop",true))
+		else if (kw == kw_ATTR_manip_noop)
 		{
 			cmd.cmd = attr_Manip_Noop;
 			cmd.idx_offset = outObj.manips.size();
@@ -1049,7 +1297,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 /******************************************************************************************************************************/
 		// LIGHT LEVEL (930)
 /******************************************************************************************************************************/
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_light_level",false))
+		else if (kw == kw_ATTR_light_level)
 		{
 			cmd.cmd = attr_Light_Level;
 			cmd.params[0] = TXT_MAP_flt_scan(cur_ptr,end_ptr,false);
@@ -1059,7 +1307,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		}
 
 		// ATTR_manip_push <cursor> <v1max> <v1min> <dref1> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_push", false))
+		else if (kw == kw_ATTR_manip_push)
 		{
 			cmd.cmd = attr_Manip_Push;
 			cmd.idx_offset = outObj.manips.size();
@@ -1075,7 +1323,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_radio <cursor> <v1max> <dref1> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_radio", false))
+		else if (kw == kw_ATTR_manip_radio)
 		{
 			cmd.cmd = attr_Manip_Radio;
 			cmd.idx_offset = outObj.manips.size();
@@ -1090,7 +1338,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_toggle <cursor> <v1max> <v1min> <dref1> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_toggle", false))
+		else if (kw == kw_ATTR_manip_toggle)
 		{
 			cmd.cmd = attr_Manip_Toggle;
 			cmd.idx_offset = outObj.manips.size();
@@ -1107,7 +1355,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		}
 
 		// ATTR_manip_delta <cursor> <v1max> <v1min> <dref1> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_delta", false))
+		else if (kw == kw_ATTR_manip_delta)
 		{
 			cmd.cmd = attr_Manip_Delta;
 			cmd.idx_offset = outObj.manips.size();
@@ -1125,7 +1373,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_wrap <cursor> <v1max> <v1min> <dref1> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr,end_ptr,"ATTR_manip_wrap", false))
+		else if (kw == kw_ATTR_manip_wrap)
 		{
 			cmd.cmd = attr_Manip_Wrap;
 			cmd.idx_offset = outObj.manips.size();
@@ -1145,13 +1393,13 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 /******************************************************************************************************************************/
 		// NEW MANIPS (1050)
 /******************************************************************************************************************************/
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_wheel", false))
+		else if (kw == kw_ATTR_manip_wheel)
 		{
 			if(!outObj.manips.empty())
 				outObj.manips.back().mouse_wheel_delta = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 		}
 		// ATTR_manip_drag_axis_pix <cursor> <dx_pix> <step> <exp> <v1> <v2> <dataref> <tooltip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_drag_axis_pix", xfals))
+		else if (kw == kw_ATTR_manip_drag_axis_pix)
 		{
 			cmd.cmd = attr_Manip_Drag_Axis_Pix;;
 			cmd.idx_offset = outObj.manips.size();
@@ -1174,7 +1422,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_knob <cursor> <positive cmnd> <negative cmnd> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_knob", xfals))
+		else if (kw == kw_ATTR_manip_command_knob)
 		{
 			cmd.cmd = attr_Manip_Command_Knob;
 			cmd.idx_offset = outObj.manips.size();
@@ -1189,7 +1437,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_switch_up_down <cursor> <positive cmnd> <negative cmnd> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_switch_up_down", xfals))
+		else if (kw == kw_ATTR_manip_command_switch_up_down)
 		{
 			cmd.cmd = attr_Manip_Command_Switch_Up_Down;
 			cmd.idx_offset = outObj.manips.size();
@@ -1204,7 +1452,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_switch_left_right <cursor> <positive cmnd> <negative cmnd> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_switch_left_right", xfals))
+		else if (kw == kw_ATTR_manip_command_switch_left_right)
 		{
 			cmd.cmd = attr_Manip_Command_Switch_Left_Right;
 			cmd.idx_offset = outObj.manips.size();
@@ -1220,7 +1468,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		}
 
 		// ATTR_manip_axis_switch_left_right <cursor>  <v1> <v2> <click step> <hold step> <dref> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_axis_knob", xfals))
+		else if (kw == kw_ATTR_manip_axis_knob)
 		{
 			cmd.cmd = attr_Manip_Axis_Knob;
 			cmd.idx_offset = outObj.manips.size();
@@ -1240,7 +1488,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_axis_switch_up_down <cursor>  <v1> <v2> <click step> <hold step> <dref> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_axis_switch_up_down", xfals))
+		else if (kw == kw_ATTR_manip_axis_switch_up_down)
 		{
 			cmd.cmd = attr_Manip_Axis_Switch_Up_Down;
 			cmd.idx_offset = outObj.manips.size();
@@ -1260,7 +1508,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_axis_switch_left_right <cursor>  <v1> <v2> <click step> <hold step> <dref> <tool tip>
-		else if (TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_axis_switch_left_right", xfals))
+		else if (kw == kw_ATTR_manip_axis_switch_left_right)
 		{
 			cmd.cmd = attr_Manip_Axis_Switch_Left_Right;
 			cmd.idx_offset = outObj.manips.size();
@@ -1283,12 +1531,12 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		// PARTICLE SYSTEM
 /******************************************************************************************************************************/
 		// PARTICLE_SYSTEM <def name>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "PARTICLE_SYSTEM",xfals))
+		else if(kw == kw_PARTICLE_SYSTEM)
 		{
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &outObj.particle_system);
 		}
 		// EMITTER name x y z psi the phi low high dref
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "EMITTER",xfals))
+		else if(kw == kw_EMITTER)
 		{
 			cmd.cmd = attr_Emitter;
 			cmd.idx_offset = outObj.emitters.size();
@@ -1316,7 +1564,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 		// V11 NEW STUFF
 /******************************************************************************************************************************/
 		// ATTR_cockpit_device <device> <bus> <rheostat> <auto_adjust>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_cockpit_device", xfals))
+		else if(kw == kw_ATTR_cockpit_device)
 		{
 			cmd.cmd = attr_Cockpit_Device;
 			TXT_MAP_str_scan_space(cur_ptr, end_ptr, &cmd.name);
@@ -1325,16 +1573,16 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			cmd.params[2] = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 			outObj.lods.back().cmds.push_back(cmd);
 		}
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "NORMAL_METALNESS",xtrue))
+		else if(kw == kw_NORMAL_METALNESS)
 		{
 			outObj.use_metalness = 1;
 		}
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "BLEND_GLASS",xtrue))
+		else if(kw == kw_BLEND_GLASS)
 		{
 			outObj.glass_blending = 1;
 		}
 		// ATTR_axis_detented <dx> <dy> <dz> <v1_min> <v1_max> <dref>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_axis_detented", false))
+		else if(kw == kw_ATTR_axis_detented)
 		{
 			XObjManip8& manip(outObj.manips.back());
 			
@@ -1348,7 +1596,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			TXT_MAP_str_scan_space(cur_ptr,end_ptr,&manip.dataref2);
 		}
 		// ATTR_manip_drag_rotate <cursor> <x> <y> <z> <dx> <dy> <dz> <ange1> <angle2> <lift> <v1min> <v1max> <v2min> <v2max> <dataref1> <dataref2> <tooltip>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_drag_rotate", xfals))
+		else if(kw == kw_ATTR_manip_drag_rotate)
 		{
 			cmd.cmd = attr_Manip_Drag_Rotate;
 			cmd.idx_offset = outObj.manips.size();
@@ -1382,7 +1630,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_keyframe dref angle
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_keyframe",xfals))
+		else if(kw == kw_ATTR_manip_keyframe)
 		{
 			XObjKey k;
 			k.key = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -1390,7 +1638,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.back().rotation_key_frames.push_back(k);
 		}
 		// ATTR_axis_detent_range <lo> <hi> <height>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_axis_detent_range", false))
+		else if(kw == kw_ATTR_axis_detent_range)
 		{
 			XObjDetentRange d;
 			d.lo = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
@@ -1399,7 +1647,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.back().detents.push_back(d);
 		}
 		// ATTR_manip_command_switch_left_right2 <currsor> <cmnd> <tooltip>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_switch_left_right2", xfals))
+		else if(kw == kw_ATTR_manip_command_switch_left_right2)
 		{
 			cmd.cmd = attr_Manip_Command_Switch_Left_Right2;
 			cmd.idx_offset = outObj.manips.size();
@@ -1414,7 +1662,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_switch_up_down2 <cursor> <cmnd> <tooltip>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_switch_up_down2", xfals))
+		else if(kw == kw_ATTR_manip_command_switch_up_down2)
 		{
 			cmd.cmd = attr_Manip_Command_Switch_Up_Down2;
 			cmd.idx_offset = outObj.manips.size();
@@ -1429,7 +1677,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			outObj.manips.push_back(manip);
 		}
 		// ATTR_manip_command_knob2 <currsor> <cmnd> <tooltip>
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "ATTR_manip_command_knob2", xfals))
+		else if(kw == kw_ATTR_manip_command_knob2)
 		{
 			cmd.cmd = attr_Manip_Command_Knob2;
 			cmd.idx_offset = outObj.manips.size();
@@ -1443,7 +1691,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			ate_eoln=true;
 			outObj.manips.push_back(manip);
 		}
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "MAGNET", xfals))
+		else if(kw == kw_MAGNET)
 		{
 			cmd.cmd = attr_Magnet;
 			// SKIP magnet name - we always write 'magnet'
@@ -1460,7 +1708,7 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 
 			outObj.lods.back().cmds.push_back(cmd);
 		}
-		else if(TXT_MAP_str_match_space(cur_ptr, end_ptr, "#fixed_heading", xfals))
+		else if(kw == kw_fixed_heading)
 		{
 			outObj.fixed_heading = TXT_MAP_flt_scan(cur_ptr, end_ptr, xfals);
 		}
@@ -1489,8 +1737,6 @@ bool	XObj8Read(const char * inFile, XObj8& outObj)
 			TXT_MAP_str_scan_eoln(cur_ptr, end_ptr, NULL);
 	} // While loop
 
-	free(mem_buf);
-
 	outObj.geo_tri.get_minmax(outObj.xyz_min,outObj.xyz_max);
 	
 	return true;
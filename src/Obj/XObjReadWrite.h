@@ -30,6 +30,7 @@ bool	XObjRead(const char * inFile, XObj& outObj);
 bool	XObjWrite(const char * inFile, const XObj& inObj);
 
 bool	XObj8Read(const char * inFile, XObj8& outObj);
+bool	XObj8ReadMem(const char * inBuf, int inLen, XObj8& outObj);		// Parses an OBJ8 file already in memory
 bool	XObj8Write(const char * inFile, const XObj8& outObj);
 
 #endif
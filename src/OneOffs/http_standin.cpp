@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+
+	BUILD:	g++ -std=c++11 -O2 -DLIN=1 -include ../Obj/XDefs.h -I../Obj -I../Utils -I../Network http_standin.cpp ../Network/curl_http.cpp \
+				../Utils/AssertUtils.cpp ../Utils/FileUtils.cpp -o http_standin -lcurl -lz -lpthread
+
+	http_standin is a local stand-in for a slippy map tile server, so WED's tile fetching can be
+	exercised without hammering (or waiting on) OSM or ESRI.  Every GET is answered with a 256x256
+	PNG whose shade is derived from the request path, after an optional artificial delay that
+	plays the part of network latency.  Connections are kept alive like a real server would.
+
+	USAGE:	http_standin [-port <port>] [-delay <ms>]
+
+	Then set WED's custom slippy map URL to http://127.0.0.1:<port>/${z}/${x}/${y}.png and pick
+	the custom map.  Clear the tile cache folder first, or WED will draw the tiles it already has.
+
+	USAGE:	http_standin -bench <count> [-inflight <n>] [-delay <ms>]
+
+	Benchmarks curl_http_get_file: starts the server on a free port and fetches count distinct tiles
+	from it, keeping n requests in flight (default 8, like the slippy map), then prints the time taken,
+	requests per second and any failures.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#include "curl_http.h"
+#include "PerfUtils.h"
+
+#define TILE_DIM		256
+#define DEFAULT_PORT	8088
+
+/************************************************************************************************************************
+ * TILES
+ ************************************************************************************************************************/
+
+static void	put_be32(string& s, unsigned int v)
+{
+	s += (char) (v >> 24); s += (char) (v >> 16); s += (char) (v >> 8); s += (char) v;
+}
+
+static void	put_chunk(string& png, const char * type, const string& data)
+{
+	put_be32(png, data.size());
+	string body(type, 4);
+	body += data;
+	png += body;
+	put_be32(png, crc32(0, (const Bytef *) body.data(), body.size()));
+}
+
+// A TILE_DIM square 8-bit gray PNG with a diagonal gradient, offset by shade.
+static string	make_tile(unsigned char shade)
+{
+	vector<unsigned char>	raw;
+	raw.reserve((TILE_DIM + 1) * TILE_DIM);
+	for(int y = 0; y < TILE_DIM; ++y)
+	{
+		raw.push_back(0);		// filter: none
+		for(int x = 0; x < TILE_DIM; ++x)
+			raw.push_back(shade + (x + y) / 4);
+	}
+
+	uLongf	zlen = compressBound(raw.size());
+	string	z(zlen, 0);
+	compress2((Bytef *) &z[0], &zlen, &raw[0], raw.size(), 6);
+	z.resize(zlen);
+
+	string ihdr;
+	put_be32(ihdr, TILE_DIM);
+	put_be32(ihdr, TILE_DIM);
+	ihdr += (char) 8;			// bit depth
+	ihdr += (char) 0;			// gray
+	ihdr += string(3, 0);		// compression, filter, interlace
+
+	string png("\x89PNG\r\n\x1a\n", 8);
+	put_chunk(png, "IHDR", ihdr);
+	put_chunk(png, "IDAT", z);
+	put_chunk(png, "IEND", string());
+	return png;
+}
+
+/************************************************************************************************************************
+ * SERVER
+ ************************************************************************************************************************/
+
+static bool	send_all(int fd, const char * p, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t sent = send(fd, p, len, 0);
+		if(sent <= 0) return false;
+		p += sent;
+		len -= sent;
+	}
+	return true;
+}
+
+// Serves one keep-alive connection until the client hangs up.
+static void	serve_connection(int fd, int delay_ms)
+{
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	string	pending;
+	char	buf[4096];
+	while(true)
+	{
+		string::size_type end;
+		while((end = pending.find("\r\n\r\n")) == pending.npos)
+		{
+			ssize_t got = recv(fd, buf, sizeof(buf), 0);
+			if(got <= 0)
+			{
+				close(fd);
+				return;
+			}
+			pending.append(buf, got);
+		}
+		string request = pending.substr(0, end);
+		pending.erase(0, end + 4);
+
+		string::size_type p1 = request.find(' ');
+		string::size_type p2 = request.find(' ', p1 + 1);
+		string path = (p1 == request.npos || p2 == request.npos) ? string("/") : request.substr(p1 + 1, p2 - p1 - 1);
+
+		if(delay_ms > 0)
+			this_thread::sleep_for(chrono::milliseconds(delay_ms));
+
+		string	body = make_tile(crc32(0, (const Bytef *) path.data(), path.size()) & 0x7F);
+		char	header[256];
+		snprintf(header, sizeof(header),
+			"HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: %d\r\nConnection: keep-alive\r\n\r\n", (int) body.size());
+		if(!send_all(fd, header, strlen(header)) || !send_all(fd, body.data(), body.size()))
+		{
+			close(fd);
+			return;
+		}
+	}
+}
+
+// Binds to 127.0.0.1:port - port 0 picks a free one.  Returns the listening socket, or -1.
+static int	start_listening(int& port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) return -1;
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	socklen_t len = sizeof(addr);
+	if(::bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, 64) != 0 ||
+	   getsockname(fd, (sockaddr *) &addr, &len) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	port = ntohs(addr.sin_port);
+	return fd;
+}
+
+static void	accept_loop(int listener, int delay_ms)
+{
+	while(true)
+	{
+		int fd = accept(listener, NULL, NULL);
+		if(fd < 0) break;
+		thread(serve_connection, fd, delay_ms).detach();
+	}
+}
+
+/************************************************************************************************************************
+ * BENCHMARK
+ ************************************************************************************************************************/
+
+static int	run_bench(int count, int inflight, int delay_ms)
+{
+	int port = 0;
+	int listener = start_listening(port);
+	if(listener < 0)
+	{
+		perror("Could not listen");
+		return 1;
+	}
+	thread(accept_loop, listener, delay_ms).detach();
+
+	vector<curl_http_get_file *>	reqs(inflight, (curl_http_get_file *) NULL);
+	vector<vector<char> >			bufs(inflight);
+	int		started = 0, finished = 0, failed = 0;
+	long long	bytes = 0;
+
+	printf("Fetching %d tiles, %d in flight, %d ms server delay.\n", count, inflight, delay_ms);
+	unsigned long long start = query_hpc();
+	{
+		StElapsedTime	timer("Fetch time");
+		while(finished < count)
+		{
+			bool idle = true;
+			for(int n = 0; n < inflight; ++n)
+			{
+				if(reqs[n] && reqs[n]->is_done())
+				{
+					if(reqs[n]->is_ok() && bufs[n].size() > 8 && memcmp(&bufs[n][0], "\x89PNG", 4) == 0)
+						bytes += bufs[n].size();
+					else
+						++failed;
+					delete reqs[n];
+					reqs[n] = NULL;
+					++finished;
+					idle = false;
+				}
+				if(reqs[n] == NULL && started < count)
+				{
+					char url[256];
+					snprintf(url, sizeof(url), "http://127.0.0.1:%d/17/%d/%d.png", port, started % 1000, started / 1000);
+					bufs[n].clear();
+					reqs[n] = new curl_http_get_file(url, &bufs[n], string());
+					++started;
+					idle = false;
+				}
+			}
+			if(idle)
+				this_thread::sleep_for(chrono::microseconds(200));
+		}
+	}
+	double secs = hpc_to_microseconds(query_hpc() - start) / 1000000.0;
+	printf("%d requests, %d failed, %.1f requests/sec, %.1f MB/sec.\n", count, failed, count / secs, bytes / secs / (1024.0 * 1024.0));
+	return failed ? 1 : 0;
+}
+
+/************************************************************************************************************************
+ * MAIN
+ ************************************************************************************************************************/
+
+int main(int argc, const char * argv[])
+{
+	int port = DEFAULT_PORT;
+	int delay_ms = 0;
+	int bench_count = 0;
+	int inflight = 8;
+
+	for(int n = 1; n < argc; ++n)
+	{
+		if(strcmp(argv[n], "-port") == 0 && n + 1 < argc)			port = atoi(argv[++n]);
+		else if(strcmp(argv[n], "-delay") == 0 && n + 1 < argc)		delay_ms = atoi(argv[++n]);
+		else if(strcmp(argv[n], "-bench") == 0 && n + 1 < argc)		bench_count = atoi(argv[++n]);
+		else if(strcmp(argv[n], "-inflight") == 0 && n + 1 < argc)	inflight = max(1, atoi(argv[++n]));
+		else
+		{
+			fprintf(stderr, "Usage: %s [-port <port>] [-delay <ms>]\n"
+							"       %s -bench <count> [-inflight <n>] [-delay <ms>]\n", argv[0], argv[0]);
+			return 1;
+		}
+	}
+
+	if(bench_count > 0)
+		return run_bench(bench_count, inflight, delay_ms);
+
+	int listener = start_listening(port);
+	if(listener < 0)
+	{
+		perror("Could not listen");
+		return 1;
+	}
+
+	printf("Serving tiles on http://127.0.0.1:%d/${z}/${x}/${y}.png, %d ms delay per tile.\n", port, delay_ms);
+	accept_loop(listener, delay_ms);
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+
+	BUILD:	g++ -std=c++11 -O2 -DLIN=1 -DAPL=0 -DIBM=0 -include ../Obj/XDefs.h -I../Obj -I../Utils obj_bench.cpp ../Obj/XObjReadWrite.cpp \
+				../Obj/XObjDefs.cpp ../Obj/ObjPointPool.cpp ../Utils/AssertUtils.cpp ../Utils/FileUtils.cpp -o obj_bench
+
+	obj_bench measures OBJ8 parse throughput.  All files are read into memory first, then each one is
+	parsed with XObj8ReadMem -reps times, so the disk stays out of the numbers.  It prints the time,
+	MB/sec and objects/sec, plus totals of what was parsed - compare those between two builds to make
+	sure a faster parser still reads the same thing.
+
+	USAGE:	obj_bench [-reps <n>] [-synth <vertices>] <.obj files or folders...>
+
+	Folders are searched recursively for .obj files.  -synth adds a generated object with that many
+	triangle vertices, for when no real corpus is at hand.
+
+*/
+
+#include "XObjDefs.h"
+#include "XObjReadWrite.h"
+#include "FileUtils.h"
+#include "PerfUtils.h"
+
+static bool	has_obj_suffix(const string& path)
+{
+	return path.size() > 4 && strcasecmp(path.c_str() + path.size() - 4, ".obj") == 0;
+}
+
+// A plain OBJ8 triangle soup - numbers with varied precision, like exporters write them.
+static string	make_synth_obj(int verts)
+{
+	verts -= verts % 3;
+	string obj = "I\n800\nOBJ\n\nTEXTURE synth.png\n";
+	char line[256];
+	snprintf(line, sizeof(line), "POINT_COUNTS %d 0 0 %d\n\n", verts, verts);
+	obj += line;
+
+	srand(1234);
+	for(int n = 0; n < verts; ++n)
+	{
+		snprintf(line, sizeof(line), "VT %.4f %.3f %.5f %.6f %.6f %.6f %.7f %.7f\n",
+			(rand() % 200000) * 0.001 - 100.0, (rand() % 50000) * 0.001, (rand() % 200000) * 0.001 - 100.0,
+			(rand() % 2001) * 0.001 - 1.0, (rand() % 1001) * 0.001, (rand() % 2001) * 0.001 - 1.0,
+			(rand() % 10000) * 0.0001, (rand() % 10000) * 0.0001);
+		obj += line;
+	}
+	obj += "\n";
+	int n = 0;
+	for(; n + 10 <= verts; n += 10)
+	{
+		snprintf(line, sizeof(line), "IDX10 %d %d %d %d %d %d %d %d %d %d\n", n, n+1, n+2, n+3, n+4, n+5, n+6, n+7, n+8, n+9);
+		obj += line;
+	}
+	for(; n < verts; ++n)
+	{
+		snprintf(line, sizeof(line), "IDX %d\n", n);
+		obj += line;
+	}
+	// Draw it in small batches with state changes in between, the way modelled objects usually come out.
+	static const char * k_attrs[] = { "ATTR_shade_flat", "ATTR_shade_smooth", "ATTR_no_blend 0.5", "ATTR_blend",
+									  "ATTR_hard", "ATTR_no_hard", "ATTR_cull", "ATTR_no_cull" };
+	obj += "\nATTR_LOD 0 10000\n";
+	for(n = 0; n < verts; n += 30)
+	{
+		snprintf(line, sizeof(line), "%s\nTRIS %d %d\n", k_attrs[rand() % 8], n, min(30, verts - n));
+		obj += line;
+	}
+	return obj;
+}
+
+static bool	load_file(const string& path, string& out)
+{
+	FILE * fi = fopen(path.c_str(), "rb");
+	if(fi == NULL) return false;
+	char buf[65536];
+	size_t got;
+	out.clear();
+	while((got = fread(buf, 1, sizeof(buf), fi)) > 0)
+		out.append(buf, got);
+	fclose(fi);
+	return true;
+}
+
+int main(int argc, const char * argv[])
+{
+	int reps = 5;
+	int synth = 0;
+	vector<string>	paths;
+
+	for(int n = 1; n < argc; ++n)
+	{
+		if(strcmp(argv[n], "-reps") == 0 && n + 1 < argc)			reps = max(1, atoi(argv[++n]));
+		else if(strcmp(argv[n], "-synth") == 0 && n + 1 < argc)		synth = atoi(argv[++n]);
+		else if(argv[n][0] == '-')
+		{
+			fprintf(stderr, "Usage: %s [-reps <n>] [-synth <vertices>] <.obj files or folders...>\n", argv[0]);
+			return 1;
+		}
+		else
+		{
+			struct stat		meta;
+			vector<string>	files, dirs;
+			if(FILE_get_file_meta_data(argv[n], meta) == 0 && S_ISDIR(meta.st_mode) &&
+			   FILE_get_directory_recursive(argv[n], files, dirs) >= 0)
+			{
+				for(vector<string>::iterator f = files.begin(); f != files.end(); ++f)
+				if(has_obj_suffix(*f))
+					paths.push_back(*f);
+			}
+			else
+				paths.push_back(argv[n]);
+		}
+	}
+
+	vector<string>	corpus;
+	long long		bytes = 0;
+	for(vector<string>::iterator p = paths.begin(); p != paths.end(); ++p)
+	{
+		string data;
+		if(load_file(*p, data))
+		{
+			bytes += data.size();
+			corpus.push_back(data);
+		}
+		else
+			fprintf(stderr, "Could not read %s\n", p->c_str());
+	}
+	if(synth > 0)
+	{
+		corpus.push_back(make_synth_obj(synth));
+		bytes += corpus.back().size();
+	}
+	if(corpus.empty())
+	{
+		fprintf(stderr, "Nothing to parse.\n");
+		return 1;
+	}
+
+	printf("Parsing %d objects, %.1f MB, %d times each.\n", (int) corpus.size(), bytes / (1024.0 * 1024.0), reps);
+
+	int			failed = 0;
+	long long	tri_verts = 0, indices = 0, cmds = 0;
+	unsigned long long start = query_hpc();
+	{
+		StElapsedTime	timer("Parse time");
+		for(int r = 0; r < reps; ++r)
+		for(vector<string>::iterator o = corpus.begin(); o != corpus.end(); ++o)
+		{
+			XObj8	obj;
+			if(!XObj8ReadMem(o->data(), o->size(), obj))
+			{
+				++failed;
+				continue;
+			}
+			if(r == 0)
+			{
+				tri_verts += obj.geo_tri.count();
+				indices += obj.indices.size();
+				for(vector<XObjLOD8>::iterator l = obj.lods.begin(); l != obj.lods.end(); ++l)
+					cmds += l->cmds.size();
+			}
+		}
+	}
+	double secs = hpc_to_microseconds(query_hpc() - start) / 1000000.0;
+
+	printf("%.1f MB/sec, %.1f objects/sec, %d parse failures.\n",
+		bytes * reps / secs / (1024.0 * 1024.0), corpus.size() * reps / secs, failed);
+	printf("Parsed: %lld triangle vertices, %lld indices, %lld commands.\n", tri_verts, indices, cmds);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+
+	BUILD:	g++ -std=c++11 -O2 -DLIN=1 -DAPL=0 -DIBM=0 -include ../Obj/XDefs.h -I../Obj -I../Utils pointpool_bench.cpp \
+				../Obj/ObjPointPool.cpp -o pointpool_bench
+
+	pointpool_bench times ObjPointPool::accumulate against the map<vector<float>, int> pool it replaced.
+	Both pools take the same points in the same order, and the bench fails unless they hand out the same
+	indices.  The points are OBJ vertices - xyz, normal, st - picked at random from a set of distinct ones,
+	so -distinct controls how much gets shared.
+
+	USAGE:	pointpool_bench [-count <n>] [-distinct <n>] [-depth <n>] [-reps <n>]
+
+	Defaults are 500000 points out of 400000 distinct ones, 8 floats each, 3 reps.  Run it once more with
+	-distinct 5000 to see the heavily shared case.
+
+*/
+
+#include "ObjPointPool.h"
+#include "PerfUtils.h"
+
+struct lex_less_floats {
+	bool operator()(const vector<float>& lhs, const vector<float>& rhs) const {
+		return lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+};
+
+// The old pool - keyed by copies of the points.
+class RefPointPool {
+public:
+	RefPointPool(int depth) : mDepth(depth) { }
+
+	int		accumulate(const float pt[])
+	{
+		map<vector<float>, int, lex_less_floats>::iterator i = mIndex.find(vector<float>(pt, pt + mDepth));
+		if (i != mIndex.end())
+			return i->second;
+		int ret = mData.size() / mDepth;
+		mData.insert(mData.end(), pt, pt + mDepth);
+		mIndex.insert(make_pair(vector<float>(pt, pt + mDepth), ret));
+		return ret;
+	}
+
+private:
+	vector<float>								mData;
+	map<vector<float>, int, lex_less_floats>	mIndex;
+	int											mDepth;
+};
+
+static unsigned long long	mix64(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+static int	make_points(vector<float>& pts, int count, int distinct, int depth)
+{
+	pts.resize((size_t) count * depth);
+	set<unsigned long long>	picked;
+	for (int n = 0; n < count; ++n)
+	{
+		unsigned long long which = mix64(n) % distinct;
+		picked.insert(which);
+		for (int d = 0; d < depth; ++d)
+			pts[(size_t) n * depth + d] = (float) (mix64((1ULL << 63) | (which << 8) | d) >> 40) / 4096.0f - 2048.0f;
+	}
+	return picked.size();
+}
+
+int main(int argc, const char * argv[])
+{
+	int count = 500000;
+	int distinct = 400000;
+	int depth = 8;
+	int reps = 3;
+
+	for(int n = 1; n < argc; ++n)
+	{
+		if(strcmp(argv[n], "-count") == 0 && n + 1 < argc)				count = max(1, atoi(argv[++n]));
+		else if(strcmp(argv[n], "-distinct") == 0 && n + 1 < argc)		distinct = max(1, atoi(argv[++n]));
+		else if(strcmp(argv[n], "-depth") == 0 && n + 1 < argc)			depth = min(256, max(1, atoi(argv[++n])));
+		else if(strcmp(argv[n], "-reps") == 0 && n + 1 < argc)			reps = max(1, atoi(argv[++n]));
+		else
+		{
+			fprintf(stderr, "Usage: %s [-count <n>] [-distinct <n>] [-depth <n>] [-reps <n>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	vector<float> pts;
+	int picked = make_points(pts, count, distinct, depth);
+	printf("Pooling %d points of %d floats, %d distinct, %d times each.\n", count, depth, picked, reps);
+
+	vector<int>	ref_idx(count), idx(count);
+	{
+		StElapsedTime	timer("map<vector<float>, int> pool");
+		for(int r = 0; r < reps; ++r)
+		{
+			RefPointPool ref(depth);
+			for (int n = 0; n < count; ++n)
+				ref_idx[n] = ref.accumulate(&pts[(size_t) n * depth]);
+		}
+	}
+	int pooled = 0;
+	{
+		StElapsedTime	timer("ObjPointPool");
+		for(int r = 0; r < reps; ++r)
+		{
+			ObjPointPool pool;
+			pool.clear(depth);
+			for (int n = 0; n < count; ++n)
+				idx[n] = pool.accumulate(&pts[(size_t) n * depth]);
+			pooled = pool.count();
+		}
+	}
+
+	if(idx != ref_idx || pooled != picked)
+	{
+		printf("FAILED: the pools disagree (%d vs %d points pooled).\n", pooled, picked);
+		return 1;
+	}
+	printf("Pools match.\n");
+	return 0;
+}
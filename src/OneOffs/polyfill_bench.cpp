@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+
+	BUILD:	g++ -std=c++11 -O2 -DLIN=1 -DAPL=0 -DIBM=0 -include ../Obj/XDefs.h -I../Obj -I../Utils polyfill_bench.cpp \
+				../Utils/PolyRasterUtils.cpp -o polyfill_bench -lpthread
+
+	polyfill_bench times PolyRasterFill against the serial fill it replaced: one PolyRasterizer walked up
+	from row 0.  The polygons are random non-overlapping stars, one per 80x60 pixel cell, so the raster is
+	covered about evenly.  Both fills count coverage into their own raster, and the bench fails unless
+	the two rasters match.
+
+	USAGE:	polyfill_bench [-size <width> <height>] [-sides <max>] [-threads <n>] [-reps <n>]
+
+	Defaults are an 8000x6000 raster, up to 60 sides per star, one thread per core and 3 reps.
+
+*/
+
+#include "PolyRasterUtils.h"
+#include "PerfUtils.h"
+
+static void	make_stars(PolyRasterizer<double>& raster, int cols, int rows, int max_sides)
+{
+	srand(7);
+	for(int p = 0; p < cols * rows; ++p)
+	{
+		double	cx = 40 + 80 * (p % cols);
+		double	cy = -20 + 60 * (p / cols);
+		double	rad = 5 + rand() % 25;
+		int		n = 3 + rand() % max_sides;
+		vector<double>	xs, ys;
+		for(int k = 0; k < n; ++k)
+		{
+			double a = 2.0 * M_PI * k / n;
+			double r = rad * (0.3 + 0.7 * (rand() % 1000) / 1000.0);
+			xs.push_back(cx + r * cos(a));
+			ys.push_back(cy + r * sin(a));
+		}
+		for(int k = 0; k < n; ++k)
+			raster.AddEdge(xs[k], ys[k], xs[(k + 1) % n], ys[(k + 1) % n]);
+	}
+	raster.SortMasters();
+}
+
+static void	serial_fill(const PolyRasterizer<double>& raster, int width, int height, vector<float>& out)
+{
+	PolyRasterizer<double>	r(raster);
+	int y = 0;
+	r.StartScanline(y);
+	while(!r.DoneScan())
+	{
+		int x1, x2;
+		while(r.GetRange(x1, x2))
+		{
+			x1 = max(x1, 0);
+			x2 = min(x2, width);
+			float * row = &out[(size_t) y * width];
+			for(int x = x1; x < x2; ++x)
+				row[x] += 1.0f;
+		}
+		if(++y >= height)
+			break;
+		r.AdvanceScanline(y);
+	}
+}
+
+static void	banded_fill(const PolyRasterizer<double>& raster, int width, int height, vector<float>& out, int threads)
+{
+	PolyRasterFill(raster, width, height, [&](int y, int x1, int x2) {
+		float * row = &out[(size_t) y * width];
+		for(int x = x1; x < x2; ++x)
+			row[x] += 1.0f;
+	}, threads);
+}
+
+int main(int argc, const char * argv[])
+{
+	int width = 8000, height = 6000;
+	int sides = 60;
+	int threads = 0;
+	int reps = 3;
+
+	for(int n = 1; n < argc; ++n)
+	{
+		if(strcmp(argv[n], "-size") == 0 && n + 2 < argc)			{ width = atoi(argv[++n]); height = atoi(argv[++n]); }
+		else if(strcmp(argv[n], "-sides") == 0 && n + 1 < argc)		sides = max(1, atoi(argv[++n]));
+		else if(strcmp(argv[n], "-threads") == 0 && n + 1 < argc)	threads = max(0, atoi(argv[++n]));
+		else if(strcmp(argv[n], "-reps") == 0 && n + 1 < argc)		reps = max(1, atoi(argv[++n]));
+		else
+		{
+			fprintf(stderr, "Usage: %s [-size <width> <height>] [-sides <max>] [-threads <n>] [-reps <n>]\n", argv[0]);
+			return 1;
+		}
+	}
+	if(width <= 0 || height <= 0)
+	{
+		fprintf(stderr, "Bad raster size %d x %d\n", width, height);
+		return 1;
+	}
+
+	PolyRasterizer<double>	raster;
+	make_stars(raster, width / 80 + 1, height / 60 + 1, sides);
+	printf("Filling %d x %d with %d edges, %d threads, %d times each.\n",
+		width, height, (int) raster.masters.size(), parallel_thread_count(threads), reps);
+
+	vector<float>	serial((size_t) width * height, 0.0f), banded((size_t) width * height, 0.0f);
+	{
+		StElapsedTime	timer("Serial fill");
+		for(int r = 0; r < reps; ++r)
+			serial_fill(raster, width, height, serial);
+	}
+	{
+		StElapsedTime	timer("Banded fill");
+		for(int r = 0; r < reps; ++r)
+			banded_fill(raster, width, height, banded, threads);
+	}
+
+	if(serial != banded)
+	{
+		size_t bad = 0;
+		for(size_t n = 0; n < serial.size(); ++n)
+		if(serial[n] != banded[n])
+			++bad;
+		printf("FAILED: %llu pixels differ.\n", (unsigned long long) bad);
+		return 1;
+	}
+	printf("Fills match.\n");
+	return 0;
+}
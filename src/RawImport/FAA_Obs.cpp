@@ -27,8 +27,8 @@
 #include "DEMDefs.h"
 #include "MapDefs.h"
 #include "MapAlgs.h"
+#include "MapIndex.h"
 #include "GISTool_Globals.h"
-#include <CGAL/Arr_walk_along_line_point_location.h>
 
 FAAObsTable		gFAAObs;
 
@@ -508,8 +508,7 @@ void ApplyObjects(Pmwx& ioMap)
 
 	int	placed = 0;
 
-//	CGAL::Arr_landmarks_point_location<Arrangement_2>	locator(gMap);
-	CGAL::Arr_walk_along_line_point_location<Arrangement_2>	locator(gMap);
+	MapIndex_t	index(ioMap);
 
 	for (FAAObsTable::iterator i = gFAAObs.begin(); i != gFAAObs.end(); ++i)
 	{
@@ -518,11 +517,9 @@ void ApplyObjects(Pmwx& ioMap)
 			Point_2 loc = Point_2(i->second.lon, i->second.lat);
 
 			DebugAssert(CGAL::is_valid(gMap));
-			CGAL::Object obj = locator.locate(loc);
-			Face_const_handle ff;
-			if(CGAL::assign(ff,obj))
+			Face_handle f = index.face_at_point(loc);
+			if(f != Face_handle())
 			{
-				Face_handle f = ioMap.non_const_handle(ff);
 				GISPointFeature_t	feat;
 					feat.mFeatType = i->second.kind;
 					feat.mLocation = loc;
@@ -1285,31 +1285,15 @@ bool	RasterShapeFile(
 	SHPClose(file);
 	if(db)	DBFClose(db);
 
+	// Features go one at a time since later ones paint over earlier ones - each one is filled in parallel bands.
 	for(map<int, PolyRasterizer<double> >::iterator r = rasterizers.begin(); r != rasterizers.end(); ++r)
 	{
 		r->second.SortMasters();
-		int x, y = 0;
-		r->second.StartScanline(y);
-		while (!r->second.DoneScan())
-		{
-			DebugAssert(y >= 0);
-			if (y >= dem.mHeight)
-				break;
-
-			int x1, x2;
-			while (r->second.GetRange(x1, x2))
-			{
-				x1 = max(x1,0);
-				x2 = min(x2,dem.mWidth);
-
-				for (x = x1; x < x2; ++x)
-				{
-					dem(x,y) = r->first;
-				}
-			}
-			++y;
-			r->second.AdvanceScanline(y);
-		}
+		float v = r->first;
+		PolyRasterFill(r->second, dem.mWidth, dem.mHeight, [&](int y, int x1, int x2) {
+			float * row = dem.mData + (size_t) y * dem.mWidth;
+			std::fill(row + x1, row + x2, v);
+		});
 	}
 
 	return true;
@@ -55,38 +55,14 @@ int g_color_face_use_supr_tint = 0;
 
 void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index)
 {
-	index.faces.clear();
-	vector<pair<Bbox2, Face_handle> >	faces;
-	faces.reserve(pmwx.number_of_faces());	
-	for(Pmwx::Face_iterator f = pmwx.faces_begin(); f != pmwx.faces_end(); ++f)
-	if(!f->is_unbounded())
+	if(index.map.arrangement() != &pmwx)
 	{
-		Pmwx::Ccb_halfedge_circulator circ, stop;
-		circ = stop = f->outer_ccb();
-		Bbox2	bbox(cgal2ben(circ->source()->point()));
-		do
-		{
-			bbox += cgal2ben(circ->source()->point());
-		} while(++circ != stop);
+		if(index.map.arrangement())
+			index.map.detach();
+		index.map.attach(pmwx);
+	}
+	index.map.rebuild();
 
-		faces.push_back(pair<Bbox2,Face_handle>(bbox, f));
-	}	
-	index.faces.insert(faces.begin(),faces.end());
-	faces.clear();
-	trim(faces);
-	
-	index.halfedges.clear();
-	vector<pair<Bbox2, Halfedge_handle> >	halfedges;
-	halfedges.reserve(pmwx.number_of_edges());	
-	for(Pmwx::Edge_iterator e = pmwx.edges_begin(); e != pmwx.edges_end(); ++e)
-	{
-		Bbox2	bbox(cgal2ben(e->source()->point()),cgal2ben(e->target()->point()));
-		halfedges.push_back(pair<Bbox2,Halfedge_handle>(bbox, e));
-	}	
-	index.halfedges.insert(halfedges.begin(),halfedges.end());	
-	halfedges.clear();
-	trim(halfedges);
-	
 	index.vertices.clear();
 	vector<pair<Bbox2, Vertex_handle> > vertices;
 	vertices.reserve(pmwx.number_of_vertices());	
@@ -657,8 +633,8 @@ void	DrawMapBucketed(
 //	double	screenWidth = screenRight - screenLeft;
 //	double	screenHeight = screenTop - screenBottom;
 
-	vector<PmwxIndex_t::FaceTree::item_type>		faces;
-	vector<PmwxIndex_t::HalfedgeTree::item_type>	halfedges;
+	vector<Face_handle>								faces;
+	vector<Halfedge_handle>							halfedges;
 	vector<PmwxIndex_t::VertexTree::item_type>		vertices;
 //	FindFaceTouchesRectFast(inMap,Point2(mapWest, mapSouth), Point2(mapEast, mapNorth), faces);
 //	FindHalfedgeTouchesRectFast(inMap,Point2(mapWest, mapSouth), Point2(mapEast, mapNorth), halfedges);
@@ -667,9 +643,9 @@ void	DrawMapBucketed(
 	Bbox2	box(Point2(mapWest,mapSouth),Point2(mapEast,mapNorth));
 
 	faces.reserve(inMap.number_of_faces());
-	inIndex.faces.query<back_insert_iterator<vector<PmwxIndex_t::FaceTree::item_type> > > (box,back_inserter(faces));
+	inIndex.map.faces_in_box(box, faces);
 	halfedges.reserve(inMap.number_of_edges());
-	inIndex.halfedges.query(box, back_inserter(halfedges));
+	inIndex.map.edges_in_box(box, halfedges);
 	vertices.reserve(inMap.number_of_vertices());
 	inIndex.vertices.query(box, back_inserter(vertices));
 	
@@ -691,9 +667,9 @@ void	DrawMapBucketed(
 	glDisable(GL_CULL_FACE);
 	glBegin(GL_TRIANGLES);
 
-	for (vector<PmwxIndex_t::FaceTree::item_type>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
+	for (vector<Face_handle>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
 	{
-		Pmwx::Face_handle f = fi->second;
+		Pmwx::Face_handle f = *fi;
 		if (!f->is_unbounded())
 		{
 			bool	sel = faceSel.count(f) > 0;
@@ -721,10 +697,10 @@ void	DrawMapBucketed(
 #if DRAW_EDGES
 	glBegin(GL_LINES);
 	int	width = 1;
-	for (vector<PmwxIndex_t::HalfedgeTree::item_type>::iterator he = halfedges.begin(); he != halfedges.end(); ++he)
+	for (vector<Halfedge_handle>::iterator he = halfedges.begin(); he != halfedges.end(); ++he)
 	for(int n = 0; n < 2; ++n)
 	{
-		Pmwx::Halfedge_handle e = n ? he->second->twin() : he->second;
+		Pmwx::Halfedge_handle e = n ? (*he)->twin() : *he;
 		{
 			glColor3ubv(e->data().mGLColor);
 			int wantWidth = (edgeSel.find(e) != edgeSel.end() || edgeSel.find(e->twin()) != edgeSel.end()) ? 2 : 1;
@@ -750,9 +726,9 @@ void	DrawMapBucketed(
 	 * DRAW POLYGON AND POINT OBJECTS INSIDE FACES
 	 ******************************************************************************************/
 #if DRAW_FEATURES
-	for (vector<PmwxIndex_t::FaceTree::item_type>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
+	for (vector<Face_handle>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
 	{
-		Pmwx::Face_handle f = fi->second;
+		Pmwx::Face_handle f = *fi;
 		if (!f->is_unbounded())
 		{
 			bool	draw = faceSel.count(f);
@@ -901,23 +877,23 @@ void	DrawMapBucketed(
 
 #if DRAW_FOOTPRINTS
 	glMatrixMode(GL_MODELVIEW);
-	for (vector<PmwxIndex_t::FaceTree::item_type>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
+	for (vector<Face_handle>::iterator fi = faces.begin(); fi != faces.end(); ++fi)
 	{
 		int n = 0;
-		bool	 fsel = faceSel.find(fi->second) != faceSel.end();
+		bool	 fsel = faceSel.find(*fi) != faceSel.end();
 		if (!fsel) continue;
-		for (int j = 0; j < fi->second->data().mObjs.size(); ++j)
+		for (int j = 0; j < (*fi)->data().mObjs.size(); ++j)
 		{
 			float shade = (float) (n % 10) / 20.0 + 0.1;
 			++n;
-			glColor4f(shade, shade, fi->second->data().mObjs[j].mDerived ? 1.0 : 0.0, 1.0);
+			glColor4f(shade, shade, (*fi)->data().mObjs[j].mDerived ? 1.0 : 0.0, 1.0);
 
-			double	x1 = CGAL::to_double(fi->second->data().mObjs[j].mLocation.x());
-			double	y1 = CGAL::to_double(fi->second->data().mObjs[j].mLocation.y());
-			double r = fi->second->data().mObjs[j].mHeading;
+			double	x1 = CGAL::to_double((*fi)->data().mObjs[j].mLocation.x());
+			double	y1 = CGAL::to_double((*fi)->data().mObjs[j].mLocation.y());
+			double r = (*fi)->data().mObjs[j].mHeading;
 
-			double	w = 0.5 * gRepTable[gRepFeatureIndex[fi->second->data().mObjs[j].mRepType]].width_min;
-			double	h = 0.5 * gRepTable[gRepFeatureIndex[fi->second->data().mObjs[j].mRepType]].depth_min;
+			double	w = 0.5 * gRepTable[gRepFeatureIndex[(*fi)->data().mObjs[j].mRepType]].width_min;
+			double	h = 0.5 * gRepTable[gRepFeatureIndex[(*fi)->data().mObjs[j].mRepType]].depth_min;
 
 			Point2	corners[4];
 			Quad_1to4(Point2(x1,y1), r, 2.0 * h, 2.0 * w, corners);
@@ -955,7 +931,7 @@ void	DrawMapBucketed(
 		}
 
 		for(int pass = 0; pass < 2; ++pass)
-		for (GISPolyObjPlacementVector::iterator j = fi->second->data().mPolyObjs.begin(); j != fi->second->data().mPolyObjs.end(); ++j)
+		for (GISPolyObjPlacementVector::iterator j = (*fi)->data().mPolyObjs.begin(); j != (*fi)->data().mPolyObjs.end(); ++j)
 		{
 			int is_string = strstr(FetchTokenString(j->mRepType),".ags") != NULL;		
 			int is_block = strstr(FetchTokenString(j->mRepType),".agb") != NULL;		
@@ -1081,14 +1057,14 @@ void	DrawMapBucketed(
 	glColor4f(0.0, 1.0, 1.0, 1.0);
 	glBegin(GL_POINTS);
 	int osz = 3;
-	for (vector<PmwxIndex_t::FaceTree::item_type>::iterator fi = faces.begin();
+	for (vector<Face_handle>::iterator fi = faces.begin();
 		fi != faces.end(); ++fi)
 	{
-		bool	 fsel = faceSel.find(fi->second) != faceSel.end();
-		for (int j = 0; j < fi->second->data().mPointFeatures.size(); ++j)
+		bool	 fsel = faceSel.find(*fi) != faceSel.end();
+		for (int j = 0; j < (*fi)->data().mPointFeatures.size(); ++j)
 		{
-			bool	isel = pointFeatureSel.find(PointFeatureSelection(fi->second, j)) != pointFeatureSel.end();
-			bool	has_height = fi->second->data().mPointFeatures[j].mParams.count(pf_Height) != 0;
+			bool	isel = pointFeatureSel.find(PointFeatureSelection(*fi, j)) != pointFeatureSel.end();
+			bool	has_height = (*fi)->data().mPointFeatures[j].mParams.count(pf_Height) != 0;
 			
 			int sz = has_height ? 4 : 2;
 			
@@ -1102,15 +1078,15 @@ void	DrawMapBucketed(
 
 			if (isel || fsel)
 				glColor4f(1.0, 1.0, 1.0, 1.0);
-			else if(gEnumColors.count(fi->second->data().mPointFeatures[j].mFeatType))
+			else if(gEnumColors.count((*fi)->data().mPointFeatures[j].mFeatType))
 			{
-				glColor3fv(gEnumColors[fi->second->data().mPointFeatures[j].mFeatType].rgb);
+				glColor3fv(gEnumColors[(*fi)->data().mPointFeatures[j].mFeatType].rgb);
 			}
 			else
 				glColor4f(0.0, 0.6, 0.6, 1.0);
 
-			double	x1 = CGAL::to_double(fi->second->data().mPointFeatures[j].mLocation.x());
-			double	y1 = CGAL::to_double(fi->second->data().mPointFeatures[j].mLocation.y());
+			double	x1 = CGAL::to_double((*fi)->data().mPointFeatures[j].mLocation.x());
+			double	y1 = CGAL::to_double((*fi)->data().mPointFeatures[j].mLocation.y());
 //			x1 = screenLeft + ((x1 - mapWest) * screenWidth / mapWidth);
 //			y1 = screenBottom + ((y1 - mapSouth) * screenHeight / mapHeight);
 			glVertex2f(x1, y1);
@@ -1208,78 +1184,56 @@ void	DrawMapBucketed(
 
 void		FindFaceTouchesPt(Pmwx& inMap, PmwxIndex_t& index, const Point2& p, vector<Face_handle>& outIDs)
 {
-	vector<Face_handle>	faces;
 	outIDs.clear();
-	index.faces.query_value(Bbox2(p), back_inserter(faces));
-	for (vector<Face_handle>::iterator ff = faces.begin(); ff != faces.end(); ++ff)
-	{
-		Face_handle f = *ff;
-//		printf("Scanning poly...\n");
-		Polygon2	pol;
-		Pmwx::Ccb_halfedge_circulator circ = f->outer_ccb(), stop = f->outer_ccb();
-		do {
-			pol.push_back(cgal2ben(circ->target()->point()));
-//			printf("  pt %lf,%lf\n",CGAL::to_double(circ->target()->point().x()),CGAL::to_double(circ->target()->point().y()));
-		} while(++circ != stop);
-
-		if(pol.inside(p))
-		{
-			bool in_hole = false;
-			for(Pmwx::Hole_iterator h = f->holes_begin(); h != f->holes_end(); ++h)
-			{
-				Polygon2 polh;
-				Pmwx::Ccb_halfedge_circulator circ = *h, stop = *h;
-				do {
-					polh.push_back(cgal2ben(circ->target()->point()));
-		//			printf("  pt %lf,%lf\n",CGAL::to_double(circ->target()->point().x()),CGAL::to_double(circ->target()->point().y()));
-				} while(--circ != stop);
-				if(polh.inside(p))
-				{
-					in_hole = true;
-						break;
-				}
-			}
-			if(!in_hole)
-				outIDs.push_back(f);
-		}
-	}
+	if(index.map.arrangement() == NULL)		// Not indexed yet - nothing is drawn, so nothing can be picked.
+		return;
+	Face_handle f = index.map.face_at_point(ben2cgal<Point_2>(p));
+	if(f != Face_handle() && !f->is_unbounded())
+		outIDs.push_back(f);
 }
 
 void		FindFaceTouchesRectFast(Pmwx& inMap, PmwxIndex_t& index, const Point2& p1, const Point2& p2, vector<Face_handle>& outIDs)
 {
 	Bbox2	sel(p1, p2);
 	outIDs.clear();
-	index.faces.query_value(sel, back_inserter(outIDs));
+	index.map.faces_in_box(sel, outIDs);
 }
 
 void		FindFaceFullyInRect(Pmwx& inMap, PmwxIndex_t& index, const Point2& p1, const Point2& p2, vector<Face_handle>& outIDs)
 {
 	outIDs.clear();
 	Bbox2	sel(p1,p2);
-	vector<PmwxIndex_t::FaceTree::item_type>	faces;
-	outIDs.clear();
-	index.faces.query(sel, back_inserter(faces));
-	for (vector<PmwxIndex_t::FaceTree::item_type>::iterator ff = faces.begin(); ff != faces.end(); ++ff)
-	if(sel.contains(ff->first))
-		outIDs.push_back(ff->second);
+	vector<Face_handle>	faces;
+	index.map.faces_in_box(sel, faces);
+	for (vector<Face_handle>::iterator ff = faces.begin(); ff != faces.end(); ++ff)
+	{
+		Pmwx::Ccb_halfedge_circulator circ, stop;
+		circ = stop = (*ff)->outer_ccb();
+		Bbox2	bbox(cgal2ben(circ->source()->point()));
+		do {
+			bbox += cgal2ben(circ->source()->point());
+		} while(++circ != stop);
+		if(sel.contains(bbox))
+			outIDs.push_back(*ff);
+	}
 }
 
 void		FindHalfedgeTouchesRectFast(Pmwx& inMap, PmwxIndex_t& index, const Point2& p1, const Point2& p2, vector<Halfedge_handle>& outIDs)
 {
 	outIDs.clear();
 	Bbox2 sel(p1,p2);
-	index.halfedges.query_value(sel,back_inserter(outIDs));
+	index.map.edges_in_box(sel, outIDs);
 }
 
 void		FindHalfedgeFullyInRect(Pmwx& inMap, PmwxIndex_t& index, const Point2& p1, const Point2& p2, vector<Halfedge_handle>& outIDs)
 {
 	outIDs.clear();
 	Bbox2 sel(p1,p2);
-	vector<PmwxIndex_t::HalfedgeTree::item_type>	edges;
-	index.halfedges.query(sel,back_inserter(edges));
-	for(vector<PmwxIndex_t::HalfedgeTree::item_type>::iterator e = edges.begin(); e != edges.end(); ++e)
-	if(sel.contains(e->first))
-		outIDs.push_back(e->second);
+	vector<Halfedge_handle>	edges;
+	index.map.edges_in_box(sel, edges);
+	for(vector<Halfedge_handle>::iterator e = edges.begin(); e != edges.end(); ++e)
+	if(sel.contains(Bbox2(cgal2ben((*e)->source()->point()), cgal2ben((*e)->target()->point()))))
+		outIDs.push_back(*e);
 }
 
 
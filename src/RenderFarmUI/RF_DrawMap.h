@@ -27,6 +27,7 @@
 #include "RF_Selection.h"
 #include "ProgressUtils.h"
 #include "RTree2.h"
+#include "MapIndex.h"
 
 extern int g_color_face_with_terr;
 extern int g_color_face_with_zone;
@@ -39,14 +40,13 @@ void	PrecalcOGL(Pmwx&						ioMap, ProgressFunc inFunc);
 void	RecalcOGLColors(Pmwx&					ioMap, ProgressFunc inFunc);
 
 
+// Faces and edges come from the shared map index, which follows edits to the map on its own.  MapIndex_t does
+// not index vertices, so those still get a tree of their own that IndexPmwx rebuilds.
 struct PmwxIndex_t {
 	PmwxIndex_t() { }
-	typedef	RTree2<Face_handle,16>		FaceTree;
-	typedef	RTree2<Halfedge_handle,16>	HalfedgeTree;
 	typedef RTree2<Vertex_handle,16>	VertexTree;
 
-	FaceTree		faces;
-	HalfedgeTree 	halfedges;
+	MapIndex_t		map;
 	VertexTree		vertices;
 
 	void	IndexPmwx(Pmwx& pmwx, PmwxIndex_t& index);
@@ -180,7 +180,7 @@ static	void	RF_HandleProcMenuCmd(void *, void * i)
 			RF_Notifiable::Notify(rf_Cat_File, rf_Msg_TriangleHiChange, NULL);
 			break;
 		case procCmd_DoAirports:
-			ProcessAirports(gApts, gMap, gDem[dem_Elevation], gDem[dem_UrbanTransport], true, true, true, RF_ProgressFunc);
+			ProcessAirports(gApts, gAptIndex, gMap, gDem[dem_Elevation], gDem[dem_UrbanTransport], true, true, true, RF_ProgressFunc);
 			RF_Notifiable::Notify(rf_Cat_File, rf_Msg_VectorChange, NULL);
 			RF_Notifiable::Notify(rf_Cat_File, rf_Msg_RasterChange, NULL);
 			break;
@@ -27,9 +27,11 @@
 #include <time.h>
 
 #include <errno.h>
+#include <atomic>
 #if LIN || APL
 #include <dirent.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "zip.h"
@@ -348,6 +350,38 @@ int FILE_rename_file(const char * old_name, const char * new_name)
 	return 0;
 }
 
+int FILE_replace_file(const char * old_name, const char * new_name)
+{
+#if IBM
+	if(!MoveFileExW(convert_str_to_utf16(old_name).c_str(), convert_str_to_utf16(new_name).c_str(), MOVEFILE_REPLACE_EXISTING)) return GetLastError();
+#endif
+#if LIN || APL
+	if(rename(old_name,new_name)<0)	return errno;
+#endif
+	return 0;
+}
+
+FILE * FILE_create_temp_beside(const string& path, string& out_temp_path)
+{
+	static std::atomic<int> temp_counter(0);
+#if IBM
+	unsigned long pid = GetCurrentProcessId();
+#else
+	unsigned long pid = getpid();
+#endif
+	for(int tries = 0; tries < 100; ++tries)
+	{
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), ".%lu.%d.tmp", pid, ++temp_counter);
+		out_temp_path = path + suffix;
+		FILE * fo = fopen(out_temp_path.c_str(), "wbx");
+		if(fo)
+			return fo;
+	}
+	out_temp_path.clear();
+	return NULL;
+}
+
 int FILE_get_directory(const string& path, vector<string> * out_files, vector<string> * out_dirs)
 {
 #if IBM
@@ -107,6 +107,16 @@ int FILE_read_file_to_string(const string& path, string& content);
 // Returns 0 for success, else last_error
 int FILE_rename_file(const char * old_name, const char * new_name);
 
+// Like FILE_rename_file, but replaces new_name if it exists, in one step - anyone opening new_name
+// gets either the old or the new file, never none.
+// Returns 0 for success, else last_error
+int FILE_replace_file(const char * old_name, const char * new_name);
+
+// Creates a new, empty file next to path, named path.<process id>.<n>.tmp and opened exclusively, so no other
+// thread or process can be writing the same file.  Write it, close it, then FILE_replace_file it over path.
+// Returns NULL on failure.
+FILE * FILE_create_temp_beside(const string& path, string& out_temp_path);
+
 // Create in_dir in its parent directory
 // Returns 0 for success, else last_error
 int FILE_make_dir(const char * in_dir);
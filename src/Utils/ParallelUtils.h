@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef ParallelUtils_H
+#define ParallelUtils_H
+
+/*
+	PARALLEL UTILS - THEORY OF OPERATION
+
+	These are the minimal building blocks for spreading independent work items over a few
+	threads.  They are std::thread based, just like WriteBitmapToDDS_MT.
+
+	parallel_for runs func(i) once for every i in [begin, end).  Items are handed out one at a
+	time from a shared counter, so slow items don't stall a whole pre-assigned range.  The
+	calling thread does work too and returns only once every item is done.  No order of
+	execution is guaranteed - if the results have to come out in order, have func write into
+	slot i of a pre-sized vector and merge them afterwards.
+
+	func must be thread safe with respect to itself.  Exceptions must NOT leave func.
+
+	Passing 0 for max_threads uses one thread per core.
+*/
+
+#include <thread>
+#include <atomic>
+
+inline int	parallel_thread_count(int max_threads = 0)
+{
+	int n = std::thread::hardware_concurrency();
+	if(n < 1) n = 1;
+	if(max_threads > 0 && max_threads < n) n = max_threads;
+	return n;
+}
+
+template <typename Func>
+void	parallel_for(int begin, int end, const Func& func, int max_threads = 0)
+{
+	int count = end - begin;
+	if(count <= 0) return;
+
+	int num_threads = min(parallel_thread_count(max_threads), count);
+	if(num_threads == 1)
+	{
+		for(int i = begin; i < end; ++i)
+			func(i);
+		return;
+	}
+
+	std::atomic<int>	next(begin);
+	auto worker = [&]() {
+		int i;
+		while((i = next++) < end)
+			func(i);
+	};
+
+	vector<std::thread>	helpers;
+	helpers.reserve(num_threads - 1);
+	for(int t = 1; t < num_threads; ++t)
+		helpers.push_back(std::thread(worker));
+	worker();
+	for(auto& h : helpers)
+		h.join();
+}
+
+#endif /* ParallelUtils_H */
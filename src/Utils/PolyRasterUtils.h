@@ -26,6 +26,7 @@
 #include <vector>
 #include <math.h>
 #include <assert.h>
+#include "ParallelUtils.h"
 using std::vector;
 
 // Set to 1 to do heavy checking of the rasterizer.
@@ -215,6 +216,25 @@ private:
 
 };
 
+/************************************************************************************************************************************
+ * BANDED FILL
+ ************************************************************************************************************************************
+ * A PolyRasterizer can only walk up its scanlines one at a time.  PolyRasterFill covers the common case of "visit every pixel in
+ * the polygon" by cutting the rows into bands and giving each band its own rasterizer, set up with just the segments that reach
+ * into that band, so bands scan in parallel.  It gives the same spans as walking the whole rasterizer from row 0 up, as long as
+ * the polygon is valid.
+ *
+ * span_func(y, x1, x2) is called for every span, already clipped to [0, width): x1 is inclusive, x2 exclusive.  Spans of one row
+ * come in order from one thread, but different rows run at the same time - so span_func may only touch its own row.  Filling
+ * the span with std::fill over the row's memory lets the compiler vectorize it.
+ *
+ * The rasterizer must have had SortMasters called; it is not changed.  0 threads means one per core.
+ *
+ */
+
+template<typename Number, typename SpanFunc>
+void	PolyRasterFill(const PolyRasterizer<Number>& raster, int width, int height, const SpanFunc& span_func, int max_threads = 0);
+
 /************************************************************************************************************************************
  * INLINE DEFINITIONS
  ************************************************************************************************************************************/
@@ -610,6 +630,50 @@ bool	BoxRasterizer<Number>::DoneScan()
 }
 
 
+// Bands smaller than this spend more time copying segments than scanning.
+#define POLY_RASTER_MIN_BAND_ROWS	64
+
+template<typename Number, typename SpanFunc>
+void	PolyRasterFill(const PolyRasterizer<Number>& raster, int width, int height, const SpanFunc& span_func, int max_threads)
+{
+	if(width <= 0 || height <= 0 || raster.masters.empty())
+		return;
+
+	int threads = parallel_thread_count(max_threads);
+	int bands = min(threads * 4, (height + POLY_RASTER_MIN_BAND_ROWS - 1) / POLY_RASTER_MIN_BAND_ROWS);
+
+	parallel_for(0, bands, [&](int b) {
+		int y_start = (long long) height *  b      / bands;
+		int y_stop  = (long long) height * (b + 1) / bands;
+
+		// The masters are sorted by y1, so everything past the first one that starts above the band can be skipped.
+		// The ones that end at or below the band start would be gone by the time a full scan got here.
+		PolyRasterizer<Number>	band;
+		for(typename vector<PolyRasterSeg_t<Number> >::const_iterator m = raster.masters.begin(); m != raster.masters.end() && m->y1 < y_stop; ++m)
+		if(m->y2 > y_start)
+			band.masters.push_back(*m);
+		if(band.masters.empty())
+			return;
+		band.SortMasters();
+
+		int y = y_start;
+		band.StartScanline(y);
+		while(!band.DoneScan())
+		{
+			int x1, x2;
+			while(band.GetRange(x1, x2))
+			{
+				x1 = max(x1, 0);
+				x2 = min(x2, width);
+				if(x1 < x2)
+					span_func(y, x1, x2);
+			}
+			if(++y >= y_stop)
+				break;
+			band.AdvanceScanline(y);
+		}
+	}, threads);
+}
 
 
 #endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "PolyRasterUtils.h"
+#include "AssertUtils.h"
+
+// One star polygon per 80x60 cell - star shaped, so always valid, and the cells keep them from overlapping.
+// Every few sets snap to whole pixels, so edges land exactly on scanlines and pixel centers.
+static void	make_stars(PolyRasterizer<double>& raster, int cols, int rows, int max_sides, bool snap)
+{
+	for(int p = 0; p < cols * rows; ++p)
+	{
+		double	cx = 40 + 80 * (p % cols);
+		double	cy = -20 + 60 * (p / cols);
+		double	rad = 5 + rand() % 25;
+		int		n = 3 + rand() % max_sides;
+		vector<double>	xs, ys;
+		for(int k = 0; k < n; ++k)
+		{
+			double a = 2.0 * M_PI * k / n;
+			double r = rad * (0.3 + 0.7 * (rand() % 1000) / 1000.0);
+			double x = cx + r * cos(a);
+			double y = cy + r * sin(a);
+			xs.push_back(snap ? round(x) : x);
+			ys.push_back(snap ? round(y) : y);
+		}
+		for(int k = 0; k < n; ++k)
+			raster.AddEdge(xs[k], ys[k], xs[(k + 1) % n], ys[(k + 1) % n]);
+	}
+	raster.SortMasters();
+}
+
+// The old way - walk one rasterizer up from row 0.
+static void	serial_fill(const PolyRasterizer<double>& raster, int width, int height, vector<float>& out)
+{
+	PolyRasterizer<double>	r(raster);
+	int y = 0;
+	r.StartScanline(y);
+	while(!r.DoneScan())
+	{
+		int x1, x2;
+		while(r.GetRange(x1, x2))
+		{
+			x1 = max(x1, 0);
+			x2 = min(x2, width);
+			for(int x = x1; x < x2; ++x)
+				out[y * width + x] += 1.0f;
+		}
+		if(++y >= height)
+			break;
+		r.AdvanceScanline(y);
+	}
+}
+
+// Adds rather than sets, so a span handed out twice or dropped shows up.
+static void	banded_fill(const PolyRasterizer<double>& raster, int width, int height, vector<float>& out, int max_threads)
+{
+	PolyRasterFill(raster, width, height, [&](int y, int x1, int x2) {
+		for(int x = x1; x < x2; ++x)
+			out[y * width + x] += 1.0f;
+	}, max_threads);
+}
+
+void	TEST_PolyRasterUtils(void)
+{
+	srand(7);
+
+	// Lots of small sets: odd heights, stars hanging off the bottom and right edges, every band count.
+	for(int trial = 0; trial < 100; ++trial)
+	{
+		int		w = 300;
+		int		h = 200 + trial;
+		PolyRasterizer<double>	raster;
+		make_stars(raster, 4, 1 + rand() % 5, 30, trial % 3 == 0);
+
+		vector<float>	serial(w * h, 0.0f), banded(w * h, 0.0f);
+		serial_fill(raster, w, h, serial);
+		banded_fill(raster, w, h, banded, 1 + trial % 8);
+		TEST_Run(serial == banded);
+	}
+
+	// One big set, banded with one thread per core.
+	int		w = 4000;
+	int		h = 3000;
+	PolyRasterizer<double>	raster;
+	make_stars(raster, w / 80, h / 60 + 1, 60, false);
+
+	vector<float>	serial(w * h, 0.0f), banded(w * h, 0.0f);
+	serial_fill(raster, w, h, serial);
+	banded_fill(raster, w, h, banded, 0);
+	TEST_Run(serial == banded);
+}
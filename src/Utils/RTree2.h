@@ -26,6 +26,7 @@
 
 #include "CompGeomDefs2.h"
 #include <stdint.h>
+#include <float.h>
 
 // Quick aside:
 // A tagged ptr is a ptr + a boolean flag - because ptrs are always 4-byte aligned for dynamic memory.
@@ -65,18 +66,33 @@ public:
 	void	clear() { if(root) delete root; root = NULL; }
 	
 	template <typename O>
-	void	query(const Bbox2& where, O out);						// This results item_type ptrs.
+	void	query(const Bbox2& where, O out) const;					// This results item_type ptrs.
 	template <typename O>
-	void	query_value(const Bbox2& where, O out);					// This returns only the value, not the key.
+	void	query_value(const Bbox2& where, O out) const;			// This returns only the value, not the key.
+
+	// The item whose key is closest to p - a key containing p is at distance 0 - or NULL if the tree is empty.
+	// Distance is plain euclidean distance in key units.
+	const item_type *	query_nearest(const Point2& p) const;
 	
 private:
 	struct node;
 	struct leaf;
 
 	template <typename O>
-	void	query_recursive(node * node, const Bbox2& where, O out);
+	void	query_recursive(node * node, const Bbox2& where, O out) const;
 	template <typename O>
-	void	query_value_recursive(node * node, const Bbox2& where, O out);
+	void	query_value_recursive(node * node, const Bbox2& where, O out) const;
+	void	query_nearest_recursive(node * node, const Point2& p, const item_type *& best, double& best_d2) const;
+
+	RTree2(const RTree2&);					// The nodes are owned by raw ptrs - no copying!
+	RTree2& operator=(const RTree2&);
+
+	static double	squared_distance(const Bbox2& b, const Point2& p)
+	{
+		double dx = max(0.0, max(b.xmin() - p.x(), p.x() - b.xmax()));
+		double dy = max(0.0, max(b.ymin() - p.y(), p.y() - b.ymax()));
+		return dx * dx + dy * dy;
+	}
 	
 	node *	insert_range(int level, typename vector<item_type>::iterator begin, typename  vector<item_type>::iterator end);
 
@@ -143,7 +159,7 @@ private:
 
 template<typename T, int N>
 template <typename O>
-void	RTree2<T,N>::query(const Bbox2& where, O out)
+void	RTree2<T,N>::query(const Bbox2& where, O out) const
 {
 	if(root && where.overlap(root->bounds))
 		query_recursive(root, where,out);
@@ -151,7 +167,7 @@ void	RTree2<T,N>::query(const Bbox2& where, O out)
 
 template<typename T, int N>
 template <typename O>
-void	RTree2<T,N>::query_value(const Bbox2& where, O out)
+void	RTree2<T,N>::query_value(const Bbox2& where, O out) const
 {
 	if(root && where.overlap(root->bounds))
 		query_value_recursive(root, where,out);
@@ -159,7 +175,7 @@ void	RTree2<T,N>::query_value(const Bbox2& where, O out)
 
 template<typename T, int N>
 template <typename O>
-void	RTree2<T,N>::query_recursive(node * node, const Bbox2& where, O out)
+void	RTree2<T,N>::query_recursive(node * node, const Bbox2& where, O out) const
 {
 	if(where.overlap(node->left_as_leaf()->bounds))
 	{
@@ -195,7 +211,7 @@ void	RTree2<T,N>::query_recursive(node * node, const Bbox2& where, O out)
 
 template<typename T, int N>
 template <typename O>
-void	RTree2<T,N>::query_value_recursive(node * node, const Bbox2& where, O out)
+void	RTree2<T,N>::query_value_recursive(node * node, const Bbox2& where, O out) const
 {
 	if(where.overlap(node->left_as_leaf()->bounds))
 	{
@@ -229,6 +245,51 @@ void	RTree2<T,N>::query_value_recursive(node * node, const Bbox2& where, O out)
 	}
 }
 
+template<typename T, int N>
+const typename RTree2<T,N>::item_type *	RTree2<T,N>::query_nearest(const Point2& p) const
+{
+	const item_type *	best = NULL;
+	double				best_d2 = DBL_MAX;
+	if(root)
+		query_nearest_recursive(root, p, best, best_d2);
+	return best;
+}
+
+// Branch and bound: descend into the closer child first, and skip any subtree whose box is already farther
+// away than the best item so far.
+template<typename T, int N>
+void	RTree2<T,N>::query_nearest_recursive(node * node, const Point2& p, const item_type *& best, double& best_d2) const
+{
+	bool	is_leaf[2] = { node->left_is_leaf(), node->right_is_leaf() };
+	leaf *	kids[2] = { node->left_as_leaf(), node->right_as_leaf() };		// leaf or node - both start with their bounds
+	double	d2[2];
+	for(int k = 0; k < 2; ++k)
+		d2[k] = kids[k]->bounds.is_null() ? DBL_MAX : squared_distance(kids[k]->bounds, p);
+
+	int first = d2[1] < d2[0] ? 1 : 0;
+	for(int i = 0; i < 2; ++i)
+	{
+		int k = i ? 1 - first : first;
+		if(d2[k] >= best_d2)
+			continue;
+		if(is_leaf[k])
+		{
+			for(int n = 0; n < kids[k]->count; ++n)
+			if(!kids[k]->items[n].first.is_null())
+			{
+				double d = squared_distance(kids[k]->items[n].first, p);
+				if(d < best_d2)
+				{
+					best_d2 = d;
+					best = &kids[k]->items[n];
+				}
+			}
+		}
+		else
+			query_nearest_recursive(reinterpret_cast<struct node *>(kids[k]), p, best, best_d2);
+	}
+}
+
 template<typename T, int N>
 template <typename I>
 void	RTree2<T,N>::insert(I begin, I end)
@@ -238,7 +299,7 @@ void	RTree2<T,N>::insert(I begin, I end)
 		root = NULL;
 	else {
 		vector<item_type>	container(begin,end);
-		root = insert_range(0, begin, end);
+		root = insert_range(0, container.begin(), container.end());
 	}
 }
 
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "RTree2.h"
+#include "AssertUtils.h"
+
+static double	box_point_d2(const Bbox2& b, const Point2& p)
+{
+	double dx = p.x() < b.xmin() ? b.xmin() - p.x() : (p.x() > b.xmax() ? p.x() - b.xmax() : 0.0);
+	double dy = p.y() < b.ymin() ? b.ymin() - p.y() : (p.y() > b.ymax() ? p.y() - b.ymax() : 0.0);
+	return dx * dx + dy * dy;
+}
+
+static double	rand_coord(double range)
+{
+	return range * (double) rand() / (double) RAND_MAX;
+}
+
+// query_nearest must find an item at the same distance as a brute force search - ties may pick either item.
+static void	TEST_NearestMatchesBruteForce(int item_count, int query_count)
+{
+	typedef RTree2<int, 8>	tree_t;
+	vector<tree_t::item_type>	items;
+	for(int n = 0; n < item_count; ++n)
+	{
+		Point2	p(rand_coord(1000.0), rand_coord(1000.0));
+		items.push_back(tree_t::item_type(Bbox2(p, Point2(p.x() + rand_coord(20.0), p.y() + rand_coord(20.0))), n));
+	}
+
+	tree_t	tree;
+	tree.insert(items.begin(), items.end());
+
+	for(int q = 0; q < query_count; ++q)
+	{
+		Point2 p(rand_coord(1200.0) - 100.0, rand_coord(1200.0) - 100.0);
+		double best = DBL_MAX;
+		for(int n = 0; n < item_count; ++n)
+			best = min(best, box_point_d2(items[n].first, p));
+
+		const tree_t::item_type * found = tree.query_nearest(p);
+		TEST_Run(found != NULL);
+		if(found)
+		{
+			TEST_Run(box_point_d2(found->first, p) == best);
+			TEST_Run(found->second >= 0 && found->second < item_count && items[found->second].first == found->first);
+		}
+	}
+}
+
+void	TEST_RTree2(void)
+{
+	srand(1234);
+
+	// Empty tree
+	RTree2<int, 8>	empty;
+	TEST_Run(empty.query_nearest(Point2(0, 0)) == NULL);
+
+	// A key containing the point is at distance 0 and wins over a closer-looking small box.
+	vector<RTree2<int, 8>::item_type>	two;
+	two.push_back(RTree2<int, 8>::item_type(Bbox2(0, 0, 100, 100), 1));
+	two.push_back(RTree2<int, 8>::item_type(Bbox2(51, 51, 52, 52), 2));
+	RTree2<int, 8>	small;
+	small.insert(two.begin(), two.end());
+	TEST_Run(small.query_nearest(Point2(50, 50))->second == 1);
+	TEST_Run(small.query_nearest(Point2(200, 51.5))->second == 1);
+	TEST_Run(small.query_nearest(Point2(-10, -10))->second == 1);
+
+	// Fewer items than a leaf holds, a few leaves, many leaves.
+	TEST_NearestMatchesBruteForce(1, 50);
+	TEST_NearestMatchesBruteForce(5, 200);
+	TEST_NearestMatchesBruteForce(37, 500);
+	TEST_NearestMatchesBruteForce(5000, 2000);
+}
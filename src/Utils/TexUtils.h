@@ -38,6 +38,9 @@ enum {
 
 };
 
+// Removes the row padding of a bitmap in place.  Touches no GL state, so it may be done on a worker thread.
+void UnpadImage(ImageInfo * im);
+
 bool LoadTextureFromFile(
 				const char * 	inFileName,
 				int 			inTexNum,
@@ -47,6 +47,8 @@
 #include "GUI_Splitter.h"
 
 #include "WED_FileCache.h"
+#include "XObjBinCache.h"
+#include "PlatformUtils.h"
 
 #define	REGISTER_LIST	\
 	_R(WED_Airport) \
@@ -176,6 +178,9 @@ int main(int argc, char * argv[])
 
 	start->ShowMessage("Initializing WED File Cache");
 	gFileCache.init();
+	string os_cache = GetCacheFolder();
+	if(!os_cache.empty())
+		XObjBinCache_Init(os_cache + DIR_STR "wed_obj_cache", 256);
   //	start->ShowMessage("Loading DEM tables...");
 //	LoadDEMTables();
 //	start->ShowMessage("Loading OBJ tables...");
@@ -30,7 +30,16 @@
 #include "AssertUtils.h"
 #include "WED_Errors.h"
 #include "WED_XMLWriter.h"
+#include "WED_Snapshot.h"
 #include "WED_Messages.h"
+#include "ParallelUtils.h"
+
+// Objects are formatted into private outputs in runs of this many objects, a batch of runs
+// at a time, so the memory bubble stays around (cores * 4 * XML_OBJS_PER_RUN) objects' worth of text.
+#define XML_OBJS_PER_RUN 2000
+
+// Shared by all archives, so a stamp never repeats even if an archive is reopened at the same address.
+static long long sChangeStamp = 0;
 
 WED_Archive::WED_Archive(IResolver * r) : mResolver(r), mDying(false), mUndo(NULL), mUndoMgr(NULL),
  #if WITHNWLINK
@@ -69,6 +78,7 @@ void		WED_Archive::ChangedObject(WED_Persistent * inObject, int change_kind)
 {
 	if (mDying) return;
 	++mCacheKey;
+	inObject->SetChangeStamp(++sChangeStamp);
 #if WITHNWLINK
 	if (mNWAdapter) mNWAdapter->ObjectChanged(inObject, change_kind);
 #endif
@@ -81,6 +91,7 @@ void		WED_Archive::AddObject(WED_Persistent * inObject)
 {
 	if (mDying) return;
 	++mCacheKey;
+	inObject->SetChangeStamp(++sChangeStamp);
 	mID = max(mID,inObject->GetID()+1);
 	ObjectMap::iterator iter = mObjects.find(inObject->GetID());
 	DebugAssert(iter == mObjects.end() || iter->second == NULL);
@@ -125,15 +136,107 @@ void			WED_Archive::SaveToXML(WED_XMLElement * parent)
 	// old code bumps cache key on save...wHY?!
 	//++mCacheKey;
 	WED_XMLElement * obj = parent->add_sub_element("objects");
+
+	// ToXML only reads the objects, so runs of them can be formatted on worker threads.  The
+	// runs are spliced back in hash order, so the file is exactly what a serial save writes.
+	vector<WED_Persistent *> objs;
+	objs.reserve(mObjects.size());
 	for (ObjectMap::iterator ob = mObjects.begin(); ob != mObjects.end(); ++ob)
 	if(ob->second != NULL)
+		objs.push_back(ob->second);
+
+	int runs = (objs.size() + XML_OBJS_PER_RUN - 1) / XML_OBJS_PER_RUN;
+	int batch = parallel_thread_count() * 4;
+
+	for(int b = 0; b < runs; b += batch)
 	{
-		ob->second->ToXML(obj);
-		obj->flush();
+		int e = min(runs, b + batch);
+		vector<WED_XMLOutput> formatted(e - b);
+
+		parallel_for(b, e, [&](int r) {
+			WED_XMLElement	frag(*obj, &formatted[r - b]);
+			int last = min((int) objs.size(), (r + 1) * XML_OBJS_PER_RUN);
+			for(int n = r * XML_OBJS_PER_RUN; n < last; ++n)
+			{
+				objs[n]->ToXML(&frag);
+				frag.flush();
+			}
+		});
+
+		for(int r = 0; r < formatted.size(); ++r)
+			obj->splice_children(formatted[r]);
 	}
 
 	mOpCount = 0;
 }
+void			WED_Archive::SaveToSnapshot(WED_SnapshotWriter * writer)
+{
+	int count = 0;
+	for (ObjectMap::iterator ob = mObjects.begin(); ob != mObjects.end(); ++ob)
+	if(ob->second != NULL)
+		++count;
+
+	// Each object carries its class's layout signature, so the loader can refuse a snapshot
+	// whose classes have changed shape since - see WED_Snapshot.h.
+	map<const char *, int>	signatures;
+	writer->WriteInt(count);
+	for (ObjectMap::iterator ob = mObjects.begin(); ob != mObjects.end(); ++ob)
+	if(ob->second != NULL)
+	{
+		const char * class_name = ob->second->GetClass();
+		map<const char *, int>::iterator sig = signatures.find(class_name);
+		if(sig == signatures.end())
+			sig = signatures.insert(make_pair(class_name, WED_SnapshotClassSignature(ob->second))).first;
+
+		writer->WriteString(class_name);
+		writer->WriteInt(ob->first);
+		writer->WriteInt(sig->second);
+		ob->second->WriteTo(writer);
+	}
+}
+
+bool			WED_Archive::LoadFromSnapshot(WED_SnapshotReader * reader)
+{
+	vector<WED_Persistent *>	needs_post_call;
+	map<const char *, int>		signatures;
+	string						class_name;
+	int							count, id, sig;
+
+	reader->ReadInt(count);
+	for(int n = 0; n < count && reader->IsOK(); ++n)
+	{
+		reader->ReadString(class_name);
+		reader->ReadInt(id);
+		reader->ReadInt(sig);
+		if(!reader->IsOK() || id <= 0 || Fetch(id) != NULL)
+			return false;
+
+		WED_Persistent * new_obj = WED_Persistent::CreateByClass(class_name.c_str(), this, id);
+		if(new_obj == NULL)
+			return false;
+
+		// Refuse to stream into a class whose properties differ from the ones that were written.
+		map<const char *, int>::iterator known = signatures.find(new_obj->GetClass());
+		if(known == signatures.end())
+			known = signatures.insert(make_pair(new_obj->GetClass(), WED_SnapshotClassSignature(new_obj))).first;
+		if(known->second != sig)
+			return false;
+
+		if(new_obj->ReadFrom(reader))
+			needs_post_call.push_back(new_obj);
+	}
+	if(!reader->IsOK())
+		return false;
+
+	for(vector<WED_Persistent *>::iterator o = needs_post_call.begin(); o != needs_post_call.end(); ++o)
+		(*o)->PostChangeNotify();
+
+	// Same as finishing an XML read - we match what is on disk.
+	mOpCount = 0;
+	++mCacheKey;
+	return true;
+}
+
 #if WITHNWLINK
 void			WED_Archive::SetNWLinkAdapter(WED_NWLinkAdapter * inAdapter)
 {
@@ -50,6 +50,8 @@ class	WED_Persistent;
 class	WED_UndoLayer;
 class	WED_UndoMgr;
 class	WED_XMLElement;
+class	WED_SnapshotReader;
+class	WED_SnapshotWriter;
 class	IResolver;
 #if WITHNWLINK
 class	WED_NWLinkAdapter;
@@ -77,6 +79,11 @@ public:
 
 	void			ClearAll(void);
 	void			SaveToXML(WED_XMLElement * parent);
+
+	// Binary dump of all objects for WED_Snapshot.  Load must happen inside a command on an
+	// empty archive; it returns false if the snapshot is corrupt, leaving any loaded objects behind.
+	void			SaveToSnapshot(WED_SnapshotWriter * writer);
+	bool			LoadFromSnapshot(WED_SnapshotReader * reader);
 #if WITHNWLINK
 	void			SetNWLinkAdapter(WED_NWLinkAdapter * inAdapter);
 #endif
@@ -41,6 +41,8 @@
 #include "WED_Messages.h"
 #include "WED_EnumSystem.h"
 #include "WED_XMLWriter.h"
+#include "WED_Snapshot.h"
+#include "MemFileUtils.h"
 #include "WED_Errors.h"
 #include "WED_TexMgr.h"
 #include "WED_LibraryMgr.h"
@@ -69,6 +71,9 @@ int gModeratorMode;
 int gFontSize;
 string gCustomSlippyMap;
 int gOrthoExport;
+int gSnapshot;
+int gSlippyMapCacheMB;
+int gTextureCacheMB;
 
 static set<WED_Document *> sDocuments;
 static map<string,string>	sGlobalPrefs;
@@ -246,6 +251,7 @@ void	WED_Document::Save(void)
 		StElapsedTime	etime("Save time");
 #endif
 		WriteXML(xml_file);
+		ferrorErr = ferror(xml_file);
 	}
 	int fcloseErr = fclose(xml_file);
 	if(ferrorErr != 0 || fcloseErr != 0)
@@ -281,6 +287,7 @@ void	WED_Document::Save(void)
 	{
 		// This is the save-was-okay case.
 		mOnDisk=true;
+		WriteSnapshot(xml);
 	}
 	
 	//if the second backup still exists after the error handling
@@ -313,9 +320,11 @@ void	WED_Document::Revert(void)
 		fname+=".xml";
 		mArchive.ClearAll();
 
-		// First: try to IO the XML file.
-		bool xml_exists;
-		string result = reader.ReadFile(fname.c_str(),&xml_exists);
+		// First: try the binary snapshot of the XML file, then the XML file itself.
+		bool xml_exists = true;
+		string result;
+		if(!ReadSnapshot(fname))
+			result = reader.ReadFile(fname.c_str(),&xml_exists);
 
 		if(xml_exists && !result.empty())
 			WED_ThrowPrintf("Unable to open XML file: %s",result.c_str());
@@ -581,6 +590,9 @@ void	WED_Document::ReadGlobalPrefs(void)
 	gFontSize = intlim(FontSize, 10, 18);
 	GUI_SetFontSizes(gFontSize);
 	gOrthoExport = atoi(GUI_GetPrefString("preferences","OrthoExport","1"));
+	gSnapshot = atoi(GUI_GetPrefString("preferences","Snapshot","1"));
+	gSlippyMapCacheMB = intlim(atoi(GUI_GetPrefString("preferences","SlippyMapCacheMB","256")), 16, 4096);
+	gTextureCacheMB = intlim(atoi(GUI_GetPrefString("preferences","TextureCacheMB","1024")), 64, 16384);
 }
 
 void	WED_Document::WriteGlobalPrefs(void)
@@ -591,6 +603,9 @@ void	WED_Document::WriteGlobalPrefs(void)
 	string FontSize(to_string(gFontSize));
 	GUI_SetPrefString("preferences","FontSize",FontSize.c_str());
 	GUI_SetPrefString("preferences","OrthoExport",gOrthoExport ? "1" : "0");
+	GUI_SetPrefString("preferences","Snapshot",gSnapshot ? "1" : "0");
+	GUI_SetPrefString("preferences","SlippyMapCacheMB",to_string(gSlippyMapCacheMB).c_str());
+	GUI_SetPrefString("preferences","TextureCacheMB",to_string(gTextureCacheMB).c_str());
 	
 	for (map<string,string>::iterator i = sGlobalPrefs.begin(); i != sGlobalPrefs.end(); ++i)
 		GUI_SetPrefString("doc_prefs", i->first.c_str(), i->second.c_str());
@@ -697,10 +712,11 @@ void WED_Document::Panic(void)
 void		WED_Document::WriteXML(FILE * xml_file)
 {
 	//print to file the xml file passed in with the following encoding
-	fprintf(xml_file,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-	fprintf(xml_file,"<!-- written by WED " WED_VERSION_STRING " -->\n");
+	WED_XMLOutput	out(xml_file);
+	out.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+	out.write("<!-- written by WED " WED_VERSION_STRING " -->\n");
 	{
-		WED_XMLElement	top_level("doc",0,xml_file);
+		WED_XMLElement	top_level("doc",0,&out);
 		mArchive.SaveToXML(&top_level);
 		WED_XMLElement * pref;
 		WED_XMLElement * prefs = top_level.add_sub_element("prefs");
@@ -723,4 +739,120 @@ void		WED_Document::WriteXML(FILE * xml_file)
 	}
 }
 
+void		WED_Document::WriteSnapshot(const string& xml_path)
+{
+	string snap = mFilePath + ".snapshot";
+	if(!gSnapshot)
+	{
+		if(FILE_exists(snap.c_str()))
+			FILE_delete_file(snap.c_str(), false);
+		return;
+	}
+
+	// Written aside and renamed into place, so a crash mid-write never leaves a half-written snapshot.
+	string tmp;
+	FILE * snap_file = FILE_create_temp_beside(snap, tmp);
+	if(snap_file == NULL)
+		return;
+
+	bool ok;
+	{
+#if DEV
+		StElapsedTime	etime("Snapshot write time");
+#endif
+		WED_SnapshotWriter	writer(snap_file);
+		ok = WED_SnapshotWriteHeader(&writer, xml_path);
+		if(ok)
+		{
+			mArchive.SaveToSnapshot(&writer);
+
+			writer.WriteInt(mDocPrefs.size());
+			for(map<string,string>::iterator p = mDocPrefs.begin(); p != mDocPrefs.end(); ++p)
+			{
+				writer.WriteString(p->first);
+				writer.WriteString(p->second);
+			}
+			writer.WriteInt(mDocPrefsItems.size());
+			for(map<string,set<int> >::iterator pi = mDocPrefsItems.begin(); pi != mDocPrefsItems.end(); ++pi)
+			{
+				writer.WriteString(pi->first);
+				writer.WriteInt(pi->second.size());
+				for(set<int>::iterator i = pi->second.begin(); i != pi->second.end(); ++i)
+					writer.WriteInt(*i);
+			}
+			ok = writer.Finish();
+		}
+	}
+	if(fclose(snap_file) != 0)
+		ok = false;
 
+	// If we can't replace it, the old snapshot would fail its XML check anyway - but don't leave it around.
+	if(!ok || FILE_replace_file(tmp.c_str(), snap.c_str()) != 0)
+	{
+		FILE_delete_file(tmp.c_str(), false);
+		FILE_delete_file(snap.c_str(), false);
+	}
+}
+
+bool		WED_Document::ReadSnapshot(const string& xml_path)
+{
+	string snap = mFilePath + ".snapshot";
+	if(!gSnapshot || !FILE_exists(snap.c_str()))
+		return false;
+
+	MFMemFile * mf = MemFile_Open(snap.c_str());
+	if(mf == NULL)
+		return false;
+
+	WED_SnapshotReader	reader(MemFile_GetBegin(mf), MemFile_GetEnd(mf));
+	bool ok = WED_SnapshotCheckHeader(&reader, xml_path, snap);
+	if(ok)
+	{
+#if DEV
+		StElapsedTime	etime("Snapshot read time");
+#endif
+		// The header vouches for the bytes, but anything that goes wrong from here on just means
+		// "read the XML instead" - never a document that fails to open.
+		try {
+			ok = mArchive.LoadFromSnapshot(&reader);
+			if(ok)
+			{
+				mDocPrefs.clear();
+				mDocPrefsItems.clear();
+				string k, v;
+				int count, items, item;
+				reader.ReadInt(count);
+				for(int n = 0; n < count && reader.IsOK(); ++n)
+				{
+					reader.ReadString(k);
+					reader.ReadString(v);
+					mDocPrefs[k] = v;
+				}
+				reader.ReadInt(count);
+				for(int n = 0; n < count && reader.IsOK(); ++n)
+				{
+					reader.ReadString(k);
+					reader.ReadInt(items);
+					set<int>& ip(mDocPrefsItems[k]);
+					for(int i = 0; i < items && reader.IsOK(); ++i)
+					{
+						reader.ReadInt(item);
+						ip.insert(item);
+					}
+				}
+				ok = reader.Finish();
+			}
+		} catch(...) {
+			ok = false;
+		}
+
+		if(!ok)
+		{
+			mArchive.ClearAll();
+			mDocPrefs.clear();
+			mDocPrefsItems.clear();
+		}
+	}
+	MemFile_Close(mf);
+	return ok;
+}
@@ -133,6 +133,8 @@ public:
 
 private:
 	void				WriteXML(FILE * fi);
+	void				WriteSnapshot(const string& xml_path);
+	bool				ReadSnapshot(const string& xml_path);
 
 	//Member Variables
 
@@ -28,6 +28,20 @@ vector<pair<Point2,Point3> >		gMeshPoints;
 vector<pair<Point2,Point3> >		gMeshLines;
 vector<pair<Polygon2,Point3> >		gMeshPolygons;
 
+static thread_local debug_mesh_t *	sMeshDest = NULL;
+
+void	debug_mesh_redirect(debug_mesh_t * dest)
+{
+	sMeshDest = dest;
+}
+
+void	debug_mesh_append(const debug_mesh_t& src)
+{
+	gMeshPoints.insert(gMeshPoints.end(), src.points.begin(), src.points.end());
+	gMeshLines.insert(gMeshLines.end(), src.lines.begin(), src.lines.end());
+	gMeshPolygons.insert(gMeshPolygons.end(), src.polygons.begin(), src.polygons.end());
+}
+
 void	debug_mesh_bbox(const Bbox2& bb1, float r1, float g1, float b1, float r2, float g2, float b2)
 {
 	debug_mesh_segment(bb1.left_side(),   r1, g1, b1, r2, g2, b2);
@@ -43,18 +57,19 @@ void	debug_mesh_segment(const Segment2& s1, float r1, float g1, float b1, float
 
 void	debug_mesh_line(const Point2& p1, const Point2& p2, float r1, float g1, float b1, float r2, float g2, float b2)
 {
-	gMeshLines.push_back(pair<Point2,Point3>(p1,Point3(r1,g1,b1)));
-	gMeshLines.push_back(pair<Point2,Point3>(p2,Point3(r2,g2,b2)));
+	vector<pair<Point2,Point3> >& lines(sMeshDest ? sMeshDest->lines : gMeshLines);
+	lines.push_back(pair<Point2,Point3>(p1,Point3(r1,g1,b1)));
+	lines.push_back(pair<Point2,Point3>(p2,Point3(r2,g2,b2)));
 }
 
 void	debug_mesh_point(const Point2& p1, float r1, float g1, float b1)
 {
-	gMeshPoints.push_back(pair<Point2,Point3>(p1,Point3(r1,g1,b1)));
+	(sMeshDest ? sMeshDest->points : gMeshPoints).push_back(pair<Point2,Point3>(p1,Point3(r1,g1,b1)));
 }
 
 void	debug_mesh_polygon(const Polygon2& p1, float r1, float g1, float b1)
 {
-	gMeshPolygons.push_back(pair<Polygon2,Point3>(p1,Point3(r1,g1,b1)));
+	(sMeshDest ? sMeshDest->polygons : gMeshPolygons).push_back(pair<Polygon2,Point3>(p1,Point3(r1,g1,b1)));
 }
 #endif
 
@@ -39,6 +39,19 @@ void	debug_mesh_line(const Point2& p1, const Point2& p2, float r1, float g1, flo
 void	debug_mesh_point(const Point2& p1, float r1, float g1, float b1);
 void	debug_mesh_polygon(const Polygon2& p1, float r1, float g1, float b1);
 
+// While a thread has a debug mesh set, its debug_mesh_ calls go there instead of into the globals above.
+// This lets work running on several threads keep its lines apart and hand them over in a defined order.
+struct	debug_mesh_t {
+	vector<pair<Point2,Point3> >	points;
+	vector<pair<Point2,Point3> >	lines;
+	vector<pair<Polygon2,Point3> >	polygons;
+
+	void	clear(void) { points.clear(); lines.clear(); polygons.clear(); }
+};
+
+void	debug_mesh_redirect(debug_mesh_t * dest);			// NULL to go back to the globals
+void	debug_mesh_append(const debug_mesh_t& src);			// copies into the globals
+
 #endif /* DEV */
 
 /* Is WED running in English or metric units?  (feet == 0 -> metric.) */
@@ -51,6 +64,8 @@ extern int gModeratorMode;
 extern int gFontSize;
 /* Switch format for orthophoto tiles export */
 extern int gOrthoExport;
+/* Write and use earth.wed.snapshot to speed up opening documents */
+extern int gSnapshot;
 
 enum WED_Export_Target {
 		wet_xplane_900,		// X-Plane 9-compatible DSFs.
@@ -68,5 +83,9 @@ extern WED_Export_Target gExportTarget;
 
 /* Changes the listing in the gateway Import for GW moderation purposes */
 extern string gCustomSlippyMap;
+/* Texture memory the slippy map may keep cached tiles in */
+extern int gSlippyMapCacheMB;
+/* Texture memory documents may keep textures of the scenery and library in */
+extern int gTextureCacheMB;
 
 #endif
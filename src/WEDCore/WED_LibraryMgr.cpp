@@ -29,7 +29,10 @@
 #include "FileUtils.h"
 #include "PlatformUtils.h"
 #include "MemFileUtils.h"
+#include "ParallelUtils.h"
 #include <time.h>
+#include <atomic>
+#include <mutex>
 
 void WED_clean_vpath(string& s)
 {
@@ -98,7 +101,7 @@ static int is_direct_parent(const string& parent, const string& child)
 }
 
 //Library manager constructor
-WED_LibraryMgr::WED_LibraryMgr(const string& ilocal_package) : local_package(ilocal_package)
+WED_LibraryMgr::WED_LibraryMgr(const string& ilocal_package) : local_package(ilocal_package), rescan_count(0)
 {
 	DebugAssert(gPackageMgr != NULL);
 	gPackageMgr->AddListener(this);
@@ -116,6 +119,7 @@ string WED_LibraryMgr::GetLocalPackage() const
 
 bool WED_LibraryMgr::GetLineVpath(int lt, string& vpath)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	map<int,string>::iterator l = default_lines.find(lt);
 	if(l == default_lines.end())
 		return false;
@@ -135,6 +139,7 @@ string		WED_LibraryMgr::GetResourceParent(const string& r)
 
 void		WED_LibraryMgr::GetResourceChildren(const string& r, int filter_package, vector<string>& children)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	children.clear();
 	res_map_t::iterator me = r.empty() ? res_table.begin() : res_table.find(r);
 	if(me == res_table.end())						return;
@@ -171,6 +176,7 @@ void		WED_LibraryMgr::GetResourceChildren(const string& r, int filter_package, v
 
 int			WED_LibraryMgr::GetResourceType(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::iterator me = res_table.find(r);
 	if (me==res_table.end()) return res_None;
 	return me->second.res_type;
@@ -178,6 +184,7 @@ int			WED_LibraryMgr::GetResourceType(const string& r)
 
 string		WED_LibraryMgr::GetResourcePath(const string& r, int variant)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::iterator me = res_table.find(r);
 	if (me==res_table.end()) return string();
 	DebugAssert(variant < me->second.real_paths.size());
@@ -186,6 +193,7 @@ string		WED_LibraryMgr::GetResourcePath(const string& r, int variant)
 
 bool	WED_LibraryMgr::IsResourceDefault(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::const_iterator me = res_table.find(r);
 	if (me==res_table.end()) return false;
 	return me->second.is_default;
@@ -193,6 +201,7 @@ bool	WED_LibraryMgr::IsResourceDefault(const string& r)
 
 bool	WED_LibraryMgr::IsResourceLocal(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::const_iterator me = res_table.find(r);
 	if (me==res_table.end()) return false;
 	return me->second.packages.count(pack_Local) && me->second.packages.size() == 1;
@@ -200,6 +209,7 @@ bool	WED_LibraryMgr::IsResourceLocal(const string& r)
 
 bool	WED_LibraryMgr::IsResourceLibrary(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::const_iterator me = res_table.find(r);
 	if (me==res_table.end()) return false;
 	return !me->second.packages.count(pack_Local) || me->second.packages.size() > 1;
@@ -207,6 +217,7 @@ bool	WED_LibraryMgr::IsResourceLibrary(const string& r)
 
 bool	WED_LibraryMgr::IsResourceDeprecatedOrPrivate(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::const_iterator me = res_table.find(r);
 	if (me==res_table.end()) return false;
 	return me->second.status < status_Yellow;                  // status "Yellow' is still deemed public wrt validation, i.e. allowed on the gateway
@@ -214,6 +225,7 @@ bool	WED_LibraryMgr::IsResourceDeprecatedOrPrivate(const string& r)
 
 bool	WED_LibraryMgr::DoesPackHaveLibraryItems(int package)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	for(res_map_t::iterator i = res_table.begin(); i != res_table.end(); ++i)
 		if(i->second.packages.count(package))
 		{
@@ -233,6 +245,7 @@ bool	WED_LibraryMgr::DoesPackHaveLibraryItems(int package)
 
 int		WED_LibraryMgr::GetNumVariants(const string& r)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	res_map_t::const_iterator me = res_table.find(r);
 	if (me==res_table.end()) return 1;
 	return me->second.real_paths.size();
@@ -262,106 +275,280 @@ struct local_scan_t {
 	WED_LibraryMgr * who;
 };
 
+// Bump this whenever ParseLibrary's results change, so old indexes are thrown away.
+#define LIBRARY_INDEX_FORMAT	1
+#define LIBRARY_INDEX_MAGIC		0x5849424C		// "LBIX"
+
+static string	library_index_path(void)
+{
+	string folder = GetCacheFolder();
+	if(folder.empty()) return folder;
+	return folder + DIR_STR "wed_library_index";
+}
+
+// Runs on worker threads - touches nothing but lib and the file system.
+void	WED_LibraryMgr::ParseLibrary(lib_parse_t& lib)
+{
+	MFMemFile * mf = MemFile_Open(lib.lib_path.c_str());
+	lib.ok = mf != NULL;
+	if(!mf) return;
+
+	MFScanner	s;
+	MFS_init(&s, mf);
+
+	int cur_status = status_Public;
+	int new_until = 0;
+	int lib_version[] = { 800, 0 };
+
+	if(MFS_xplane_header(&s,lib_version,"LIBRARY",NULL))
+	while(!MFS_done(&s))
+	{
+		string vpath, rpath;
+		bool is_export_backup = false;
+
+		bool is_export = MFS_string_match(&s,"EXPORT",false) ||
+						 MFS_string_match(&s,"EXPORT_EXTEND",false) ||
+						 MFS_string_match(&s,"EXPORT_EXCLUDE",false) ||
+						 (is_export_backup  = MFS_string_match(&s,"EXPORT_BACKUP",false));
+		if(!is_export && MFS_string_match(&s,"EXPORT_RATIO",false))
+		{
+			MFS_double(&s);
+			is_export = true;
+		}
+
+		if(is_export)
+		{
+			MFS_string(&s,&vpath);
+			MFS_string_eol(&s,&rpath);
+			WED_clean_vpath(vpath);
+			WED_clean_rpath(rpath);
+
+			if (is_no_true_subdir_path(rpath)) break; // ignore paths that lead outside current scenery directory
+			rpath=lib.pack_base+DIR_STR+rpath;
+			FILE_case_correct( (char *) rpath.c_str());  /* yeah - I know I'm overriding the 'const' protection of the c_str() here.
+			   But I know this operation is never going to change the strings length, so thats OK to do.
+			   And I have to case-correct the path right here, as this path later is not only used by the case insensitive MF_open()
+			   but also to derive the paths to the textures referenced in those assets. And those textures are loaded with case-sensitive fopen.
+			   */
+			lib_export_t e;
+			e.vpath = vpath;
+			e.rpath = rpath;
+			e.is_backup = is_export_backup;
+			e.status = cur_status;
+			e.new_until = new_until;
+			lib.exports.push_back(e);
+		}
+		else
+		{
+			if(MFS_string_match(&s,"PUBLIC",true))
+			{
+				cur_status = status_Public;
+				new_until = MFS_int(&s);
+			}
+			else if(MFS_string_match(&s,"PRIVATE",true))
+				cur_status = status_Private;
+			else if(MFS_string_match(&s,"DEPRECATED",true))
+				cur_status = status_Deprecated;
+			else if(MFS_string_match(&s,"SEMI_DEPRECATED",true))
+				cur_status = status_Yellow;
+
+			MFS_string_eol(&s,NULL);
+		}
+	}
+	MemFile_Close(mf);
+}
+
+/*
+	The library index remembers what every library.txt exported the last time it was parsed, keyed by
+	its path, size and time stamp.  It is a cache only - a missing, truncated or outdated index just
+	means those libraries get parsed again.  Note that the case-correction of the real paths is cached
+	along with them, so renaming art assets without touching library.txt needs a touch of library.txt.
+*/
+
+static void	index_put(vector<char>& buf, const void * p, int len)	{ buf.insert(buf.end(), (const char *) p, (const char *) p + len); }
+static void	index_put_int(vector<char>& buf, int v)				{ index_put(buf, &v, sizeof(v)); }
+static void	index_put_ll(vector<char>& buf, long long v)			{ index_put(buf, &v, sizeof(v)); }
+static void	index_put_str(vector<char>& buf, const string& s)		{ index_put_int(buf, s.size()); index_put(buf, s.data(), s.size()); }
+
+static bool	index_get(const char *& p, const char * e, void * d, int len)
+{
+	if(len < 0 || e - p < len) return false;
+	memcpy(d, p, len);
+	p += len;
+	return true;
+}
+static bool	index_get_str(const char *& p, const char * e, string& s)
+{
+	int len;
+	if(!index_get(p, e, &len, sizeof(len)) || len < 0 || e - p < len) return false;
+	s.assign(p, len);
+	p += len;
+	return true;
+}
+
+void	WED_LibraryMgr::LoadLibraryIndex(map<string, lib_parse_t>& index)
+{
+	string path = library_index_path();
+	if(path.empty()) return;
+	MFMemFile * mf = MemFile_Open(path.c_str());
+	if(!mf) return;
+
+	const char * p = MemFile_GetBegin(mf);
+	const char * e = MemFile_GetEnd(mf);
+
+	int magic, format, count;
+	if(index_get(p, e, &magic, sizeof(magic)) && magic == LIBRARY_INDEX_MAGIC &&
+	   index_get(p, e, &format, sizeof(format)) && format == LIBRARY_INDEX_FORMAT &&
+	   index_get(p, e, &count, sizeof(count)))
+	{
+		for(int l = 0; l < count; ++l)
+		{
+			lib_parse_t lib;
+			int n;
+			if(!index_get_str(p, e, lib.lib_path) ||
+			   !index_get(p, e, &lib.size, sizeof(lib.size)) ||
+			   !index_get(p, e, &lib.mtime, sizeof(lib.mtime)) ||
+			   !index_get(p, e, &n, sizeof(n)) || n < 0 || n > e - p)
+				break;
+			lib.ok = true;
+			lib.exports.resize(n);
+			bool good = true;
+			for(vector<lib_export_t>::iterator x = lib.exports.begin(); good && x != lib.exports.end(); ++x)
+			{
+				int backup;
+				good = index_get_str(p, e, x->vpath) && index_get_str(p, e, x->rpath) &&
+					   index_get(p, e, &backup, sizeof(backup)) &&
+					   index_get(p, e, &x->status, sizeof(x->status)) &&
+					   index_get(p, e, &x->new_until, sizeof(x->new_until));
+				x->is_backup = backup != 0;
+			}
+			if(!good) break;
+			lib_parse_t& slot = index[lib.lib_path];
+			slot.size = lib.size;
+			slot.mtime = lib.mtime;
+			slot.exports.swap(lib.exports);
+		}
+	}
+	MemFile_Close(mf);
+}
+
+void	WED_LibraryMgr::SaveLibraryIndex(const vector<lib_parse_t>& libs)
+{
+	string path = library_index_path();
+	if(path.empty()) return;
+
+	vector<char> buf;
+	int count = 0;
+	for(vector<lib_parse_t>::const_iterator l = libs.begin(); l != libs.end(); ++l)
+		if(l->ok) ++count;
+
+	index_put_int(buf, LIBRARY_INDEX_MAGIC);
+	index_put_int(buf, LIBRARY_INDEX_FORMAT);
+	index_put_int(buf, count);
+	for(vector<lib_parse_t>::const_iterator l = libs.begin(); l != libs.end(); ++l)
+	if(l->ok)
+	{
+		index_put_str(buf, l->lib_path);
+		index_put_ll(buf, l->size);
+		index_put_ll(buf, l->mtime);
+		index_put_int(buf, l->exports.size());
+		for(vector<lib_export_t>::const_iterator x = l->exports.begin(); x != l->exports.end(); ++x)
+		{
+			index_put_str(buf, x->vpath);
+			index_put_str(buf, x->rpath);
+			index_put_int(buf, x->is_backup);
+			index_put_int(buf, x->status);
+			index_put_int(buf, x->new_until);
+		}
+	}
+
+	// Write aside and rename over the old index, so a second WED never reads a half-written one.  The
+	// temp file is created exclusively under a fresh name, so two WEDs saving at once never share one.
+	static std::atomic<int> temp_counter(0);
+	string tmp_path;
+	FILE * fo = NULL;
+	for(int tries = 0; fo == NULL && tries < 100; ++tries)
+	{
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), ".%d.tmp", ++temp_counter);
+		tmp_path = path + suffix;
+		fo = fopen(tmp_path.c_str(), "wbx");
+	}
+	if(!fo) return;
+	bool ok = fwrite(&buf[0], 1, buf.size(), fo) == buf.size();
+	ok = fclose(fo) == 0 && ok;
+	if(!ok || FILE_replace_file(tmp_path.c_str(), path.c_str()) != 0)
+		FILE_delete_file(tmp_path.c_str(), false);
+}
+
 void		WED_LibraryMgr::Rescan()
 {
-	res_table.clear();
+	BroadcastMessage(msg_LibraryWillChange,0);
 	int np = gPackageMgr->CountPackages();
 
+	// Library.txt files of unchanged packages come out of the index, the others are parsed
+	// concurrently - they are independent until they get merged, in package order, below.
+	map<string, lib_parse_t>	index;
+	LoadLibraryIndex(index);
+
+	vector<lib_parse_t>	libs(np);
+	vector<int>			to_parse;
 	for(int p = 0; p < np; ++p)
 	{
+		libs[p].ok = false;
 		if(gPackageMgr->IsDisabled(p)) continue;
-		//the physical directory of the scenery pack
-		string pack_base;
 		//Get the pack's physical location
-		gPackageMgr->GetNthPackagePath(p,pack_base);
-
-		pack_base += DIR_STR "library.txt";
+		gPackageMgr->GetNthPackagePath(p,libs[p].pack_base);
+		libs[p].lib_path = libs[p].pack_base + DIR_STR "library.txt";
+		FILE_case_correct((char *) libs[p].lib_path.c_str());
 
-		bool is_default_pack = gPackageMgr->IsPackageDefault(p);
+		struct stat info;
+		if(FILE_get_file_meta_data(libs[p].lib_path, info) != 0) continue;
+		libs[p].size = info.st_size;
+		libs[p].mtime = info.st_mtime;
 
-		//Connects the physical Library.txt to the virual Memory File system? (95% sure) -Ted
-		MFMemFile * lib = MemFile_Open(pack_base.c_str());
-
-		if(lib)
+		map<string, lib_parse_t>::iterator i = index.find(libs[p].lib_path);
+		if(i != index.end() && i->second.size == libs[p].size && i->second.mtime == libs[p].mtime)
 		{
-			gPackageMgr->GetNthPackagePath(p,pack_base);
-			MFScanner	s;
-			MFS_init(&s, lib);
+			libs[p].exports.swap(i->second.exports);
+			libs[p].ok = true;
+		}
+		else
+			to_parse.push_back(p);
+	}
 
-			int cur_status = status_Public;
-			int lib_version[] = { 800, 0 };
+	parallel_for(0, to_parse.size(), [&](int n) {
+		ParseLibrary(libs[to_parse[n]]);
+	});
 
-			if(MFS_xplane_header(&s,lib_version,"LIBRARY",NULL))
-			while(!MFS_done(&s))
-			{
-				string vpath, rpath;
-				bool is_export_backup = false;
-				
-				if( MFS_string_match(&s,"EXPORT",false) ||
-				    MFS_string_match(&s,"EXPORT_EXTEND",false) ||
-				    MFS_string_match(&s,"EXPORT_EXCLUDE",false) ||
-					(is_export_backup  = MFS_string_match(&s,"EXPORT_BACKUP",false)))
-				{
-					MFS_string(&s,&vpath);
-					MFS_string_eol(&s,&rpath);
-					WED_clean_vpath(vpath);
-					WED_clean_rpath(rpath);
-
-					if (is_no_true_subdir_path(rpath)) break; // ignore paths that lead outside current scenery directory
-					rpath=pack_base+DIR_STR+rpath;
-					FILE_case_correct( (char *) rpath.c_str());  /* yeah - I know I'm overriding the 'const' protection of the c_str() here.
-					   But I know this operation is never going to change the strings length, so thats OK to do.
-					   And I have to case-correct the path right here, as this path later is not only used by the case insensitive MF_open()
-					   but also to derive the paths to the textures referenced in those assets. And those textures are loaded with case-sensitive fopen.
-					   */
-					AccumResource(vpath, p, rpath, is_export_backup, is_default_pack, cur_status);
-				}
-				else if(MFS_string_match(&s,"EXPORT_RATIO",false))
-				{
-				    double x = MFS_double(&s);
-					MFS_string(&s,&vpath);
-					MFS_string_eol(&s,&rpath);
-					WED_clean_vpath(vpath);
-					WED_clean_rpath(rpath);
-					if (is_no_true_subdir_path(rpath)) break; // ignore paths that lead outside current scenery directory
-					rpath=pack_base+DIR_STR+rpath;
-					FILE_case_correct( (char *) rpath.c_str());  // yeah - I know I'm overriding the 'const' protection of the c_str() here.
-					AccumResource(vpath, p, rpath,false,is_default_pack, cur_status);
-				}
-				else
-				{
-					if(MFS_string_match(&s,"PUBLIC",true))
-					{
-						cur_status = status_Public;
+	time_t rawtime;
+	struct tm * timeinfo;
+	time (&rawtime);
+	timeinfo = localtime (&rawtime);
+	int now = 10000 * (timeinfo->tm_year+1900) +100*timeinfo->tm_mon + timeinfo->tm_mday;
 
-						int new_until = 0;
-						new_until = MFS_int(&s);
-						if (new_until > 20170101)
-						{
-							time_t rawtime;
-							struct tm * timeinfo;
-							time (&rawtime);
-							timeinfo = localtime (&rawtime);
-							int now = 10000 * (timeinfo->tm_year+1900) +100*timeinfo->tm_mon + timeinfo->tm_mday;
-							if (new_until >= now)
-							{
-								cur_status = status_New;
-							}
-						}
-					}
-					else if(MFS_string_match(&s,"PRIVATE",true))
-						cur_status = status_Private;
-					else if(MFS_string_match(&s,"DEPRECATED",true))
-						cur_status = status_Deprecated;
-					else if(MFS_string_match(&s,"SEMI_DEPRECATED",true))
-						cur_status = status_Yellow;
-
-					MFS_string_eol(&s,NULL);
-				}
-			}
-			MemFile_Close(lib);
+	// Resource loader threads look things up while we rebuild - they wait until the table is complete.
+	unique_lock<recursive_mutex> guard(mLock);
+	res_table.clear();
+
+	int num_ok = 0;
+	for(int p = 0; p < np; ++p)
+	if(libs[p].ok)
+	{
+		++num_ok;
+		bool is_default_pack = gPackageMgr->IsPackageDefault(p);
+		for(vector<lib_export_t>::iterator x = libs[p].exports.begin(); x != libs[p].exports.end(); ++x)
+		{
+			int status = x->status;
+			if (status == status_Public && x->new_until > 20170101 && x->new_until >= now)
+				status = status_New;
+			AccumResource(x->vpath, p, x->rpath, x->is_backup, is_default_pack, status);
 		}
 	}
+
+	if(!to_parse.empty() || index.size() != num_ok)
+		SaveLibraryIndex(libs);
+
 	RescanLines();
 
 	string package_base;
@@ -376,6 +563,8 @@ void		WED_LibraryMgr::Rescan()
 		MF_IterateDirectory(package_base.c_str(), AccumLocalFile, reinterpret_cast<void*>(&info));
 	}
 
+	++rescan_count;
+	guard.unlock();
 	BroadcastMessage(msg_LibraryChanged,0);
 }
 
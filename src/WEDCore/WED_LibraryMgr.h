@@ -27,6 +27,7 @@
 #include "GUI_Broadcaster.h"
 #include "GUI_Listener.h"
 #include "IBase.h"
+#include <mutex>
 
 enum {
 	res_None,
@@ -100,9 +101,36 @@ public:
 	int			GetNumVariants(const string& r);
 				// get vpath for a apt.dat taxiline line type #.
 	bool		GetLineVpath(int lt, string& vpath);
+				// goes up every time the library is rescanned - anything derived from library contents is stale once this changes.
+	int			GetRescanCount() const { return rescan_count; }
 
 private:
 
+	// One EXPORT line of a library.txt.  PUBLIC <date> is kept as is and only turned into status_New
+	// when merging, so parse results can be reused on later days.
+	struct	lib_export_t {
+		string		vpath;
+		string		rpath;
+		bool		is_backup;
+		int			status;
+		int			new_until;
+	};
+
+	// Everything one package's library.txt exports, in file order.  size/mtime identify the file
+	// it came from in the persisted index.
+	struct	lib_parse_t {
+		string					lib_path;
+		string					pack_base;
+		long long				size;
+		long long				mtime;
+		bool					ok;
+		vector<lib_export_t>	exports;
+	};
+
+	static	void	ParseLibrary(lib_parse_t& lib);
+	static	void	LoadLibraryIndex(map<string, lib_parse_t>& index);
+	static	void	SaveLibraryIndex(const vector<lib_parse_t>& libs);
+
 	void			Rescan();
 	void			RescanLines();
 	void			AccumResource(const string& path, int package, const string& real_path, bool is_backup, bool is_default, int status);
@@ -156,9 +184,11 @@ private:
 
 	typedef map<string,res_info_t,compare_str_no_case>	res_map_t;
 	res_map_t			res_table;
+	recursive_mutex		mLock;			// guards res_table and default_lines - resource loaders and validation look up from worker threads
 
 	string				local_package;
 	map<int, string>	default_lines;  // list of art assets for sim default lines
+	int					rescan_count;
 };
 
 #endif /* WED_LibraryMgr_H */
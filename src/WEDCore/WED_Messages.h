@@ -45,7 +45,9 @@ enum {
 	msg_SystemFolderChanged,
 	msg_SystemFolderUpdated,
 
-	msg_LibraryChanged
+	msg_LibraryWillChange,					// Sent by the library manager right before it rescans
+	msg_LibraryChanged,
+	msg_ResourceLoaded						// Sent when assets requested from the resource or texture manager finished loading
 
 #if WITHNWLINK
 	,msg_NetworkStatusInfo
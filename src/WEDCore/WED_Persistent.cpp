@@ -25,14 +25,14 @@
 #include "WED_Archive.h"
 #include "AssertUtils.h"
 WED_Persistent::WED_Persistent(WED_Archive * parent)
-	: mArchive(parent)
+	: mArchive(parent), mChangeStamp(0)
 {
 	mDirty = true;
 	mArchive->AddObject(this);
 }
 
 WED_Persistent::WED_Persistent(WED_Archive * parent, int id) :
-	mArchive(parent), mID(id)
+	mArchive(parent), mID(id), mChangeStamp(0)
 {
 	mDirty = true;
 }
@@ -218,9 +218,14 @@ public:
 
 	virtual const char *	GetClass(void) const=0;
 
+	// Every create or change of the object stamps it with a number that only ever goes up, across all archives.
+	// If the newest stamp in a sub-tree has not moved, nothing in that sub-tree was touched.
+			long long		GetChangeStamp(void) const			{ return mChangeStamp; }
+
 	// These are for the archive's use..
 			void			SetDirty(int dirty);
 			int				GetDirty(void) const;
+			void			SetChangeStamp(long long stamp)		{ mChangeStamp = stamp; }
 
 	// ISelectable
 	virtual		int			GetSelectionID(void) const { return mID; }
@@ -237,6 +242,7 @@ private:
 		int				mID;
 		WED_Archive *	mArchive;
 		int				mDirty;
+		long long		mChangeStamp;
 
 		WED_Persistent();	// No ctor without archive!
 
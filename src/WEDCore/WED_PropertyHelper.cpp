@@ -32,6 +32,7 @@
 #include "MathUtils.h"
 #include "XESConstants.h"
 #include <algorithm>
+#include <typeinfo>
 
 template<typename T>
 inline void CallEditCallback(WED_PropertyHelper* P, T& value, const T& v) 
@@ -167,6 +168,30 @@ void		WED_PropertyHelper::PropsToXML(WED_XMLElement * parent)
 		mItems[n]->ToXML(parent);
 }
 
+// FNV-1a over the XML name, attribute name and C++ type of every item.  The type name is
+// compiler-specific, which is fine - the signature is only ever compared against a build of
+// the same WED.
+static void	hash_str(unsigned int& h, const char * s)
+{
+	if(s == NULL) s = "";
+	do {
+		h ^= (unsigned char) *s;
+		h *= 16777619u;
+	} while(*s++);
+}
+
+unsigned int	WED_PropertyHelper::PropsLayoutSignature(void) const
+{
+	unsigned int h = 2166136261u;
+	for(int n = 0; n < mItems.size(); ++n)
+	{
+		hash_str(h, mItems[n]->GetXmlName());
+		hash_str(h, mItems[n]->GetXmlAttrName());
+		hash_str(h, typeid(*mItems[n]).name());
+	}
+	return h;
+}
+
 
 void		WED_PropertyHelper::StartElement(
 								WED_XMLReader * reader,
@@ -530,6 +555,11 @@ void 		WED_PropStringText::ReadFrom(IOReader * reader)
 {
 	int sz;
 	reader->ReadInt(sz);
+	if(sz <= 0)
+	{
+		value.clear();
+		return;
+	}
 	vector<char> buf(sz);
 	reader->ReadBulk(&*buf.begin(),sz,false);
 	value = string(buf.begin(),buf.end());
@@ -600,6 +630,11 @@ void 		WED_PropFileText::ReadFrom(IOReader * reader)
 {
 	int sz;
 	reader->ReadInt(sz);
+	if(sz <= 0)
+	{
+		value.clear();
+		return;
+	}
 	vector<char> buf(sz);
 	reader->ReadBulk(&*buf.begin(),sz,false);
 	value = string(buf.begin(),buf.end());
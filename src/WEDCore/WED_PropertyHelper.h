@@ -161,6 +161,8 @@ public:
 				void 		ReadPropsFrom(IOReader * reader);
 				void 		WritePropsTo(IOWriter * writer);
 				void		PropsToXML(WED_XMLElement * parent);
+				// Fingerprint of what ReadPropsFrom expects: item names and types, in streaming order.
+				unsigned int	PropsLayoutSignature(void) const;
 
 	virtual	void		StartElement(
 								WED_XMLReader * reader,
@@ -31,11 +31,13 @@
 
 #include "MemFileUtils.h"
 #include "XObjReadWrite.h"
+#include "XObjBinCache.h"
 #include "ObjConvert.h"
 #include "FileUtils.h"
 #include "WED_PackageMgr.h"
 #include "CompGeomDefs2.h"
 #include "MathUtils.h"
+#include "ParallelUtils.h"
 
 #if IBM
 #define DIR_CHAR '\\'
@@ -93,17 +95,60 @@ static void process_texture_path(const string& path_of_obj, string& path_of_tex)
 	path_of_tex = parent + ".bmp";
 }
 
-WED_ResourceMgr::WED_ResourceMgr(WED_LibraryMgr * in_library) : mLibrary(in_library)
+// Everything below follows the same pattern: look up under the lock, parse without it, publish under the lock.
+// Parsing can take a while, so this keeps other threads (and the UI) from waiting on somebody else's load.
+
+template <typename M, typename T>
+static bool find_loaded(recursive_mutex& lock, M& m, const string& key, T const *& info)
+{
+	lock_guard<recursive_mutex> guard(lock);
+	auto i = m.find(key);
+	if(i == m.end()) return false;
+	info = &i->second;
+	return true;
+}
+
+// If another thread published the same asset in the meantime, theirs stays and ours is dropped - so everyone
+// ends up with the same pointer.
+template <typename M, typename T>
+static const T * publish_loaded(recursive_mutex& lock, M& m, const string& key, T& info)
+{
+	lock_guard<recursive_mutex> guard(lock);
+	auto i = m.find(key);
+	if(i == m.end())
+		i = m.insert(make_pair(key, std::move(info))).first;
+	return &i->second;
+}
+
+WED_ResourceMgr::WED_ResourceMgr(WED_LibraryMgr * in_library) : mLibrary(in_library),
+	mBusy(0), mFinished(0), mQuit(false), mTimerRunning(false)
 {
+	mLibrary->AddListener(this);
 }
 
 WED_ResourceMgr::~WED_ResourceMgr()
 {
+	{
+		lock_guard<mutex> guard(mJobLock);
+		mQuit = true;
+	}
+	mJobQueued.notify_all();
+	for(auto& t : mLoaders)
+		t.join();
+	mLoaders.clear();
+
 	Purge();
 }
 
 void	WED_ResourceMgr::Purge(void)
 {
+	StopLoaders();
+	{
+		lock_guard<mutex> guard(mJobLock);
+		mFailed.clear();
+	}
+
+	lock_guard<recursive_mutex> guard(mLock);
 	for(auto& i : mObj)
 		for(auto j : i.second)
 			delete j;
@@ -128,7 +173,7 @@ XObj8 * WED_ResourceMgr::LoadObj(const string& abspath)
 //printf("LoadObj '%s' - ",abspath.c_str());
 
 	XObj8 * new_obj = new XObj8;
-	if(!XObj8Read(abspath.c_str(),*new_obj))
+	if(!XObj8ReadCached(abspath.c_str(),*new_obj))
 	{
 		XObj obj7;
 		if(XObjRead(abspath.c_str(),obj7))
@@ -199,19 +244,27 @@ bool	WED_ResourceMgr::GetObjRelative(const string& obj_path, const string& paren
 #endif
 			a = DIR_CHAR;
 
-	auto i = mObj.find(apath);
-	if(i != mObj.end())
 	{
-		obj = i->second.front();
-		return true;
+		lock_guard<recursive_mutex> guard(mLock);
+		auto i = mObj.find(apath);
+		if(i != mObj.end())
+		{
+			obj = i->second.front();
+			return true;
+		}
 	}
 
 //printf("GetObjRel trying via abspath '%s'\n", apath.c_str());
 	XObj8 * new_obj = LoadObj(apath);
 	if(!new_obj) return false;
 
-	mObj[apath].push_back(new_obj);  // store the thing under its absolute path name
-	obj = new_obj;
+	lock_guard<recursive_mutex> guard(mLock);
+	vector<const XObj8 *>& loaded(mObj[apath]);  // store the thing under its absolute path name
+	if(loaded.empty())
+		loaded.push_back(new_obj);
+	else
+		delete new_obj;							// another thread was faster
+	obj = loaded.front();
 	return true;
 }
 
@@ -220,17 +273,20 @@ bool	WED_ResourceMgr::GetObj(const string& vpath, XObj8 const *& obj, int varian
 	if(toupper(vpath[vpath.size()-3]) != 'O') return false;   // save time by not trying to load .agp's
 
 //printf("GetObj %s' V=%d\n", path.c_str(), variant);
-	auto i = mObj.find(vpath);
 	int first_needed = 0;
-	if(i != mObj.end())
 	{
-		if(variant < i->second.size())
+		lock_guard<recursive_mutex> guard(mLock);
+		auto i = mObj.find(vpath);
+		if(i != mObj.end())
 		{
-			obj = i->second[variant];
-			return true;
+			if(variant < i->second.size())
+			{
+				obj = i->second[variant];
+				return true;
+			}
+			else
+				first_needed = i->second.size();
 		}
-		else
-			first_needed = i->second.size();
 	}
 
 	DebugAssert(variant < mLibrary->GetNumVariants(vpath));
@@ -244,8 +300,13 @@ bool	WED_ResourceMgr::GetObj(const string& vpath, XObj8 const *& obj, int varian
 			XObj8 * new_obj = LoadObj(p);
 			if(new_obj)
 			{
-				mObj[vpath].push_back(new_obj);
-				obj = new_obj;
+				lock_guard<recursive_mutex> guard(mLock);
+				vector<const XObj8 *>& variants(mObj[vpath]);
+				if(variants.size() == v)
+					variants.push_back(new_obj);
+				else
+					delete new_obj;				// another thread was faster
+				obj = variants[v];
 			}
 			else
 			{
@@ -259,6 +320,7 @@ bool	WED_ResourceMgr::GetObj(const string& vpath, XObj8 const *& obj, int varian
 
 bool 	WED_ResourceMgr::SetPolUV(const string& path, Bbox2 box)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	auto i = mPol.find(path);
 	if(i != mPol.end())
 	{
@@ -271,12 +333,8 @@ bool 	WED_ResourceMgr::SetPolUV(const string& path, Bbox2 box)
 
 bool	WED_ResourceMgr::GetLin(const string& path, lin_info_t const *& info)
 {
-	auto i = mLin.find(path);
-	if(i != mLin.end())
-	{
-		info = &i->second;
+	if(find_loaded(mLock, mLin, path, info))
 		return true;
-	}
 	
 	string p = mLibrary->GetResourcePath(path);
 	MFMemFile * lin = MemFile_Open(p.c_str());
@@ -293,8 +351,8 @@ bool	WED_ResourceMgr::GetLin(const string& path, lin_info_t const *& info)
 		return false;
 	}
 	
-	lin_info_t * out_info = &mLin[path];
-	info = out_info;
+	lin_info_t new_info;
+	lin_info_t * out_info = &new_info;
 
 	out_info->base_tex.clear();
 	out_info->scale_s=100;
@@ -383,17 +441,14 @@ bool	WED_ResourceMgr::GetLin(const string& path, lin_info_t const *& info)
 	out_info->eff_width = out_info->scale_s * ( out_info->s2[0] - out_info->s1[0] - 4 / tex_width ); // assume 2 transparent pixels on each side
 
 	process_texture_path(p,out_info->base_tex);
+	info = publish_loaded(mLock, mLin, path, new_info);
 	return true;
 }
 
 bool	WED_ResourceMgr::GetStr(const string& path, str_info_t const *& info)
 {
-	auto i = mStr.find(path);
-	if(i != mStr.end())
-	{
-		info = &i->second;
+	if(find_loaded(mLock, mStr, path, info))
 		return true;
-	}
 
 	string p = mLibrary->GetResourcePath(path);
 	MFMemFile * str = MemFile_Open(p.c_str());
@@ -410,8 +465,8 @@ bool	WED_ResourceMgr::GetStr(const string& path, str_info_t const *& info)
 		return false;
 	}
 	
-	str_info_t * out_info = &mStr[path];
-	info = out_info;
+	str_info_t new_info;
+	str_info_t * out_info = &new_info;
 
 	out_info->offset = 0.0;
 	out_info->rotation = 0.0;
@@ -434,18 +489,15 @@ bool	WED_ResourceMgr::GetStr(const string& path, str_info_t const *& info)
 		MFS_string_eol(&s,NULL);
 	}
 	MemFile_Close(str);
+	info = publish_loaded(mLock, mStr, path, new_info);
 	return true;
 }
 
 
 bool	WED_ResourceMgr::GetPol(const string& path, pol_info_t const*& info)
 {
-	auto i = mPol.find(path);
-	if(i != mPol.end())
-	{
-		info = &i->second;
+	if(find_loaded(mLock, mPol, path, info))
 		return true;
-	}
 	
 	string p = mLibrary->GetResourcePath(path);
 	MFMemFile * file = MemFile_Open(p.c_str());
@@ -462,8 +514,8 @@ bool	WED_ResourceMgr::GetPol(const string& path, pol_info_t const*& info)
 		return false;
 	}
 
-	pol_info_t * pol = &mPol[path];
-	info = pol;
+	pol_info_t new_pol;
+	pol_info_t * pol = &new_pol;
 
 	pol->mSubBoxes.clear();
 	pol->mUVBox = Bbox2();
@@ -522,6 +574,7 @@ bool	WED_ResourceMgr::GetPol(const string& path, pol_info_t const*& info)
 	}
 	MemFile_Close(file);
 	process_texture_path(p,pol->base_tex);
+	info = publish_loaded(mLock, mPol, path, new_pol);
 	return true;
 }
 
@@ -555,23 +608,213 @@ void	WED_ResourceMgr::ReceiveMessage(
 	{
 		Purge();
 	}
+	else if (inMsg == msg_LibraryWillChange)
+	{
+		StopLoaders();			// they look up paths in the library
+	}
+}
+
+/************************************************************************************************************************
+ * ASYNC LOADING
+ ************************************************************************************************************************/
+
+enum {
+	load_obj,
+	load_fac,
+	load_for,
+	load_pol,
+	load_lin,
+	load_agp
+};
+
+static string job_key(int kind, const string& path, int variant)
+{
+	return to_string(kind) + ":" + to_string(variant) + ":" + path;
+}
+
+void	WED_ResourceMgr::QueueLoad(int kind, const string& path, int variant)
+{
+	{
+		lock_guard<mutex> guard(mJobLock);
+		string key = job_key(kind, path, variant);
+		if(mFailed.count(key) || !mQueued.insert(key).second)
+			return;
+
+		load_job_t job = { kind, path, variant };
+		mJobs.push_back(job);
+		mLoading.insert(path);
+
+		if(mLoaders.empty())
+		{
+			// Leave a core for the UI; the loaders mostly wait on the disk anyway.
+			int n = min(4, max(1, parallel_thread_count() - 1));
+			for(int i = 0; i < n; ++i)
+				mLoaders.push_back(std::thread(&WED_ResourceMgr::LoaderThread, this));
+		}
+	}
+	mJobQueued.notify_one();
+
+	if(!mTimerRunning)
+	{
+		Start(0.1);
+		mTimerRunning = true;
+	}
+}
+
+void	WED_ResourceMgr::LoaderThread(void)
+{
+	unique_lock<mutex> guard(mJobLock);
+	while(true)
+	{
+		while(!mQuit && mJobs.empty())
+			mJobQueued.wait(guard);
+		if(mQuit)
+			return;
+
+		load_job_t job = mJobs.front();
+		mJobs.pop_front();
+		++mBusy;
+		guard.unlock();
+
+		bool ok = false;
+		switch(job.kind) {
+		case load_obj:	{ XObj8 const *		o; ok = GetObj(job.path, o, job.variant); } break;
+		case load_fac:	{ fac_info_t const *	f; ok = GetFac(job.path, f, job.variant); } break;
+		case load_for:	{ XObj8 const *		o; ok = GetFor(job.path, o); } break;
+		case load_pol:	{ pol_info_t const *	p; ok = GetPol(job.path, p); } break;
+		case load_lin:	{ lin_info_t const *	l; ok = GetLin(job.path, l); } break;
+		case load_agp:	{ agp_t const *		a; ok = GetAGP(job.path, a); } break;
+		}
+
+		guard.lock();
+		string key = job_key(job.kind, job.path, job.variant);
+		mQueued.erase(key);
+		mLoading.erase(mLoading.find(job.path));
+		if(!ok)
+			mFailed.insert(key);
+		--mBusy;
+		++mFinished;
+		mJobDone.notify_all();
+	}
+}
+
+// Drops whatever is still queued and waits for the jobs in progress to finish.  The loader threads stay around.
+void	WED_ResourceMgr::StopLoaders(void)
+{
+	unique_lock<mutex> guard(mJobLock);
+	for(auto& j : mJobs)
+	{
+		mQueued.erase(job_key(j.kind, j.path, j.variant));
+		mLoading.erase(mLoading.find(j.path));
+	}
+	mJobs.clear();
+	while(mBusy > 0)
+		mJobDone.wait(guard);
+}
+
+void	WED_ResourceMgr::TimerFired(void)
+{
+	int finished;
+	bool idle;
+	{
+		lock_guard<mutex> guard(mJobLock);
+		finished = mFinished;
+		mFinished = 0;
+		idle = mJobs.empty() && mBusy == 0;
+	}
+	if(idle)
+	{
+		Stop();
+		mTimerRunning = false;
+	}
+	if(finished)
+		BroadcastMessage(msg_ResourceLoaded, 0);
+}
+
+bool	WED_ResourceMgr::IsLoading(const string& path)
+{
+	lock_guard<mutex> guard(mJobLock);
+	return mLoading.count(path) > 0;
+}
+
+bool	WED_ResourceMgr::RequestObj(const string& path, XObj8 const *& obj, int variant)
+{
+	if(toupper(path[path.size()-3]) != 'O') return false;   // same shortcut as GetObj - don't queue .agp's
+
+	{
+		lock_guard<recursive_mutex> guard(mLock);
+		auto i = mObj.find(path);
+		if(i != mObj.end() && variant < i->second.size())
+		{
+			obj = i->second[variant];
+			return true;
+		}
+	}
+	QueueLoad(load_obj, path, variant);
+	return false;
+}
+
+bool	WED_ResourceMgr::RequestFac(const string& path, fac_info_t const *& info, int variant)
+{
+	{
+		lock_guard<recursive_mutex> guard(mLock);
+		auto i = mFac.find(path);
+		if(i != mFac.end() && variant < i->second.size())
+		{
+			info = &i->second[variant];
+			return true;
+		}
+	}
+	QueueLoad(load_fac, path, variant);
+	return false;
+}
+
+bool	WED_ResourceMgr::RequestFor(const string& path, XObj8 const *& obj)
+{
+	if(find_loaded(mLock, mFor, path, obj)) return true;
+	QueueLoad(load_for, path, 0);
+	return false;
+}
+
+bool	WED_ResourceMgr::RequestPol(const string& path, pol_info_t const *& info)
+{
+	if(find_loaded(mLock, mPol, path, info)) return true;
+	QueueLoad(load_pol, path, 0);
+	return false;
+}
+
+bool	WED_ResourceMgr::RequestLin(const string& path, lin_info_t const *& info)
+{
+	if(find_loaded(mLock, mLin, path, info)) return true;
+	QueueLoad(load_lin, path, 0);
+	return false;
+}
+
+bool	WED_ResourceMgr::RequestAGP(const string& path, agp_t const *& info)
+{
+	if(find_loaded(mLock, mAGP, path, info)) return true;
+	QueueLoad(load_agp, path, 0);
+	return false;
 }
 
 #define FAIL(s) { printf("%s: %s\n",vpath.c_str(),s); return false; }
 
 bool	WED_ResourceMgr::GetFac(const string& vpath, fac_info_t const *& info, int variant)
 {
-	auto i = mFac.find(vpath);
 	int first_needed = 0;
-	if(i != mFac.end())
 	{
-		if(variant < i->second.size())
+		lock_guard<recursive_mutex> guard(mLock);
+		auto i = mFac.find(vpath);
+		if(i != mFac.end())
 		{
-			info = &i->second[variant];
-			return true;
+			if(variant < i->second.size())
+			{
+				info = &i->second[variant];
+				return true;
+			}
+			else
+				first_needed = i->second.size();
 		}
-		else
-			first_needed = i->second.size();
 	}
 	
 	DebugAssert(variant < mLibrary->GetNumVariants(vpath));
@@ -593,9 +836,8 @@ bool	WED_ResourceMgr::GetFac(const string& vpath, fac_info_t const *& info, int
 			return false;
 		}
 
-		mFac[vpath].push_back(fac_info_t());
-		fac_info_t * fac = &mFac[vpath].back();
-		info = fac;
+		fac_info_t new_fac;
+		fac_info_t * fac = &new_fac;
 
 		fac->is_new = (vers == 1000);
 
@@ -1050,6 +1292,14 @@ bool	WED_ResourceMgr::GetFac(const string& vpath, fac_info_t const *& info, int
 		process_texture_path(p,fac->roof_tex);
 		
 		height_desc_for_facade(*fac, fac->h_range);
+
+		lock_guard<recursive_mutex> guard(mLock);
+		vector<fac_info_t>& variants(mFac[vpath]);
+		if(variants.empty())
+			variants.reserve(mLibrary->GetNumVariants(vpath));	// so adding variants never moves the ones handed out
+		if(variants.size() == v)
+			variants.push_back(std::move(new_fac));
+		info = &variants[v];
 	}
 	return true;
 }
@@ -1078,12 +1328,8 @@ struct tree_t {
 
 bool	WED_ResourceMgr::GetFor(const string& path, XObj8 const *& obj)
 {
-	auto i = mFor.find(path);
-	if(i != mFor.end())
-	{
-		obj = &i->second;
+	if(find_loaded(mLock, mFor, path, obj))
 		return true;
-	}
 	
 	string p = mLibrary->GetResourcePath(path);
 	
@@ -1196,7 +1442,8 @@ bool	WED_ResourceMgr::GetFor(const string& path, XObj8 const *& obj)
 #endif		
 	
 	// fills a XObj8-structure for library preview
-	XObj8 * new_obj = &mFor[path];
+	XObj8 new_for;
+	XObj8 * new_obj = &new_for;
 	XObjCmd8 cmd;
 
 	new_obj->texture = tex;
@@ -1269,17 +1516,14 @@ bool	WED_ResourceMgr::GetFor(const string& path, XObj8 const *& obj)
 	cmd.idx_count  = 6*quads;
 	new_obj->lods.back().cmds.push_back(cmd);
 
+	obj = publish_loaded(mLock, mFor, path, new_for);
 	return true;
 }
 
 bool	WED_ResourceMgr::GetAGP(const string& path, agp_t const *& info)
 {
-	auto i = mAGP.find(path);
-	if(i != mAGP.end())
-	{
-		info = &i->second;
+	if(find_loaded(mLock, mAGP, path, info))
 		return true;
-	}
 	
 	string p = mLibrary->GetResourcePath(path);
 	MFMemFile * file = MemFile_Open(p.c_str());
@@ -1296,8 +1540,8 @@ bool	WED_ResourceMgr::GetAGP(const string& path, agp_t const *& info)
 		return false;
 	}
 	
-	agp_t * agp = &mAGP[path];
-	info = agp;
+	agp_t new_agp;
+	agp_t * agp = &new_agp;
 
 	double tex_s = 1.0, tex_t = 1.0;		// these scale from pixels to UV coords
 	double tex_x = 1.0, tex_y = 1.0;		// meters for tex, x & y
@@ -1521,12 +1765,14 @@ bool	WED_ResourceMgr::GetAGP(const string& path, agp_t const *& info)
 		else
 			o = agp->objs.erase(o);
 	}
+	info = publish_loaded(mLock, mAGP, path, new_agp);
 	return true;
 }
 
 #if ROAD_EDITING
 bool	WED_ResourceMgr::GetRoad(const string& path, road_info_t& out_info)
 {
+	lock_guard<recursive_mutex> guard(mLock);
 	auto i = mRoad.find(path);
 	if(i != mRoad.end())
 	{
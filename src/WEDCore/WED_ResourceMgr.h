@@ -42,6 +42,21 @@
 	it's also definitely not very dangerous at this point in the code's development - that is, WED is not so big that this
 	represents a scalability issue.
 
+	THREADING
+
+	The getters may be called from worker threads (e.g. validation runs airports in parallel).  Lookups and publishing
+	of results happen under one lock, the parsing in between does not - if two threads load the same asset, the first
+	one to publish wins.  The hash maps never move their values and variant lists are sized up front, so the pointers
+	handed out stay good until the next Purge.
+
+	ASYNC LOADING
+
+	The Get calls parse on the calling thread, which stalls the UI when a pane asks for hundreds of new assets.  Drawing
+	code can use the Request calls instead: they return what is loaded already, and otherwise queue the asset for a small
+	pool of loader threads and return false right away, so the caller can draw a placeholder.  Once queued assets are in,
+	msg_ResourceLoaded is broadcast from the main thread (polled by a timer), so panes know to redraw.  Assets that failed
+	to load are remembered and not queued again until the next Purge.
+
 */
 
 #include "GUI_Listener.h"
@@ -49,7 +64,13 @@
 #include "IBase.h"
 #include "XObjDefs.h"
 #include "CompGeomDefs2.h"
+#include "GUI_Timer.h"
 #include <list>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 class	WED_LibraryMgr;
 
@@ -144,7 +165,7 @@ struct agp_t {
 };
 
 
-class WED_ResourceMgr : public GUI_Broadcaster, public GUI_Listener, public virtual IBase {
+class WED_ResourceMgr : public GUI_Broadcaster, public GUI_Listener, public GUI_Timer, public virtual IBase {
 public:
 
 					 WED_ResourceMgr(WED_LibraryMgr * in_library);
@@ -166,14 +187,34 @@ public:
 			bool	GetAGP(const string& path, agp_t const *& info);
 			bool	GetRoad(const string& path, road_info_t& out_info);
 
+			// Non-blocking getters - main thread only.  False means "not loaded (yet)".
+			bool	RequestObj(const string& path, XObj8 const *& obj, int variant = 0);
+			bool	RequestFac(const string& path, fac_info_t const *& info, int variant = 0);
+			bool	RequestFor(const string& path, XObj8 const *& obj);
+			bool	RequestPol(const string& path, pol_info_t const *& info);
+			bool	RequestLin(const string& path, lin_info_t const *& info);
+			bool	RequestAGP(const string& path, agp_t const *& info);
+			bool	IsLoading(const string& path);		// True while any variant of path is queued or being loaded.
+
 	virtual	void	ReceiveMessage(
 							GUI_Broadcaster *		inSrc,
 							intptr_t				inMsg,
 							intptr_t				inParam);
 
+	virtual	void	TimerFired(void);
+
 private:
 
+	struct	load_job_t {
+		int		kind;
+		string	path;
+		int		variant;
+	};
+
 			XObj8 * LoadObj(const string& abspath);
+			void	QueueLoad(int kind, const string& path, int variant);
+			void	LoaderThread(void);
+			void	StopLoaders(void);
 	
 	unordered_map<string,vector<fac_info_t> > mFac;
 	unordered_map<string,pol_info_t>		mPol;
@@ -186,6 +227,20 @@ private:
 	unordered_map<string,road_info_t>		mRoad;
 #endif	
 	WED_LibraryMgr *				mLibrary;
+	recursive_mutex					mLock;			// guards the asset maps above
+
+	mutex							mJobLock;		// guards everything below
+	condition_variable				mJobQueued;
+	condition_variable				mJobDone;
+	deque<load_job_t>				mJobs;
+	set<string>						mQueued;		// jobs queued or in progress, see job_key
+	set<string>						mFailed;
+	multiset<string>				mLoading;		// paths of the above
+	vector<std::thread>				mLoaders;
+	int								mBusy;			// loaders working on a job right now
+	int								mFinished;		// jobs done since the last broadcast
+	bool							mQuit;
+	bool							mTimerRunning;
 };	
 
 #endif /* WED_ResourceMgr_H */
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "WED_Snapshot.h"
+#include "WED_Version.h"
+#include "WED_Persistent.h"
+#include "WED_PropertyHelper.h"
+#include "FileUtils.h"
+#include "AssertUtils.h"
+
+// Bump this whenever the layout of the snapshot itself changes.  Changes to the object streams
+// are covered by WED_VERSION_NUMERIC and the per-class layout signatures.
+#define SNAPSHOT_FORMAT		3
+#define SNAPSHOT_MAGIC		0x53444557		// "WEDS"
+#define SNAPSHOT_END		0x444E4553		// "SEND"
+#define SNAPSHOT_BUF_SIZE	(256 * 1024)
+
+/************************************************************************************************************************
+ * WRITER
+ ************************************************************************************************************************/
+
+// MD5Update takes at most 64k at a time.
+static void	md5_update(MD5_CTX * ctx, const void * p, size_t len)
+{
+	const unsigned char * c = (const unsigned char *) p;
+	while(len > 0)
+	{
+		unsigned short chunk = min(len, (size_t) 60000);
+		MD5Update(ctx, (unsigned char *) c, chunk);
+		c += chunk;
+		len -= chunk;
+	}
+}
+
+WED_SnapshotWriter::WED_SnapshotWriter(FILE * f) : mFile(f), mError(false), mCheckPos(-1), mBodySize(0)
+{
+	mBuf.reserve(SNAPSHOT_BUF_SIZE);
+}
+
+WED_SnapshotWriter::~WED_SnapshotWriter()
+{
+	Flush();
+}
+
+void	WED_SnapshotWriter::Put(const void * p, int len)
+{
+	if(mBuf.size() + len > SNAPSHOT_BUF_SIZE)
+		Flush();
+	if(len > SNAPSHOT_BUF_SIZE)
+		Emit(p, len);
+	else
+		mBuf.insert(mBuf.end(), (const char *) p, (const char *) p + len);
+}
+
+void	WED_SnapshotWriter::Flush(void)
+{
+	if(!mBuf.empty())
+	{
+		Emit(&mBuf[0], mBuf.size());
+		mBuf.clear();
+	}
+}
+
+void	WED_SnapshotWriter::Emit(const void * p, size_t len)
+{
+	if(fwrite(p, 1, len, mFile) != len)
+		mError = true;
+	if(mCheckPos >= 0)
+	{
+		md5_update(&mBodyHash, p, len);
+		mBodySize += len;
+	}
+}
+
+void	WED_SnapshotWriter::WriteShort(short v)		{ Put(&v, sizeof(v)); }
+void	WED_SnapshotWriter::WriteInt(int v)			{ Put(&v, sizeof(v)); }
+void	WED_SnapshotWriter::WriteFloat(float v)		{ Put(&v, sizeof(v)); }
+void	WED_SnapshotWriter::WriteDouble(double v)	{ Put(&v, sizeof(v)); }
+
+void	WED_SnapshotWriter::WriteBulk(const char * inBuf, int inLength, bool inZip)
+{
+	DebugAssert(!inZip);
+	Put(inBuf, inLength);
+}
+
+void	WED_SnapshotWriter::WriteString(const string& s)
+{
+	WriteInt(s.size());
+	Put(s.c_str(), s.size());
+}
+
+// Leaves room for the body size and MD5, which Finish fills in once it knows them.
+void	WED_SnapshotWriter::BeginBody(void)
+{
+	DebugAssert(mCheckPos < 0);
+	Flush();
+	mCheckPos = ftell(mFile);
+	if(mCheckPos < 0)
+	{
+		mError = true;
+		mCheckPos = 0;
+	}
+	char room[8 + 16] = { 0 };
+	if(fwrite(room, 1, sizeof(room), mFile) != sizeof(room))
+		mError = true;
+	MD5Init(&mBodyHash);
+	mBodySize = 0;
+}
+
+bool	WED_SnapshotWriter::Finish(void)
+{
+	DebugAssert(mCheckPos >= 0);
+	WriteInt(SNAPSHOT_END);
+	Flush();
+	MD5Final(&mBodyHash);
+
+	int size_lo = mBodySize & 0xFFFFFFFF;
+	int size_hi = mBodySize >> 32;
+	if(fseek(mFile, mCheckPos, SEEK_SET) != 0 ||
+	   fwrite(&size_lo, 1, sizeof(size_lo), mFile) != sizeof(size_lo) ||
+	   fwrite(&size_hi, 1, sizeof(size_hi), mFile) != sizeof(size_hi) ||
+	   fwrite(mBodyHash.digest, 1, 16, mFile) != 16 ||
+	   fseek(mFile, 0, SEEK_END) != 0)
+		mError = true;
+	return !mError && fflush(mFile) == 0;
+}
+
+/************************************************************************************************************************
+ * READER
+ ************************************************************************************************************************/
+
+WED_SnapshotReader::WED_SnapshotReader(const char * b, const char * e) : mPtr(b), mEnd(e), mOK(true)
+{
+}
+
+void	WED_SnapshotReader::Get(void * p, int len)
+{
+	if(!mOK || len < 0 || mEnd - mPtr < len)
+	{
+		mOK = false;
+		if(len > 0) memset(p, 0, len);
+		return;
+	}
+	memcpy(p, mPtr, len);
+	mPtr += len;
+}
+
+void	WED_SnapshotReader::ReadShort(short& v)		{ Get(&v, sizeof(v)); }
+void	WED_SnapshotReader::ReadInt(int& v)			{ Get(&v, sizeof(v)); }
+void	WED_SnapshotReader::ReadFloat(float& v)		{ Get(&v, sizeof(v)); }
+void	WED_SnapshotReader::ReadDouble(double& v)	{ Get(&v, sizeof(v)); }
+
+void	WED_SnapshotReader::ReadBulk(char * inBuf, int inLength, bool inZip)
+{
+	DebugAssert(!inZip);
+	Get(inBuf, inLength);
+}
+
+void	WED_SnapshotReader::ReadString(string& s)
+{
+	int len;
+	ReadInt(len);
+	if(!mOK || len < 0 || mEnd - mPtr < len)
+	{
+		mOK = false;
+		s.clear();
+		return;
+	}
+	s.assign(mPtr, len);
+	mPtr += len;
+}
+
+bool	WED_SnapshotReader::CheckRest(long long size, const unsigned char digest[16]) const
+{
+	if(!mOK || size != mEnd - mPtr)
+		return false;
+	MD5_CTX	ctx;
+	MD5Init(&ctx);
+	md5_update(&ctx, mPtr, mEnd - mPtr);
+	MD5Final(&ctx);
+	return memcmp(ctx.digest, digest, 16) == 0;
+}
+
+bool	WED_SnapshotReader::Finish(void)
+{
+	int end_marker;
+	ReadInt(end_marker);
+	return mOK && end_marker == SNAPSHOT_END && mPtr == mEnd;
+}
+
+/************************************************************************************************************************
+ * HEADER
+ ************************************************************************************************************************/
+
+// Fingerprint of the XML file: its size and MD5.  MD5Update takes at most 64k at a time.
+static bool	hash_xml_file(const string& xml_path, long long& size, unsigned char digest[16])
+{
+	FILE * fi = fopen(xml_path.c_str(), "rb");
+	if(fi == NULL) return false;
+
+	MD5_CTX	ctx;
+	MD5Init(&ctx);
+	size = 0;
+
+	vector<unsigned char> buf(60000);
+	size_t got;
+	while((got = fread(&buf[0], 1, buf.size(), fi)) > 0)
+	{
+		MD5Update(&ctx, &buf[0], got);
+		size += got;
+	}
+	bool ok = ferror(fi) == 0;
+	fclose(fi);
+
+	MD5Final(&ctx);
+	memcpy(digest, ctx.digest, 16);
+	return ok;
+}
+
+bool	WED_SnapshotWriteHeader(WED_SnapshotWriter * writer, const string& xml_path)
+{
+	long long		size;
+	unsigned char	digest[16];
+	if(!hash_xml_file(xml_path, size, digest))
+		return false;
+
+	writer->WriteInt(SNAPSHOT_MAGIC);
+	writer->WriteInt(SNAPSHOT_FORMAT);
+	writer->WriteInt(WED_VERSION_NUMERIC);
+	writer->WriteInt(size & 0xFFFFFFFF);
+	writer->WriteInt(size >> 32);
+	writer->WriteBulk((const char *) digest, 16, false);
+	writer->BeginBody();
+	return true;
+}
+
+bool	WED_SnapshotCheckHeader(WED_SnapshotReader * reader, const string& xml_path, const string& snapshot_path)
+{
+	date_cmpr_result_t age = FILE_date_cmpr(xml_path.c_str(), snapshot_path.c_str());
+	if(age != dcr_secondIsNew && age != dcr_same)
+		return false;
+
+	int magic, format, version, size_lo, size_hi;
+	unsigned char digest[16];
+	reader->ReadInt(magic);
+	reader->ReadInt(format);
+	reader->ReadInt(version);
+	reader->ReadInt(size_lo);
+	reader->ReadInt(size_hi);
+	reader->ReadBulk((char *) digest, 16, false);
+
+	int body_lo, body_hi;
+	unsigned char body_digest[16];
+	reader->ReadInt(body_lo);
+	reader->ReadInt(body_hi);
+	reader->ReadBulk((char *) body_digest, 16, false);
+
+	if(!reader->IsOK() || magic != SNAPSHOT_MAGIC || format != SNAPSHOT_FORMAT || version != WED_VERSION_NUMERIC)
+		return false;
+
+	long long		xml_size;
+	unsigned char	xml_digest[16];
+	if(!hash_xml_file(xml_path, xml_size, xml_digest))
+		return false;
+
+	if(xml_size != (((long long) size_hi << 32) | (unsigned int) size_lo) || memcmp(digest, xml_digest, 16) != 0)
+		return false;
+
+	return reader->CheckRest(((long long) body_hi << 32) | (unsigned int) body_lo, body_digest);
+}
+
+/************************************************************************************************************************
+ * CLASS LAYOUT
+ ************************************************************************************************************************/
+
+int		WED_SnapshotClassSignature(WED_Persistent * obj)
+{
+	unsigned int h = 2166136261u;
+	for(const char * c = obj->GetClass(); *c; ++c)
+	{
+		h ^= (unsigned char) *c;
+		h *= 16777619u;
+	}
+	WED_PropertyHelper * props = dynamic_cast<WED_PropertyHelper *>(obj);
+	if(props)
+		h ^= props->PropsLayoutSignature() * 2654435761u;
+	return (int) h;
+}
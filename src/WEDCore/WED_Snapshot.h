@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef WED_Snapshot_H
+#define WED_Snapshot_H
+
+/*
+
+	WED_Snapshot - THEORY OF OPERATION
+
+	Opening a big project is dominated by parsing earth.wed.xml - every attribute of every object
+	goes through expat, get_att and atoi/atof.  So after each successful save we also dump the
+	archive into earth.wed.snapshot, using the same WriteTo/ReadFrom streaming the undo system uses.
+
+	The snapshot is only a cache - earth.wed.xml remains THE document.  A snapshot is used only if:
+
+	- Its format version and the WED version that wrote it match ours, since the object streams
+	  change whenever a class gains a property.
+	- Every object's class has the same layout signature it had when the snapshot was written -
+	  a hash of the class name and its property items' names and types, in streaming order.  This
+	  catches a class gaining, losing, reordering or retyping a property between two builds that
+	  share a version number.  Hand-written fields a class streams outside its property items are
+	  not covered - changing those still requires a bump of WED_VERSION_NUMERIC.
+	- It is not older than the XML file.
+	- The size and MD5 of the XML file are what they were when the snapshot was written.
+	- The size and MD5 of everything after the header are what the header says, so a snapshot that
+	  was cut short or damaged on disk is never streamed into objects.
+
+	In any other case, or if loading fails in any way, we quietly read the XML file.  The snapshot
+	is written to a temp file and renamed into place, so a crash mid-write leaves the old one (or
+	none) behind rather than a half-written one.  Snapshots are raw native-endian dumps, they are not
+	meant to travel between machines.
+
+*/
+
+#include "IODefs.h"
+#include "md5.h"
+
+class	WED_Persistent;
+
+class	WED_SnapshotWriter : public IOWriter {
+public:
+
+					WED_SnapshotWriter(FILE * destination);
+	virtual			~WED_SnapshotWriter();
+
+	virtual	void	WriteShort(short);
+	virtual	void	WriteInt(int);
+	virtual	void	WriteFloat(float);
+	virtual	void	WriteDouble(double);
+	virtual	void	WriteBulk(const char * inBuf, int inLength, bool inZip);
+
+			void	WriteString(const string& s);
+			void	BeginBody(void);				// Ends the header - everything after this is sized and hashed into it.
+			bool	Finish(void);					// Writes the end marker and the body check, returns false if any write failed.
+
+private:
+
+			void	Put(const void * p, int len);
+			void	Flush(void);
+			void	Emit(const void * p, size_t len);
+
+	FILE *			mFile;
+	vector<char>	mBuf;
+	bool			mError;
+	long			mCheckPos;						// Where the body size and MD5 go, -1 before BeginBody.
+	long long		mBodySize;
+	MD5_CTX			mBodyHash;
+
+	WED_SnapshotWriter(const WED_SnapshotWriter&);
+	WED_SnapshotWriter& operator=(const WED_SnapshotWriter&);
+};
+
+// Reads from a memory image of the snapshot.  Reading past the end never crashes - it returns
+// zeros and marks the reader as failed, which the loader checks before it trusts anything.
+class	WED_SnapshotReader : public IOReader {
+public:
+
+					WED_SnapshotReader(const char * begin, const char * end);
+
+	virtual	void	ReadShort(short&);
+	virtual	void	ReadInt(int&);
+	virtual	void	ReadFloat(float&);
+	virtual	void	ReadDouble(double&);
+	virtual	void	ReadBulk(char * inBuf, int inLength, bool inZip);
+
+			void	ReadString(string& s);
+			bool	CheckRest(long long size, const unsigned char digest[16]) const;	// True if the unread bytes have this size and MD5.
+			bool	Finish(void);					// True if the end marker comes next and nothing failed so far.
+			bool	IsOK(void) const { return mOK; }
+
+private:
+
+			void	Get(void * p, int len);
+
+	const char *	mPtr;
+	const char *	mEnd;
+	bool			mOK;
+};
+
+// Stamps a new snapshot with the format/WED version and the fingerprint of the XML file it mirrors.
+bool	WED_SnapshotWriteHeader(WED_SnapshotWriter * writer, const string& xml_path);
+
+// True if the snapshot being read was written by this WED for exactly this XML file, and arrived intact.
+bool	WED_SnapshotCheckHeader(WED_SnapshotReader * reader, const string& xml_path, const string& snapshot_path);
+
+// Layout signature of an object's class - see above.  Objects of the same class always agree.
+int		WED_SnapshotClassSignature(WED_Persistent * obj);
+
+#endif /* WED_Snapshot_H */
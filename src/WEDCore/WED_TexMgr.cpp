@@ -21,15 +21,14 @@
  *
  */
 
-#define NEW_TEX_LOAD_STRATEGY 1
-
 #include "WED_TexMgr.h"
-#if !NEW_TEX_LOAD_STRATEGY
-	#include "BitmapUtils.h"
-#endif
-#include "MemFileUtils.h"
 #include "TexUtils.h"
 #include "WED_PackageMgr.h"
+#include "WED_Messages.h"
+#include "WED_Globals.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <chrono>
 
 #if APL
 	#include <OpenGL/gl.h>
@@ -37,33 +36,112 @@
 	#include <GL/gl.h>
 #endif
 
-WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package)
+// Bytes of decoded images handed to the GL per timer tick, i.e. per redraw while textures come in.  One texture
+// always goes, no matter how big.
+#define TEX_UPLOAD_BUDGET	(16 * 1024 * 1024)
+// Textures drawn this recently are never evicted, and decoded ones this fresh are not thrown away unused.
+#define TEX_KEEP_SECONDS	2.0
+
+static double	tex_clock(void)
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads and decodes an image file - everything short of talking to the GL, so this is safe on any thread.
+// With LOAD_DDS_DIRECT, DDS files are kept as they are, to upload them without decompressing.
+static bool	decode_texture(const string& fpath, vector<char>& dds, ImageInfo& im)
+{
+#if LOAD_DDS_DIRECT
+	FILE * file = fopen(fpath.c_str(), "rb");
+	if (file)
+	{
+		char c[4];
+		if (fread(c, 1, 4, file) == 4 && strncmp(c, "DDS ",4) == 0) // cut it short, if no joy
+		{
+			fseek(file, 0, SEEK_END);
+			int fileLength = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			dds.resize(fileLength);
+			if (fileLength <= 0 || fread(&dds[0], 1, fileLength, file) != fileLength)
+				dds.clear();
+		}
+		fclose(file);
+	}
+	if(!dds.empty()) return true;
+#endif
+	// auto-detection of file type, basic on file content, only
+	if (LoadBitmapFromAnyFile(fpath.c_str(), &im) != 0)
+		return false;
+	if (im.pad != 0)
+		UnpadImage(&im);
+	return true;
+}
+
+WED_TexMgr::WED_TexMgr(const string& package) : mPackage(package), mBytes(0), mUploadBudget(TEX_UPLOAD_BUDGET),
+	mBusy(0), mQuit(false), mTimerRunning(false)
 {
 }
 
 WED_TexMgr::~WED_TexMgr()
 {
+	{
+		lock_guard<mutex> guard(mDecodeLock);
+		mQuit = true;
+	}
+	mDecodeQueued.notify_all();
+	for(auto& t : mDecoders)
+		t.join();
+
+	for(auto& d : mDecoded)
+		if(d.second.ok && d.second.dds.empty())
+			DestroyBitmap(&d.second.im);
+
 	for(map<string,TexInfo *>::iterator t = mTexes.begin(); t != mTexes.end(); ++t)
 	{
 		GLuint id = t->second->tex_id;
-		glDeleteTextures(1, &id);
+		if(id) glDeleteTextures(1, &id);
 		delete t->second;
 	}
 }
 
 TexRef		WED_TexMgr::LookupTexture(const char * path, bool is_absolute, int flags)
+{
+	TexMap::iterator i = mTexes.find(path);
+	TexInfo * inf = i == mTexes.end() ? NewTexture(path, is_absolute, flags) : i->second;
+
+	if (inf->state == tex_Loaded || inf->state == tex_Queued)
+		if (UseTexture(inf))
+			return inf;
+	if (inf->state == tex_Failed)
+		return NULL;
+
+	// Not there yet - load it right here.  Should a decoder be working on it, TimerFired throws its result away.
+	if (inf->state == tex_Queued)
+	{
+		lock_guard<mutex> guard(mDecodeLock);
+		auto j = find(mJobs.begin(), mJobs.end(), inf);
+		if (j != mJobs.end())
+			mJobs.erase(j);
+	}
+	return LoadTexture(inf) ? inf : NULL;
+}
+
+TexRef		WED_TexMgr::RequestTexture(const char * path, bool is_absolute, int flags)
 {
 	TexMap::iterator i = mTexes.find(path);
 	if (i == mTexes.end())
 	{
-		return LoadTexture(path, is_absolute,flags);
+		QueueTexture(NewTexture(path, is_absolute, flags));
+		return NULL;
 	}
-	return i->second;
+	return UseTexture(i->second) ? i->second : NULL;
 }
 
 int			WED_TexMgr::GetTexID(TexRef ref)
 {
-	return ((TexInfo *) ref)->tex_id;
+	TexInfo * inf = (TexInfo *) ref;
+	UseTexture(inf);
+	return inf->tex_id;
 }
 
 void		WED_TexMgr::GetTexInfo(
@@ -84,85 +162,236 @@ void		WED_TexMgr::GetTexInfo(
 	if (org_y) *org_y = i->org_y;
 }
 
-WED_TexMgr::TexInfo *	WED_TexMgr::LoadTexture(const char * path, bool is_absolute, int flags)
+WED_TexMgr::TexInfo *	WED_TexMgr::NewTexture(const char * path, bool is_absolute, int flags)
+{
+	TexInfo * inf = new TexInfo;
+	inf->tex_id = 0;
+	inf->vis_x = inf->vis_y = inf->act_x = inf->act_y = inf->org_x = inf->org_y = 0;
+	inf->fpath = is_absolute ? path : gPackageMgr->ComputePath(mPackage, path);
+	inf->flags = flags;
+	inf->state = tex_Evicted;
+	inf->bytes = 0;
+	inf->last_used = tex_clock();
+	inf->lru = mLRU.end();
+	mTexes[path] = inf;
+	return inf;
+}
+
+bool	WED_TexMgr::LoadTexture(TexInfo * inf)
+{
+	decoded_t d;
+	d.tex = inf;
+	d.im.data = NULL;
+	d.ok = decode_texture(inf->fpath, d.dds, d.im);
+	d.offered = 0;
+	return UploadTexture(inf, d);
+}
+
+// Marks a texture as used.  Uploads it if it is decoded and the budget allows, or queues it again if it was
+// evicted.  Returns true if the texture can be drawn right now.
+bool	WED_TexMgr::UseTexture(TexInfo * inf)
+{
+	inf->last_used = tex_clock();
+	switch(inf->state) {
+	case tex_Loaded:
+		mLRU.splice(mLRU.begin(), mLRU, inf->lru);
+		return true;
+	case tex_Evicted:
+		QueueTexture(inf);
+		return false;
+	case tex_Queued:
+		{
+			decoded_t d;
+			{
+				lock_guard<mutex> guard(mDecodeLock);
+				auto i = mDecoded.find(inf);
+				if(i == mDecoded.end() || mUploadBudget <= 0)
+					return false;
+				d = i->second;
+				mDecoded.erase(i);
+			}
+			bool ok = UploadTexture(inf, d);
+			mUploadBudget -= inf->bytes;
+			return ok;
+		}
+	default:
+		return false;
+	}
+}
+
+void	WED_TexMgr::QueueTexture(TexInfo * inf)
 {
-	string fpath(is_absolute ? path : gPackageMgr->ComputePath(mPackage, path));
-	TexInfo * inf = NULL;
+	inf->state = tex_Queued;
+	{
+		lock_guard<mutex> guard(mDecodeLock);
+		mJobs.push_back(inf);
+		if(mDecoders.empty())
+		{
+			// Leave a core for the UI; the decoders mostly wait on the disk anyway.
+			int n = min(4, max(1, parallel_thread_count() - 1));
+			for(int i = 0; i < n; ++i)
+				mDecoders.push_back(std::thread(&WED_TexMgr::DecoderThread, this));
+		}
+	}
+	mDecodeQueued.notify_one();
+
+	if(!mTimerRunning)
+	{
+		Start(0.1);
+		mTimerRunning = true;
+	}
+}
+
+// Hands a decoded image to the GL and consumes it.  The texture ends up either loaded or failed.
+bool	WED_TexMgr::UploadTexture(TexInfo * inf, decoded_t& d)
+{
+	if(!d.ok)
+	{
+		inf->state = tex_Failed;
+		return false;
+	}
 
 	GLuint tn;
 	glGenTextures(1,&tn);
+	int siz_x, siz_y, bytes = 0;
+	float s = 1.0, t = 1.0;
+	bool ok;
+
 #if LOAD_DDS_DIRECT
-	FILE * file = fopen(fpath.c_str(), "rb");
-	if (file)
+	if(!d.dds.empty())
 	{
-		char c[4];
-		if (fread(c, 1, 4, file) == 4 && strncmp(c, "DDS ",4) == 0) // cut it short, if no joy
+		ok = LoadTextureFromDDS(&d.dds[0], &d.dds[0] + d.dds.size(), tn, inf->flags, &siz_x, &siz_y);
+		bytes = d.dds.size();
+		if(!ok)		// a DDS flavor the GL can not take as is - have it decompressed after all
 		{
-			fseek(file, 0, SEEK_END);
-			int fileLength = ftell(file);
-			fseek(file, 0, SEEK_SET);
-			char * buffer = new char[fileLength];
-			if (buffer)
-			{
-				if (fread(buffer, 1, fileLength, file) == fileLength)
-				{
-					int siz_x, siz_y;
-					if (LoadTextureFromDDS(buffer, buffer + fileLength, tn, flags, &siz_x, &siz_y))
-					{
-//						printf("Direct loading DDS %s\n", fpath.c_str());
-						inf = new TexInfo;
-						inf->tex_id = tn;
-						inf->org_x = inf->vis_x = inf->act_x = siz_x;
-						inf->org_y = inf->vis_y = inf->act_y = siz_y;
-						mTexes[path] = inf;
-					}
-				}
-				delete [] buffer;
-			}
-			fclose(file);
+			ok = LoadTextureFromFile(inf->fpath.c_str(), tn, inf->flags, &siz_x, &siz_y, &s, &t);
+			bytes = 0;
 		}
+		vector<char>().swap(d.dds);
 	}
-	if(inf) return inf;
-
-//	printf("Normal load %s\n", fpath.c_str());
+	else
 #endif
+	{
+		ok = LoadTextureFromImage(d.im, tn, inf->flags, &siz_x, &siz_y, &s, &t);
+		DestroyBitmap(&d.im);
+	}
+	d.ok = false;
 
-#if NEW_TEX_LOAD_STRATEGY
-	// auto-detection of file type, basic on file content, only
+	if(!ok)
 	{
-		int siz_x, siz_y;
-		float s,t;
-		if (LoadTextureFromFile(fpath.c_str(), tn, flags, &siz_x, &siz_y, &s,&t))
-#else
-	// loading based on file name suffix. With this method we preserve awareness of original image size.
-	// But with openGL 3.0 as new minimum requirement - all GPU's have to support non-power-2 textures,
-	// and only Orthophoto export would be affected. So thats unlikely to be a loss, ever.
-	ImageInfo	im;
-	if(MakeSupportedType(fpath.c_str(), &im) == 0)
+		glDeleteTextures(1, &tn);
+		inf->state = tex_Failed;
+		return false;
+	}
+
+	// With openGL 3.0 as new minimum requirement all GPU's support non-power-2 textures, so the original image
+	// size is only lost for tex_Always_Pad - and only Orthophoto export would care about that.
+	inf->tex_id = tn;
+	inf->org_x = siz_x;
+	inf->org_y = siz_y;
+	inf->act_x = siz_x;
+	inf->act_y = siz_y;
+	inf->vis_x = (float) siz_x * s;
+	inf->vis_y = (float) siz_y * t;
+	inf->bytes = bytes ? bytes : (int) ((long long) siz_x * siz_y * 4 * ((inf->flags & tex_Mipmap) ? 4 : 3) / 3);
+	Loaded(inf);
+	return true;
+}
+
+void	WED_TexMgr::Loaded(TexInfo * inf)
+{
+	inf->state = tex_Loaded;
+	mLRU.push_front(inf);
+	inf->lru = mLRU.begin();
+	mBytes += inf->bytes;
+	EvictTextures();
+}
+
+void	WED_TexMgr::EvictTextures(void)
+{
+	long long budget = (long long) gTextureCacheMB << 20;
+	double now = tex_clock();
+	while(mBytes > budget && !mLRU.empty())
 	{
-		int siz_x, siz_y;
-		float s,t;
-		if (LoadTextureFromImage(im, tn, flags, &siz_x, &siz_y, &s,&t))
-#endif
+		TexInfo * t = mLRU.back();
+		if(now - t->last_used < TEX_KEEP_SECONDS)
+			break;								// everything left is on screen
+		GLuint id = t->tex_id;
+		glDeleteTextures(1, &id);
+		t->tex_id = 0;
+		t->state = tex_Evicted;
+		mBytes -= t->bytes;
+		t->lru = mLRU.end();
+		mLRU.pop_back();
+	}
+}
+
+void	WED_TexMgr::DecoderThread(void)
+{
+	unique_lock<mutex> guard(mDecodeLock);
+	while(true)
+	{
+		while(!mQuit && mJobs.empty())
+			mDecodeQueued.wait(guard);
+		if(mQuit)
+			return;
+
+		decoded_t d;
+		d.tex = mJobs.front();
+		mJobs.pop_front();
+		string fpath(d.tex->fpath);
+		++mBusy;
+		guard.unlock();
+
+		d.im.data = NULL;
+		d.ok = decode_texture(fpath, d.dds, d.im);
+		d.offered = 0;
+
+		guard.lock();
+		--mBusy;
+		if(!mDecoded.insert(make_pair(d.tex, d)).second && d.ok && d.dds.empty())
+			DestroyBitmap(&d.im);				// queued twice, the first one in wins
+	}
+}
+
+void	WED_TexMgr::TimerFired(void)
+{
+	bool pending, idle;
+	double now = tex_clock();
+	{
+		lock_guard<mutex> guard(mDecodeLock);
+		for(auto d = mDecoded.begin(); d != mDecoded.end(); )
 		{
-			inf = new TexInfo;
-			inf->tex_id = tn;
-#if NEW_TEX_LOAD_STRATEGY
-			inf->org_x = siz_x;
-			inf->org_y = siz_y;
-#else
-			inf->org_x = im.width;
-			inf->org_y = im.height;
-#endif
-			inf->act_x = siz_x;
-			inf->act_y = siz_y;
-			inf->vis_x = (float) siz_x * s;
-			inf->vis_y = (float) siz_y * t;
-			mTexes[path] = inf;
+			// Loaded some other way meanwhile, or nobody asked for it since it was announced - the next ask queues it again.
+			// A decode can take longer than TEX_KEEP_SECONDS, so the clock starts with the broadcast, not the request.
+			TexInfo * t = d->first;
+			bool stale = t->state != tex_Queued;
+			if(!stale && d->second.offered == 0)
+				d->second.offered = now;
+			else if(!stale && now - max(d->second.offered, t->last_used) > TEX_KEEP_SECONDS &&
+								find(mJobs.begin(), mJobs.end(), t) == mJobs.end())
+			{
+				t->state = tex_Evicted;
+				stale = true;
+			}
+			if(stale)
+			{
+				if(d->second.ok && d->second.dds.empty())
+					DestroyBitmap(&d->second.im);
+				d = mDecoded.erase(d);
+			}
+			else
+				++d;
 		}
-#if !NEW_TEX_LOAD_STRATEGY
-		DestroyBitmap(&im);
-#endif
+		pending = !mDecoded.empty();
+		idle = !pending && mJobs.empty() && mBusy == 0;
 	}
-	return inf;
+	mUploadBudget = TEX_UPLOAD_BUDGET;
+	if(idle)
+	{
+		Stop();
+		mTimerRunning = false;
+	}
+	if(pending)
+		BroadcastMessage(msg_ResourceLoaded, 0);
 }
@@ -24,15 +24,44 @@
 #ifndef WED_TexMgr_H
 #define WED_TexMgr_H
 
+/*
+	WED_TexMgr - THEORY OF OPERATION
+
+	LookupTexture loads a texture right away, on the calling thread.  That is what code that needs the real size of
+	an image (like creating an orthophoto) wants, but draw code calling it for a few hundred facades or orthophotos
+	freezes the map until every last one is read, decoded and uploaded.
+
+	So draw code calls RequestTexture instead.  It returns what is uploaded already and otherwise queues the file for
+	a few decoder threads and returns NULL right away, which the draw code treats like a missing texture.  Decoded
+	images go to the GL when they are asked for again - from draw code, so a GL context is current - but only
+	TEX_UPLOAD_BUDGET bytes per timer tick, so a burst of textures coming in does not stall a frame either.  While
+	decoded images are waiting, msg_ResourceLoaded is broadcast from the timer so panes redraw and pick them up.
+	A decoded image nobody picks up is dropped again TEX_KEEP_SECONDS after it was first announced.
+
+	Uploaded textures are kept in an LRU.  Once they take more than gTextureCacheMB, the textures used longest ago
+	have their GL texture deleted - but never one used in the last TEX_KEEP_SECONDS.  TexRefs stay good for the life
+	of the manager though: an evicted texture is simply queued again the next time it is asked for.  Files that fail
+	to load are remembered and never retried.
+*/
+
 #include "ITexMgr.h"
+#include "GUI_Broadcaster.h"
+#include "GUI_Timer.h"
+#include "BitmapUtils.h"
+#include <list>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
-class WED_TexMgr : public virtual ITexMgr {
+class WED_TexMgr : public virtual ITexMgr, public GUI_Broadcaster, public GUI_Timer {
 public:
 
 						 WED_TexMgr(const string& package);
 	virtual				~WED_TexMgr();
 
 	virtual	TexRef		LookupTexture(const char * path, bool is_absolute, int flags);
+	virtual	TexRef		RequestTexture(const char * path, bool is_absolute, int flags);
 
 	virtual	int			GetTexID(TexRef ref);
 	virtual	void		GetTexInfo(
@@ -44,8 +73,17 @@ public:
 								int *	org_x,
 								int *	org_y);
 
+	virtual	void		TimerFired(void);
+
 private:
 
+	enum tex_state_t {
+		tex_Loaded,				// tex_id and the sizes are valid
+		tex_Queued,				// with a decoder, or decoded and waiting in mDecoded for its upload
+		tex_Evicted,			// was loaded, GL texture deleted to make room
+		tex_Failed
+	};
+
 	struct	TexInfo {
 		int			tex_id;
 		int			vis_x;
@@ -54,6 +92,21 @@ private:
 		int			act_y;
 		int			org_x;
 		int			org_y;
+
+		string		fpath;
+		int			flags;
+		tex_state_t	state;
+		int			bytes;			// GL memory, roughly
+		double		last_used;
+		list<TexInfo *>::iterator lru;
+	};
+
+	struct	decoded_t {
+		TexInfo *		tex;
+		bool			ok;
+		vector<char>	dds;		// a DDS file as is, uploaded without decompressing
+		ImageInfo		im;			// anything else, decoded
+		double			offered;	// when msg_ResourceLoaded first went out for it, 0 before that
 	};
 
 	typedef map<string,TexInfo *>	TexMap;
@@ -62,7 +115,27 @@ private:
 
 	string	mPackage;
 
-	TexInfo *	LoadTexture(const char * path, bool is_absolute, int flags);
+	list<TexInfo *>					mLRU;			// loaded textures, most recently used first
+	long long						mBytes;
+	long long						mUploadBudget;
+
+	mutex							mDecodeLock;	// guards everything below
+	condition_variable				mDecodeQueued;
+	deque<TexInfo *>				mJobs;
+	map<TexInfo *,decoded_t>		mDecoded;
+	vector<std::thread>				mDecoders;
+	int								mBusy;			// decoders working on a job right now
+	bool							mQuit;
+	bool							mTimerRunning;
+
+	TexInfo *	NewTexture(const char * path, bool is_absolute, int flags);
+	bool		LoadTexture(TexInfo * inf);
+	bool		UseTexture(TexInfo * inf);
+	void		QueueTexture(TexInfo * inf);
+	bool		UploadTexture(TexInfo * inf, decoded_t& d);
+	void		Loaded(TexInfo * inf);
+	void		EvictTextures(void);
+	void		DecoderThread(void);
 
 };
 
@@ -72,6 +72,8 @@
 #include "WED_ResourceMgr.h"
 
 #include "CompGeomUtils.h"
+#include "RTree2.h"
+#include "ParallelUtils.h"
 
 #include "BitmapUtils.h"
 #include "GISUtils.h"
@@ -843,9 +845,9 @@ static void ValidateOneATCRunwayUse(WED_ATCRunwayUse* use, validation_error_vect
 	}
 }
 
-static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt)
+static void TJunctionTest(const vector<WED_TaxiRoute*>& all_taxiroutes, validation_error_vector& msgs, WED_Airport * apt)
 {
-	static CoordTranslator2 translator;
+	CoordTranslator2 translator;
 	Bbox2 box;
 	apt->GetBounds(gis_Geo, box);
 	CreateTranslatorForBounds(box,translator);
@@ -862,24 +864,43 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 						validation failure - that node is too close to a taxiway route but isn't joined.
 	*/
 
-	for (vector<WED_TaxiRoute*>::iterator edge_a_itr = all_taxiroutes.begin(); edge_a_itr != all_taxiroutes.end(); ++edge_a_itr)
+	const double TJUNCTION_THRESHOLD = 1.00;
+
+	// Only an edge B whose bounds come within TJUNCTION_THRESHOLD of edge A can have an end that close to A.
+	// So project every edge once and index the bounds, instead of testing all pairs of the airport's routes.
+	typedef RTree2<int, 8>	edge_index_t;
+	vector<Segment2>					edges(all_taxiroutes.size());
+	vector<edge_index_t::item_type>		items(all_taxiroutes.size());
+	for (int n = 0; n < all_taxiroutes.size(); ++n)
 	{
 		// most of this data isn't needed. At most the location of the two ends is needed - as a segment
 		// TaxiRouteInfo edge_a(*edge_a_itr,translator);
 		Bezier2 b;
-		(*edge_a_itr)->GetSide(gis_Geo, 0, b);
-		Segment2 edge_a( translator.Forward(b.p1) , translator.Forward(b.p2) );
-		
-		for (vector<WED_TaxiRoute*>::iterator edge_b_itr = all_taxiroutes.begin(); edge_b_itr != all_taxiroutes.end(); ++edge_b_itr)
+		all_taxiroutes[n]->GetSide(gis_Geo, 0, b);
+		edges[n] = Segment2( translator.Forward(b.p1) , translator.Forward(b.p2) );
+		items[n] = edge_index_t::item_type(Bbox2(edges[n]), n);
+	}
+	edge_index_t	index;
+	index.insert(items.begin(), items.end());
+
+	vector<int> near_edges;
+	for (int a = 0; a < all_taxiroutes.size(); ++a)
+	{
+		const Segment2& edge_a(edges[a]);
+		Bbox2 search(edge_a);
+		search.expand(TJUNCTION_THRESHOLD);
+
+		near_edges.clear();
+		index.query_value(search, back_inserter(near_edges));
+		sort(near_edges.begin(), near_edges.end());		// same order of messages as testing every pair
+
+		for (vector<int>::iterator b_itr = near_edges.begin(); b_itr != near_edges.end(); ++b_itr)
 		{
 			// Don't test an edge against itself
-			if (edge_a_itr == edge_b_itr)	continue;
+			if (*b_itr == a)	continue;
 
-			// most of this data isn't needed. At most the location of the two ends is needed - as a segment
-			// TaxiRouteInfo edge_b(*edge_b_itr,translator);
-			
-			(*edge_b_itr)->GetSide(gis_Geo, 0, b);
-			Segment2 edge_b( translator.Forward(b.p1) , translator.Forward(b.p2) );
+			const Segment2& edge_b(edges[*b_itr]);
+			WED_TaxiRoute * route_b = all_taxiroutes[*b_itr];
 
 			// Skip crossing edges
 			// Note - its validated elsewhere - why duplicate this effort ???
@@ -891,7 +912,6 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 			if (edge_a.p1 == edge_b.p1 || edge_a.p1 == edge_b.p2 ||
 				 edge_a.p2 == edge_b.p1 || edge_a.p2 == edge_b.p2 ) continue;
 
-			const double TJUNCTION_THRESHOLD = 1.00;
 			for (int i = 0; i < 2; i++)
 			{
 				// its also worth changing this to Bezier2.is_near() to prepare for future curved edges
@@ -900,15 +920,15 @@ static void TJunctionTest(vector<WED_TaxiRoute*> all_taxiroutes, validation_erro
 				if (dist_b_node_to_a_edge < TJUNCTION_THRESHOLD * TJUNCTION_THRESHOLD)
 				{
 					set<WED_Thing*> node_viewers;
-					(*edge_b_itr)->GetNthSource(i)->GetAllViewers(node_viewers);
+					route_b->GetNthSource(i)->GetAllViewers(node_viewers);
 
 					int valence = node_viewers.size();
 					if (valence == 1)
 					{	
 						vector<WED_Thing*> problem_children;
-						problem_children.push_back(*edge_a_itr);
-						problem_children.push_back((*edge_b_itr)->GetNthSource(i));
-						string name; (*edge_a_itr)->GetName(name);
+						problem_children.push_back(all_taxiroutes[a]);
+						problem_children.push_back(route_b->GetNthSource(i));
+						string name; all_taxiroutes[a]->GetName(name);
 
 						msgs.push_back(validation_error_t("Taxi route " + name + " is not joined to a destination route.", err_taxi_route_not_joined_to_dest_route, problem_children, apt));
 					}
@@ -1197,7 +1217,15 @@ static void ValidateATC(WED_Airport* apt, validation_error_vector& msgs, set<int
 //------------------------------------------------------------------------------------------------------------------------------------
 #pragma mark -
 
-static void ValidateOneRampPosition(WED_RampPosition* ramp, validation_error_vector& msgs, WED_Airport * apt, const vector<WED_Runway *>& runways)
+// What the ramp start checks need to know about a runway.  Getting the length of a runway means a geodesic
+// distance - so this is worked out once per airport rather than once per ramp and runway.
+struct ramp_rwy_info_t {
+	bool	paved;
+	double	length;
+	double	width;
+};
+
+static void ValidateOneRampPosition(WED_RampPosition* ramp, validation_error_vector& msgs, WED_Airport * apt, const vector<ramp_rwy_info_t>& runways)
 {
 	AptGate_t	g;
 	ramp->Export(g);
@@ -1240,12 +1268,10 @@ static void ValidateOneRampPosition(WED_RampPosition* ramp, validation_error_vec
             req_rwy_len *= FT_TO_MTR;
             req_rwy_wid *= FT_TO_MTR;
 
-            vector<WED_Runway *>::const_iterator r(runways.begin());
+            vector<ramp_rwy_info_t>::const_iterator r(runways.begin());
             while(r != runways.end())
             {
-                WED_GISLine_Width * lw = dynamic_cast<WED_GISLine_Width *>(*r);
-
-                if(((*r)->GetSurface() <= surf_Concrete || (*r)->GetSurface() == surf_Trans || unpaved_OK) && lw->GetLength() >= req_rwy_len && lw->GetWidth() >= req_rwy_wid)
+                if((r->paved || unpaved_OK) && r->length >= req_rwy_len && r->width >= req_rwy_wid)
                         break;
                 ++r;
             }
@@ -2219,9 +2245,20 @@ static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs,
 		ValidateOneHelipad(*h, msgs,apt);
 	}
 
+	vector<ramp_rwy_info_t> ramp_rwys;
+	if(!ramps.empty())
+	for(vector<WED_Runway *>::iterator r = runways.begin(); r != runways.end(); ++r)
+	{
+		ramp_rwy_info_t info;
+		info.paved = (*r)->GetSurface() <= surf_Concrete || (*r)->GetSurface() == surf_Trans;
+		info.length = (*r)->GetLength();
+		info.width = (*r)->GetWidth();
+		ramp_rwys.push_back(info);
+	}
+
 	for(vector<WED_RampPosition *>::iterator r = ramps.begin(); r != ramps.end(); ++r)
 	{
-		ValidateOneRampPosition(*r,msgs,apt, runways);
+		ValidateOneRampPosition(*r,msgs,apt, ramp_rwys);
 	}
 
 	if(gExportTarget >= wet_xplane_1050)
@@ -2467,6 +2504,75 @@ static void ValidateOneAirport(WED_Airport* apt, validation_error_vector& msgs,
 	ValidateDSFRecursive(apt, lib_mgr, msgs, apt);
 }
 
+//------------------------------------------------------------------------------------------------------------------------------------
+// INCREMENTAL VALIDATION
+//------------------------------------------------------------------------------------------------------------------------------------
+// What ValidateOneAirport finds depends only on the airport's own sub-tree, the export target, the library and the CIFP data.
+// Every object carries the stamp of its last change, so the newest stamp in the sub-tree tells if anything in there was
+// touched - deleting a child changes its parent, and undo/redo change objects like any other command.  So we keep the
+// findings of every airport and only re-run the airports that did change since the last validation.
+//
+// The airports that do need a re-run are independent of each other and ValidateOneAirport only reads the document, so
+// they are validated in parallel.  Each one writes its own findings (and debug lines) and the results are merged in
+// airport order afterwards, so the report reads exactly like a serial run.
+
+struct apt_validation_t {
+	apt_validation_t() : stamp(-1), export_target(-1), library_rescans(-1) { }
+
+	long long						stamp;				// newest change stamp within the airport
+	int								export_target;
+	int								library_rescans;
+	string							cifp_key;			// which CIFP data was checked against, empty if none
+	validation_error_vector			msgs;
+#if DEBUG_VIS_LINES
+	debug_mesh_t					mesh;
+#endif
+};
+
+// Airport ID -> findings.  Only kept for one archive at a time - switching documents starts over.
+static WED_Archive *					sValidatedArchive = NULL;
+static map<int, apt_validation_t>		sValidatedAirports;
+
+// Taxi routes and other edges look at their nodes, so those count as part of the airport even if they are filed elsewhere.
+static long long NewestChangeStamp(WED_Thing * who)
+{
+	long long stamp = who->GetChangeStamp();
+	int ns = who->CountSources();
+	for(int n = 0; n < ns; ++n)
+		stamp = max(stamp, who->GetNthSource(n)->GetChangeStamp());
+	int nc = who->CountChildren();
+	for(int n = 0; n < nc; ++n)
+		stamp = max(stamp, NewestChangeStamp(who->GetNthChild(n)));
+	return stamp;
+}
+
+// Entities build their bounds and point lists lazily, on first use.  Do that for the whole airport here,
+// so the workers find every cache valid and only ever read them.
+static void WarmEntityCaches(WED_Thing * who)
+{
+	IGISEntity * ent = dynamic_cast<IGISEntity *>(who);
+	if(ent)
+	{
+		Bbox2 bounds;
+		ent->GetBounds(gis_Geo, bounds);
+		if(ent->HasLayer(gis_UV))
+			ent->GetBounds(gis_UV, bounds);
+	}
+	int ns = who->CountSources();
+	for(int n = 0; n < ns; ++n)
+	{
+		IGISEntity * src = dynamic_cast<IGISEntity *>(who->GetNthSource(n));
+		if(src)
+		{
+			Bbox2 bounds;
+			src->GetBounds(gis_Geo, bounds);
+			src->HasLayer(gis_UV);
+		}
+	}
+	int nc = who->CountChildren();
+	for(int n = 0; n < nc; ++n)
+		WarmEntityCaches(who->GetNthChild(n));
+}
 
 validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane, WED_Thing * wrl, bool skipErrorDialog, const char * abortMsg)
 {
@@ -2490,6 +2596,7 @@ validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane,
 
 	// get data about runways from CIFP data
 	MFMemFile * mf = NULL;
+	string cifp_key;
 	if(gExportTarget == wet_gateway)
 	{
 		WED_file_cache_request  mCacheRequest;
@@ -2528,11 +2635,67 @@ validation_result_t	WED_ValidateApt(WED_Document * resolver, WED_MapPane * pane,
 		}
 		else
 			mf = MemFile_Open(res.out_path.c_str());
+		struct stat meta;
+		if(mf && FILE_get_file_meta_data(res.out_path, meta) == 0)
+			cifp_key = res.out_path + ":" + to_string((long long) meta.st_size) + ":" + to_string((long long) meta.st_mtime);
+	}
+
+	WED_Archive * archive = wrl->GetArchive();
+	if(archive != sValidatedArchive)
+	{
+		sValidatedAirports.clear();
+		sValidatedArchive = archive;
+	}
+	else
+	{
+		// Forget airports that were deleted since.
+		for(map<int, apt_validation_t>::iterator c = sValidatedAirports.begin(); c != sValidatedAirports.end(); )
+		if(dynamic_cast<WED_Airport *>(archive->Fetch(c->first)) == NULL)
+			sValidatedAirports.erase(c++);
+		else
+			++c;
 	}
 
-	for(vector<WED_Airport *>::iterator a = apts.begin(); a != apts.end(); ++a)
+	vector<apt_validation_t *>	results(apts.size());
+	vector<int>					dirty;
+	for(int a = 0; a < apts.size(); ++a)
 	{
-		ValidateOneAirport(*a, msgs, lib_mgr, res_mgr, mf);
+		long long stamp = NewestChangeStamp(apts[a]);
+		apt_validation_t * entry = &sValidatedAirports[apts[a]->GetID()];
+		if(entry->stamp != stamp ||
+			entry->export_target != gExportTarget ||
+			entry->library_rescans != lib_mgr->GetRescanCount() ||
+			entry->cifp_key != cifp_key)
+		{
+			entry->stamp = stamp;
+			entry->export_target = gExportTarget;
+			entry->library_rescans = lib_mgr->GetRescanCount();
+			entry->cifp_key = cifp_key;
+			dirty.push_back(a);
+			WarmEntityCaches(apts[a]);
+		}
+		results[a] = entry;
+	}
+
+	parallel_for(0, dirty.size(), [&](int d) {
+		apt_validation_t * entry = results[dirty[d]];
+		entry->msgs.clear();
+#if DEBUG_VIS_LINES
+		entry->mesh.clear();
+		debug_mesh_redirect(&entry->mesh);
+#endif
+		ValidateOneAirport(apts[dirty[d]], entry->msgs, lib_mgr, res_mgr, mf);
+#if DEBUG_VIS_LINES
+		debug_mesh_redirect(NULL);
+#endif
+	});
+
+	for(int a = 0; a < apts.size(); ++a)
+	{
+		msgs.insert(msgs.end(), results[a]->msgs.begin(), results[a]->msgs.end());
+#if DEBUG_VIS_LINES
+		debug_mesh_append(results[a]->mesh);
+#endif
 	}
 	if (mf) MemFile_Close(mf);
 
@@ -49,16 +49,16 @@
 	
 	Benchmarked throughtput is 75 sec for 14 million items (global airports) to create a 5.5GB xml file.
 
+	Attributes are now formatted straight into one pre-formatted string per element and all text goes
+	through WED_XMLOutput, which drains to disk in 1 MB blocks.  WED_Archive::SaveToXML formats runs of
+	objects on all cores into fragment outputs and splices them back in order, so the file doesn't change.
+
 */
 
 #define FIX_EMPTY 0
 
-inline void fi_indent(int n, FILE * fi) { while(n--) fputc(' ', fi); }
-
-inline string str_escape(const string& str)
+inline void str_escape(string& result, const string& str)
 {
-	string result;
-
 	UTF8 * b = (UTF8 *) str.c_str();
 	UTF8 * e = b + str.length();
 	
@@ -123,76 +123,94 @@ inline string str_escape(const string& str)
 			++b;
 		}
 	}
-	return result;
 }
 
 
+WED_XMLOutput::WED_XMLOutput(FILE * f) : file(f)
+{
+	if(file)
+		buf.reserve(kDrainSize + kDrainSize / 4);
+}
+
+WED_XMLOutput::~WED_XMLOutput()
+{
+	drain();
+}
+
+void WED_XMLOutput::splice(WED_XMLOutput& other)
+{
+	if(buf.empty() && !file)
+		buf.swap(other.buf);
+	else
+		buf += other.buf;
+	string().swap(other.buf);
+	check_drain();
+}
+
+void WED_XMLOutput::drain(void)
+{
+	if(file && !buf.empty())
+	{
+		fwrite(buf.data(), 1, buf.size(), file);
+		buf.clear();
+	}
+}
+
 WED_XMLElement::WED_XMLElement(
 									const char *		n,
 									int					i,
-									FILE *				f) : 
+									WED_XMLOutput *		f) : 
 	file(f), indent(i), name(n), flushed(false), parent(NULL)
 {
 }
 
-WED_XMLElement::~WED_XMLElement()
+WED_XMLElement::WED_XMLElement(
+									const WED_XMLElement&	like,
+									WED_XMLOutput *			f) :
+	file(f), indent(like.indent), name(NULL), flushed(false), parent(NULL)
 {
-	if(!flushed)
-	{
-		fi_indent(indent, file);
-		fputc('<',file); fputs(name,file);
-
-		for(auto a : attrs)
-		{
-			fputc(' ',file); fputs(a.first,file); fputs("=\"",file);
-			fputs(a.second.c_str(), file);
-			fputc('"',file);
-		}
+}
 
-		if(children.empty())
-			fputs("/>\n",file);
-		else
-			fputs(">\n",file);
-	}
+WED_XMLElement::~WED_XMLElement()
+{
+	if(!flushed && name)
+		write_open(children.empty());
 
 	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
 		delete *c;
 
-	if(!children.empty() || flushed)
+	if((!children.empty() || flushed) && name)
 	{
-		fi_indent(indent,file);
-		fputs("</",file); fputs(name,file); fputs(">\n",file);
+		file->indent(indent);
+		file->write("</"); file->write(name); file->write(">\n");
 	}
+	file->check_drain();
+}
+
+void WED_XMLElement::write_open(bool empty)
+{
+	file->indent(indent);
+	file->put('<'); file->write(name);
+	file->write(attrs);
+	file->write(empty ? "/>\n" : ">\n");
 }
 
 void WED_XMLElement::flush()
 {
-	flush_from(NULL);
+	if(!children.empty())
+		flush_from(NULL);
 }
 
 void WED_XMLElement::flush_from(WED_XMLElement * who)
 {
-	if(who == NULL && children.empty())	return;
-
 	if(parent)
 		parent->flush_from(this);
 	parent = NULL;
 
-	if(!flushed)
-	{
-		fi_indent(indent, file);
-		fputc('<',file); fputs(name,file);
-
-		for(auto a : attrs)
-		{
-			fputc(' ',file); fputs(a.first,file); fputs("=\"",file);
-			fputs(a.second.c_str(), file);
-			fputc('"',file);
-		}
-		fputs(">\n",file);
-	}
+	if(!flushed && name)
+		write_open(false);
 
-	DebugAssert(who == children.back() || who == NULL);
+	DebugAssert(who == NULL || who == children.back());
 
 	for(vector<WED_XMLElement *>::iterator c = children.begin(); c != children.end(); ++c)
 	if(*c != who)
@@ -204,6 +222,15 @@ void WED_XMLElement::flush_from(WED_XMLElement * who)
 	flushed = true;
 }
 
+void WED_XMLElement::splice_children(WED_XMLOutput& formatted)
+{
+	if(formatted.empty()) return;
+	DebugAssert(file != &formatted);
+
+	flush_from(NULL);
+	file->splice(formatted);
+}
+
 inline char * to_chars(char * str, int len, int num)
 {
         char *p = str+len-1;
@@ -236,7 +263,9 @@ void					WED_XMLElement::add_attr_int(const char * name, int value)
 	DebugAssert(!flushed);
 //	attrs[name] = to_string(value); // its friggin slow - wanna spend 10% of the _whole_ time to save in his _one_ line ???
 	char c[16];
-	attrs.push_back(make_pair(name, string(to_chars(c, sizeof(c), value))));
+	attrs += ' '; attrs += name; attrs += "=\"";
+	attrs += to_chars(c, sizeof(c), value);
+	attrs += '"';
 }
 
 void					WED_XMLElement::add_attr_double(const char * name, double value, int dec)
@@ -247,14 +276,16 @@ void					WED_XMLElement::add_attr_double(const char * name, double value, int de
 	DebugAssert(name && *name);	
 #endif
 	DebugAssert(!flushed);
+	attrs += ' '; attrs += name; attrs += "=\"";
 	if(value == 0.0)
-		attrs.push_back(make_pair(name, string("0.0")));
+		attrs += "0.0";
 	else
 	{
 		char buf[32];
 		snprintf(buf,32,"%.*lf",dec,value);
-		attrs.push_back(make_pair(name, string(buf)));
+		attrs += buf;
 	}
+	attrs += '"';
 }
 
 void					WED_XMLElement::add_attr_c_str(const char * name, const char * str)
@@ -266,7 +297,9 @@ void					WED_XMLElement::add_attr_c_str(const char * name, const char * str)
 	DebugAssert(name && *name && str && *str);
 #endif
 	DebugAssert(!flushed);
-	attrs.push_back(make_pair(name, str_escape(str)));
+	attrs += ' '; attrs += name; attrs += "=\"";
+	str_escape(attrs, str);
+	attrs += '"';
 }
 
 void					WED_XMLElement::add_attr_stl_str(const char * name, const string& str)
@@ -277,7 +310,9 @@ void					WED_XMLElement::add_attr_stl_str(const char * name, const string& str)
 	DebugAssert(name && *name);	
 #endif
 	DebugAssert(!flushed);
-	attrs.push_back(make_pair(name, str_escape(str)));
+	attrs += ' '; attrs += name; attrs += "=\"";
+	str_escape(attrs, str);
+	attrs += '"';
 }
 
 WED_XMLElement *		WED_XMLElement::add_sub_element(const char * name)
@@ -303,9 +338,8 @@ WED_XMLElement *		WED_XMLElement::add_or_find_sub_element(const char * name)
 #endif
 
 	DebugAssert(!flushed);
-	string n(name);
 	for(int i = 0; i < children.size(); ++i)
-	if(children[i]->name == n)
+	if(strcmp(children[i]->name, name) == 0)
 		return children[i];
 		
 	WED_XMLElement * child = new WED_XMLElement(name, indent + 2, file);
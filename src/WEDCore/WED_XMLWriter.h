@@ -32,13 +32,53 @@
 
  */
 
+/*
+	WED_XMLOutput is the byte sink the elements format into.  It is a big string buffer; when
+	it is attached to a FILE it drains into the file in large blocks, otherwise it just keeps
+	the text so it can be spliced into another output later.  This lets several threads format
+	sibling elements into private outputs and then stitch them together in their original order.
+ */
+
+class	WED_XMLOutput {
+public:
+				 WED_XMLOutput(FILE * destination = NULL);
+				~WED_XMLOutput();
+
+	inline void				put(char c)							{ buf += c; }
+	inline void				write(const char * s)				{ buf += s; }
+	inline void				write(const string& s)				{ buf += s; }
+	inline void				indent(int n)						{ buf.append(n, ' '); }
+	inline void				check_drain(void)					{ if(file && buf.size() > kDrainSize) drain(); }
+
+	void					splice(WED_XMLOutput& other);		// Appends and empties other.
+	void					drain(void);						// Pushes all buffered text to the file, if any.
+	bool					empty(void) const { return buf.empty(); }
+
+private:
+
+	enum { kDrainSize = 1024 * 1024 };
+
+		FILE *				file;
+		string				buf;
+
+	WED_XMLOutput(const WED_XMLOutput&);
+	WED_XMLOutput& operator=(const WED_XMLOutput&);
+};
+
 class	WED_XMLElement {
 public:
 
 				 WED_XMLElement(
 									const char *		name,
 									int					indent,
-									FILE *				destination);
+									WED_XMLOutput *		destination);
+
+	// A fragment has no tag of its own - it only writes out its sub-elements, formatted as
+	// if they were children of "like".  Use it to format a run of children into a private
+	// output, then splice the output back into "like" with splice_children.
+				 WED_XMLElement(
+									const WED_XMLElement&	like,
+									WED_XMLOutput *			destination);
 				~WED_XMLElement();
 		
 	void					add_attr_int(const char * name, int value);
@@ -57,15 +97,21 @@ public:
 	// We use flush to keep memory bubble down.
 	void					flush(void);
 	
+	// Flushes like above, then appends pre-formatted children (from a fragment's output) after the
+	// existing children.  Empty outputs are ignored, so an element that never gets children still
+	// comes out as <name/>.
+	void					splice_children(WED_XMLOutput& children);
+
 private:
 
 	void					flush_from(WED_XMLElement * child);
+	void					write_open(bool empty);
 
 		bool									flushed;
-		FILE *									file;
+		WED_XMLOutput *							file;
 		int										indent;
-		const char *							name;
-		vector<pair<const char *,string> >	attrs;
+		const char *							name;				// NULL for fragments
+		string									attrs;				// pre-formatted ' name="value"' pairs
 		vector<WED_XMLElement *>			children;
 		WED_XMLElement *						parent;
 };	
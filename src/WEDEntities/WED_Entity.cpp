@@ -105,7 +105,8 @@ void	WED_Entity::CacheInval(int flags)
 int	WED_Entity::CacheBuild(int flags) const
 {
 	int needed_flags = flags & ~cache_valid_;
-	cache_valid_ |= needed_flags;
+	if(needed_flags)					// a warm cache is only read - validation workers rely on that
+		cache_valid_ |= needed_flags;
 	return needed_flags;
 }
 
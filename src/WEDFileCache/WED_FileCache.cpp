@@ -159,7 +159,7 @@ void WED_FileCache::init(void)
 
 		for (auto p : paired_files)
 		{
-			CACHE_file_cache.push_back(new CACHE_CacheObject());
+			CACHE_CacheObject * co = new CACHE_CacheObject();
 
 			bool info_read_success = false;
 
@@ -175,21 +175,26 @@ void WED_FileCache::init(void)
 
 				if(json_parse_result == true)
 				{
-					CACHE_file_cache.back()->m_last_time_modified = root["last_time_modified"].asInt();
-					CACHE_file_cache.back()->m_domain = static_cast<CACHE_domain>(root["domain"].asInt());
-					CACHE_file_cache.back()->set_disk_location(files[p.first]);
+					co->m_last_time_modified = root["last_time_modified"].asInt();
+					co->m_domain = static_cast<CACHE_domain>(root["domain"].asInt());
+					co->set_disk_location(files[p.first]);
 
-					time_t age = difftime(now,CACHE_file_cache.back()->m_last_time_modified);
+					time_t age = difftime(now,co->m_last_time_modified);
 
-					if(age < (GetDomainPolicy(CACHE_file_cache.back()->m_domain)).cache_domain_pol_max_seconds_on_disk /* + margin ? */)
+					if(age < (GetDomainPolicy(co->m_domain)).cache_domain_pol_max_seconds_on_disk /* + margin ? */)
 						info_read_success = true;
 				}
 			}
 
-			if(info_read_success == false)
+			if(info_read_success)
 			{
-				delete CACHE_file_cache.back();
-				CACHE_file_cache.pop_back();
+				CACHE_CacheObject *& slot = CACHE_file_cache[files[p.first]];
+				delete slot;
+				slot = co;
+			}
+			else
+			{
+				delete co;
 #if KEEP_EXPIRED_CACHE_FILES
 				files_to_delete.push_back(p.first);
 				files_to_delete.push_back(p.second);
@@ -294,10 +299,12 @@ static void interpret_error(curl_http_get_file& mCurl, string& out_error_human,
 	out_error_human = ss.str();
 }
 
-WED_file_cache_response WED_FileCache::start_new_cache_object(WED_file_cache_request req)
+WED_file_cache_response WED_FileCache::start_new_cache_object(const WED_file_cache_request& req, const string& path)
 {
-	CACHE_file_cache.push_back(new CACHE_CacheObject());
-	CACHE_CacheObject& co = *CACHE_file_cache.back();
+	CACHE_CacheObject *& slot = CACHE_file_cache[path];
+	delete slot;
+	slot = new CACHE_CacheObject();
+	CACHE_CacheObject& co = *slot;
 	
 	co.create_RAII_curl_hndl(req.in_url, req.in_cert);
 	
@@ -308,12 +315,6 @@ WED_file_cache_response WED_FileCache::start_new_cache_object(WED_file_cache_req
 								   cache_status_downloading);
 }
 
-void WED_FileCache::remove_cache_object(vector<CACHE_CacheObject* >::iterator itr)
-{
-	delete *itr;
-	CACHE_file_cache.erase(itr);
-}
-
 WED_file_cache_response WED_FileCache::request_file(const WED_file_cache_request& req)
 {
 	//The cache must be initialized!
@@ -345,29 +346,21 @@ WED_file_cache_response WED_FileCache::request_file(const WED_file_cache_request
 	---------------------------------------------------------------------------
 	*/
 	
-	vector<CACHE_CacheObject* >::iterator itr = CACHE_file_cache.begin();
-	for ( ; itr != CACHE_file_cache.end(); ++itr)
-	{
-		if((**itr).get_disk_location() == url_to_cache_path(req))
-		{
-			break;
-		}
-		else if ((**itr).get_last_url() == req.in_url)
-		{
-			break;
-		}
-	}
+	// Every object lives under the path its file has (or will have) in the cache, so one hash lookup finds it -
+	// this gets called for every tile on screen on every frame.
+	string cache_path = url_to_cache_path(req);
+	cache_table_t::iterator itr = CACHE_file_cache.find(cache_path);
 
 	if(itr == CACHE_file_cache.end()) //1. Not in CACHE_file_cache?
 	{
 		//If it is not on disk, not cooling down, and not in the download_queue, we finally get to download it
-		return start_new_cache_object(req);
+		return start_new_cache_object(req, cache_path);
 	}
 	
-	CACHE_CacheObject & co = **itr;
+	CACHE_CacheObject & co = *itr->second;
 
 	//2. In CACHE_file_cache with active cURL_handle?
-	if((**itr).get_RAII_curl_hndl() != NULL)
+	if(co.get_RAII_curl_hndl() != NULL)
 	{
 		curl_http_get_file & hndl = co.get_RAII_curl_hndl()->get_curl_handle();
 		
@@ -391,7 +384,7 @@ WED_file_cache_response WED_FileCache::request_file(const WED_file_cache_request
 				Either it all is saved perfectly or we delete it all and report an error. This is an all or nothing situation.
 				*/
 
-				res.out_path = url_to_cache_path(req);
+				res.out_path = cache_path;
 				FILE_make_dir_exist(string(CACHE_folder + DIR_STR + req.in_folder_prefix).c_str());
 
 				//We test if file and cache_file_info file save PERFECECTLY, with NO issues
@@ -404,10 +397,8 @@ WED_file_cache_response WED_FileCache::request_file(const WED_file_cache_request
 				if(f() != NULL)
 				{
 					const vector<char>& buf = co.get_RAII_curl_hndl()->get_dest_buffer();
-					for(vector<char>::const_iterator itr = buf.begin(); itr != buf.end(); ++itr)
-					{
-						fprintf(f(),"%c",*itr);
-					}
+					if(!buf.empty())
+						fwrite(&buf[0], 1, buf.size(), f());
 
 					good_file_save = ferror(f()) == 0 ? true : false;
 				}
@@ -482,23 +473,21 @@ WED_file_cache_response WED_FileCache::request_file(const WED_file_cache_request
 		{
 			return WED_file_cache_response(-1, "Cache cooling after failed network attempt, please wait: " + to_string(seconds_left) + " seconds...", cache_error_type_none, "", cache_status_cooling);
 		}
-		else if(FILE_exists((*itr)->get_disk_location().c_str()) == true) //Check if file was deleted between requests
+		else if(FILE_exists(co.get_disk_location().c_str()) == true) //Check if file was deleted between requests
 		{
 			if(co.needs_refresh(pol) == false)
 			{
-				DebugAssert((*itr)->get_disk_location() != "");
-				return WED_file_cache_response(-1, "", cache_error_type_none, (*itr)->get_disk_location(), cache_status_available);
+				DebugAssert(co.get_disk_location() != "");
+				return WED_file_cache_response(-1, "", cache_error_type_none, co.get_disk_location(), cache_status_available);
 			}
 			else
 			{
-				remove_cache_object(itr);
-				return start_new_cache_object(req);
+				return start_new_cache_object(req, cache_path);
 			}
 		}
 		else
 		{
-			remove_cache_object(itr);
-			return start_new_cache_object(req);
+			return start_new_cache_object(req, cache_path);
 		}
 	}
 }
@@ -521,11 +510,11 @@ vector<string> WED_FileCache::get_files_available(CACHE_domain domain, string fo
 
 WED_FileCache::~WED_FileCache()
 {
-	for(vector<CACHE_CacheObject* >::iterator co = CACHE_file_cache.begin();
+	for(cache_table_t::iterator co = CACHE_file_cache.begin();
 		co != CACHE_file_cache.end();
 		++co)
 	{
-		delete *co;
+		delete co->second;
 	}
 	CACHE_file_cache.clear();
 }
@@ -25,6 +25,7 @@
 #define WED_FILECACHE_H
 
 #include "CACHE_DomainPolicy.h"
+#include <unordered_map>
 
 class CACHE_CacheObject;
 
@@ -101,12 +102,13 @@ class WED_FileCache
 
 		vector<string>	get_files_available(CACHE_domain domain, string folder_prefix);
 		WED_file_cache_response Request_file(const WED_file_cache_request& req);
-		WED_file_cache_response start_new_cache_object(WED_file_cache_request req);
-		void 				remove_cache_object(vector<CACHE_CacheObject* >::iterator itr);
+		WED_file_cache_response start_new_cache_object(const WED_file_cache_request& req, const string& path);
+
+		typedef unordered_map<string, CACHE_CacheObject *>	cache_table_t;
 
 		const string 	CACHE_INFO_FILE_EXT = ".cache_object_info";
 		string 			CACHE_folder;	                  // The fully qualified path to the file cache folder
-		vector<CACHE_CacheObject* > CACHE_file_cache;   // Our vector of CacheObjects
+		cache_table_t	CACHE_file_cache;                 // Our CacheObjects, by their path in the cache - see url_to_cache_path
 };
 
 extern WED_FileCache gFileCache;
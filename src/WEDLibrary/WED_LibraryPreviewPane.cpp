@@ -34,6 +34,7 @@
 #include "GUI_Messages.h"
 #include "GUI_Resources.h"
 #include "WED_Menus.h"
+#include "WED_Messages.h"
 
 #include "WED_Colors.h"
 #include "WED_LibraryMgr.h"
@@ -70,6 +71,10 @@ WED_LibraryPreviewPane::WED_LibraryPreviewPane(GUI_Commander * cmdr, WED_Resourc
 		mNextButton->SetMsg(next_variant,0);
 		mNextButton->AddListener(this);
 		mNextButton->Hide();
+
+		mResMgr->AddListener(this);
+		if(GUI_Broadcaster * b = dynamic_cast<GUI_Broadcaster *>(mTexMgr))
+			b->AddListener(this);
 }
 
 void		WED_LibraryPreviewPane::ReceiveMessage(GUI_Broadcaster * inSrc, intptr_t inMsg, intptr_t inParam)
@@ -84,6 +89,8 @@ void		WED_LibraryPreviewPane::ReceiveMessage(GUI_Broadcaster * inSrc, intptr_t i
 		char s[16]; sprintf(s,"%d/%d",mVariant+1,mNumVariants);
 		mNextButton->SetDescriptor(s);
 	}
+	else if(inMsg == msg_ResourceLoaded)
+		Refresh();
 }
 
 void WED_LibraryPreviewPane::SetResource(const string& r, int res_type)
@@ -328,9 +335,9 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 	if(!mRes.empty())
 	{	switch(mType) {
 		case res_Polygon:
-			if(mResMgr->GetPol(mRes,pol))
+			if(mResMgr->RequestPol(mRes,pol))
 			{
-				TexRef	tref = mTexMgr->LookupTexture(pol->base_tex.c_str(),true, pol->wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
+				TexRef	tref = mTexMgr->RequestTexture(pol->base_tex.c_str(),true, pol->wrap ? (tex_Compress_Ok|tex_Wrap) : tex_Compress_Ok);
 				if(tref != NULL)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
@@ -383,9 +390,9 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 			}
 			break;
 		case res_Line:
-			if(mResMgr->GetLin(mRes,lin))
+			if(mResMgr->RequestLin(mRes,lin))
 			{
-				TexRef	tref = mTexMgr->LookupTexture(lin->base_tex.c_str(),true, tex_Compress_Ok);
+				TexRef	tref = mTexMgr->RequestTexture(lin->base_tex.c_str(),true, tex_Compress_Ok);
 				if(tref != NULL)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
@@ -420,7 +427,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 			}
 			break;
 		case res_Facade:
-			if (mResMgr->GetFac(mRes, fac, mVariant))
+			if (mResMgr->RequestFac(mRes, fac, mVariant))
 			{
 				Polygon2 footprint;
 				vector<int> choices;
@@ -474,7 +481,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 			}
 			break;
 		case res_Forest:
-			if(!mResMgr->GetFor(mRes,o))
+			if(!mResMgr->RequestFor(mRes,o))
 				break;
 		case res_String:
 			if(!o)
@@ -488,7 +495,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 			g->SetState(false,1,false,true,true,true,true);
 			glClear(GL_DEPTH_BUFFER_BIT);
 
-			if (o || mResMgr->GetObj(mRes,o,mVariant))
+			if (o || mResMgr->RequestObj(mRes,o,mVariant))
 			{
 				double real_radius=pythag(
 									o->xyz_max[0]-o->xyz_min[0],
@@ -505,7 +512,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 						
 				end3d();
 			}
-			else if (mResMgr->GetAGP(mRes,agp))
+			else if (mResMgr->RequestAGP(mRes,agp))
 			{
 				double real_radius=pythag(
 									agp->xyz_max[0] - agp->xyz_min[0],
@@ -520,7 +527,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 
 				if(!agp->tile.empty() && !agp->hide_tiles)
 				{
-					TexRef	ref = mTexMgr->LookupTexture(agp->base_tex.c_str(), true, tex_Linear | tex_Mipmap | tex_Compress_Ok);
+					TexRef	ref = mTexMgr->RequestTexture(agp->base_tex.c_str(), true, tex_Linear | tex_Mipmap | tex_Compress_Ok);
 					int id1 = ref ? mTexMgr->GetTexID(ref) : 0;
 					if (id1)g->BindTex(id1, 0);
 
@@ -545,7 +552,9 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 		
 		// plot some additional information about the previewed object
 		char buf1[120] = "", buf2[120] = "";
-		switch(mType)
+		if(mResMgr->IsLoading(mRes))
+			sprintf(buf2,"Loading ...");
+		else switch(mType)
 		{
 			case res_Facade:
 				if(fac && fac->wallName.size())
@@ -567,7 +576,7 @@ void	WED_LibraryPreviewPane::Draw(GUI_GraphState * g)
 				{
 					sprintf(buf1,"Has decal (not shown)");
 				}
-				if (pol->mSubBoxes.size())
+				if (pol && pol->mSubBoxes.size())
 				{
 					sprintf(buf2,"Select desired part of texture by clicking on it");
 				}
@@ -32,6 +32,8 @@
 #include "WED_Map.h"
 #include "WED_MapBkgnd.h"
 #include "WED_ToolUtils.h"
+#include "ITexMgr.h"
+#include "GUI_Broadcaster.h"
 #include "WED_MarqueeTool.h"
 #include "WED_CreateBoxTool.h"
 #include "WED_CreateEdgeTool.h"
@@ -295,6 +297,10 @@ WED_MapPane::WED_MapPane(GUI_Commander * cmdr, double map_bounds[4], IResolver *
 
 	archive->AddListener(mMap);
 
+	// Same for textures the map layers asked for in the background - the map redraws once they are in.
+	if(GUI_Broadcaster * tex_mgr = dynamic_cast<GUI_Broadcaster *>(WED_GetTexMgr(resolver)))
+		tex_mgr->AddListener(mMap);
+
 	// This is a band-aid.  We don't restore the current tab in the tab hierarchy (as of WED 1.5) so we don't get a tab changed message.  Instead we just
 	// are always in the selection tab.  So mostly that means the defaults for things like filters are fine, but for the ATC layer it needs to be off!
 	mATCLayer->ToggleVisible();
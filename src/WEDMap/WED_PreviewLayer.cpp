@@ -149,7 +149,7 @@ static bool setup_taxi_texture(int surface_code, double heading, const Point2& c
 static bool setup_pol_texture(ITexMgr * tman, const pol_info_t& pol, double heading, bool no_proj, const Point2& centroid, GUI_GraphState * g,
 							WED_MapZoomerNew * z, float alpha, bool isAbsPath = true)
 {
-	TexRef	ref = tman->LookupTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Always_Pad) : tex_Compress_Ok|tex_Always_Pad);
+	TexRef	ref = tman->RequestTexture(pol.base_tex.c_str(),true, pol.wrap ? (tex_Compress_Ok|tex_Wrap|tex_Always_Pad) : tex_Compress_Ok|tex_Always_Pad);
 	if(ref == NULL) return false;
 	int tex_id = tman->GetTexID(ref);
 
@@ -250,8 +250,8 @@ static ObjDrawFuncs10_t kFuncs  = { Obj_SetupPoly, Obj_SetupLine, Obj_SetupLight
 void draw_obj_at_ll(ITexMgr * tman, const XObj8 * o, const Point2& loc, float r, GUI_GraphState * g, WED_MapZoomerNew * zoomer)
 {
 	if (!o) return;
-	TexRef	ref = tman->LookupTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);			
-	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->LookupTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);
+	TexRef	ref = tman->RequestTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);			
+	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->RequestTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);
 	int id1 = ref  ? tman->GetTexID(ref ) : 0;
 	int id2 = ref2 ? tman->GetTexID(ref2) : 0;
 	g->SetTexUnits(1);
@@ -272,8 +272,8 @@ void draw_obj_at_ll(ITexMgr * tman, const XObj8 * o, const Point2& loc, float r,
 void draw_obj_at_xyz(ITexMgr * tman, const XObj8 * o, double x, double y, double z, float r, GUI_GraphState * g)
 {
 	if (!o) return;
-	TexRef	ref = tman->LookupTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);			
-	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->LookupTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);
+	TexRef	ref = tman->RequestTexture(o->texture.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);			
+	TexRef	ref2 = o->texture_draped.empty() ? ref : tman->RequestTexture(o->texture_draped.c_str() ,true, tex_Wrap|tex_Compress_Ok|tex_Always_Pad);
 	int id1 = ref  ? tman->GetTexID(ref ) : 0;
 	int id2 = ref2 ? tman->GetTexID(ref2) : 0;
 	g->SetTexUnits(1);
@@ -648,7 +648,7 @@ struct	preview_line : WED_PreviewItem {
 		if (!rmgr->GetLin(vpath,linfo)) return;
 
 		ITexMgr *	tman = WED_GetTexMgr(resolver);
-		TexRef tref = tman->LookupTexture(linfo->base_tex.c_str(),true,tex_Compress_Ok);
+		TexRef tref = tman->RequestTexture(linfo->base_tex.c_str(),true,tex_Compress_Ok);
 		int tex_id = 0;
 		if(tref) tex_id = tman->GetTexID(tref);
 
@@ -840,7 +840,7 @@ struct	preview_airportlines : WED_PreviewItem {
 			if (lmgr->GetLineVpath(t, vpath))
 				if (rmgr->GetLin(vpath, linfo))
 				{
-					TexRef tref = tman->LookupTexture(linfo->base_tex.c_str(),true,tex_Compress_Ok);
+					TexRef tref = tman->RequestTexture(linfo->base_tex.c_str(),true,tex_Compress_Ok);
 					if(tref) tex_id = tman->GetTexID(tref);
 				}
 			
@@ -1098,7 +1098,7 @@ struct	preview_ortho : public preview_polygon {
 		{
 			string rpath;
 			orth->GetResource(rpath);
-			TexRef	tref = tman->LookupTexture(rpath.c_str(), false, tex_Compress_Ok|tex_Linear);
+			TexRef	tref = tman->RequestTexture(rpath.c_str(), false, tex_Compress_Ok|tex_Linear);
 			if(tref == NULL) return;
 			if(int tex_id = tman->GetTexID(tref))
 			{
@@ -1148,7 +1148,7 @@ struct	preview_object : public WED_PreviewItem {
 			Point2 loc;
 			obj->GetLocation(gis_Geo,loc);
 			g->SetState(false,1,false,true,true,true,true);
-			TexRef	ref = tman->LookupTexture(agp->base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok|tex_Always_Pad);
+			TexRef	ref = tman->RequestTexture(agp->base_tex.c_str() ,true, tex_Linear|tex_Mipmap|tex_Compress_Ok|tex_Always_Pad);
 			int id1 = ref  ? tman->GetTexID(ref ) : 0;
 			if(id1)g->BindTex(id1,0);
 			glMatrixMode(GL_MODELVIEW);
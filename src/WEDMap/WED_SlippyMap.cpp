@@ -37,7 +37,9 @@
 #include "GUI_Fonts.h"
 #include "curl_http.h"
 
-#include "WED_FileCache.h"
+#include "ParallelUtils.h"
+
+#include <chrono>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
@@ -60,6 +62,10 @@
 							// Since zoom goes by 1.2x steps - it matters little w.r.t "sharpness"
 							// but saves on average 34% of all tile loads
 
+#define MAX_TILE_FETCHES	8	// tile requests in flight at once - all run on curl_http's one download thread
+#define MAX_TILE_DECODERS	3
+#define UPLOAD_BUDGET_MS	8	// max time spent per frame turning decoded tiles into textures
+
 #define PREDEFINED_MAPS 2
 
 static const char * attributions[PREDEFINED_MAPS] = {
@@ -134,23 +140,58 @@ static void get_tile_range_for_box(const double bounds[4], int z, int tiles[4])
 }
 
 
+// Reads one downloaded tile and applies the color adjustment.  Runs on the decoder threads.
+static bool decode_tile(const string& path, int mode, ImageInfo& info)
+{
+	memset(&info, 0, sizeof(info));
+	int r = CreateBitmapFromPNG(path.c_str(), &info, false, 0);
+	if(r != 0)
+		r = CreateBitmapFromJPEG(path.c_str(), &info);
+	if(r != 0)
+		return false;
+
+	if (info.channels == 3)                                                        // apply to color changes
+		for (int x = 0; x < info.height * (info.width+info.pad) * info.channels; x += info.channels)
+			{
+				double BRIGHTNESS = -20;
+				double SATURATION = 1.0;
+				if(mode == 1) { BRIGHTNESS = -140.0; SATURATION = 0.4; }
+
+				int val = 0.3 * info.data[x] + 0.6 * info.data[x+1] + 0.1 * info.data[x+2];  // deliberately not HSV weighing - want red's brighter
+				for (int c = 0; c < info.channels; ++c)
+					info.data[x+c] = intlim((1.0-SATURATION) * val + SATURATION * info.data[x+c] + BRIGHTNESS, 0, 255);
+			}
+	return true;
+}
+
 WED_SlippyMap::WED_SlippyMap(GUI_Pane * h, WED_MapZoomerNew * zoomer, IResolver * resolver)
 	: WED_MapLayer(h, zoomer, resolver),
-	m_cache_request(NULL),
+	m_cache_bytes(0),
+	m_frame(0),
+	m_quit(false),
 	mMapMode(0)
 {
 }
 
 WED_SlippyMap::~WED_SlippyMap()
 {
-	delete m_cache_request;
-	m_cache_request = NULL;
+	{
+		lock_guard<mutex> guard(m_decode_lock);
+		m_quit = true;
+	}
+	m_decode_ready.notify_all();
+	for(auto& t : m_decoders)
+		t.join();
+	for(auto& d : m_decoded)
+		DestroyBitmap(&d.info);
+	// Like before, the textures are left to die with the GL context - there might not be a current one here.
 }
 
 void	WED_SlippyMap::DrawVisualization(bool inCurrent, GUI_GraphState * g)
 {
 	if (mMapMode ==0) return;
-	finish_loading_tile();
+	++m_frame;
+	finish_loading_tiles();
 
 	double map_bounds[4];
 
@@ -166,6 +207,16 @@ void	WED_SlippyMap::DrawVisualization(bool inCurrent, GUI_GraphState * g)
 	int min_zoom = flt_abs(map_bounds[1]) > 60.0 ? MIN_ZOOM-1 : MIN_ZOOM; // get those ant/artic designers a bit more visibility
 	if(z_max < min_zoom) return;
 
+	// Tiles nearest the center of the view get downloaded first.
+	struct wanted_tile_t {
+		double					dist;
+		string					path;
+		WED_file_cache_request	req;
+	};
+	vector<wanted_tile_t>	missing;
+	double center_x = zoomer->LonToXPixel((map_bounds[0] + map_bounds[2]) * 0.5);
+	double center_y = zoomer->LatToYPixel((map_bounds[1] + map_bounds[3]) * 0.5);
+
 	int want = 0, got = 0, bad = 0;
 	for(int z = max(min_zoom,z_max-1); z <= z_max; ++z)      // Display only the next lower zoom level
 	{                                                        // avoids having to load up to 4x14 extra tiles at ZL16
@@ -228,11 +279,14 @@ void	WED_SlippyMap::DrawVisualization(bool inCurrent, GUI_GraphState * g)
 			//The potential place the tile could appear on disk, were it to be downloaded or have been downloaded
 			string potential_path = gFileCache.url_to_cache_path(WED_file_cache_request("", cache_domain_osm_tile, folder_prefix , url));
 
-			if (m_cache.count(potential_path))
+			auto t = m_cache.find(potential_path);
+			if (t != m_cache.end())
 			{
 				++got;
+				t->second.last_used = m_frame;
+				m_lru.splice(m_lru.begin(), m_lru, t->second.lru);
 
-				int id = m_cache[potential_path];
+				int id = t->second.tex_id;
 				if(id != 0)
 				{
 					g->SetState(0, 1, 0, 0, 0, 0, 0);
@@ -262,14 +316,26 @@ void	WED_SlippyMap::DrawVisualization(bool inCurrent, GUI_GraphState * g)
 					++bad;
 				}
 			}
-			else if(m_cache_request == NULL)
+			else if(!m_pending.count(potential_path))
 			{
-				m_cache_request = new WED_file_cache_request("", cache_domain_osm_tile, folder_prefix, url);
+				wanted_tile_t w = { pythag((pbounds[0] + pbounds[2]) * 0.5 - center_x, (pbounds[1] + pbounds[3]) * 0.5 - center_y),
+									potential_path, WED_file_cache_request("", cache_domain_osm_tile, folder_prefix, url) };
+				missing.push_back(w);
 			}
 		}
 	}
 
-	if (m_cache_request)
+	sort(missing.begin(), missing.end(), [](const wanted_tile_t& a, const wanted_tile_t& b) { return a.dist < b.dist; });
+	for(auto& w : missing)
+	{
+		if(m_fetching.size() >= MAX_TILE_FETCHES) break;
+		m_fetching.insert(make_pair(w.path, w.req));
+		m_pending.insert(w.path);
+	}
+
+	evict_tiles();
+
+	if (!m_pending.empty())
 	{
 		this->Start(0.05);
 	}
@@ -282,7 +348,7 @@ void	WED_SlippyMap::DrawVisualization(bool inCurrent, GUI_GraphState * g)
 	zoom_msg << "ZL" << z_max << ": "
 			 << got << " of " << want
 			 << " (" << (float)got * 100.0f / (float)want << "% done, " << bad << " errors). "
-			 << (int)m_cache.size() << " tiles cached (" << (int)m_cache.size() / 4 << " MB)";
+			 << (int)m_cache.size() << " tiles cached (" << (int)(m_cache_bytes >> 20) << " of " << gSlippyMapCacheMB << " MB)";
 
 	int bnds[4];
 	GetHost()->GetBounds(bnds);
@@ -310,63 +376,126 @@ void	WED_SlippyMap::GetCaps(bool& draw_ent_v, bool& draw_ent_s, bool& cares_abou
 	draw_ent_v = draw_ent_s = cares_about_sel = wants_clicks = 0;
 }
 
-void	WED_SlippyMap::finish_loading_tile()
+void	WED_SlippyMap::finish_loading_tiles()
 {
-	if (m_cache_request != NULL)
+	for(auto f = m_fetching.begin(); f != m_fetching.end(); )
 	{
-		WED_file_cache_response res = gFileCache.request_file(*m_cache_request);
+		WED_file_cache_response res = gFileCache.request_file(f->second);
 		if (res.out_status == cache_status_available)
 		{
-			struct ImageInfo info;
-			int r = CreateBitmapFromPNG(res.out_path.c_str(), &info, false, 0);
-			if(r != 0)
-				r = CreateBitmapFromJPEG(res.out_path.c_str(), &info);
-			if(r == 0)
+			if(m_decoders.empty())
+				for(int n = 0; n < min(MAX_TILE_DECODERS, parallel_thread_count()); ++n)
+					m_decoders.push_back(std::thread(&WED_SlippyMap::decode_tiles, this));
 			{
-				if (info.channels == 3)                                                        // apply to color changes
-					for (int x = 0; x < info.height * (info.width+info.pad) * info.channels; x += info.channels)
-						{
-							double BRIGHTNESS = -20;
-							double SATURATION = 1.0;
-							if(mMapMode == 1) { BRIGHTNESS = -140.0; SATURATION = 0.4; }
-
-							int val = 0.3 * info.data[x] + 0.6 * info.data[x+1] + 0.1 * info.data[x+2];  // deliberately not HSV weighing - want red's brighter
-							for (int c = 0; c < info.channels; ++c)
-								info.data[x+c] = intlim((1.0-SATURATION) * val + SATURATION * info.data[x+c] + BRIGHTNESS, 0, 255);
-						}
-
-				GLuint tex_id;
-				glGenTextures(1, &tex_id);
-				if (LoadTextureFromImage(info, tex_id, tex_Linear, NULL, NULL, NULL, NULL))
-				{
-					m_cache[res.out_path] = tex_id;
-				}
-				else
-				{
-					printf("Failed texture load from image.\n");
-					m_cache[res.out_path] = 0;
-				}
-			}
-			else
-			{
-				printf("Can not read image tile - bad PNG or JPG data.\n");
-				m_cache[res.out_path] = 0;
+				lock_guard<mutex> guard(m_decode_lock);
+				decode_job_t job = { f->first, mMapMode };
+				m_decode_jobs.push_back(job);
 			}
-			DestroyBitmap(&info);
-			delete m_cache_request;
-			m_cache_request = NULL;
+			m_decode_ready.notify_one();
+			f = m_fetching.erase(f);
 		}
 		else if (res.out_status == cache_status_error)
 		{
 			int code = res.out_error_type;
 
-			printf("%s: %d\n%s\n", res.out_path.c_str(), code, res.out_error_human.c_str());
+			printf("%s: %d\n%s\n", f->first.c_str(), code, res.out_error_human.c_str());
 
-			m_cache[res.out_path] = 0;
+			add_tile(f->first, 0, 0);
+			m_pending.erase(f->first);
+			f = m_fetching.erase(f);
+		}
+		else if (res.out_status == cache_status_cooling)
+		{
+			m_pending.erase(f->first);				// don't block a download slot - we ask again next frame
+			f = m_fetching.erase(f);
+		}
+		else
+			++f;
+	}
 
-			delete m_cache_request;
-			m_cache_request = NULL;
+	auto upload_start = chrono::steady_clock::now();
+	while(chrono::steady_clock::now() - upload_start < chrono::milliseconds(UPLOAD_BUDGET_MS))
+	{
+		decoded_tile_t d;
+		{
+			lock_guard<mutex> guard(m_decode_lock);
+			if(m_decoded.empty()) break;
+			d = m_decoded.front();
+			m_decoded.pop_front();
 		}
+
+		if(d.ok)
+		{
+			GLuint tex_id;
+			glGenTextures(1, &tex_id);
+			if (LoadTextureFromImage(d.info, tex_id, tex_Linear, NULL, NULL, NULL, NULL))
+			{
+				add_tile(d.path, tex_id, d.info.width * d.info.height * 4);
+			}
+			else
+			{
+				printf("Failed texture load from image.\n");
+				glDeleteTextures(1, &tex_id);
+				add_tile(d.path, 0, 0);
+			}
+		}
+		else
+		{
+			printf("Can not read image tile - bad PNG or JPG data.\n");
+			add_tile(d.path, 0, 0);
+		}
+		DestroyBitmap(&d.info);
+		m_pending.erase(d.path);
+	}
+}
+
+void	WED_SlippyMap::add_tile(const string& path, int tex_id, int bytes)
+{
+	m_lru.push_front(path);
+	tile_t t = { tex_id, bytes, m_frame, m_lru.begin() };
+	m_cache[path] = t;
+	m_cache_bytes += bytes;
+}
+
+void	WED_SlippyMap::evict_tiles()
+{
+	long long budget = (long long) gSlippyMapCacheMB << 20;
+	while(m_cache_bytes > budget && !m_lru.empty())
+	{
+		auto t = m_cache.find(m_lru.back());
+		if(t->second.last_used == m_frame)
+			break;								// everything left is on screen
+		if(t->second.tex_id)
+		{
+			GLuint id = t->second.tex_id;
+			glDeleteTextures(1, &id);
+		}
+		m_cache_bytes -= t->second.bytes;
+		m_cache.erase(t);
+		m_lru.pop_back();
+	}
+}
+
+void	WED_SlippyMap::decode_tiles()
+{
+	unique_lock<mutex> guard(m_decode_lock);
+	while(true)
+	{
+		while(!m_quit && m_decode_jobs.empty())
+			m_decode_ready.wait(guard);
+		if(m_quit)
+			return;
+
+		decode_job_t job = m_decode_jobs.front();
+		m_decode_jobs.pop_front();
+		guard.unlock();
+
+		decoded_tile_t d;
+		d.path = job.path;
+		d.ok = decode_tile(job.path, job.mode, d.info);
+
+		guard.lock();
+		m_decoded.push_back(d);
 	}
 }
 
@@ -25,10 +25,30 @@
 #ifndef WED_SlippyMap_h
 #define WED_SlippyMap_h
 
-class	WED_file_cache_request;
+/*
+	WED_SlippyMap - THEORY OF OPERATION
+
+	Tiles go through three stages, each on its own clock:
+
+	- Download: up to MAX_TILE_FETCHES requests to the file cache are in flight at once.  Every frame the tiles
+	  we still need are sorted by distance from the center of the view, so the middle of the screen fills first.
+	- Decode: a few worker threads read the PNG/JPEG off disk and apply the color adjustment.
+	- Upload: back on the UI thread, decoded tiles become GL textures - only for a few ms per frame, so panning
+	  stays smooth while a burst of tiles comes in.
+
+	Uploaded textures live in an LRU cache.  Once it grows past gSlippyMapCacheMB, the tiles drawn longest ago
+	are deleted - but never one that is on screen right now.
+*/
 
 #include "GUI_Timer.h"
 #include "WED_MapLayer.h"
+#include "WED_FileCache.h"
+#include "BitmapUtils.h"
+#include <list>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 enum yCoord_t { yNone, yNormal, yYahoo, yOSGeo };
 
@@ -46,13 +66,45 @@ public:
 
 private:
 
-			void	finish_loading_tile();
+	struct	tile_t {
+		int							tex_id;		// 0 = tile failed to load
+		int							bytes;		// estimated VRAM use
+		int							last_used;	// frame it was last drawn in
+		list<string>::iterator		lru;
+	};
+
+	struct	decode_job_t {
+		string		path;			// where the file cache put it - also the key into m_cache
+		int			mode;			// map mode, picks the color adjustment
+	};
+
+	struct	decoded_tile_t {
+		string		path;
+		ImageInfo	info;
+		bool		ok;
+	};
+
+			void	finish_loading_tiles();
+			void	add_tile(const string& path, int tex_id, int bytes);
+			void	evict_tiles();
+			void	decode_tiles();
 			int 	get_zl_for_map(double in_ppm, double lattitude);
 
-	WED_file_cache_request* m_cache_request;
+	map<string,WED_file_cache_request>	m_fetching;		// downloads in flight, by cache path
+	set<string>							m_pending;		// tiles downloading, decoding or waiting for upload
+
+	//The texture cache, where they key is the tile texture path on disk
+	map<string,tile_t>	m_cache;
+	list<string>		m_lru;				// most recently drawn first
+	long long			m_cache_bytes;
+	int					m_frame;
 
-	//The texture cache, where they key is the tile texture path on disk and the value is the texture id
-	map<string,int>	m_cache;
+	mutex					m_decode_lock;	// guards the decode queues and m_quit
+	condition_variable		m_decode_ready;
+	deque<decode_job_t>		m_decode_jobs;
+	deque<decoded_tile_t>	m_decoded;
+	vector<std::thread>		m_decoders;
+	bool					m_quit;
 
 			int		mMapMode;
 			string	url_printf_fmt;
@@ -99,7 +99,7 @@ void		WED_WorldMapLayer::DrawVisualization		(bool inCurrent, GUI_GraphState * g)
 			{
 				char	fname[200];
 				snprintf(fname,200,"%s%+03d%+04d.dds", mBitmapPath.c_str(), y, x);
-				TexRef tref = mTexMgr->LookupTexture(fname, true, tex_Compress_Ok);
+				TexRef tref = mTexMgr->RequestTexture(fname, true, tex_Compress_Ok);
 				if(tref)
 				{
 					int tex_id = mTexMgr->GetTexID(tref);
@@ -28,6 +28,7 @@
 #include "MapAlgs.h"
 #include "MapOverlay.h"
 #include "AptDefs.h"
+#include "AptAlgs.h"
 #include "AssertUtils.h"
 #include "XESConstants.h"
 #include "GISUtils.h"
@@ -70,6 +71,9 @@
 #define AIRPORT_OUTER_FILL_AREA		(400.0 * 400.0 / (DEG_TO_NM_LAT * NM_TO_MTR * DEG_TO_NM_LAT * NM_TO_MTR))
 #define AIRPORT_INNER_FILL_AREA		(40.0 * 40.0 / (DEG_TO_NM_LAT * NM_TO_MTR * DEG_TO_NM_LAT * NM_TO_MTR))
 
+// When cropping, airports this close (in degrees) to the map are still burned - the buffers and fills above reach out past the layout itself.
+#define AIRPORT_CROP_MARGIN		0.1
+
 enum apt_fill_mode {
 	fill_nukeroads,		// Hard splat of roads underneath pavement...only for when user made the boundaries.
 	fill_water2apt,		// Water becomes airport - tightest radius - ensure airport under runways.
@@ -494,7 +498,7 @@ static void mask_with(DEMGeo& dst, const DEMGeo& src)
 		*d = DEM_NO_DATA;
 }
 
-void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMGeo& transport, bool crop, bool dems, bool kill_rivers, ProgressFunc prog)
+void ProcessAirports(const AptVector& all_apts, const AptIndex& index, Pmwx& ioMap, DEMGeo& elevation, DEMGeo& transport, bool crop, bool dems, bool kill_rivers, ProgressFunc prog)
 {
 //	double wet_area = 0;
 //	for(Pmwx::Face_iterator f = ioMap.faces_begin(); f != ioMap.faces_end(); ++f)
@@ -507,8 +511,20 @@ void ProcessAirports(const AptVector& apts, Pmwx& ioMap, DEMGeo& elevation, DEMG
 
 	int x1, x2, x, y1, y2, y;
 	Point_2 p1, p2;
+	// If we crop, anything that is not near the map gets thrown out anyway - only burn what the index finds near the map.
+	AptVector	near_apts;
 	if (crop)
+	{
 		CalcBoundingBox(ioMap, p1, p2);
+		Bbox2		map_bounds(cgal2ben(p1), cgal2ben(p2));
+		set<int>	found;
+		map_bounds.expand(AIRPORT_CROP_MARGIN);
+		FindAirports(map_bounds, index, found);
+		near_apts.reserve(found.size());
+		for (set<int>::iterator a = found.begin(); a != found.end(); ++a)
+			near_apts.push_back(all_apts[*a]);
+	}
+	const AptVector& apts(crop ? near_apts : all_apts);
 
 	set<Face_handle>		simple_faces;
 
@@ -39,6 +39,7 @@ void BurnInAirport(
 
 void ProcessAirports(
 				const AptVector& 	inAirports,
+				const AptIndex&		inAirportIndex,		// Only needed if inCrop is set - used to skip airports far from the map.
 				Pmwx& 				ioMap,
 				DEMGeo& 			ioElevation,
 				DEMGeo& 			ioTransport,
@@ -34,9 +34,6 @@
  * APT FORMAT CONVERSION FROM 810 TO 850
  ************************************************************************************************************************************************************************/
 
-inline int hash_ll(int lon, int lat) {	return (lon+180) + 360 * (lat+90); }
-
-
 static void EndsToCenter(const Segment2& ends, Point2& center, double& len, double& heading)
 {
 	center = ends.midpoint();
@@ -110,36 +107,24 @@ static void CenterToCorners(Point2 location, double heading, double len, double
 
 void	IndexAirports(const AptVector& apts, AptIndex& index)
 {
-	index.clear();
+	vector<AptIndex::item_type>	items;
+	items.reserve(apts.size());
 	for (int a = 0; a < apts.size(); ++ a)
-	{
-		POINT2 ctr(
-			(apts[a].bounds.xmin()+apts[a].bounds.xmax())*0.5,
-			(apts[a].bounds.ymin()+apts[a].bounds.ymax())*0.5);
-
-		int lon = floor(CGAL2DOUBLE(ctr.x()));
-		int lat = floor(CGAL2DOUBLE(ctr.y()));
-		index.insert(AptIndex::value_type(hash_ll(lon, lat), a));
-//		printf("LL hash for %s is %d,%d\n", apts[a].icao.c_str(), lon, lat);
-	}
+	if (!apts[a].bounds.is_null())
+		items.push_back(AptIndex::item_type(apts[a].bounds, a));
+	index.insert(items.begin(), items.end());
 }
 
 void	FindAirports(const Bbox2& bounds, const AptIndex& index, set<int>& apts)
 {
 	apts.clear();
-	int x1 = floor(bounds.xmin() - 0.5);
-	int x2 =  ceil(bounds.xmax() + 0.5);
-	int y1 = floor(bounds.ymin() - 0.5);
-	int y2 =  ceil(bounds.ymax() + 0.5);
-	for (int x = x1; x <= x2; ++x)
-	for (int y = y1; y <= y2; ++y)
-	{
-		pair<AptIndex::const_iterator,AptIndex::const_iterator>	range = index.equal_range(hash_ll(x,y));
-		for (AptIndex::const_iterator i = range.first; i != range.second; ++i)
-		{
-			apts.insert(i->second);
-		}
-	}
+	index.query_value(bounds, inserter(apts, apts.end()));
+}
+
+int		FindNearestAirport(const Point2& where, const AptIndex& index)
+{
+	const AptIndex::item_type * best = index.query_nearest(where);
+	return best ? best->second : -1;
 }
 
 /************************************************************************************************************************************************************************
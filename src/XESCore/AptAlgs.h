@@ -100,9 +100,12 @@ void apt_make_cut_map(Polygon_set_2& in_area, Pmwx& out_map, double cut_x, doubl
 // Get all of the points of interest for a layout...gates, runway ends, etc.
 void GetAptPOI(const AptInfo_t * a, vector<Point2>& poi);
 
-// Indexing
+// Indexing.  FindAirports returns every airport whose bounds overlap the query box; FindNearestAirport
+// returns the airport whose bounds come closest to the point (in degrees, not meters!) or -1 if there are none.
+// Airports without any geometry (null bounds) are not indexed.
 void	IndexAirports(const AptVector& apts, AptIndex& index);
 void	FindAirports(const Bbox2& bounds, const AptIndex& index, set<int>& apts);
+int		FindNearestAirport(const Point2& where, const AptIndex& index);
 
 
 /***************************************************************************************************************************************
@@ -26,6 +26,7 @@
 
 #include <vector>
 #include "CompGeomDefs2.h"
+#include "RTree2.h"
 
 
 enum {
@@ -597,6 +598,7 @@ struct AptInfo_t {
 
 typedef vector<AptInfo_t>	AptVector;
 
-typedef hash_multimap<int,int>	AptIndex;
+// R-tree of airport bounds, valued by index into the AptVector it was built from.  Build it with IndexAirports.
+typedef RTree2<int,8>		AptIndex;
 
 #endif
@@ -32,6 +32,7 @@
 #include "AssertUtils.h"
 #include "CompGeomUtils.h"
 #include "STLUtils.h"
+#include "ParallelUtils.h"
 
 #include "WED_Version.h"
 // for now
@@ -251,46 +252,109 @@ string	ReadAptFile(const char * inFileName, AptVector& outApts)
 	return err;
 }
 
-string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outApts)
-{
-	outApts.clear();
+// The parallel reader hands each worker at least this much of the file - small files are read in one go.
+#define APT_MIN_CHUNK (4 * 1024 * 1024)
 
-	MFTextScanner * s = TextScanner_OpenMem(inBegin, inEnd);
-	string ok;
+struct apt_chunk_t {
+	AptVector	apts;
+	string		err;
+	int			lines;
+	bool		done;
+};
 
-	int ln = 0;
+// True if p starts a line the way TextScanner_Next steps over line ends - after a \n, or after a \r that is
+// not followed by a \n - and that line is an airport, seaport or heliport header.
+static bool	is_apt_header(const char * begin, const char * p, const char * end)
+{
+	if (p <= begin || p >= end) return false;
+	if (p[-1] != '\n' && (p[-1] != '\r' || *p == '\n')) return false;
 
-	// Versioning:
-	// 703 (base)
-	// 715 - addded vis flag to tower
-	// 810 - added vasi slope to towers
-	// 850 - added next-gen stuff
+	int code = 0, digits = 0;
+	while (p < end && *p >= '0' && *p <= '9' && digits < 3)
+	{
+		code = code * 10 + *p++ - '0';
+		++digits;
+	}
+	return p < end && (*p == ' ' || *p == '\t') && (code == apt_airport || code == apt_seaport || code == apt_heliport);
+}
 
-		int vers = 0;
+// Cuts [begin,end) into runs of roughly equal size that each start with an airport header, except the first one.
+static void	find_apt_chunks(const char * begin, const char * end, vector<const char *>& cuts)
+{
+	int		want = max(1, parallel_thread_count() * 4);
+	size_t	step = max((size_t) APT_MIN_CHUNK, (size_t) (end - begin) / want);
 
-	if (TextScanner_IsDone(s))
-		ok = string("File is empty.");
-	if (ok.empty())
+	cuts.push_back(begin);
+	const char * p = begin;
+	while ((size_t) (end - p) > step)
 	{
-		string app_win;
-		if (TextScanner_FormatScan(s, "T", &app_win) != 1) ok = "Invalid header";
-		if (app_win != "a" && app_win != "A" && app_win != "i" && app_win != "I") ok = string("Invalid header:") + app_win;
-		TextScanner_Next(s);
-		++ln;
+		p += step;
+		while (p < end && !is_apt_header(begin, p, end))
+			++p;
+		if (p < end)
+			cuts.push_back(p);
 	}
-	if (ok.empty())
+	cuts.push_back(end);
+}
+
+static void	calc_apt_bounds(AptVector& apts)
+{
+	for (AptVector::iterator a = apts.begin(); a != apts.end(); ++a)
 	{
-		if (TextScanner_FormatScan(s, "i", &vers) != 1) ok = "Invalid version";
-		if (vers != 703 && vers != 715 && vers != 810 && vers != 850 && vers != 1000 && vers != 1050 && vers != 1100 && vers != 1130)
+		a->bounds = Bbox2();
+		if (a->tower.draw_obj != -1)
+			a->bounds = Bbox2(a->tower.location);
+		if(a->beacon.color_code != apt_beacon_none)
+			a->bounds += a->beacon.location;
+		for (int w = 0; w < a->windsocks.size(); ++w)
+			a->bounds += a->windsocks[w].location;
+		for (int r = 0; r < a->gates.size(); ++r)
+			a->bounds += a->gates[r].location;
+		for (AptPavementVector::iterator p = a->pavements.begin(); p != a->pavements.end(); ++p)
 		{
-		  if (vers > 1130)
-			ok = "Format is newer than supported by this version of WED";
-		  else
-			ok = "Illegal version";
+			a->bounds +=  p->ends.source();
+			a->bounds +=  p->ends.target();
 		}
-		TextScanner_Next(s);
-		++ln;
+		for (AptRunwayVector::iterator r = a->runways.begin(); r != a->runways.end(); ++r)
+		{
+			a->bounds +=  r->ends.source();
+			a->bounds +=  r->ends.target();
+		}
+		for(AptSealaneVector::iterator s = a->sealanes.begin(); s != a->sealanes.end(); ++s)
+		{
+			a->bounds +=  s->ends.source();
+			a->bounds +=  s->ends.target();
+		}
+		for(AptHelipadVector::iterator h = a->helipads.begin(); h != a->helipads.end(); ++h)
+			a->bounds +=  h->location;
+
+		for(AptTaxiwayVector::iterator t = a->taxiways.begin(); t != a->taxiways.end(); ++t)
+		for(AptPolygon_t::iterator pt = t->area.begin(); pt != t->area.end(); ++pt)
+		{
+			a->bounds +=  pt->pt;
+			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
+				a->bounds +=  pt->ctrl;
+		}
+
+		for(AptBoundaryVector::iterator b = a->boundaries.begin(); b != a->boundaries.end(); ++b)
+		for(AptPolygon_t::iterator pt = b->area.begin(); pt != b->area.end(); ++pt)
+		{
+			a->bounds +=  pt->pt;
+			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
+				a->bounds +=  pt->ctrl;
+		}
+
+		//a->bounds.expand(0.001);
 	}
+}
+
+// Parses the records of an apt.dat (everything past the version line), airport by airport.  ln counts the lines
+// done, forceDone tells whether we hit the 99 that ends the file.
+static string	parse_apt_records(const char * inBegin, const char * inEnd, int vers, AptVector& outApts, int& ln, bool& forceDone)
+{
+	MFTextScanner * s = TextScanner_OpenMem(inBegin, inEnd);
+	string ok;
+	ln = 0;
 
 	set<string>		centers;
 	string codez;
@@ -301,7 +365,7 @@ string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outAp
 	
 	AptEdgeBase_t *	last_edge = NULL;
 	
-	bool forceDone = false;
+	forceDone = false;
 	while (ok.empty() && !TextScanner_IsDone(s) && !forceDone)
 	{
 		int		rec_code;
@@ -1101,64 +1165,106 @@ string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outAp
 	}
 	TextScanner_Close(s);
 
-	if (!ok.empty())
+	calc_apt_bounds(outApts);
+	return ok;
+}
+
+string	ReadAptFileMem(const char * inBegin, const char * inEnd, AptVector& outApts)
+{
+	outApts.clear();
+
+	MFTextScanner * s = TextScanner_OpenMem(inBegin, inEnd);
+	string ok;
+
+	int ln = 0;
+
+	// Versioning:
+	// 703 (base)
+	// 715 - addded vis flag to tower
+	// 810 - added vasi slope to towers
+	// 850 - added next-gen stuff
+
+		int vers = 0;
+
+	if (TextScanner_IsDone(s))
+		ok = string("File is empty.");
+	if (ok.empty())
 	{
-		char buf[50];
-		sprintf(buf," (Line %d)",ln);
-		ok += buf;
+		string app_win;
+		if (TextScanner_FormatScan(s, "T", &app_win) != 1) ok = "Invalid header";
+		if (app_win != "a" && app_win != "A" && app_win != "i" && app_win != "I") ok = string("Invalid header:") + app_win;
+		TextScanner_Next(s);
+		++ln;
 	}
-
-	for (AptVector::iterator a = outApts.begin(); a != outApts.end(); ++a)
+	if (ok.empty())
 	{
-		a->bounds = Bbox2();
-		if (a->tower.draw_obj != -1)
-			a->bounds = Bbox2(a->tower.location);
-		if(a->beacon.color_code != apt_beacon_none)
-			a->bounds += a->beacon.location;
-		for (int w = 0; w < a->windsocks.size(); ++w)
-			a->bounds += a->windsocks[w].location;
-		for (int r = 0; r < a->gates.size(); ++r)
-			a->bounds += a->gates[r].location;
-		for (AptPavementVector::iterator p = a->pavements.begin(); p != a->pavements.end(); ++p)
-		{
-			a->bounds +=  p->ends.source();
-			a->bounds +=  p->ends.target();
-		}
-		for (AptRunwayVector::iterator r = a->runways.begin(); r != a->runways.end(); ++r)
-		{
-			a->bounds +=  r->ends.source();
-			a->bounds +=  r->ends.target();
-		}
-		for(AptSealaneVector::iterator s = a->sealanes.begin(); s != a->sealanes.end(); ++s)
+		if (TextScanner_FormatScan(s, "i", &vers) != 1) ok = "Invalid version";
+		if (vers != 703 && vers != 715 && vers != 810 && vers != 850 && vers != 1000 && vers != 1050 && vers != 1100 && vers != 1130)
 		{
-			a->bounds +=  s->ends.source();
-			a->bounds +=  s->ends.target();
+		  if (vers > 1130)
+			ok = "Format is newer than supported by this version of WED";
+		  else
+			ok = "Illegal version";
 		}
-		for(AptHelipadVector::iterator h = a->helipads.begin(); h != a->helipads.end(); ++h)
-			a->bounds +=  h->location;
+		TextScanner_Next(s);
+		++ln;
+	}
 
-		for(AptTaxiwayVector::iterator t = a->taxiways.begin(); t != a->taxiways.end(); ++t)
-		for(AptPolygon_t::iterator pt = t->area.begin(); pt != t->area.end(); ++pt)
-		{
-			a->bounds +=  pt->pt;
-			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
-				a->bounds +=  pt->ctrl;
-		}
+	// Airports do not share any parser state, so the records are cut into chunks at airport headers and the chunks
+	// are parsed at once.  Stitched back together in order, this is exactly what parsing the file in one go gives -
+	// including where the first error is reported and that anything past the first 99 is ignored.
+	const char * body = TextScanner_GetBegin(s);
+	TextScanner_Close(s);
 
-		for(AptBoundaryVector::iterator b = a->boundaries.begin(); b != a->boundaries.end(); ++b)
-		for(AptPolygon_t::iterator pt = b->area.begin(); pt != b->area.end(); ++pt)
+	if (ok.empty())
+	{
+		vector<const char *>	cuts;
+		find_apt_chunks(body, inEnd, cuts);
+
+		// Chunks are handed out in order, so once one errs or hits the 99, the ones after it are not needed.
+		vector<apt_chunk_t>		chunks(cuts.size() - 1);
+		std::atomic<int>		last_needed(chunks.size());
+		parallel_for(0, (int) chunks.size(), [&](int n) {
+			apt_chunk_t& c = chunks[n];
+			c.lines = 0;
+			c.done = false;
+			if (n > last_needed) return;
+			c.err = parse_apt_records(cuts[n], cuts[n+1], vers, c.apts, c.lines, c.done);
+			if (!c.err.empty() || c.done)
+			{
+				int was = last_needed;
+				while (n < was && !last_needed.compare_exchange_weak(was, n)) { }
+			}
+		});
+
+		size_t total = 0;
+		for (vector<apt_chunk_t>::iterator c = chunks.begin(); c != chunks.end(); ++c)
+			total += c->apts.size();
+		outApts.reserve(total);
+
+		for (vector<apt_chunk_t>::iterator c = chunks.begin(); c != chunks.end(); ++c)
 		{
-			a->bounds +=  pt->pt;
-			if(pt->code == apt_lin_crv || pt->code == apt_rng_crv || pt-> code == apt_end_crv)
-				a->bounds +=  pt->ctrl;
+			for (AptVector::iterator a = c->apts.begin(); a != c->apts.end(); ++a)
+				outApts.push_back(std::move(*a));
+			AptVector().swap(c->apts);
+			ln += c->lines;
+			ok = c->err;
+			if (!ok.empty() || c->done)
+				break;
 		}
+	}
 
-		//a->bounds.expand(0.001);
-
-		#if OPENGL_MAP
-			GenerateOGL(&*a);
-		#endif
+	if (!ok.empty())
+	{
+		char buf[50];
+		sprintf(buf," (Line %d)",ln);
+		ok += buf;
 	}
+
+	#if OPENGL_MAP
+	for (AptVector::iterator a = outApts.begin(); a != outApts.end(); ++a)
+		GenerateOGL(&*a);
+	#endif
 	return ok;
 }
 
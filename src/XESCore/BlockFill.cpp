@@ -78,6 +78,54 @@ int num_line_integ = 0;
 
 #include <stdarg.h>
 
+/************************************************************************************************************************
+ * RANDOM NUMBERS
+ ************************************************************************************************************************/
+
+// A 64-bit LCG, reseeded for every block by seed_block_rand.
+static unsigned long long	sBlockRand = 1;
+
+int		block_rand(void)
+{
+	sBlockRand = sBlockRand * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (int) (sBlockRand >> 33);
+}
+
+double	block_rand_range(double mmin, double mmax)
+{
+	if (mmin >= mmax)
+		return mmin;
+	double	v = (double) block_rand() / (double) BLOCK_RAND_MAX;
+	return mmin + ((mmax - mmin) * v);
+}
+
+static inline unsigned long long	splitmix64(unsigned long long z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// The seed comes from every vertex of the block's outer boundary.  The vertex hashes are summed, so neither
+// the order blocks are filled in nor where the boundary's circulator starts matters - and blocks that merely
+// share a vertex, like the wedges around a junction, still get unrelated sequences.
+static void	seed_block_rand(Pmwx::Face_handle f)
+{
+	Pmwx::Ccb_halfedge_circulator circ, stop;
+	circ = stop = f->outer_ccb();
+	unsigned long long	sum = 0, count = 0;
+	do {
+		Point2 p = cgal2ben(circ->source()->point());
+		double	xy[2] = { p.x(), p.y() };
+		unsigned long long	bits[2];
+		memcpy(bits, xy, sizeof(bits));
+		sum += splitmix64(bits[0] ^ splitmix64(bits[1]));
+		++count;
+	} while(++circ != stop);
+
+	sBlockRand = splitmix64(sum ^ (count * 0x9E3779B97F4A7C15ULL));
+}
+
 typedef UTL_interval<double>	time_region;
 
 #include "GISTool_Globals.h"
@@ -944,7 +992,7 @@ static void make_one_subdiv_spelling(const FillRule_t * info, double width, vect
 	double t = 0.0;
 	for(int i = 0; i < approx_wanted; ++i)
 	{
-		div_rats.push_back(info->fac_max_width + info->fac_step * (rand() % range));
+		div_rats.push_back(info->fac_max_width + info->fac_step * (block_rand() % range));
 		t += div_rats.back();
 	}
 	DebugAssert(t > 0.0);
@@ -972,7 +1020,7 @@ static void make_fac_subdiv_spelling(const FillRule_t * info, double width, vect
 		return;
 	}
 
-	int our_pick = rand() % num_choices;
+	int our_pick = block_rand() % num_choices;
 	
 	advance(rs,our_pick);
 	for(int n = 0; n < rs->second.size(); ++n)
@@ -1857,12 +1905,12 @@ static int	init_subdivisions(
 					{
 						// If the facades have flexibility within height range use it; otherwise just clamp to min.
 						if(max_height >= fac_rule->facs[fn].height_min)
-							bf.height = RandRange(fac_rule->facs[fn].height_min,fltmin2(fac_rule->facs[fn].height_max,max_height));
+							bf.height = block_rand_range(fac_rule->facs[fn].height_min,fltmin2(fac_rule->facs[fn].height_max,max_height));
 						else
 							bf.height = fac_rule->facs[fn].height_min;
 					}
 					else
-						bf.height = RandRange(fac_rule->facs[fn].height_min,fac_rule->facs[fn].height_max);
+						bf.height = block_rand_range(fac_rule->facs[fn].height_min,fac_rule->facs[fn].height_max);
 					bf.simplify_id = ctr++;
 					
 					double a_start = double_interp(0,r->a_time,fac_rule->width_real,n->a_time,accum);
@@ -2057,9 +2105,9 @@ static int	init_subdivisions(
 			{
 				a_cuts.push_back(pair<double,bool>(
 					double_interp(
-							0,fac.first,fac_rule->width_real,fac.second,accum + RandRange(-2,2)),false));
-				a_features.push_back(pair<int,float>(fac_rule->facs[n].fac_id_front,RandRange(fac_rule->facs[n].height_min,fac_rule->facs[n].height_max)));
-				b_features.push_back(pair<int,float>(fac_rule->facs[n].fac_id_back,RandRange(fac_rule->facs[n].height_min,fac_rule->facs[n].height_max)));
+							0,fac.first,fac_rule->width_real,fac.second,accum + block_rand_range(-2,2)),false));
+				a_features.push_back(pair<int,float>(fac_rule->facs[n].fac_id_front,block_rand_range(fac_rule->facs[n].height_min,fac_rule->facs[n].height_max)));
+				b_features.push_back(pair<int,float>(fac_rule->facs[n].fac_id_back,block_rand_range(fac_rule->facs[n].height_min,fac_rule->facs[n].height_max)));
 				a_features.back().second = min(a_features.back().second,max(f->data().GetParam(af_HeightObjs,0.0),16.0f));
 				b_features.back().second = min(b_features.back().second,max(f->data().GetParam(af_HeightObjs,0.0),16.0f));
 
@@ -4215,6 +4263,7 @@ void	extract_features(
 bool process_block(Pmwx::Face_handle f, CDT& mesh, const DEMGeo& ag_ok_approx_dem, const DEMGeo& forest_dem,ForestIndex&	forest_index)
 {
 	++num_block_processed;
+	seed_block_rand(f);
 	bool ret = false;
 	int z = f->data().GetZoning();
 	if(z == NO_VALUE || z == terrain_Natural)
@@ -4251,3 +4300,16 @@ bool process_block(Pmwx::Face_handle f, CDT& mesh, const DEMGeo& ag_ok_approx_de
 //	printf("Face had %d vertices.\n", total);
 	return ret;
 }
+
+int process_blocks(const vector<Pmwx::Face_handle>& faces, CDT& mesh, const DEMGeo& ag_ok_approx_dem, const DEMGeo& forest_dem, ForestIndex& forest_index, ProgressFunc prog)
+{
+	int filled = 0;
+	int step = max(1, (int) faces.size() / 100);
+	for(int n = 0; n < faces.size(); ++n)
+	{
+		PROGRESS_CHECK(prog, 0, 1, "Creating 3-d.", n, faces.size(), step);
+		if(process_block(faces[n], mesh, ag_ok_approx_dem, forest_dem, forest_index))
+			++filled;
+	}
+	return filled;
+}
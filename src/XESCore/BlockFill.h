@@ -28,6 +28,7 @@
 #include "MeshDefs.h"
 #include "RTree2.h"
 #include "MapDefs.h"
+#include "ProgressUtils.h"
 
 struct CoordTranslator2;
 
@@ -62,6 +63,22 @@ bool	process_block(
 					const DEMGeo&			forest_dem,
 					ForestIndex&			forest_index);
 
+// Runs process_block on every face, in order.  Each block seeds its own random numbers, so a block comes
+// out the same no matter which blocks were filled before it.  Returns the number of blocks that got filled.
+int		process_blocks(
+					const vector<Pmwx::Face_handle>& faces,
+					CDT&					mesh,
+					const DEMGeo&			ag_ok_approx_dem,
+					const DEMGeo&			forest_dem,
+					ForestIndex&			forest_index,
+					ProgressFunc			prog);
+
+// Random numbers for block fill - rand() and RandRange, but from a generator that process_block
+// reseeds from the block it is filling.
+#define BLOCK_RAND_MAX 0x7FFFFFFF
+int		block_rand(void);
+double	block_rand_range(double mmin, double mmax);
+
 
 
 
@@ -42,6 +42,7 @@
 #include "MapAlgs.h"
 #include "MapTopology.h"
 #include "Zoning.h"
+#include "DEMFlow.h"
 
 // Minimum bathymetric depth from water surface at any point!
 #define	MIN_DEPTH 10.0f
@@ -724,23 +725,12 @@ static void	BuildRoadDensityDEM(const Pmwx& inMap, DEMGeo& ioTransport)
 
 	PolyRasterizer<double>	rasterizer;
 	SetupWaterRasterizer(inMap, ioTransport, rasterizer, terrain_Water);
-	int x, y = 0;
-	rasterizer.StartScanline(y);
-	while (!rasterizer.DoneScan())
-	{
-		int x1, x2;
-		while (rasterizer.GetRange(x1, x2))
-		{
-			for (x = x1; x < x2; ++x)
-			{
-				if (ioTransport.get(x, y) != DEM_NO_DATA)
-					ioTransport(x,y) = max(ioTransport(x,y), 1.0f);
-			}
-		}
-		++y;
-		if (y >= ioTransport.mHeight) break;
-		rasterizer.AdvanceScanline(y);
-	}
+	PolyRasterFill(rasterizer, ioTransport.mWidth, ioTransport.mHeight, [&](int y, int x1, int x2) {
+		float * row = ioTransport.mData + (size_t) y * ioTransport.mWidth;
+		for (int x = x1; x < x2; ++x)
+		if (row[x] != DEM_NO_DATA)
+			row[x] = max(row[x], 1.0f);
+	});
 
 	for (Pmwx::Halfedge_const_iterator iter = inMap.halfedges_begin();
 		iter != inMap.halfedges_end(); ++iter)
@@ -1060,6 +1050,68 @@ void	UpsampleEnvironmentalParams(DEMGeoMap& ioDEMs, ProgressFunc inProg)
 }
 
 
+static void	DeriveUrbanSquare(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	DEMGeo& urbanSquare = ioDEMs[dem_UrbanSquare];
+	urbanSquare = static_cast<const DEMGeoMap&>(ioDEMs)[dem_LandUse];
+	int x, y;
+
+	for (y = 0; y < urbanSquare.mHeight; ++y)
+	for (x = 0; x < urbanSquare.mWidth; ++x)
+	{
+		float e = urbanSquare.get(x,y);
+		
+	 if(e == lu_globcover_URBAN_HIGH)						e = 2.0;
+else if(e == lu_globcover_URBAN_TOWN)						e = 2.0;
+else if(e == lu_globcover_URBAN_LOW)						e = 2.0;
+else if(e == lu_globcover_URBAN_MEDIUM)						e = 2.0;
+
+else if(e == lu_globcover_URBAN_SQUARE_TOWN)				e = 1.0;
+else if(e == lu_globcover_URBAN_SQUARE_LOW)					e = 1.0;
+else if(e == lu_globcover_URBAN_SQUARE_MEDIUM)				e = 1.0;
+else if(e == lu_globcover_URBAN_SQUARE_HIGH)				e = 1.0;
+
+else if(e == lu_globcover_URBAN_CROP_TOWN)					e = 2.0;
+else if(e == lu_globcover_URBAN_SQUARE_CROP_TOWN)			e = 1.0;
+else if(e == lu_globcover_INDUSTRY_SQUARE)					e = 1.0;
+else if(e == lu_globcover_INDUSTRY)							e = 2.0;
+else														e = DEM_NO_DATA;		
+		urbanSquare(x,y)=e;
+	}
+
+	SpreadDEMValues(urbanSquare);
+	if(urbanSquare.get(0,0) == DEM_NO_DATA)
+		urbanSquare = 1.0;
+}
+
+static void	DeriveForestType(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	const DEMGeoMap&	dems(ioDEMs);
+	const DEMGeo&		landuse = 	dems[dem_LandUse];
+	const DEMGeo&		temp = 		dems[dem_Temperature];
+	const DEMGeo&		rainfall = 	dems[dem_Rainfall];
+	DEMGeo&				forests = 	ioDEMs[dem_ForestType];
+	forests = landuse;
+	int x, y;
+
+	for (y = 0; y < landuse.mHeight;++y)
+	for (x = 0; x < landuse.mWidth; ++x)
+	{
+		int l = landuse.get(x,y);
+		float t = temp.get(temp.map_x_from(landuse,x),
+						 temp.map_y_from(landuse,y));
+		float r = rainfall.get(rainfall.map_x_from(landuse,x),
+						 rainfall.map_y_from(landuse,y));
+
+		int f = FindForest(l,t,r);
+		
+		if(f == NO_VALUE) f = DEM_NO_DATA;
+		forests(x,y) = f;				
+	}
+
+	forests.fill_nearest();
+}
+
 /*
  * DeriveDEMs
  *
@@ -1109,7 +1161,6 @@ void	DeriveDEMs(
 //	const DEMGeo&		slope = 	ioDEMs[dem_Slope];
 //	const DEMGeo&		slopeHeading = ioDEMs[dem_SlopeHeading];
 	const DEMGeo&		rainfall = 	ioDEMs[dem_Rainfall];
-		  DEMGeo&		urbanSquare =ioDEMs[dem_UrbanSquare];
 
 	int reduce_1 = elevation.mWidth / 200;
 	DEMGeo elevation_reduced;
@@ -1124,8 +1175,6 @@ void	DeriveDEMs(
 	DEMGeo	urban;
 	DEMGeo	urbanRadial;
 	DEMGeo	urbanTrans;
-	urbanSquare = landuse;
-	DEMGeo		forests(landuse);
 
 	urban.copy_geo_from(landuse);
 	urbanRadial.copy_geo_from(landuse);
@@ -1228,32 +1277,6 @@ void	DeriveDEMs(
 	for (x = 0; x < urbanTrans.mWidth; ++x)
 		urbanTrans(x,y) = max(0.0f, min(urbanTrans(x,y), 1.0f));
 
-	for (y = 0; y < urbanSquare.mHeight; ++y)
-	for (x = 0; x < urbanSquare.mWidth; ++x)
-	{
-		float e = urbanSquare.get(x,y);
-		
-	 if(e == lu_globcover_URBAN_HIGH)						e = 2.0;
-else if(e == lu_globcover_URBAN_TOWN)						e = 2.0;
-else if(e == lu_globcover_URBAN_LOW)						e = 2.0;
-else if(e == lu_globcover_URBAN_MEDIUM)						e = 2.0;
-
-else if(e == lu_globcover_URBAN_SQUARE_TOWN)				e = 1.0;
-else if(e == lu_globcover_URBAN_SQUARE_LOW)					e = 1.0;
-else if(e == lu_globcover_URBAN_SQUARE_MEDIUM)				e = 1.0;
-else if(e == lu_globcover_URBAN_SQUARE_HIGH)				e = 1.0;
-
-else if(e == lu_globcover_URBAN_CROP_TOWN)					e = 2.0;
-else if(e == lu_globcover_URBAN_SQUARE_CROP_TOWN)			e = 1.0;
-else if(e == lu_globcover_INDUSTRY_SQUARE)					e = 1.0;
-else if(e == lu_globcover_INDUSTRY)							e = 2.0;
-else														e = DEM_NO_DATA;		
-		urbanSquare(x,y)=e;
-	}
-
-	SpreadDEMValues(urbanSquare);
-	if(urbanSquare.get(0,0) == DEM_NO_DATA)
-		urbanSquare = 1.0;
 
 	/********************************************************************************************************
 	 * CALCULATE VEGETATION DENSITY
@@ -1551,22 +1574,6 @@ else														e = DEM_NO_DATA;
 
 	if (inProg) inProg(0, 1, "Calculating Derived Raster Data", 1.0);
 
-	for (y = 0; y < landuse.mHeight;++y)
-	for (x = 0; x < landuse.mWidth; ++x)
-	{
-		int l = landuse.get(x,y);
-		float t = temp.get(temp.map_x_from(landuse,x),
-						 temp.map_y_from(landuse,y));
-		float r = rainfall.get(rainfall.map_x_from(landuse,x),
-						 rainfall.map_y_from(landuse,y));
-
-		int f = FindForest(l,t,r);
-		
-		if(f == NO_VALUE) f = DEM_NO_DATA;
-		forests(x,y) = f;				
-	}
-
-	forests.fill_nearest();
 
 
 	ioDEMs[dem_UrbanDensity	   ].swap(urban);
@@ -1581,7 +1588,11 @@ else														e = DEM_NO_DATA;
 //	ioDEMs[dem_VegetationDensity].swap(vegetation);
 	ioDEMs[dem_UrbanRadial].swap(urbanRadial);
 	ioDEMs[dem_UrbanTransport].swap(urbanTrans);
-	ioDEMs[dem_ForestType].swap(forests);
+
+	// Urban squareness and forest types are full land use resolution but only read when the mesh gets its
+	// terrain - so they are made on first use.
+	ioDEMs.declare({ dem_UrbanSquare }, { dem_LandUse }, DeriveUrbanSquare);
+	ioDEMs.declare({ dem_ForestType }, { dem_LandUse, dem_Temperature, dem_Rainfall }, DeriveForestType);
 	
 	/************************************************************************************************************************
 	 * WATER AND BATHYMETRY CALC
@@ -1672,16 +1683,79 @@ else														e = DEM_NO_DATA;
 
 }
 
+// The slope layers are declared rather than computed - most of them are only read by a few passes, and
+// some runs never read them at all.  Both read elevation through a const map so that nothing else pending is
+// forced along with them.
+static void	DeriveSlope(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	const DEMGeo& elev = static_cast<const DEMGeoMap&>(ioDEMs)[dem_Elevation];
+	DEMGeo&	slope = ioDEMs[dem_Slope];
+	DEMGeo&	slopeHeading = ioDEMs[dem_SlopeHeading];
+
+	DEMGeo	elev_not_insane(elev);
+	while(elev_not_insane.mWidth > 1201 || elev_not_insane.mHeight > 1201)
+		elev_not_insane.derez(2);
+
+	slope.resize(elev_not_insane.mWidth, elev_not_insane.mHeight);
+	slopeHeading.resize(elev_not_insane.mWidth, elev_not_insane.mHeight);
+	slope.mNorth = slopeHeading.mNorth = elev.mNorth;
+	slope.mSouth = slopeHeading.mSouth = elev.mSouth;
+	slope.mEast = slopeHeading.mEast = elev.mEast;
+	slope.mWest = slopeHeading.mWest = elev.mWest;
+
+	elev_not_insane.calc_slope(slope, slopeHeading, inProg);
+}
+
+static void	DeriveRelativeElevation(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	const DEMGeo& elev = static_cast<const DEMGeoMap&>(ioDEMs)[dem_Elevation];
+	DEMGeo&	relativeElev = ioDEMs[dem_RelativeElevation];
+	DEMGeo& elevationRange = ioDEMs[dem_ElevationRange];
+
+	int y, x;
+	float e0, e1;
+
+	DEMGeo	elev2(elev);
+	while(elev2.mWidth > 1200 && elev2.mHeight > 1200)
+	{
+		elev2.derez(2);
+	}
+
+	relativeElev.resize(elev2.mWidth, elev2.mHeight);
+	elevationRange.resize(elev2.mWidth, elev2.mHeight);
+	elevationRange.mNorth = relativeElev.mNorth = elev.mNorth;
+	elevationRange.mSouth = relativeElev.mSouth = elev.mSouth;
+	elevationRange.mEast = relativeElev.mEast = elev.mEast;
+	elevationRange.mWest = relativeElev.mWest = elev.mWest;
+
+	PROGRESS_START(inProg, 1, 2, "Calculating local min/max")
+	DEMGeo	mins, maxs;
+	DEMGeo_ReduceMinMaxN(elev2, mins, maxs, 8);
+
+	for (y = 0; y < elev2.mHeight; ++y)
+	{
+		PROGRESS_CHECK(inProg, 1, 2, "Calculating local min/max", y, elev2.mHeight, 100)
+		for (x = 0; x < elev2.mWidth ; ++x)
+		{
+			e0 = mins.value_linear(elev2.x_to_lon(x), elev2.y_to_lat(y));
+			e1 = maxs.value_linear(elev2.x_to_lon(x), elev2.y_to_lat(y));
+			elevationRange(x,y) = e1 - e0;
+
+			if (e0 == e1)
+				relativeElev(x,y) = 0.0;
+			else
+				relativeElev(x,y) = min(1.0f, max(0.0f, (elev2(x,y) - e0) / (e1 - e0)));
+		}
+	}
+	PROGRESS_DONE(inProg, 1, 2, "Calculating local min/max")
+}
+
 void	CalcSlopeParams(DEMGeoMap& ioDEMs, bool force, ProgressFunc inProg)
 {
 	if (!force && ioDEMs.count(dem_Slope) > 0 && ioDEMs.count(dem_SlopeHeading) > 0) return;
 	if (ioDEMs.count(dem_Elevation) == 0) return;
 
 	DEMGeo& elev = ioDEMs[dem_Elevation];
-	DEMGeo&	slope = ioDEMs[dem_Slope];
-	DEMGeo&	slopeHeading = ioDEMs[dem_SlopeHeading];
-	DEMGeo&	relativeElev = ioDEMs[dem_RelativeElevation];
-	DEMGeo& elevationRange = ioDEMs[dem_ElevationRange];
 
 	int y, x, x0, x1;
 	float e0, e1;
@@ -1725,46 +1799,8 @@ void	CalcSlopeParams(DEMGeoMap& ioDEMs, bool force, ProgressFunc inProg)
 		}
 	}
 
-	DEMGeo	elev_not_insane(elev);
-	while(elev_not_insane.mWidth > 1201 || elev_not_insane.mHeight > 1201)
-		elev_not_insane.derez(2);
-
-	DEMGeo	elev2(elev);
-	while(elev2.mWidth > 1200 && elev2.mHeight > 1200)
-	{
-		elev2.derez(2);
-	}
-
-	slope.resize(elev_not_insane.mWidth, elev_not_insane.mHeight);
-	slopeHeading.resize(elev_not_insane.mWidth, elev_not_insane.mHeight);
-	relativeElev.resize(elev2.mWidth, elev2.mHeight);
-	elevationRange.resize(elev2.mWidth, elev2.mHeight);
-	elevationRange.mNorth = relativeElev.mNorth = slope.mNorth = slopeHeading.mNorth = elev.mNorth;
-	elevationRange.mSouth = relativeElev.mSouth = slope.mSouth = slopeHeading.mSouth = elev.mSouth;
-	elevationRange.mEast = relativeElev.mEast = slope.mEast = slopeHeading.mEast = elev.mEast;
-	elevationRange.mWest = relativeElev.mWest = slope.mWest = slopeHeading.mWest = elev.mWest;
-
-	elev_not_insane.calc_slope(slope, slopeHeading, inProg);
-
-	{
-		DEMGeo	mins, maxs;
-		DEMGeo_ReduceMinMaxN(elev2, mins, maxs, 8);
-
-		for (y = 0; y < elev2.mHeight; ++y)
-		for (x = 0; x < elev2.mWidth ; ++x)
-		{
-			e0 = mins.value_linear(elev2.x_to_lon(x), elev2.y_to_lat(y));
-			e1 = maxs.value_linear(elev2.x_to_lon(x), elev2.y_to_lat(y));
-			elevationRange(x,y) = e1 - e0;
-
-			if (e0 == e1)
-				relativeElev(x,y) = 0.0;
-			else
-				relativeElev(x,y) = min(1.0f, max(0.0f, (elev2(x,y) - e0) / (e1 - e0)));
-		}
-		if (inProg) inProg(1, 2, "Calculating local min/max", 1.0);
-
-	}
+	ioDEMs.declare({ dem_Slope, dem_SlopeHeading }, { dem_Elevation }, DeriveSlope, inProg);
+	ioDEMs.declare({ dem_RelativeElevation, dem_ElevationRange }, { dem_Elevation }, DeriveRelativeElevation, inProg);
 
 #if 0
 	{
@@ -2085,173 +2121,68 @@ float	IntegLine(const DEMGeo& dem, double x1, double y1, double x2, double y2, i
 
 #pragma mark -
 
-struct sort_pixel_by_height {
-	sort_pixel_by_height(const DEMGeo& d) : d_(d) { }
-	const DEMGeo& d_;
-	bool operator()(const DEMGeo::address lhs, const DEMGeo::address rhs) const {
-		return d_[lhs] < d_[rhs]; 
-	}
-};
-
-// This code is directly based on "Watersheds in Digital Spaces: An Efficient Algorithm Based on Immersion Simulations"
-// by Luc Vincent and Pierre Soille from their 1991 paper.
+// Every regional minimum - a 4-connected plateau with no lower neighbor - starts a watershed, then one priority flood
+// grows them all at once; each pixel joins the watershed it was flooded from.  This is the flooding form of the immersion
+// watershed of Vincent and Soille ("Watersheds in Digital Spaces", 1991); there are no watershed lines - every pixel ends
+// up in some watershed, as the old code did by spilling its watershed lines into their neighbors.
 void	Watershed(DEMGeo& input, DEMGeo& output,vector<DEMGeo::address> * out_watersheds)
 {
-	#define MASK -2.0f
-	#define WSHED DEM_NO_DATA
-	#define INIT -1.0f
-	#define FICT -1
-	
-	output.clear_from(input, INIT);
-
-	float	current_label = -1.0f;
-	float	current_dist;
-
-	DEMGeo	dist;
-	dist.clear_from(input,0.0f);
-	
-	address_fifo	fifo(input.mWidth * input.mHeight + 2);
-	
-	vector<DEMGeo::address>	all_pixels;
-	all_pixels.reserve(input.mWidth * input.mHeight);
-	for(DEMGeo::address i = input.address_begin(); i != input.address_end(); ++i)
-		all_pixels.push_back(i);
-		
-	sort(all_pixels.begin(), all_pixels.end(), sort_pixel_by_height(input));	
-
-	DEMGeo::neighbor_iterator<4> n;
-	vector<DEMGeo::address>::iterator hi = all_pixels.begin(), p;
-	while(hi != all_pixels.end())
-	{
-		//printf("Processing altitude %f\n", input[*hi]);
-		// Part 1
-		p = hi;
-		do {
-			output[*p] = MASK;
-			for(n = output.neighbor_begin<4>(*p); n != output.neighbor_end<4>(*p); ++n)
-			{
-				if(output[*n] == WSHED || output[*n] >= 0)
-				{
-					dist[*p] = 1.0f;
-					fifo.push(*p);
-				}
-			}
-		
-			++p;
-		} while(p != all_pixels.end() && input[*p] == input[*hi]);
-		
-		// Part 2
-		fifo.push(FICT);
-		current_dist = 1.0f;
-		while(1)
-		{			
-			//printf("Spreading batch of %d pixels.\n", fifo.size());
+	int w = input.mWidth;
+	int h = input.mHeight;
+	int count = w * h;
+
+	vector<int>				label(count, -1);
+	vector<char>			visited(count, 0);
+	vector<DEMGeo::address>	seeds, plateau;
+	address_fifo			fifo(count);
+	int						sheds = 0;
+
+	for(DEMGeo::address a = input.address_begin(); a != input.address_end(); ++a)
+	if(!visited[a])
+	{
+		float v = input[a];
+		bool has_lower = false;
+		plateau.clear();
+		visited[a] = 1;
+		fifo.push(a);
+		while(!fifo.empty())
+		{
 			DEMGeo::address p = fifo.pop();
-			if(p == FICT)
+			plateau.push_back(p);
+			for(DEMGeo::neighbor_iterator<4> n = input.neighbor_begin<4>(p); n != input.neighbor_end<4>(p); ++n)
 			{
-				if (fifo.empty())
-					break;
-				else
-				{
-					fifo.push(FICT);
-					++current_dist;					
-					p = fifo.pop();
-					DebugAssert(p != FICT);
-				}
-			}
-			
-			for(n = input.neighbor_begin<4>(p); n != input.neighbor_end<4>(p); ++n)
-			{
-				if(dist[*n] < current_dist && (output[*n] == WSHED || output[*n] >= 0))
-				{
-					if(output[*n] >= 0)
-					{
-						if(output[p] == MASK || output[p] == WSHED)
-							output[p] = output[*n];
-						else if(output[p] != output[*n])
-							output[p] = WSHED;
-					}
-					else if (output[p] == MASK)
-						output[p] = WSHED;
-				}
-				else if (output[*n] == MASK && dist[*n] == 0.0f)
+				if(input[*n] < v)
+					has_lower = true;
+				else if(input[*n] == v && !visited[*n])
 				{
-					dist[*n] = current_dist + 1.0f;
+					visited[*n] = 1;
 					fifo.push(*n);
 				}
 			}
 		}
-		
-		
-		// Part 3
-		p = hi;
-		do {
-			dist[*p] = 0.0f;
-			
-			if(output[*p] == MASK)
-			{
-				current_label++;
-				//printf("Adding watershed: %f.\n", current_label);
-				output[*p] = current_label;
-				if(out_watersheds)
-				{
-					out_watersheds->push_back(*p);
-					DebugAssert(out_watersheds->size() == current_label+1);
-					DebugAssert((*out_watersheds)[current_label] == *p);
-					DebugAssert(output[*p] == current_label);
-				}
-				fifo.push(*p);
-				while(!fifo.empty())
-				{
-					DEMGeo::address pp = fifo.pop();
-					for(n = input.neighbor_begin<4>(pp); n != input.neighbor_end<4>(pp); ++n)
-					if(output[*n] == MASK)
-					{
-						fifo.push(*n);
-						output[*n] = current_label;
-					}
-				}
-			}
-
-			++p;
-			
-		} while(p != all_pixels.end() && input[*p] == input[*hi]);		
-		
-		//printf("Finished %f, %d pixels.\n", input[*hi], p - hi);
-		hi = p;
-		
+		if(!has_lower)
+		{
+			for(vector<DEMGeo::address>::iterator p = plateau.begin(); p != plateau.end(); ++p)
+				label[*p] = sheds;
+			seeds.insert(seeds.end(), plateau.begin(), plateau.end());
+			if(out_watersheds)
+				out_watersheds->push_back(a);
+			++sheds;
+		}
 	}
 
-	// Part 4 - made up by me: go "fix" all of the watershed pixels.  The paper eludes that 'thick' watersheds
-	// need handling - in our case, we do a breadth-first search using the FIFO to spill any arbitrary watershed into
-	// neighbors.  Good enough for our purposes I think.
-	for(DEMGeo::address p = input.address_begin(); p != input.address_end(); ++p)
-	if(output[p] == WSHED)
-		fifo.push(p);
-	
-	while(!fifo.empty())		
+	dem_flood_t	flood;
+	DEMPriorityFlood(input, seeds, 4, flood);
+	for(vector<int>::iterator p = flood.order.begin(); p != flood.order.end(); ++p)
+	if(flood.from[*p] >= 0)
+		label[*p] = label[flood.from[*p]];
+
+	output.clear_from(input);
+	for(DEMGeo::address a = input.address_begin(); a != input.address_end(); ++a)
 	{
-		DEMGeo::address p = fifo.pop();
-		
-		if(output[p] != WSHED) 
-			continue;
-		
-		float l = WSHED;
-		for(n = input.neighbor_begin<4>(p); n != input.neighbor_end<4>(p); ++n)
-		if(output[*n] != WSHED)
-		{
-			l = output[*n];
-			break;
-		}
-		if(l != WSHED)
-		{
-			output[p] = l;
-			for(n = input.neighbor_begin<4>(p); n != input.neighbor_end<4>(p); ++n)
-			if(output[*n] == WSHED)
-				fifo.push(*n);
-		}
+		DebugAssert(label[a] >= 0);
+		output[a] = label[a];
 	}
-	
 }
 
 void VerifySheds(const DEMGeo& ws, vector<DEMGeo::address>& seeds)
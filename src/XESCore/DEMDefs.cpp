@@ -24,6 +24,9 @@
 #include "CompGeomDefs3.h"
 #include "MathUtils.h"
 #include <list>
+#include <zlib.h>
+#include "FileUtils.h"
+#include "PlatformUtils.h"
 
 #define HIST_MAX	10
 
@@ -1271,3 +1274,377 @@ void		dem_coverage_nearest(const DEMGeo& d, double lon1, double lat1, double lon
 	DebugAssert(bounds[2] <= d.mWidth);
 	DebugAssert(bounds[3] <= d.mHeight);
 }
+
+/*************************************************************************************
+ * DEMGeoMap
+ *************************************************************************************/
+
+// Bump this whenever the spill file layout changes - there is no reason to read old ones, but a stale file
+// with the right name must not be mistaken for a layer.
+#define DEM_SPILL_VERSION	1
+
+struct	dem_spill_header_t {
+	int		version;
+	int		width;
+	int		height;
+	int		post;
+	double	west;
+	double	south;
+	double	east;
+	double	north;
+};
+
+static unsigned	sSpillCounter = 0;
+
+// gzread/gzwrite take an unsigned count, so big layers go in 1 GB pieces.
+static bool	gz_write_all(gzFile fi, const void * data, size_t len)
+{
+	const char * p = (const char *) data;
+	while(len > 0)
+	{
+		unsigned chunk = min(len, (size_t) 0x40000000);
+		if(gzwrite(fi, p, chunk) != (int) chunk)
+			return false;
+		p += chunk;
+		len -= chunk;
+	}
+	return true;
+}
+
+static bool	gz_read_all(gzFile fi, void * data, size_t len)
+{
+	char * p = (char *) data;
+	while(len > 0)
+	{
+		unsigned chunk = min(len, (size_t) 0x40000000);
+		if(gzread(fi, p, chunk) != (int) chunk)
+			return false;
+		p += chunk;
+		len -= chunk;
+	}
+	return true;
+}
+
+DEMGeoMap::DEMGeoMap() : mClock(0), mMaxBytes(0)
+{
+}
+
+DEMGeoMap::DEMGeoMap(const DEMGeoMap& rhs) : mClock(0), mMaxBytes(0)
+{
+	*this = rhs;
+}
+
+DEMGeoMap::~DEMGeoMap()
+{
+	clear();
+}
+
+DEMGeoMap& DEMGeoMap::operator=(const DEMGeoMap& rhs)
+{
+	if(this == &rhs)
+		return *this;
+	clear();
+	rhs.begin();
+	base::operator=(rhs);
+	return *this;
+}
+
+DEMGeoMap::iterator	DEMGeoMap::find(int i)
+{
+	if(!mPending.empty() || !mSpilled.empty())
+		prepare(i, true);
+	iterator r = base::find(i);
+	if(r != base::end())
+		touch(i);
+	return r;
+}
+
+DEMGeoMap::const_iterator	DEMGeoMap::find(int i) const
+{
+	if(!mPending.empty() || !mSpilled.empty())
+		prepare(i, false);
+	const_iterator r = base::find(i);
+	if(r != base::end())
+		touch(i);
+	return r;
+}
+
+DEMGeoMap::size_type	DEMGeoMap::count(int i) const
+{
+	if(base::count(i) || mSpilled.count(i))
+		return 1;
+	for(list<derivation_t>::const_iterator d = mPending.begin(); d != mPending.end(); ++d)
+	if(std::find(d->outputs.begin(), d->outputs.end(), i) != d->outputs.end())
+		return 1;
+	return 0;
+}
+
+DEMGeoMap::size_type	DEMGeoMap::erase(int i)
+{
+	size_type had = count(i);
+	if(had)
+	{
+		// Whatever is made from i, or makes i, has to be settled before i goes away.
+		prepare(i, true);
+		discard(i);
+	}
+	return had;
+}
+
+DEMGeoMap::iterator	DEMGeoMap::begin(void)
+{
+	while(!mPending.empty())
+		derive(mPending.begin());
+	while(!mSpilled.empty())
+		reload(mSpilled.begin()->first);
+	return base::begin();
+}
+
+DEMGeoMap::const_iterator	DEMGeoMap::begin(void) const
+{
+	while(!mPending.empty())
+		derive(mPending.begin());
+	while(!mSpilled.empty())
+		reload(mSpilled.begin()->first);
+	return base::begin();
+}
+
+DEMGeoMap::size_type	DEMGeoMap::size(void) const
+{
+	size_type n = base::size() + mSpilled.size();
+	for(list<derivation_t>::const_iterator d = mPending.begin(); d != mPending.end(); ++d)
+		n += d->outputs.size();
+	return n;
+}
+
+void	DEMGeoMap::clear(void)
+{
+	for(hash_map<int, string>::iterator s = mSpilled.begin(); s != mSpilled.end(); ++s)
+		FILE_delete_file(s->second.c_str(), false);
+	mSpilled.clear();
+	mPending.clear();
+	mLastUse.clear();
+	base::clear();
+}
+
+void	DEMGeoMap::declare(const vector<int>& outputs, const vector<int>& inputs, derive_f func, ProgressFunc inProg)
+{
+	for(vector<int>::const_iterator o = outputs.begin(); o != outputs.end(); ++o)
+		DebugAssert(std::find(inputs.begin(), inputs.end(), *o) == inputs.end());
+
+	list<derivation_t>::iterator d = mPending.begin();
+	while(d != mPending.end())
+	{
+		bool reads = false, all_replaced = true, any_replaced = false;
+		for(vector<int>::iterator i = d->inputs.begin(); i != d->inputs.end(); ++i)
+		if(std::find(outputs.begin(), outputs.end(), *i) != outputs.end())
+			reads = true;
+		for(vector<int>::iterator o = d->outputs.begin(); o != d->outputs.end(); ++o)
+		if(std::find(outputs.begin(), outputs.end(), *o) != outputs.end())
+			any_replaced = true;
+		else
+			all_replaced = false;
+
+		if(reads || (any_replaced && !all_replaced))
+		{
+			// It needs the old contents of our outputs, or makes layers we do not - run it now.
+			// That can run other pending work too, so start over.
+			derive(d);
+			d = mPending.begin();
+		}
+		else if(any_replaced)
+			d = mPending.erase(d);
+		else
+			++d;
+	}
+
+	for(vector<int>::const_iterator o = outputs.begin(); o != outputs.end(); ++o)
+		discard(*o);
+
+	derivation_t job;
+	job.outputs = outputs;
+	job.inputs = inputs;
+	job.func = func;
+	job.prog = inProg;
+	mPending.push_back(job);
+}
+
+void	DEMGeoMap::set_memory_limit(size_t max_bytes, const string& scratch_folder)
+{
+	mMaxBytes = max_bytes;
+	mScratch = scratch_folder;
+	if(!mScratch.empty() && mScratch[mScratch.size()-1] != DIR_CHAR)
+		mScratch += DIR_STR;
+	if(mMaxBytes == 0)
+		mLastUse.clear();
+}
+
+size_t	DEMGeoMap::resident_bytes(void) const
+{
+	size_t total = 0;
+	for(base::const_iterator l = base::begin(); l != base::end(); ++l)
+		total += (size_t) l->second.mWidth * (size_t) l->second.mHeight * sizeof(float);
+	return total;
+}
+
+void	DEMGeoMap::trim(void)
+{
+	if(mMaxBytes == 0)
+		return;
+	size_t total = resident_bytes();
+	if(total <= mMaxBytes)
+		return;
+
+	vector<pair<unsigned, int> >	by_age;
+	for(base::iterator l = base::begin(); l != base::end(); ++l)
+	if(l->second.mData)
+	{
+		hash_map<int, unsigned>::iterator u = mLastUse.find(l->first);
+		by_age.push_back(pair<unsigned, int>(u == mLastUse.end() ? 0 : u->second, l->first));
+	}
+	sort(by_age.begin(), by_age.end());
+
+	for(vector<pair<unsigned, int> >::iterator l = by_age.begin(); l != by_age.end() && total > mMaxBytes; ++l)
+	{
+		const DEMGeo& dem(base::find(l->second)->second);
+		size_t bytes = (size_t) dem.mWidth * (size_t) dem.mHeight * sizeof(float);
+		if(!spill(l->second))
+		{
+			fprintf(stderr, "Could not spill DEM layer %d to %s - keeping it in memory.\n", l->second, mScratch.c_str());
+			break;
+		}
+		total -= bytes;
+	}
+}
+
+void	DEMGeoMap::prepare(int i, bool for_write) const
+{
+	for(list<derivation_t>::iterator d = mPending.begin(); d != mPending.end(); ++d)
+	if(std::find(d->outputs.begin(), d->outputs.end(), i) != d->outputs.end())
+	{
+		derive(d);
+		break;
+	}
+
+	if(mSpilled.count(i))
+		reload(i);
+
+	// A derive function filling in its own outputs is not changing anyone's input.
+	if(for_write && mDeriving.count(i) == 0)
+	{
+		list<derivation_t>::iterator d = mPending.begin();
+		while(d != mPending.end())
+		if(std::find(d->inputs.begin(), d->inputs.end(), i) != d->inputs.end())
+		{
+			derive(d);
+			d = mPending.begin();
+		}
+		else
+			++d;
+	}
+}
+
+void	DEMGeoMap::derive(list<derivation_t>::iterator d) const
+{
+	derivation_t job(*d);
+	mPending.erase(d);
+	for(vector<int>::iterator o = job.outputs.begin(); o != job.outputs.end(); ++o)
+		mDeriving.insert(*o);
+	try {
+		job.func(*const_cast<DEMGeoMap *>(this), job.prog);
+	} catch(...) {
+		for(vector<int>::iterator o = job.outputs.begin(); o != job.outputs.end(); ++o)
+			mDeriving.erase(*o);
+		throw;
+	}
+	for(vector<int>::iterator o = job.outputs.begin(); o != job.outputs.end(); ++o)
+	{
+		mDeriving.erase(*o);
+		touch(*o);
+	}
+}
+
+void	DEMGeoMap::reload(int i) const
+{
+	hash_map<int, string>::iterator s = mSpilled.find(i);
+	DebugAssert(s != mSpilled.end());
+	string path(s->second);
+	mSpilled.erase(s);
+
+	DEMGeo& dem(const_cast<DEMGeoMap *>(this)->base::operator[](i));
+	dem_spill_header_t h;
+	gzFile fi = gzopen(path.c_str(), "rb");
+	bool ok = fi && gz_read_all(fi, &h, sizeof(h)) && h.version == DEM_SPILL_VERSION;
+	if(ok)
+	{
+		dem.resize(h.width, h.height);
+		dem.mPost = h.post;
+		dem.mWest = h.west;
+		dem.mSouth = h.south;
+		dem.mEast = h.east;
+		dem.mNorth = h.north;
+		ok = dem.mWidth == h.width && dem.mHeight == h.height &&
+			gz_read_all(fi, dem.mData, (size_t) h.width * (size_t) h.height * sizeof(float));
+	}
+	if(fi)
+		gzclose(fi);
+	if(!ok)
+		AssertPrintf("Could not read DEM layer %d back from %s.\n", i, path.c_str());
+	FILE_delete_file(path.c_str(), false);
+	touch(i);
+}
+
+bool	DEMGeoMap::spill(int i)
+{
+	base::iterator l = base::find(i);
+	if(l == base::end() || l->second.mData == NULL)
+		return false;
+	if(FILE_make_dir_exist(mScratch.c_str()) != 0)
+		return false;
+
+	// Several tiles may share one scratch folder - "x" makes sure we never take over someone else's file.
+	string	path;
+	FILE *	fo = NULL;
+	for(int tries = 0; tries < 1000 && fo == NULL; ++tries)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "dem_%d_%u.gz", i, ++sSpillCounter);
+		path = mScratch + name;
+		fo = fopen(path.c_str(), "wbx");
+	}
+	if(fo == NULL)
+		return false;
+	fclose(fo);
+
+	const DEMGeo& dem(l->second);
+	dem_spill_header_t h = { DEM_SPILL_VERSION, dem.mWidth, dem.mHeight, dem.mPost, dem.mWest, dem.mSouth, dem.mEast, dem.mNorth };
+
+	// Level 1 - most of the win of gzip at a fraction of the time; these files are read back once.
+	gzFile fi = gzopen(path.c_str(), "wb1");
+	bool ok = fi && gz_write_all(fi, &h, sizeof(h)) &&
+		gz_write_all(fi, dem.mData, (size_t) dem.mWidth * (size_t) dem.mHeight * sizeof(float));
+	if(fi && gzclose(fi) != Z_OK)
+		ok = false;
+	if(!ok)
+	{
+		FILE_delete_file(path.c_str(), false);
+		return false;
+	}
+
+	mSpilled[i] = path;
+	mLastUse.erase(i);
+	base::erase(l);
+	return true;
+}
+
+void	DEMGeoMap::discard(int i)
+{
+	hash_map<int, string>::iterator s = mSpilled.find(i);
+	if(s != mSpilled.end())
+	{
+		FILE_delete_file(s->second.c_str(), false);
+		mSpilled.erase(s);
+	}
+	mLastUse.erase(i);
+	base::erase(i);
+}
@@ -25,6 +25,7 @@
 
 #include <math.h>
 #include <algorithm>
+#include <list>
 
 #include "XESConstants.h"
 #include "ProgressUtils.h"
@@ -447,21 +448,102 @@ float	DEMGeo_LocalMinMaxWithCache(
  * DEMGeoMap - MULTIPLE RASTER LAYERS BY CODE
  *************************************************************************************/
 
+/*
+
+	DEMGeoMap - LAZY LAYERS AND SPILLING
+
+	DEMGeoMap is a hash map of layers by DEM code, but it can hold layers that are not in memory.
+
+	DERIVED LAYERS: declare() names a set of layers, the layers they are made from, and a function that makes
+	them.  Nothing is computed until one of the layers is asked for (operator[], find, begin); then the function
+	runs once and the layers become ordinary layers.  count() and size() already see declared layers, so
+	"do we have slope?" tests work the same either way.
+
+	Since a derived layer is made from whatever its inputs hold when it is finally computed, handing out a
+	writable input (non-const operator[] or find, erase, or declaring a new producer of it) computes everything
+	pending that reads it first.  The derive function should read its inputs through a const DEMGeoMap& for
+	the same reason.  Layers nobody reads and whose inputs nobody touches are never computed.
+
+	SPILLING: with a memory limit set, trim() writes the least recently used layers out to gzipped files in the
+	scratch folder and frees them until the resident layers fit.  Any access brings a spilled layer back.
+	trim() frees layers that callers may hold references to, so only call it between operations - GISTool
+	does it between commands.
+
+	begin() computes and reloads every layer before handing out the iterator, so whole-map loops (saving
+	an XES file, cropping) see everything at once.  end() does not, so find(k) == end() stays cheap.
+
+	None of this is thread safe - even const access may compute or reload layers.
+
+*/
+
 class DEMGeoMap : public hash_map<int, DEMGeo> {
 public:
-	// Write ourselves a hokey const-safe [] because I am impatient!!
+	typedef	hash_map<int, DEMGeo>	base;
+	typedef	void (* derive_f)(DEMGeoMap& io_dems, ProgressFunc inProg);
+
+	DEMGeoMap();
+	DEMGeoMap(const DEMGeoMap& rhs);	// Copies get every layer in memory - no declarations or spill files.
+	~DEMGeoMap();
+	DEMGeoMap& operator=(const DEMGeoMap& rhs);
+
 	DEMGeo& operator[](int i) {
-		return hash_map<int, DEMGeo>::operator[](i);
+		if(!mPending.empty() || !mSpilled.empty())
+			prepare(i, true);
+		touch(i);
+		return base::operator[](i);
 	}
 
-
+	// Write ourselves a hokey const-safe [] because I am impatient!!
 	const DEMGeo& operator[](int i) const {
 		static DEMGeo dummy;
-		hash_map<int, DEMGeo>::const_iterator f = this->find(i);
-		if (f == this->end()) return dummy;
+		base::const_iterator f = this->find(i);
+		if (f == base::end()) return dummy;
 		return f->second;
 	}
- };
+
+	iterator		find(int i);
+	const_iterator	find(int i) const;
+	size_type		count(int i) const;
+	size_type		erase(int i);
+	iterator		begin(void);
+	const_iterator	begin(void) const;
+	size_type		size(void) const;
+	bool			empty(void) const { return size() == 0; }
+	void			clear(void);
+
+	// Declares outputs as made from inputs by func.  Any current contents of the outputs are dropped.  func gets
+	// inProg when it finally runs, so the caller must pass a progress func that outlives the declaration.
+	void			declare(const vector<int>& outputs, const vector<int>& inputs, derive_f func, ProgressFunc inProg = NULL);
+
+	// Cap on resident layers in bytes, 0 for no cap.  Spill files go in scratch_folder.
+	void			set_memory_limit(size_t max_bytes, const string& scratch_folder);
+	size_t			resident_bytes(void) const;
+	void			trim(void);		// Invalidates references to layers!
+
+private:
+
+	struct derivation_t {
+		vector<int>	outputs;
+		vector<int>	inputs;
+		derive_f	func;
+		ProgressFunc	prog;
+	};
+
+	void			prepare(int i, bool for_write) const;
+	void			derive(list<derivation_t>::iterator d) const;
+	void			reload(int i) const;
+	bool			spill(int i);
+	void			touch(int i) const { if(mMaxBytes) mLastUse[i] = ++mClock; }
+	void			discard(int i);
+
+	mutable list<derivation_t>		mPending;
+	mutable hash_map<int, string>	mSpilled;	// Layer -> spill file.
+	mutable set<int>				mDeriving;	// Outputs of derive functions that are running right now.
+	mutable hash_map<int, unsigned>	mLastUse;
+	mutable unsigned				mClock;
+	size_t							mMaxBytes;
+	string							mScratch;
+};
 
 /*************************************************************************************
  * DEM address FIFO
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "DEMDefs.h"
+#include "FileUtils.h"
+#include "PlatformUtils.h"
+#include "AssertUtils.h"
+
+static int	sDoubleCalls = 0;
+static int	sTripleCalls = 0;
+static int	sProgressCalls = 0;
+
+static bool	count_progress(int, int, const char *, float)
+{
+	++sProgressCalls;
+	return false;
+}
+
+// 2 = 1 * 2, and 3 is a plain copy of 1.
+static void	derive_double(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	++sDoubleCalls;
+	if(inProg) inProg(0, 1, "Doubling", 1.0);
+	const DEMGeo& src = static_cast<const DEMGeoMap&>(ioDEMs)[1];
+	DEMGeo& dst = ioDEMs[2];
+	dst = src;
+	dst *= 2.0;
+	ioDEMs[3] = src;
+}
+
+// 4 = 2 * 3
+static void	derive_triple(DEMGeoMap& ioDEMs, ProgressFunc inProg)
+{
+	++sTripleCalls;
+	const DEMGeo& src = static_cast<const DEMGeoMap&>(ioDEMs)[2];
+	DEMGeo& dst = ioDEMs[4];
+	dst = src;
+	dst *= 3.0;
+}
+
+static void	TEST_DeclareOrder(void)
+{
+	sDoubleCalls = sTripleCalls = sProgressCalls = 0;
+	DEMGeoMap	dems;
+	const DEMGeoMap& c(dems);
+	dems[1].resize(20, 20);
+	dems[1] = 5.0;
+
+	// Declared layers are counted but not made until someone asks.
+	dems.declare({ 2, 3 }, { 1 }, derive_double, count_progress);
+	dems.declare({ 4 }, { 2 }, derive_triple);
+	TEST_Run(dems.count(2) && dems.count(3) && dems.count(4));
+	TEST_Run(dems.size() == 4);
+	TEST_Run(sDoubleCalls == 0 && sTripleCalls == 0);
+
+	// Reading 4 makes 2 first, each exactly once, and the progress func gets through.
+	TEST_Run(c[4](3, 3) == 30.0);
+	TEST_Run(sDoubleCalls == 1 && sTripleCalls == 1 && sProgressCalls == 1);
+	TEST_Run(c[2](0, 0) == 10.0 && c[3](0, 0) == 5.0);
+	TEST_Run(sDoubleCalls == 1);
+
+	// Writing an input makes the pending layers from its old contents first.
+	dems.declare({ 2, 3 }, { 1 }, derive_double);
+	dems[1] = 7.0;
+	TEST_Run(sDoubleCalls == 2);
+	TEST_Run(c[2](0, 0) == 10.0);
+
+	// Declaring a new producer of an input settles the pending readers of the old one.
+	dems.declare({ 4 }, { 2 }, derive_triple);
+	dems.declare({ 2, 3 }, { 1 }, derive_double);
+	TEST_Run(sTripleCalls == 2 && sDoubleCalls == 2);
+	TEST_Run(c[4](0, 0) == 30.0);
+	TEST_Run(c[2](0, 0) == 14.0);
+
+	// A producer replaced before anyone reads its layers never runs.
+	dems.declare({ 4 }, { 2 }, derive_triple);
+	dems.declare({ 4 }, { 2 }, derive_triple);
+	TEST_Run(sTripleCalls == 2 && dems.size() == 4);
+	TEST_Run(c[4](0, 0) == 42.0);
+	TEST_Run(sTripleCalls == 3);
+}
+
+static void	TEST_SpillReload(void)
+{
+	char	scratch[] = "dem_spill_XXXXXX";
+	TEST_Run(mkdtemp(scratch) != NULL);
+	string	folder(string(scratch) + DIR_STR);
+
+	sDoubleCalls = sTripleCalls = 0;
+	{
+		DEMGeoMap	dems;
+		const DEMGeoMap& c(dems);
+		for(int i = 1; i <= 3; ++i)
+		{
+			DEMGeo& d = dems[i];
+			d.resize(50, 40);
+			d.mWest = -10.0 * i;
+			d.mEast = -10.0 * i + 1.0;
+			d.mSouth = 20.0;
+			d.mNorth = 21.0;
+			for(int y = 0; y < d.mHeight; ++y)
+			for(int x = 0; x < d.mWidth; ++x)
+				d(x, y) = i * 1000 + x + y * d.mWidth;
+		}
+		dems.declare({ 4 }, { 2 }, derive_triple);		// Declared layers are not spilled, just counted.
+
+		// Room for one layer - the two least recently used go out to disk.
+		size_t one_layer = 50 * 40 * sizeof(float);
+		TEST_Run(c[2](0, 0) == 2000.0 && c[3](0, 0) == 3000.0);
+		dems.set_memory_limit(one_layer, folder);
+		dems.trim();
+		TEST_Run(dems.resident_bytes() <= one_layer);
+		TEST_Run(dems.size() == 4 && dems.count(1) && dems.count(2) && dems.count(3));
+
+		vector<string>	files;
+		TEST_Run(FILE_get_directory(folder, &files, NULL) == 2);
+
+		// Every kind of access brings a layer back bit for bit, geo bounds too.
+		const DEMGeo& l1 = c[1];
+		TEST_Run(l1.mWidth == 50 && l1.mHeight == 40 && l1(7, 9) == 1000 + 7 + 9 * 50);
+		TEST_Run(l1.mWest == -10.0 && l1.mSouth == 20.0 && l1.mEast == -9.0 && l1.mNorth == 21.0);
+		TEST_Run(dems.find(2)->second(49, 39) == 2000 + 49 + 39 * 50);
+		TEST_Run(dems[3](0, 1) == 3050);
+		TEST_Run(FILE_get_directory(folder, NULL, NULL) == 0);
+
+		// begin() brings everything back, pending layers included.
+		dems.trim();
+		int n = 0;
+		for(DEMGeoMap::iterator l = dems.begin(); l != dems.end(); ++l)
+		{
+			TEST_Run(l->second.mWidth == 50 && l->second.mHeight == 40);
+			++n;
+		}
+		TEST_Run(n == 4 && sTripleCalls == 1);
+		TEST_Run(c[4](1, 0) == 3.0 * 2001);
+
+		// Copies hold everything in memory; erase and clear remove spill files.
+		dems.trim();
+		TEST_Run(FILE_get_directory(folder, NULL, NULL) == 3);
+		DEMGeoMap	copy(dems);
+		TEST_Run(copy.size() == 4 && copy.resident_bytes() == 4 * one_layer);
+		TEST_Run(copy[1](7, 9) == 1000 + 7 + 9 * 50);
+		TEST_Run(FILE_get_directory(folder, NULL, NULL) == 0);
+		dems.trim();
+		dems.erase(1);
+		dems.clear();
+		TEST_Run(FILE_get_directory(folder, NULL, NULL) == 0);
+	}
+	FILE_delete_dir_recursive(folder);
+}
+
+void	TEST_DEMDefs(void)
+{
+	TEST_DeclareOrder();
+	TEST_SpillReload();
+}
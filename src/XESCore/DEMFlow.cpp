@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "DEMFlow.h"
+#include "ParamDefs.h"
+#include "ParallelUtils.h"
+
+// Neighbor offsets, in drain_Dir0..drain_Dir7 order: clockwise from north.  The even ones are the 4 orthogonal neighbors.
+static const int	k_dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int	k_dy[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+// Below this, a strip is not worth a thread.
+#define FLOW_MIN_ROWS_PER_STRIP	64
+
+/************************************************************************************************************************************************
+ * PRIORITY FLOOD
+ ************************************************************************************************************************************************/
+
+class	flood_queue {
+public:
+	typedef pair<float, int>	entry;
+
+	flood_queue(float lo, float hi) : lo_(lo), cur_(0), count_(0)
+	{
+		// Keep the bucket count sane for weird data - a few cells sharing a bucket just cost a little heap work.
+		scale_ = 1.0f / max(1.0f, (hi - lo) / 65536.0f);
+		buckets_.resize(bucket(hi) + 1);
+	}
+
+	bool	empty(void) const { return count_ == 0; }
+
+	void	push(float level, int a)
+	{
+		int b = bucket(level);
+		DebugAssert(b >= cur_);
+		buckets_[b].push_back(entry(level, a));
+		if(b == cur_)
+			push_heap(buckets_[b].begin(), buckets_[b].end(), greater<entry>());
+		++count_;
+	}
+
+	int		pop(void)
+	{
+		DebugAssert(count_ > 0);
+		while(buckets_[cur_].empty())
+		{
+			++cur_;
+			make_heap(buckets_[cur_].begin(), buckets_[cur_].end(), greater<entry>());
+		}
+		vector<entry>& b(buckets_[cur_]);
+		pop_heap(b.begin(), b.end(), greater<entry>());
+		int a = b.back().second;
+		b.pop_back();
+		--count_;
+		return a;
+	}
+
+private:
+
+	int		bucket(float level) const { return (int) ((level - lo_) * scale_); }
+
+	float					lo_;
+	float					scale_;
+	int						cur_;
+	int						count_;
+	vector<vector<entry> >	buckets_;
+};
+
+void	DEMPriorityFlood(const DEMGeo& elev, const vector<DEMGeo::address>& seeds, int dim, dem_flood_t& out_flood)
+{
+	DebugAssert(dim == 4 || dim == 8);
+	int w = elev.mWidth;
+	int h = elev.mHeight;
+	int step = (dim == 4) ? 2 : 1;
+
+	out_flood.from.assign(w * h, DEM_FLOOD_UNREACHED);
+	out_flood.level.assign(elev.begin(), elev.end());
+	out_flood.order.clear();
+	out_flood.order.reserve(w * h);
+	if(w * h == 0)
+		return;
+
+	float lo = *min_element(elev.begin(), elev.end());
+	float hi = *max_element(elev.begin(), elev.end());
+	flood_queue		queue(lo, hi);
+	address_fifo	pit(w * h);
+
+	for(vector<DEMGeo::address>::const_iterator s = seeds.begin(); s != seeds.end(); ++s)
+	if(out_flood.from[*s] == DEM_FLOOD_UNREACHED)
+	{
+		out_flood.from[*s] = DEM_FLOOD_SEED;
+		out_flood.order.push_back(*s);
+		queue.push(elev[*s], *s);
+	}
+
+	while(!pit.empty() || !queue.empty())
+	{
+		int c = pit.empty() ? queue.pop() : pit.pop();
+		int cx = c % w;
+		int cy = c / w;
+		float l = out_flood.level[c];
+		for(int d = 0; d < 8; d += step)
+		{
+			int nx = cx + k_dx[d];
+			int ny = cy + k_dy[d];
+			if(nx < 0 || ny < 0 || nx >= w || ny >= h)
+				continue;
+			int n = nx + ny * w;
+			if(out_flood.from[n] != DEM_FLOOD_UNREACHED)
+				continue;
+			out_flood.from[n] = c;
+			out_flood.order.push_back(n);
+			if(elev[n] <= l)
+			{
+				out_flood.level[n] = l;
+				pit.push(n);
+			}
+			else
+				queue.push(elev[n], n);
+		}
+	}
+}
+
+/************************************************************************************************************************************************
+ * FLOW DIRECTIONS
+ ************************************************************************************************************************************************/
+
+// Direction of the biggest drop from a to a neighbor in z, or -1 if nothing is lower.  Like the old hydro code, drops are
+// not scaled for the longer diagonals, and holes in the DEM are never picked - water only goes into a hole through a pit.
+static int	steepest_drop(const float * z, const DEMGeo& elev, int a)
+{
+	int w = elev.mWidth;
+	int h = elev.mHeight;
+	int x = a % w;
+	int y = a / w;
+	int best = -1;
+	float best_drop = 0.0f;
+	for(int d = 0; d < 8; ++d)
+	{
+		int nx = x + k_dx[d];
+		int ny = y + k_dy[d];
+		if(nx < 0 || ny < 0 || nx >= w || ny >= h)
+			continue;
+		int n = nx + ny * w;
+		if(elev[n] == DEM_NO_DATA)
+			continue;
+		float drop = z[a] - z[n];
+		if(drop > best_drop)
+		{
+			best_drop = drop;
+			best = d;
+		}
+	}
+	return best;
+}
+
+static int	dir_to(int from, int to, int w)
+{
+	int dx = (to % w) - (from % w);
+	int dy = (to / w) - (from / w);
+	for(int d = 0; d < 8; ++d)
+	if(k_dx[d] == dx && k_dy[d] == dy)
+		return d;
+	DebugAssert(!"Flooded from a cell that is not a neighbor.");
+	return 0;
+}
+
+void	DEMFlowDirections(DEMGeo& elev, DEMGeo& dirs, float max_flood, int max_area)
+{
+	DebugAssert(elev.mWidth == dirs.mWidth && elev.mHeight == dirs.mHeight);
+	int w = elev.mWidth;
+	int h = elev.mHeight;
+	int count = w * h;
+
+	vector<DEMGeo::address>	seeds;
+	for(int a = 0; a < count; ++a)
+	{
+		if(elev[a] == DEM_NO_DATA && dirs[a] != sink_Known)
+			dirs[a] = sink_Invalid;
+		if(dirs[a] == sink_Known || dirs[a] == sink_Invalid)
+			seeds.push_back(a);
+	}
+
+	if(seeds.empty())
+	{
+		for(int a = 0; a < count; ++a)
+		{
+			int d = steepest_drop(elev.begin(), elev, a);
+			dirs[a] = (d == -1) ? sink_Invalid : drain_Dir0 + d;
+		}
+		return;
+	}
+
+	dem_flood_t	flood;
+	DEMPriorityFlood(elev, seeds, 8, flood);
+	DebugAssert(flood.order.size() == count);
+
+	for(int a = 0; a < count; ++a)
+	if(flood.from[a] >= 0)
+	{
+		int d = steepest_drop(&flood.level[0], elev, a);
+		dirs[a] = drain_Dir0 + ((d == -1) ? dir_to(a, flood.from[a], w) : d);
+	}
+
+	// Give up on pits that flood too deep or too wide, like a lake that is not in our vectors.  Each connected
+	// group of flooded cells is one pit.
+	vector<int>		pit_cells;
+	vector<char>	visited(count, 0);
+	address_fifo	fifo(count);
+	for(int a = 0; a < count; ++a)
+	if(!visited[a] && flood.level[a] > elev[a])
+	{
+		float deepest = 0.0f;
+		pit_cells.clear();
+		visited[a] = 1;
+		fifo.push(a);
+		while(!fifo.empty())
+		{
+			int c = fifo.pop();
+			pit_cells.push_back(c);
+			deepest = max(deepest, flood.level[c] - elev[c]);
+			int cx = c % w;
+			int cy = c / w;
+			for(int d = 0; d < 8; ++d)
+			{
+				int nx = cx + k_dx[d];
+				int ny = cy + k_dy[d];
+				if(nx < 0 || ny < 0 || nx >= w || ny >= h)
+					continue;
+				int n = nx + ny * w;
+				if(!visited[n] && flood.level[n] > elev[n])
+				{
+					visited[n] = 1;
+					fifo.push(n);
+				}
+			}
+		}
+		if(deepest > max_flood || (int) pit_cells.size() > max_area)
+		for(vector<int>::iterator c = pit_cells.begin(); c != pit_cells.end(); ++c)
+			dirs[*c] = sink_Invalid;
+	}
+
+	for(int a = 0; a < count; ++a)
+		elev[a] = flood.level[a];
+}
+
+/************************************************************************************************************************************************
+ * FLOW ACCUMULATION
+ ************************************************************************************************************************************************/
+
+void	DEMFlowAccumulate(const DEMGeo& elev, const DEMGeo& dirs, DEMGeo& out_flow, DEMGeo& out_slope, int max_threads)
+{
+	int w = dirs.mWidth;
+	int h = dirs.mHeight;
+	int count = w * h;
+
+	out_flow.clear_from(dirs, 0.0f);
+	out_slope.clear_from(dirs, 0.0f);
+	if(count == 0)
+		return;
+
+	// An explicit thread count sets the strips even on a machine with fewer cores, so every split can be tested anywhere.
+	int strips = max(1, min(max_threads > 0 ? max_threads : parallel_thread_count(), h / FLOW_MIN_ROWS_PER_STRIP));
+	vector<int>	strip_begin(strips + 1);
+	for(int s = 0; s <= strips; ++s)
+		strip_begin[s] = (h * s / strips) * w;
+
+	vector<int>				recv(count);		// Cell each cell drains into, or -1.
+	vector<unsigned char>	donors(count, 0);	// Cells in the same strip that have not yet been summed into this one.
+	vector<int>				order(count);		// Each strip's cells, every cell before the cell it drains into.
+	vector<int>				acc(count);
+	vector<int>				exit_of(count);		// The last cell in the strip water from here goes through, or -1 if it stays.
+	vector<int>				inflow(count, 0);	// Water coming in from other strips.
+	vector<vector<int> >	strip_exits(strips);
+
+	parallel_for(0, strips, [&](int s) {
+		int lo = strip_begin[s];
+		int hi = strip_begin[s+1];
+		for(int a = lo; a < hi; ++a)
+		{
+			int code = dirs[a];
+			recv[a] = -1;
+			if(code >= drain_Dir0 && code < drain_Dir0 + 8)
+			{
+				int nx = a % w + k_dx[code - drain_Dir0];
+				int ny = a / w + k_dy[code - drain_Dir0];
+				if(nx >= 0 && ny >= 0 && nx < w && ny < h)
+					recv[a] = nx + ny * w;
+			}
+		}
+		for(int a = lo; a < hi; ++a)
+		if(recv[a] >= lo && recv[a] < hi)
+			++donors[recv[a]];
+
+		int tail = lo;
+		for(int a = lo; a < hi; ++a)
+		{
+			acc[a] = 1;
+			if(donors[a] == 0)
+				order[tail++] = a;
+		}
+		for(int head = lo; head < tail; ++head)
+		{
+			int c = order[head];
+			int r = recv[c];
+			if(r >= lo && r < hi)
+			{
+				acc[r] += acc[c];
+				if(--donors[r] == 0)
+					order[tail++] = r;
+			}
+		}
+		DebugAssert(tail == hi);
+
+		for(int i = hi - 1; i >= lo; --i)
+		{
+			int c = order[i];
+			int r = recv[c];
+			if(r == -1)
+				exit_of[c] = -1;
+			else if(r >= lo && r < hi)
+				exit_of[c] = exit_of[r];
+			else
+			{
+				exit_of[c] = c;
+				strip_exits[s].push_back(c);
+			}
+		}
+	}, max_threads);
+
+	// Pass the water that leaves each strip on to the next.  Water that enters a strip at e leaves it again at
+	// exit_of[e], if anywhere, so the exits form a small graph we can sum over upstream-first.
+	vector<int>	exits;
+	for(int s = 0; s < strips; ++s)
+		exits.insert(exits.end(), strip_exits[s].begin(), strip_exits[s].end());
+	sort(exits.begin(), exits.end());
+
+	vector<int>	through(exits.size(), 0);
+	vector<int>	waiting(exits.size(), 0);
+	vector<int>	ready;
+	for(int i = 0; i < exits.size(); ++i)
+	{
+		int t = exit_of[recv[exits[i]]];
+		if(t != -1)
+			++waiting[lower_bound(exits.begin(), exits.end(), t) - exits.begin()];
+	}
+	for(int i = 0; i < exits.size(); ++i)
+	if(waiting[i] == 0)
+		ready.push_back(i);
+	while(!ready.empty())
+	{
+		int i = ready.back();
+		ready.pop_back();
+		int total = acc[exits[i]] + through[i];
+		int e = recv[exits[i]];
+		inflow[e] += total;
+		int t = exit_of[e];
+		if(t != -1)
+		{
+			int j = lower_bound(exits.begin(), exits.end(), t) - exits.begin();
+			through[j] += total;
+			if(--waiting[j] == 0)
+				ready.push_back(j);
+		}
+	}
+
+	parallel_for(0, strips, [&](int s) {
+		int lo = strip_begin[s];
+		int hi = strip_begin[s+1];
+		for(int i = lo; i < hi; ++i)
+		{
+			int c = order[i];
+			if(inflow[c] == 0)
+				continue;
+			acc[c] += inflow[c];
+			int r = recv[c];
+			if(r >= lo && r < hi)
+				inflow[r] += inflow[c];
+		}
+
+		for(int a = lo; a < hi; ++a)
+		{
+			out_flow[a] = acc[a];
+
+			// The gentlest way down into this cell.
+			float me = elev[a];
+			float slope = DEM_NO_DATA;
+			int x = a % w;
+			int y = a / w;
+			for(int d = 0; d < 8; ++d)
+			{
+				int nx = x - k_dx[d];
+				int ny = y - k_dy[d];
+				if(nx < 0 || ny < 0 || nx >= w || ny >= h)
+					continue;
+				int n = nx + ny * w;
+				if(recv[n] != a || me == DEM_NO_DATA || elev[n] == DEM_NO_DATA)
+					continue;
+				float drop = elev[n] - me;
+				if(drop >= 0.0f)
+					slope = MIN_NODATA(drop, slope);
+			}
+			out_slope[a] = (slope == DEM_NO_DATA) ? 0.0f : slope;
+		}
+	}, max_threads);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef DEMFlow_H
+#define DEMFlow_H
+
+#include "DEMDefs.h"
+
+/*
+
+	DEMFlow - THEORY OF OPERATION
+
+	This is the drainage engine shared by the hydro reconstruction and the raster watershed command.
+
+	Everything starts with a priority flood: water rises from a set of seed cells, always spilling next into
+	the lowest cell on the edge of what is already wet.  A cell that is lower than the water that reaches it
+	is in a pit and gets flooded to that level.  Every cell remembers which cell the water came from, so the
+	flood is a tree rooted at the seeds that only ever runs downhill (or flat) toward its root.
+
+	Levels only go up during a flood, so the queue is a bucket queue - cells are filed by level in 1 unit
+	buckets and only the bucket being drained is kept sorted.  Cells that are flooded (at or below the
+	water) skip the queue entirely and go through a FIFO.  All of the state is flat per-cell arrays; the cost
+	is linear in the size of the DEM for all practical purposes.
+
+	Flow directions are D8 steepest descent on the flooded surface.  Where that surface is flat (flooded pits
+	and real flats), cells drain back the way the water came.  This can never make a cycle: steepest descent
+	always goes down, and the flood tree always goes to a cell that was wet earlier at the same level.
+
+	Flow accumulation runs in horizontal strips on several threads.  Each strip sums up its own cells, water
+	that leaves a strip is passed between strips along the (small) graph of strip exits, and then each strip
+	adds what came in from outside.
+
+*/
+
+#define DEM_FLOOD_SEED		-1
+#define DEM_FLOOD_UNREACHED	-2
+
+struct	dem_flood_t {
+	vector<int>		from;		// Address each cell was flooded from, or DEM_FLOOD_SEED/DEM_FLOOD_UNREACHED.
+	vector<int>		order;		// Every flooded cell, in flood order - seeds first, each cell after the cell it was flooded from.
+	vector<float>	level;		// Water level when the cell was flooded - its own height or the level it was flooded from, whichever is higher.
+};
+
+// Floods elev from the seeds.  dim is 4 or 8, like DEMGeo::neighbor_iterator.  Heights are used as-is; DEM_NO_DATA is
+// just a very low height, so callers decide what to do with holes.  Cells not connected to any seed are unreached.
+void	DEMPriorityFlood(const DEMGeo& elev, const vector<DEMGeo::address>& seeds, int dim, dem_flood_t& out_flood);
+
+// D8 drainage, into dirs as drain_Dir0..drain_Dir7.  On input, dirs has sink_Known where water leaves the DEM (lakes,
+// rivers out) and sink_Invalid where it is not up to us to decide; both are left alone and every other cell is solved.
+// Holes in elev become sink_Invalid too.  Pits are filled in elev; a pit that would flood more than max_flood deep or
+// more than max_area cells wide is given up on - its cells become sink_Invalid.  With no outlet at all, cells just
+// drain downhill and every pit is sink_Invalid.
+void	DEMFlowDirections(DEMGeo& elev, DEMGeo& dirs, float max_flood, int max_area);
+
+// For every cell, the number of cells draining through it (itself included), and the smallest non-negative drop from a
+// cell draining directly into it (0 if none).  max_threads also sets the number of strips; 0 means one per core.
+void	DEMFlowAccumulate(const DEMGeo& elev, const DEMGeo& dirs, DEMGeo& out_flow, DEMGeo& out_slope, int max_threads = 0);
+
+#endif /* DEMFlow_H */
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "DEMFlow.h"
+#include "ParamDefs.h"
+#include "AssertUtils.h"
+#include <float.h>
+
+static const int	k_tdx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int	k_tdy[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+
+// Rolling hills with pits, flats and a few holes - enough to make the flood fill pits and the flow cross strips.
+static void	make_terrain(DEMGeo& elev)
+{
+	for(int y = 0; y < elev.mHeight; ++y)
+	for(int x = 0; x < elev.mWidth; ++x)
+	{
+		float z = 100.0f + 30.0f * sinf(x * 0.11f) * cosf(y * 0.07f) + 0.5f * x + (float) (rand() % 8);
+		if(x > 40 && x < 60 && y > 100 && y < 130)
+			z = 90.0f;							// a flat
+		elev(x, y) = z;
+	}
+	for(int n = 0; n < 20; ++n)
+		elev(rand() % elev.mWidth, rand() % elev.mHeight) = DEM_NO_DATA;
+}
+
+// The flood level of every cell is the lowest "highest cell" over all paths from a seed.  Relax until nothing changes.
+static void	TEST_FloodMatchesRelaxation(const DEMGeo& elev, int dim)
+{
+	int w = elev.mWidth;
+	int h = elev.mHeight;
+	vector<DEMGeo::address>	seeds;
+	for(int x = 0; x < w; ++x)
+	{
+		seeds.push_back(x);
+		seeds.push_back(x + (h - 1) * w);
+	}
+
+	dem_flood_t	flood;
+	DEMPriorityFlood(elev, seeds, dim, flood);
+
+	vector<float>	level(w * h, FLT_MAX);
+	for(vector<DEMGeo::address>::iterator s = seeds.begin(); s != seeds.end(); ++s)
+		level[*s] = elev[*s];
+	bool changed = true;
+	while(changed)
+	{
+		changed = false;
+		for(int a = 0; a < w * h; ++a)
+		for(int d = 0; d < 8; d += (dim == 4 ? 2 : 1))
+		{
+			int nx = a % w + k_tdx[d];
+			int ny = a / w + k_tdy[d];
+			if(nx < 0 || ny < 0 || nx >= w || ny >= h || level[nx + ny * w] == FLT_MAX)
+				continue;
+			float l = max(elev[a], level[nx + ny * w]);
+			if(l < level[a])
+			{
+				level[a] = l;
+				changed = true;
+			}
+		}
+	}
+
+	TEST_Run(flood.order.size() == w * h);
+	vector<int>	when(w * h, -1);
+	for(int i = 0; i < flood.order.size(); ++i)
+		when[flood.order[i]] = i;
+	for(int a = 0; a < w * h; ++a)
+	{
+		TEST_Run(flood.level[a] == level[a]);
+		int f = flood.from[a];
+		if(f == DEM_FLOOD_SEED)
+			continue;
+		TEST_Run(f >= 0 && f < w * h);
+		TEST_Run(abs(f % w - a % w) <= 1 && abs(f / w - a / w) <= 1);
+		TEST_Run(when[f] < when[a]);
+		TEST_Run(flood.level[a] == max(elev[a], flood.level[f]));
+	}
+}
+
+// Walk every cell's water down to where it stops, one cell at a time.
+static void	TEST_AccumulateMatchesWalk(const DEMGeo& elev, const DEMGeo& dirs, int max_threads)
+{
+	int w = dirs.mWidth;
+	int h = dirs.mHeight;
+	vector<int>	recv(w * h, -1);
+	for(int a = 0; a < w * h; ++a)
+	{
+		int code = dirs[a];
+		if(code >= drain_Dir0 && code < drain_Dir0 + 8)
+		{
+			int nx = a % w + k_tdx[code - drain_Dir0];
+			int ny = a / w + k_tdy[code - drain_Dir0];
+			if(nx >= 0 && ny >= 0 && nx < w && ny < h)
+				recv[a] = nx + ny * w;
+		}
+	}
+
+	vector<int>		flow(w * h, 0);
+	vector<float>	slope(w * h, DEM_NO_DATA);
+	for(int a = 0; a < w * h; ++a)
+	{
+		int steps = 0;
+		for(int c = a; c != -1 && steps <= w * h; c = recv[c], ++steps)
+			++flow[c];
+		TEST_Run(steps <= w * h);								// No cycles.
+		int r = recv[a];
+		if(r != -1 && elev[a] != DEM_NO_DATA && elev[r] != DEM_NO_DATA && elev[a] >= elev[r])
+			slope[r] = MIN_NODATA(elev[a] - elev[r], slope[r]);
+	}
+
+	DEMGeo	out_flow, out_slope;
+	DEMFlowAccumulate(elev, dirs, out_flow, out_slope, max_threads);
+	for(int a = 0; a < w * h; ++a)
+	{
+		TEST_Run(out_flow[a] == flow[a]);
+		TEST_Run(out_slope[a] == (slope[a] == DEM_NO_DATA ? 0.0f : slope[a]));
+	}
+}
+
+void	TEST_DEMFlow(void)
+{
+	srand(4321);
+
+	// Tall enough for several accumulation strips.
+	DEMGeo	elev(200, 300);
+	make_terrain(elev);
+
+	TEST_FloodMatchesRelaxation(elev, 4);
+	TEST_FloodMatchesRelaxation(elev, 8);
+
+	// Water leaves along the west edge; everything else gets solved.
+	DEMGeo	filled(elev);
+	DEMGeo	dirs(elev.mWidth, elev.mHeight);
+	dirs = DEM_NO_DATA;
+	for(int y = 0; y < dirs.mHeight; ++y)
+		dirs(0, y) = sink_Known;
+	DEMFlowDirections(filled, dirs, 1000.0f, elev.mWidth * elev.mHeight);
+
+	TEST_AccumulateMatchesWalk(filled, dirs, 1);
+	TEST_AccumulateMatchesWalk(filled, dirs, 3);
+	TEST_AccumulateMatchesWalk(filled, dirs, 0);
+
+	// Without an outlet, cells just drain downhill.
+	DEMGeo	no_outlet(elev.mWidth, elev.mHeight);
+	no_outlet = DEM_NO_DATA;
+	DEMGeo	raw(elev);
+	for(int a = 0; a < raw.mWidth * raw.mHeight; ++a)
+	if(raw[a] == DEM_NO_DATA)
+		raw[a] = 0.0f;
+	DEMFlowDirections(raw, no_outlet, 1000.0f, elev.mWidth * elev.mHeight);
+	TEST_AccumulateMatchesWalk(raw, no_outlet, 1);
+	TEST_AccumulateMatchesWalk(raw, no_outlet, 0);
+}
@@ -37,6 +37,8 @@
 #include "MathUtils.h"
 #include "PerfUtils.h"
 #include "GISTool_Globals.h"
+#include "ParallelUtils.h"
+#include <exception>
 
 /*
 	TODO:
@@ -927,121 +929,109 @@ static int IsAliased(int lu)
 	return 0;
 }
 
-void	BuildDSF(
-			const char *	inFileName1,
-			const char *	inFileName2,
-			const DEMGeo&	inElevation,
-			const DEMGeo&	inBathymetry,
-			const DEMGeo&	inUrbanDensity,
-//			const DEMGeo&	inVegeDem,
-			CDT&			inHiresMesh,
-//			CDT&			inLoresMesh,
-			Pmwx&			inVectorMap,
-			rf_region		inRegion,
-			ProgressFunc	inProgress)
-{
-
-
-vector<CDT::Face_handle>	sHiResTris[PATCH_DIM_HI * PATCH_DIM_HI];
-vector<CDT::Face_handle>	sLoResTris[PATCH_DIM_LO * PATCH_DIM_LO];
-set<int>					sHiResLU[PATCH_DIM_HI * PATCH_DIM_HI];
-set<int>					sHiResBO[PATCH_DIM_HI * PATCH_DIM_HI];
-set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
-
-
-		double	prog_c = 0.0;
-		int		debug_add_tri_fan = 0;
-		int		debug_sub_tri_fan = 0;
-		int		total_tris = 0;
-		int		total_tri_fans = 0;
-		int		total_tri_fan_pts = 0;
-		int		border_tris = 0;
-		int		total_patches = 0;
-		int		total_objs = 0;
-		int		total_polys = 0;
-		int		total_chains = 0;
-		int		total_shapes = 0;
-
-
-		int		cur_id = 0, tri, tris_this_patch;
-		double	coords3[3];
-		double	coords4[4];
-		double	coords2[2];
-		//double	coords6[6];
-		double	coords8[8];
-		double							x, y, v;
-		CDT::Finite_faces_iterator		fi;
-		CDT::Face_handle				f;
-		CDT::Vertex_handle				avert;
-		CDT::Finite_vertices_iterator	vert;
-		map<int, int, SortByLULayer>::iterator 		lu_ranked;
-		map<int, int>::iterator 		lu;
-		map<int, int>::iterator 		obdef;
-		map<int, int, ObjPrio>::iterator obdef_prio;
-		set<int>::iterator				border_lu;
-		bool							is_water, is_overlay;
-		list<CDT::Face_handle>::iterator nf;
-
-		Pmwx::Face_iterator						pf;
-		GISObjPlacementVector::iterator			pointObj;
-		GISPolyObjPlacementVector::iterator		polyObj;
-		Polygon2::iterator						polyPt;
-		vector<Polygon2>::iterator				polyHole;
+/****************************************************************************************************************************************
+ * BUILD STAGES
+ ****************************************************************************************************************************************
 
-		void *			writer1, * writer2;
-		DSFCallbacks_t	cbs;
+	BuildDSF works in stages.  The mesh stages (terrain patches, then beaches) only write the base mesh DSF writer;
+	the overlay stages (objects and facades, then networks) only write the overlay writer.  They run one after the
+	other - the mesh and the vector map share CGAL's lazy numbers, which the CGAL we build against can not read from
+	two threads.  The finished files never touch CGAL, so when there are two of them they are written side by side.
 
-		Net_JunctionInfoSet				junctions;
-		Net_ChainInfoSet				chains;
-		Net_JunctionInfoSet::iterator 	ji;
-		Net_ChainInfoSet::iterator 		ci;
-		vector<Point2>::iterator		shapePoint;
+	Each stage returns false if the user cancelled via the progress func.
 
-		map<int, int, SortByLULayer>landuses;			// This is a map from DSF to layer, used to start a patch and generally get organized.  Sorting is specialized to be by LU layering from config file.
-		map<int, int>				landuses_reversed;	// This is a map from DSF layer to land-use, used to write out DSF layers in order.
-		map<int, int>				objects_reversed;
-		map<int, int>	facades,	facades_reversed;
-		map<int, int, ObjPrio>		objects;
+ ****************************************************************************************************************************************/
 
-		char	prop_buf[256];
+enum {
+	dsf_stage_Setup,
+	dsf_stage_Mesh,
+	dsf_stage_Beaches,
+	dsf_stage_Objects,
+	dsf_stage_Networks,
+	dsf_stage_Write,
+	dsf_stage_Count
+};
 
-		deferred_pool	must_dealloc;
+static const char * k_dsf_stage_names[dsf_stage_Count] = { "Setup", "Mesh", "Beaches", "Objects", "Networks", "Write" };
+
+// What the stages emitted and how long each took.  Every stage only touches its own fields.
+struct	DSFBuildStats_t {
+	int		total_tris;
+	int		total_tri_fans;
+	int		border_tris;
+	int		total_patches;
+	int		total_objs;
+	int		total_polys;
+	int		total_chains;
+	int		total_shapes;
+	int		num_landuses;
+	int		num_objdefs;
+	int		num_polydefs;
+	double	stage_secs[dsf_stage_Count];
+};
 
-	/****************************************************************
-	 * SETUP
-	 ****************************************************************/
+// Like StElapsedTime, but files the seconds away for the report at the end instead of printing them.
+class	StStageTime {
+	unsigned long long	mStartTime;
+	double&				mSecs;
+public:
+	StStageTime(double& outSecs) : mStartTime(query_hpc()), mSecs(outSecs) { }
+	~StStageTime() { mSecs = hpc_to_microseconds(query_hpc() - mStartTime) / 1000000.0; }
+};
 
-	double hmin = 9.9e9, hmax = -9.9e9;
-	for(vert = inHiresMesh.finite_vertices_begin(); vert != inHiresMesh.finite_vertices_end(); ++vert)
+static void	print_stage_times(const DSFBuildStats_t& stats, double wall_secs)
+{
+#if PROFILE_PERFORMANCE
+	double total = 0.0;
+	for(int s = 0; s < dsf_stage_Count; ++s)
 	{
-		hmin = min(hmin, vert->info().height);
-		hmax = max(hmax, vert->info().height);
+		printf("DSF stage %-9s - %lf seconds.\n", k_dsf_stage_names[s], stats.stage_secs[s]);
+		total += stats.stage_secs[s];
 	}
-	int emin = floor(hmin);
-	int emax = ceil(hmax);
-	int erange = emax - emin;
-	int erange2 = 1;
-	while(erange2 <= erange) erange2 *= 2;
-	erange2--;
-	int extra = erange2 - erange;
-	int use_min = emin - extra/2;
-	int use_max = use_min + erange2;
-	printf("Real span: %lf to %lf.  Using: %d to %d\n", hmin, hmax, use_min, use_max);
-	// Andrew: change divisions to 16
-	writer1 = inFileName1 ? DSFCreateWriter(inElevation.mWest, inElevation.mSouth, inElevation.mEast, inElevation.mNorth, -32768, 32767, DSF_DIVISIONS) : NULL;
-	writer2 = inFileName2 ? ((inFileName1 && strcmp(inFileName1,inFileName2)==0) ? writer1 : DSFCreateWriter(inElevation.mWest, inElevation.mSouth, inElevation.mEast, inElevation.mNorth,use_min, use_max, DSF_DIVISIONS)) : NULL;
-	StNukeWriter	dontLeakWriter1(writer1);
-	StNukeWriter	dontLeakWriter2(writer2==writer1 ? NULL : writer2);
- 	DSFGetWriterCallbacks(&cbs);
+	printf("DSF stages took %lf seconds, %lf seconds elapsed.\n", total, wall_secs);
+#endif
+}
+
+/****************************************************************
+ * MESH PATCHES
+ ****************************************************************/
+
+static bool	build_dsf_mesh(
+			void *					writer,
+			const DSFCallbacks_t&	cbs,
+			const DEMGeo&			inElevation,
+			const DEMGeo&			inBathymetry,
+			CDT&					inHiresMesh,
+			deferred_pool&			must_dealloc,
+			DSFBuildStats_t&		ioStats,
+			ProgressFunc			inProgress)
+{
+	vector<CDT::Face_handle>	sHiResTris[PATCH_DIM_HI * PATCH_DIM_HI];
+	vector<CDT::Face_handle>	sLoResTris[PATCH_DIM_LO * PATCH_DIM_LO];
+	set<int>					sHiResLU[PATCH_DIM_HI * PATCH_DIM_HI];
+	set<int>					sHiResBO[PATCH_DIM_HI * PATCH_DIM_HI];
+	set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
+
+	double							prog_c = 0.0;
+	int								debug_add_tri_fan = 0;
+	int								cur_id = 0, tri, tris_this_patch = 0;
+	double							coords8[8];
+	double							x, y;
+	CDT::Finite_faces_iterator		fi;
+	CDT::Face_handle				f;
+	map<int, int, SortByLULayer>::iterator 		lu_ranked;
+	map<int, int>::iterator 		lu;
+	set<int>::iterator				border_lu;
+	bool							is_water, is_overlay;
+
+	map<int, int, SortByLULayer>landuses;			// This is a map from DSF to layer, used to start a patch and generally get organized.  Sorting is specialized to be by LU layering from config file.
+	map<int, int>				landuses_reversed;	// This is a map from DSF layer to land-use, used to write out DSF layers in order.
 
-	/****************************************************************
-	 * MESH GENERATION
-	 ****************************************************************/
 
 	// First assign IDs to each triangle to differentiate patches.
 	// Also work out land uses.
 
-	if (inProgress && inProgress(0, 5, "Compiling Mesh", 0.0)) return;
+	if (inProgress && inProgress(0, 5, "Compiling Mesh", 0.0)) return false;
 
 	#if DEV
 	for (fi = inHiresMesh.finite_faces_begin(); fi != inHiresMesh.finite_faces_end(); ++fi)
@@ -1072,7 +1062,6 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 	}
 	#endif
 
-	if(writer1)
 	for (fi = inHiresMesh.finite_faces_begin(); fi != inHiresMesh.finite_faces_end(); ++fi)
 	{
 		fi->info().flag = 0;
@@ -1174,10 +1163,9 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 		}
 	}
 
-	if (inProgress && inProgress(0, 5, "Compiling Mesh", 0.5)) return;
+	if (inProgress && inProgress(0, 5, "Compiling Mesh", 0.5)) return false;
 
 #if !NO_ORTHO
-	if(writer1)
 	for (fi = inLoresMesh.finite_faces_begin(); fi != inLoresMesh.finite_faces_end(); ++fi)
 	{
 		if (fi->vertex(0)->point().y() >= inElevation.mNorth &&
@@ -1222,7 +1210,6 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 	// the DSF-file-relative indices.
 
 	cur_id = 0;
-	if(writer1)
 	for (lu_ranked = landuses.begin(); lu_ranked != landuses.end(); ++lu_ranked)
 	if (!IsAliased(lu_ranked->first))
 	{
@@ -1235,12 +1222,11 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 	if(IsAliased(lu_ranked->first))
 		lu_ranked->second = landuses[IsAliased(lu_ranked->first)];
 
-	if (inProgress && inProgress(0, 5, "Compiling Mesh", 1.0)) return;
+	if (inProgress && inProgress(0, 5, "Compiling Mesh", 1.0)) return false;
 
-	if(writer1)
 	for (prog_c = 0.0, lu_ranked = landuses.begin(); lu_ranked != landuses.end(); ++lu_ranked, prog_c += 1.0)
 	{
-		if (inProgress && inProgress(1, 5, "Sorting Mesh", prog_c / (float) landuses.size())) return;
+		if (inProgress && inProgress(1, 5, "Sorting Mesh", prog_c / (float) landuses.size())) return false;
 
 		/***************************************************************************************************************************************
 		 * WRITE OUT LOW RES ORTHOPHOTO PATCHES
@@ -1264,7 +1250,7 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 				}
 			}
 			fan_builder.CalcFans();
-			cbs.BeginPatch_f(lu_ranked->second, ORTHO_NEAR_LOD, ORTHO_FAR_LOD, 0, 5, writer1);
+			cbs.BeginPatch_f(lu_ranked->second, ORTHO_NEAR_LOD, ORTHO_FAR_LOD, 0, 5, writer);
 			list<CDT::Vertex_handle>				primv;
 			list<CDT::Vertex_handle>::iterator		vert;
 			int										primt;
@@ -1274,14 +1260,14 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 				if(primv.empty()) break;
 				if(primt != dsf_Tri)
 				{
-					++total_tri_fans;
-					total_tris += (primv.size() - 2);
+					++ioStats.total_tri_fans;
+					ioStats.total_tris += (primv.size() - 2);
 				} else {
-					total_tris += (primv.size() / 3);
+					ioStats.total_tris += (primv.size() / 3);
 					tris_this_patch += (primv.size() / 3);
 				}
 				if
-				cbs.BeginPrimitive_f(primt, writer1);
+				cbs.BeginPrimitive_f(primt, writer);
 				for(vert = primv.begin(); vert != primv.end(); ++vert)
 				{
 					coords8[0] = (*vert)->point().x();
@@ -1293,12 +1279,12 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 					DebugAssert(coords8[3] <=  1.0);
 					DebugAssert(coords8[4] >= -1.0);
 					DebugAssert(coords8[4] <=  1.0);
-					cbs.AddPatchVertex_f(coords8, writer1);
+					cbs.AddPatchVertex_f(coords8, writer);
 				}
-				cbs.EndPrimitive_f(writer1);
+				cbs.EndPrimitive_f(writer);
 			}
-			cbs.EndPatch_f(writer1);
-			++total_patches;
+			cbs.EndPatch_f(writer);
+			++ioStats.total_patches;
 		}
 #endif
 
@@ -1332,7 +1318,7 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 				!IsCustomOverWaterSoft(lu_ranked->first))			// custom over soft water - we get physics from who is underneath
 				flags |= dsf_Flag_Physical;
 
-			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_LOD, TERRAIN_FAR_LOD, flags, is_water ? 7 : (pinfo ? 7 : 5), writer1);
+			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_LOD, TERRAIN_FAR_LOD, flags, is_water ? 7 : (pinfo ? 7 : 5), writer);
 			list<CDT::Vertex_handle>				primv;
 			list<CDT::Vertex_handle>::iterator		vert;
 			int										primt;
@@ -1342,13 +1328,13 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
                 if(primv.empty()) break;
                 if(primt != dsf_Tri)
                  {
-                    ++total_tri_fans;
-                    total_tris += (primv.size() - 2);
+                    ++ioStats.total_tri_fans;
+                    ioStats.total_tris += (primv.size() - 2);
                 } else {
-                    total_tris += (primv.size() / 3);
+                    ioStats.total_tris += (primv.size() / 3);
                     tris_this_patch += (primv.size() / 3);
                 }
-                cbs.BeginPrimitive_f(primt, writer1);
+                cbs.BeginPrimitive_f(primt, writer);
                 for(vert = primv.begin(); vert != primv.end(); ++vert)
                 {
 					// Ben says: the use of doblim warrants some explanation: CGAL provides EXACT arithmetic, but it does not give exact
@@ -1383,12 +1369,12 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 					DebugAssert(coords8[3] <=  1.0);
 					DebugAssert(coords8[4] >= -1.0);
 					DebugAssert(coords8[4] <=  1.0);
-					cbs.AddPatchVertex_f(coords8, writer1);
+					cbs.AddPatchVertex_f(coords8, writer);
 				}
-				cbs.EndPrimitive_f(writer1);
+				cbs.EndPrimitive_f(writer);
 			}
-			cbs.EndPatch_f(writer1);
-			++total_patches;
+			cbs.EndPatch_f(writer);
+			++ioStats.total_patches;
 		}
 
 		/***************************************************************************************************************************************
@@ -1400,8 +1386,8 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 		if (lu_ranked->first >= terrain_Natural)
 		if (sHiResBO[cur_id].count(lu_ranked->first))							// Quick check: do we have ANY border tris in this layer in this patch?
 		{
-			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_BORDER_LOD, TERRAIN_FAR_BORDER_LOD, dsf_Flag_Overlay, /*is_composite ? 8 :*/ 7, writer1);
-			cbs.BeginPrimitive_f(dsf_Tri, writer1);
+			cbs.BeginPatch_f(lu_ranked->second, TERRAIN_NEAR_BORDER_LOD, TERRAIN_FAR_BORDER_LOD, dsf_Flag_Overlay, /*is_composite ? 8 :*/ 7, writer);
+			cbs.BeginPrimitive_f(dsf_Tri, writer);
 			tris_this_patch = 0;
 			for (tri = 0; tri < sHiResTris[cur_id].size(); ++tri)				// For each tri
 			{
@@ -1433,8 +1419,8 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 
 						if (tris_this_patch >= MAX_TRIS_PER_PATCH)
 						{
-							cbs.EndPrimitive_f(writer1);
-							cbs.BeginPrimitive_f(dsf_Tri, writer1);
+							cbs.EndPrimitive_f(writer);
+							cbs.BeginPrimitive_f(dsf_Tri, writer);
 							tris_this_patch = 0;
 						}
 
@@ -1464,187 +1450,219 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 							DebugAssert(coords8[3] <=  1.0);
 							DebugAssert(coords8[4] >= -1.0);
 							DebugAssert(coords8[4] <=  1.0);
-							cbs.AddPatchVertex_f(coords8, writer1);
+							cbs.AddPatchVertex_f(coords8, writer);
 						}
-						++total_tris;
-						++border_tris;
+						++ioStats.total_tris;
+						++ioStats.border_tris;
 						++tris_this_patch;
 					}
 				}
 			}
-			cbs.EndPrimitive_f(writer1);
-			cbs.EndPatch_f(writer1);
-			++total_patches;
+			cbs.EndPrimitive_f(writer);
+			cbs.EndPatch_f(writer);
+			++ioStats.total_patches;
 		}
 #endif
 	}
 
-	if(writer1)
 	for (lu = landuses_reversed.begin(); lu != landuses_reversed.end(); ++lu)
 	{
 		string def = get_terrain_name(lu->second);
-		cbs.AcceptTerrainDef_f(def.c_str(), writer1);
+		cbs.AcceptTerrainDef_f(def.c_str(), writer);
 	}
 
-	if (inProgress && inProgress(1, 5, "Sorting Mesh", 1.0)) return;
+	if (inProgress && inProgress(1, 5, "Sorting Mesh", 1.0)) return false;
 
 
-	if(writer1)
 	{
-		cbs.AcceptRasterDef_f("elevation",writer1);
-		cbs.AcceptRasterDef_f("sea_level",writer1);
-		cbs.AcceptRasterDef_f("bathymetry",writer1);
+		cbs.AcceptRasterDef_f("elevation",writer);
+		cbs.AcceptRasterDef_f("sea_level",writer);
+		cbs.AcceptRasterDef_f("bathymetry",writer);
 
 		DSFRasterHeader_t	header;
 		short * data = ConvertDEMTo<short>(inElevation,header, dsf_Raster_Format_Int,1.0,0.0);
 		must_dealloc.push_back(data);
-		cbs.AddRasterData_f(&header,data,writer1);
+		cbs.AddRasterData_f(&header,data,writer);
 
 //		data = ConvertDEMTo<short>(inSeaLevel,header, dsf_Raster_Format_Int,1.0,0.0);
 //		must_dealloc.push_back(data);
-//		cbs.AddRasterData_f(&header,data,writer1);
+//		cbs.AddRasterData_f(&header,data,writer);
 
 		data = ConvertDEMTo<short>(inBathymetry,header, dsf_Raster_Format_Int,1.0,0.0);
 		must_dealloc.push_back(data);
-		cbs.AddRasterData_f(&header,data,writer1);
+		cbs.AddRasterData_f(&header,data,writer);
 	}
+	ioStats.num_landuses = landuses.size();
+	return true;
+}
 
-	/****************************************************************
-	 * BEACH EXPORT
-	 ****************************************************************/
+/****************************************************************
+ * BEACH EXPORT
+ ****************************************************************/
 
 #if !PHONE
-	if(writer1)
+static void	build_dsf_beaches(
+			void *					writer,
+			const DSFCallbacks_t&	cbs,
+			const DEMGeo&			inElevation,
+			CDT&					inHiresMesh)
+{
+	CDT::Finite_faces_iterator	fi;
+	double						coords3[3];
+
+	// Beach export - we are going to export polygon rings/chains out of
+	// every homogenous continous coastline type.  Two issues:
+	// When a beach is not a ring, we need to find the start link
+	// We also need to identify rings somehow.
+
+	typedef edge_hash_map														LinkMap;
+	typedef set<CDT::Edge>													LinkSet;
+	typedef edge_info_map														LinkInfo;
+
+	LinkMap			linkNext;	// A hash map from each halfedge to the next with matching beach.  Uses CCW traversal to handle screw cases.
+	LinkSet			nonStart;	// Set of all halfedges that are pointed to by another.
+	LinkInfo		all;		// Ones we haven't exported.
+	LinkSet			starts;		// Ones that are not pointed to by a HE
+	CDT::Edge	beach, last_beach;
+	int				beachKind;
+
+	// Go through and build up the link map, e.g. for each edge, who's next.
+	// Also record each edge that's pointed to by another - these are NOT
+	// the starts of non-ring beaches.
+	for (fi = inHiresMesh.finite_faces_begin(); fi != inHiresMesh.finite_faces_end(); ++fi)
+	for (int v = 0; v < 3; ++v)
 	{
-		// Beach export - we are going to export polygon rings/chains out of
-		// every homogenous continous coastline type.  Two issues:
-		// When a beach is not a ring, we need to find the start link
-		// We also need to identify rings somehow.
-
-		typedef edge_hash_map														LinkMap;
-		typedef set<CDT::Edge>													LinkSet;
-		typedef edge_info_map														LinkInfo;
-
-		LinkMap			linkNext;	// A hash map from each halfedge to the next with matching beach.  Uses CCW traversal to handle screw cases.
-		LinkSet			nonStart;	// Set of all halfedges that are pointed to by another.
-		LinkInfo		all;		// Ones we haven't exported.
-		LinkSet			starts;		// Ones that are not pointed to by a HE
-		CDT::Edge	beach, last_beach;
-		int				beachKind;
-
-		// Go through and build up the link map, e.g. for each edge, who's next.
-		// Also record each edge that's pointed to by another - these are NOT
-		// the starts of non-ring beaches.
-		for (fi = inHiresMesh.finite_faces_begin(); fi != inHiresMesh.finite_faces_end(); ++fi)
-		for (v = 0; v < 3; ++v)
+		CDT::Edge edge;
+		edge.first = fi;
+		edge.second = v;
+		if (has_beach(edge, inHiresMesh, beachKind))
 		{
-			CDT::Edge edge;
-			edge.first = fi;
-			edge.second = v;
-			if (has_beach(edge, inHiresMesh, beachKind))
+			all[edge] = beachKind;
+			starts.insert(edge);
+			// Go through each he coming out of our target starting with the one to the clockwise of us, going clockwise.
+			// We're searching for the next beach seg but skipping bogus in-water stuff like brides.
+			for (CDT::Edge iter = edge_next(edge); iter != edge_twin(edge); iter = edge_twin_next(iter))
 			{
-				all[edge] = beachKind;
-				starts.insert(edge);
-				// Go through each he coming out of our target starting with the one to the clockwise of us, going clockwise.
-				// We're searching for the next beach seg but skipping bogus in-water stuff like brides.
-				for (CDT::Edge iter = edge_next(edge); iter != edge_twin(edge); iter = edge_twin_next(iter))
+				if (has_beach(iter, inHiresMesh, beachKind))
 				{
-					if (has_beach(iter, inHiresMesh, beachKind))
-					{
-	//					DebugAssert(iter->twin() != he);
-						DebugAssert(linkNext.count(edge) == 0);
-						linkNext[edge] = iter;
-						DebugAssert(nonStart.count(iter) == 0);
-						nonStart.insert(iter);
-						break;
-					}
-					// If we hit something that isn't bounding water, we've gone out of our land into the next
-					// water out of this vertex.  Stop now before we link to a non-connected water body!!
-					if (iter.first->info().terrain != terrain_Water)
-						break;
+//					DebugAssert(iter->twin() != he);
+					DebugAssert(linkNext.count(edge) == 0);
+					linkNext[edge] = iter;
+					DebugAssert(nonStart.count(iter) == 0);
+					nonStart.insert(iter);
+					break;
 				}
+				// If we hit something that isn't bounding water, we've gone out of our land into the next
+				// water out of this vertex.  Stop now before we link to a non-connected water body!!
+				if (iter.first->info().terrain != terrain_Water)
+					break;
 			}
 		}
+	}
 
-		for (LinkSet::iterator i = nonStart.begin(); i != nonStart.end(); ++i)
-		{
-			starts.erase(*i);
-		}
-
-		// Export non-ring beaches.  For each link that's not pointed to by someone else
-		// export the chain.
+	for (LinkSet::iterator i = nonStart.begin(); i != nonStart.end(); ++i)
+	{
+		starts.erase(*i);
+	}
 
-		for (LinkSet::iterator a_start = starts.begin(); a_start != starts.end(); ++a_start)
-		{
-			FixBeachContinuity(linkNext, *a_start, all);
+	// Export non-ring beaches.  For each link that's not pointed to by someone else
+	// export the chain.
 
-			cbs.BeginPolygon_f(0, 0, 3, writer1);
-			cbs.BeginPolygonWinding_f(writer1);
+	for (LinkSet::iterator a_start = starts.begin(); a_start != starts.end(); ++a_start)
+	{
+		FixBeachContinuity(linkNext, *a_start, all);
 
-			for (beach = *a_start; beach != CDT::Edge(); beach = ((linkNext.count(beach)) ? (linkNext[beach]) : CDT::Edge()))
-			{
-	//			printf("output non-circ beach type = %d, len = %lf\n", all[beach], edge_len(beach));
-				last_beach = beach;
-				DebugAssert(all.count(beach) != 0);
-				beachKind = all[beach];
-				BeachPtGrab(beach, false, inHiresMesh, coords3, beachKind);
-				coords3[0] = doblim(coords3[0],inElevation.mWest,  inElevation.mEast);
-				coords3[1] = doblim(coords3[1],inElevation.mSouth, inElevation.mNorth);
-				cbs.AddPolygonPoint_f(coords3, writer1);
-				all.erase(beach);
-			}
-			DebugAssert(all.count(*a_start) == 0);
+		cbs.BeginPolygon_f(0, 0, 3, writer);
+		cbs.BeginPolygonWinding_f(writer);
 
-			BeachPtGrab(last_beach, true, inHiresMesh, coords3, beachKind);
+		for (beach = *a_start; beach != CDT::Edge(); beach = ((linkNext.count(beach)) ? (linkNext[beach]) : CDT::Edge()))
+		{
+//			printf("output non-circ beach type = %d, len = %lf\n", all[beach], edge_len(beach));
+			last_beach = beach;
+			DebugAssert(all.count(beach) != 0);
+			beachKind = all[beach];
+			BeachPtGrab(beach, false, inHiresMesh, coords3, beachKind);
 			coords3[0] = doblim(coords3[0],inElevation.mWest,  inElevation.mEast);
 			coords3[1] = doblim(coords3[1],inElevation.mSouth, inElevation.mNorth);
-			cbs.AddPolygonPoint_f(coords3, writer1);
-
-			cbs.EndPolygonWinding_f(writer1);
-			cbs.EndPolygon_f(writer1);
-			//printf("end non-circular.\n");
+			cbs.AddPolygonPoint_f(coords3, writer);
+			all.erase(beach);
 		}
+		DebugAssert(all.count(*a_start) == 0);
 
-	#if DEV
-		for (LinkInfo::iterator test = all.begin(); test != all.end(); ++test)
-		{
-			DebugAssert(linkNext.count(test->first) != 0);
-		}
-	#endif
+		BeachPtGrab(last_beach, true, inHiresMesh, coords3, beachKind);
+		coords3[0] = doblim(coords3[0],inElevation.mWest,  inElevation.mEast);
+		coords3[1] = doblim(coords3[1],inElevation.mSouth, inElevation.mNorth);
+		cbs.AddPolygonPoint_f(coords3, writer);
 
-		// Now just pick an edge and export in a circulator - we should only have rings!
-		while (!all.empty())
-		{
-			CDT::Edge this_start = all.begin()->first;
-			FixBeachContinuity(linkNext, this_start, all);
-			cbs.BeginPolygon_f(0, 1, 3, writer1);
-			cbs.BeginPolygonWinding_f(writer1);
+		cbs.EndPolygonWinding_f(writer);
+		cbs.EndPolygon_f(writer);
+		//printf("end non-circular.\n");
+	}
 
-			beach = this_start;
-			do {
-	//			printf("output circ beach type = %d, len = %lf\n", all[beach], edge_len(beach));
-				DebugAssert(all.count(beach) != 0);
-				DebugAssert(linkNext.count(beach) != 0);
-				beachKind = all.begin()->second;
-				BeachPtGrab(beach, false, inHiresMesh, coords3, beachKind);
-				coords3[0] = doblim(coords3[0],inElevation.mWest,  inElevation.mEast);
-				coords3[1] = doblim(coords3[1],inElevation.mSouth, inElevation.mNorth);
-				cbs.AddPolygonPoint_f(coords3, writer1);
-				all.erase(beach);
-				beach = linkNext[beach];
-			} while (beach != this_start);
-			cbs.EndPolygonWinding_f(writer1);
-			cbs.EndPolygon_f(writer1);
+#if DEV
+	for (LinkInfo::iterator test = all.begin(); test != all.end(); ++test)
+	{
+		DebugAssert(linkNext.count(test->first) != 0);
+	}
+#endif
+
+	// Now just pick an edge and export in a circulator - we should only have rings!
+	while (!all.empty())
+	{
+		CDT::Edge this_start = all.begin()->first;
+		FixBeachContinuity(linkNext, this_start, all);
+		cbs.BeginPolygon_f(0, 1, 3, writer);
+		cbs.BeginPolygonWinding_f(writer);
+
+		beach = this_start;
+		do {
+//			printf("output circ beach type = %d, len = %lf\n", all[beach], edge_len(beach));
+			DebugAssert(all.count(beach) != 0);
+			DebugAssert(linkNext.count(beach) != 0);
+			beachKind = all.begin()->second;
+			BeachPtGrab(beach, false, inHiresMesh, coords3, beachKind);
+			coords3[0] = doblim(coords3[0],inElevation.mWest,  inElevation.mEast);
+			coords3[1] = doblim(coords3[1],inElevation.mSouth, inElevation.mNorth);
+			cbs.AddPolygonPoint_f(coords3, writer);
+			all.erase(beach);
+			beach = linkNext[beach];
+		} while (beach != this_start);
+		cbs.EndPolygonWinding_f(writer);
+		cbs.EndPolygon_f(writer);
 
-		}
-		cbs.AcceptPolygonDef_f("lib/g8/beaches.bch", writer1);
 	}
+	cbs.AcceptPolygonDef_f("lib/g8/beaches.bch", writer);
+}
 #endif
-	/****************************************************************
-	 * OBJECT EXPORT/FACADE/FOREST WRITEOUT
-	 ****************************************************************/
 
-	if (inProgress && inProgress(2, 5, "Compiling Objects", 0.0)) return;
+/****************************************************************
+ * OBJECT EXPORT/FACADE/FOREST WRITEOUT
+ ****************************************************************/
+
+static bool	build_dsf_objects(
+			void *					writer,
+			bool					inSharesMeshWriter,
+			const DSFCallbacks_t&	cbs,
+			const DEMGeo&			inElevation,
+			Pmwx&					inVectorMap,
+			DSFBuildStats_t&		ioStats,
+			ProgressFunc			inProgress)
+{
+	int										cur_id;
+	double									coords2[2];
+	Pmwx::Face_iterator						pf;
+	GISObjPlacementVector::iterator			pointObj;
+	GISPolyObjPlacementVector::iterator		polyObj;
+	Polygon2::iterator						polyPt;
+	vector<Polygon2>::iterator				polyHole;
+	map<int, int>::iterator 				obdef;
+	map<int, int, ObjPrio>::iterator		obdef_prio;
+
+	map<int, int>				objects_reversed;
+	map<int, int>	facades,	facades_reversed;
+	map<int, int, ObjPrio>		objects;
+
+	if (inProgress && inProgress(2, 5, "Compiling Objects", 0.0)) return false;
 
 	// First go through and accumulate our object and facade types.
 	// We need this in advance so we can figure out the DSF-relative
@@ -1671,15 +1689,14 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 			lowest_required = min(lowest_required, cur_id);
 	}
 
-	if(writer2)
 	if (lowest_required != objects.size())
 	{
 		char buf[256];
 		sprintf(buf,"1/%d", lowest_required);
-		cbs.AcceptProperty_f("sim/require_object", buf, writer2);
+		cbs.AcceptProperty_f("sim/require_object", buf, writer);
 	}
 
-	cur_id = (writer2 == writer1 ? 1 : 0);
+	cur_id = inSharesMeshWriter ? 1 : 0;			// Polygon def 0 of a shared writer is the beaches.
 	for (obdef = facades.begin(); obdef != facades.end(); ++obdef, ++cur_id)
 	{
 		obdef->second = cur_id;
@@ -1690,7 +1707,6 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 	// sorting them - the DSF lib is good about cleaning up the object
 	// data you give it.
 
-	if(writer2)
 	for (pf = inVectorMap.faces_begin(); pf != inVectorMap.faces_end(); ++pf)
 	if (!pf->is_unbounded())
 	{
@@ -1702,8 +1718,8 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 				objects[pointObj->mRepType],
 				coords2,
 				(pointObj->mHeading < 0.0) ? (pointObj->mHeading + 360.0) : pointObj->mHeading,
-				writer2);
-			++total_objs;
+				writer);
+			++ioStats.total_objs;
 		}
 
 		for (polyObj = pf->data().mPolyObjs.begin(); polyObj != pf->data().mPolyObjs.end(); ++polyObj)
@@ -1730,37 +1746,35 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 			cbs.BeginPolygon_f(
 						facades[polyObj->mRepType],
 						polyObj->mParam, 2,
-						writer2);
+						writer);
 			// boundary
 
 			for (polyHole = polyObj->mShape.begin(); polyHole != polyObj->mShape.end(); ++ polyHole)
 			{
-				cbs.BeginPolygonWinding_f(writer2);
+				cbs.BeginPolygonWinding_f(writer);
 				for (polyPt = polyHole->begin(); polyPt != polyHole->end(); ++polyPt)
 				{
 					coords2[0] = polyPt->x();
 					coords2[1] = polyPt->y();
-					cbs.AddPolygonPoint_f(coords2, writer2);
+					cbs.AddPolygonPoint_f(coords2, writer);
 				}
-				cbs.EndPolygonWinding_f(writer2);
+				cbs.EndPolygonWinding_f(writer);
 			}
-			cbs.EndPolygon_f(writer2);
-			++total_polys;
+			cbs.EndPolygon_f(writer);
+			++ioStats.total_polys;
 		}
 	}
 
 	// Write out definition names too.
-	if(writer2)
 	for (obdef = objects_reversed.begin(); obdef != objects_reversed.end(); ++obdef)
 	{
 		Assert(obdef->second != NO_VALUE);
 		Assert(obdef->second != DEM_NO_DATA);
 		string objName = gObjLibPrefix + FetchTokenString(obdef->second);
 		objName += ".obj";
-		cbs.AcceptObjectDef_f(objName.c_str(), writer2);
+		cbs.AcceptObjectDef_f(objName.c_str(), writer);
 	}
 
-	if(writer2)
 	for (obdef = facades_reversed.begin(); obdef != facades_reversed.end(); ++obdef)
 	{
 		Assert(obdef->second != NO_VALUE);
@@ -1775,24 +1789,45 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 			} else
 				facName = gObjLibPrefix + facName + ".fac";
 		}
-		cbs.AcceptPolygonDef_f(facName.c_str(), writer2);
+		cbs.AcceptPolygonDef_f(facName.c_str(), writer);
 	}
 
-	if (inProgress && inProgress(2, 5, "Compiling Objects", 1.0)) return;
+	if (inProgress && inProgress(2, 5, "Compiling Objects", 1.0)) return false;
+	ioStats.num_objdefs = objects.size();
+	ioStats.num_polydefs = facades.size();
+	return true;
+}
 
-	/****************************************************************
-	 * VECTOR EXPORT
-	 ****************************************************************/
+/****************************************************************
+ * VECTOR EXPORT
+ ****************************************************************/
+
+static bool	build_dsf_networks(
+			void *					writer,
+			const DSFCallbacks_t&	cbs,
+			const DEMGeo&			inElevation,
+			CDT&					inHiresMesh,
+			Pmwx&					inVectorMap,
+			rf_region				inRegion,
+			DSFBuildStats_t&		ioStats,
+			ProgressFunc			inProgress)
+{
+	int								cur_id;
+	double							coords3[3];
+	double							coords4[4];
+	Net_JunctionInfoSet				junctions;
+	Net_ChainInfoSet				chains;
+	Net_JunctionInfoSet::iterator 	ji;
+	Net_ChainInfoSet::iterator 		ci;
 
 	static int vec_export_hint_id = CDT::gen_cache_key();
 
-	if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.0)) return;
+	if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.0)) return false;
 
-	if(writer2)
 	if (gDSFBuildPrefs.export_roads)
 	{
 
-		if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.3)) return;
+		if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.3)) return false;
 
 		{
 			TIMER(BuildNetworkTopology)
@@ -1807,7 +1842,7 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 
 //		{
 //			TIMER(DrapeRoads)
-//			if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.6)) return;
+//			if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.6)) return false;
 //			DrapeRoads(junctions, chains, inHiresMesh, false);
 //			DrapeRoads(junctions, chains, inHiresMesh, true);
 //		}
@@ -1850,7 +1885,7 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 //			TIMER(SpacePowerlines)
 //			SpacePowerlines(junctions, chains, 1000.0, 10.0);
 //		}
-		if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.7)) return;
+		if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.7)) return false;
 
 		{
 			int orig_shape_count = 0;
@@ -1883,8 +1918,8 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 								(*ci)->export_type,
 								coords4,
 								false,
-								writer2);
-				++total_chains;
+								writer);
+				++ioStats.total_chains;
 				//debug_mesh_point(Point2(coords3[0],coords3[1]),1,0,0);
 
 
@@ -1969,8 +2004,8 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 					}
 					checker.check(coords3,'S');
 					//printf("Shp: %lf, %lf, %lf\n", coords3[0],coords3[1],coords3[2]);
-					cbs.AddSegmentShapePoint_f(coords3, false, writer2);
-					++total_shapes;
+					cbs.AddSegmentShapePoint_f(coords3, false, writer);
+					++ioStats.total_shapes;
 					//debug_mesh_point(Point2(coords3[0],coords3[1]),1,1,coords3[2]);
 				}
 
@@ -1987,65 +2022,157 @@ set<int>					sLoResLU[PATCH_DIM_LO * PATCH_DIM_LO];
 				cbs.EndSegment_f(
 						coords4,
 						false,
-						writer2);
+						writer);
 				//debug_mesh_point(Point2(coords3[0],coords3[1]),0,1,0);
 			}
-			if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.9)) return;
+			if (inProgress && inProgress(3, 5, "Compiling Vectors", 0.9)) return false;
 
 			CleanupNetworkTopology(junctions, chains);
-			if (inProgress && inProgress(3, 5, "Compiling Vectors", 1.0)) return;
+			if (inProgress && inProgress(3, 5, "Compiling Vectors", 1.0)) return false;
 			if(inRegion == rf_eu)
-				cbs.AcceptNetworkDef_f("lib/g10/roads_EU.net", writer2);
+				cbs.AcceptNetworkDef_f("lib/g10/roads_EU.net", writer);
 			else
-				cbs.AcceptNetworkDef_f("lib/g10/roads.net", writer2);			
+				cbs.AcceptNetworkDef_f("lib/g10/roads.net", writer);			
 
 			printf("Shape points: %d to %d.\n", orig_shape_count, reduced_shape_count);
 		}
 	}
+	return true;
+}
+
+/****************************************************************
+ * MANIFEST
+ ****************************************************************/
+
+static void	build_dsf_manifest(void * writer, bool is_overlay, const DSFCallbacks_t& cbs, const DEMGeo& inElevation)
+{
+	char	prop_buf[256];
+	sprintf(prop_buf, "%d", (int) inElevation.mWest);			cbs.AcceptProperty_f("sim/west", prop_buf, writer);
+	sprintf(prop_buf, "%d", (int) inElevation.mEast);			cbs.AcceptProperty_f("sim/east", prop_buf, writer);
+	sprintf(prop_buf, "%d", (int) inElevation.mNorth);		cbs.AcceptProperty_f("sim/north", prop_buf, writer);
+	sprintf(prop_buf, "%d", (int) inElevation.mSouth);		cbs.AcceptProperty_f("sim/south", prop_buf, writer);
+	cbs.AcceptProperty_f("sim/planet", "earth", writer);
+	cbs.AcceptProperty_f("sim/creation_agent", "X-Plane Scenery Creator 0.9a", writer);
+	cbs.AcceptProperty_f("laminar/internal_revision", "1", writer);
+	if (is_overlay)
+		cbs.AcceptProperty_f("sim/overlay", "1", writer);
+}
+
+void	BuildDSF(
+			const char *	inFileName1,
+			const char *	inFileName2,
+			const DEMGeo&	inElevation,
+			const DEMGeo&	inBathymetry,
+			const DEMGeo&	inUrbanDensity,
+//			const DEMGeo&	inVegeDem,
+			CDT&			inHiresMesh,
+//			CDT&			inLoresMesh,
+			Pmwx&			inVectorMap,
+			rf_region		inRegion,
+			ProgressFunc	inProgress)
+{
+		CDT::Finite_vertices_iterator	vert;
+		void *			writer1, * writer2;
+		DSFCallbacks_t	cbs;
+		DSFBuildStats_t	stats = { 0 };
+		deferred_pool	must_dealloc;
+		unsigned long long	start_time = query_hpc();
 
 	/****************************************************************
-	 * MANIFEST
+	 * SETUP
 	 ****************************************************************/
 
-	if(writer1)
+	double hmin = 9.9e9, hmax = -9.9e9;
+	for(vert = inHiresMesh.finite_vertices_begin(); vert != inHiresMesh.finite_vertices_end(); ++vert)
 	{
-		sprintf(prop_buf, "%d", (int) inElevation.mWest);			cbs.AcceptProperty_f("sim/west", prop_buf, writer1);
-		sprintf(prop_buf, "%d", (int) inElevation.mEast);			cbs.AcceptProperty_f("sim/east", prop_buf, writer1);
-		sprintf(prop_buf, "%d", (int) inElevation.mNorth);		cbs.AcceptProperty_f("sim/north", prop_buf, writer1);
-		sprintf(prop_buf, "%d", (int) inElevation.mSouth);		cbs.AcceptProperty_f("sim/south", prop_buf, writer1);
-		cbs.AcceptProperty_f("sim/planet", "earth", writer1);
-		cbs.AcceptProperty_f("sim/creation_agent", "X-Plane Scenery Creator 0.9a", writer1);
-		cbs.AcceptProperty_f("laminar/internal_revision", "1", writer1);
+		hmin = min(hmin, vert->info().height);
+		hmax = max(hmax, vert->info().height);
 	}
+	int emin = floor(hmin);
+	int emax = ceil(hmax);
+	int erange = emax - emin;
+	int erange2 = 1;
+	while(erange2 <= erange) erange2 *= 2;
+	erange2--;
+	int extra = erange2 - erange;
+	int use_min = emin - extra/2;
+	int use_max = use_min + erange2;
+	printf("Real span: %lf to %lf.  Using: %d to %d\n", hmin, hmax, use_min, use_max);
+	// Andrew: change divisions to 16
+	writer1 = inFileName1 ? DSFCreateWriter(inElevation.mWest, inElevation.mSouth, inElevation.mEast, inElevation.mNorth, -32768, 32767, DSF_DIVISIONS) : NULL;
+	writer2 = inFileName2 ? ((inFileName1 && strcmp(inFileName1,inFileName2)==0) ? writer1 : DSFCreateWriter(inElevation.mWest, inElevation.mSouth, inElevation.mEast, inElevation.mNorth,use_min, use_max, DSF_DIVISIONS)) : NULL;
+	StNukeWriter	dontLeakWriter1(writer1);
+	StNukeWriter	dontLeakWriter2(writer2==writer1 ? NULL : writer2);
+ 	DSFGetWriterCallbacks(&cbs);
+	stats.stage_secs[dsf_stage_Setup] = hpc_to_microseconds(query_hpc() - start_time) / 1000000.0;
 
-	if (writer2 && writer2 != writer1)
+	/****************************************************************
+	 * MESH AND OVERLAY
+	 ****************************************************************/
+
+	if (writer1)
 	{
-		sprintf(prop_buf, "%d", (int) inElevation.mWest);			cbs.AcceptProperty_f("sim/west", prop_buf, writer2);
-		sprintf(prop_buf, "%d", (int) inElevation.mEast);			cbs.AcceptProperty_f("sim/east", prop_buf, writer2);
-		sprintf(prop_buf, "%d", (int) inElevation.mNorth);		cbs.AcceptProperty_f("sim/north", prop_buf, writer2);
-		sprintf(prop_buf, "%d", (int) inElevation.mSouth);		cbs.AcceptProperty_f("sim/south", prop_buf, writer2);
-		cbs.AcceptProperty_f("sim/planet", "earth", writer2);
-		cbs.AcceptProperty_f("sim/creation_agent", "X-Plane Scenery Creator 0.9a", writer2);
-		cbs.AcceptProperty_f("laminar/internal_revision", "1", writer2);
-		cbs.AcceptProperty_f("sim/overlay", "1", writer2);
+		{
+			StStageTime	t(stats.stage_secs[dsf_stage_Mesh]);
+			if (!build_dsf_mesh(writer1, cbs, inElevation, inBathymetry, inHiresMesh, must_dealloc, stats, inProgress))
+				return;
+		}
+#if !PHONE
+		StStageTime	t(stats.stage_secs[dsf_stage_Beaches]);
+		build_dsf_beaches(writer1, cbs, inElevation, inHiresMesh);
+#endif
+	}
+	if (writer2)
+	{
+		{
+			StStageTime	t(stats.stage_secs[dsf_stage_Objects]);
+			if (!build_dsf_objects(writer2, writer2 == writer1, cbs, inElevation, inVectorMap, stats, inProgress))
+				return;
+		}
+		StStageTime	t(stats.stage_secs[dsf_stage_Networks]);
+		if (!build_dsf_networks(writer2, cbs, inElevation, inHiresMesh, inVectorMap, inRegion, stats, inProgress))
+			return;
 	}
 
+	/****************************************************************
+	 * MANIFEST
+	 ****************************************************************/
+
+	if (writer1)
+		build_dsf_manifest(writer1, false, cbs, inElevation);
+	if (writer2 && writer2 != writer1)
+		build_dsf_manifest(writer2, true, cbs, inElevation);
+
 	/****************************************************************
 	 * WRITEOUT
 	 ****************************************************************/
 	if (inProgress && inProgress(4, 5, "Writing DSF file", 0.0)) return;
-	if (writer1) DSFWriteToFile(inFileName1, writer1);
-	if (inProgress && inProgress(4, 5, "Writing DSF file", 0.5)) return;
-																																																																																												if (writer2 && writer2 != writer1) DSFWriteToFile(inFileName2, writer2);
+	{
+		// Each DSF writer only works on its own data, so two files can always be written side by side.
+		// A writer that throws keeps its exception until both are done, then the base mesh's goes first.
+		StStageTime		t(stats.stage_secs[dsf_stage_Write]);
+		void *			writers[2] = { writer1, (writer2 == writer1) ? NULL : writer2 };
+		const char *	paths[2] = { inFileName1, inFileName2 };
+		exception_ptr	errors[2];
+		parallel_for(0, 2, [&](int n) {
+			try {
+				if (writers[n]) DSFWriteToFile(paths[n], writers[n]);
+			} catch (...) {
+				errors[n] = current_exception();
+			}
+		}, (writers[0] && writers[1]) ? 2 : 1);
+		for (int n = 0; n < 2; ++n)
+		if (errors[n])
+			rethrow_exception(errors[n]);
+	}
 	if (inProgress && inProgress(4, 5, "Writing DSF file", 1.0)) return;
 
 //	printf("Patches: %d, Free Tris: %d, Tri Fans: %d, Tris in Fans: %d, Border Tris: %d, Avg Per Patch: %f, avg per fan: %f\n",
-//		total_patches, total_tris, total_tri_fans, total_tri_fan_pts, border_tris,
-//		(float) (total_tri_fan_pts + total_tris) / (float) total_patches,
-//		(total_tri_fans == 0) ? 0.0 : ((float) (total_tri_fan_pts) / (float) total_tri_fans));
-	printf("Objects: %d, Polys: %d\n", total_objs, total_polys);
-	printf("LU: %llu, Objdef: %llu, PolyDef: %llu\n", (unsigned long long)landuses.size(), (unsigned long long)objects.size(), (unsigned long long)facades.size());
-	printf("Chains: %d, Shapes: %d\n", total_chains, total_shapes);
-//	printf("Submitted to tri fan builder: %d.  Removed from builder: %d.\n", debug_add_tri_fan, debug_sub_tri_fan);
-
+//		stats.total_patches, stats.total_tris, stats.total_tri_fans, total_tri_fan_pts, stats.border_tris,
+//		(float) (total_tri_fan_pts + stats.total_tris) / (float) stats.total_patches,
+//		(stats.total_tri_fans == 0) ? 0.0 : ((float) (total_tri_fan_pts) / (float) stats.total_tri_fans));
+	printf("Objects: %d, Polys: %d\n", stats.total_objs, stats.total_polys);
+	printf("LU: %d, Objdef: %d, PolyDef: %d\n", stats.num_landuses, stats.num_objdefs, stats.num_polydefs);
+	printf("Chains: %d, Shapes: %d\n", stats.total_chains, stats.total_shapes);
+	print_stage_times(stats, hpc_to_microseconds(query_hpc() - start_time) / 1000000.0);
 }
@@ -39,6 +39,7 @@
 #include "DEMToVector.h"
 #include "CompGeomUtils.h"
 #include "PlatformUtils.h"
+#include "DEMFlow.h"
 
 inline Halfedge_handle	dominant(Halfedge_handle e) { return e->data().mDominant ? e : e->twin(); }
 
@@ -62,9 +63,6 @@ inline Halfedge_handle	dominant(Halfedge_handle e) { return e->data().mDominant
 // Number of DEM squares to look through to find river exit.
 #define DEM_EXIT_SEARCH_RANGE 10
 
-// Use 4-way flow instead of 8-way
-#define DIRS_FOUR 0
-
 // How far do we look around to see if this is hilly terrain?  Use this to tell VMAP to chill out
 #define VMAP_RELIEF_RANGE 3
 // If our steepness is beyond this, shouldn't be using VMAP!
@@ -76,15 +74,10 @@ inline Halfedge_handle	dominant(Halfedge_handle e) { return e->data().mDominant
 // If less than this is wet by SRTM - hrm - maybe VMAP is on to something?
 #define SRTM_TRUSTED_WETNESS 0.05
 
-#if DIRS_FOUR
-#define	DIRS_COUNT 4
-static int dirs_x[DIRS_COUNT] = { 0, 1, 0, -1 };
-static int dirs_y[DIRS_COUNT] = { 1, 0, -1, 0 };
-#else
+// Drainage directions as DEMFlow writes them - drain_Dir0 is north, then clockwise.
 #define DIRS_COUNT 8
 static int dirs_x[DIRS_COUNT] = { 0, 1, 1, 1, 0, -1, -1, -1 };
 static int dirs_y[DIRS_COUNT] = { 1, 1, 0, -1, -1, -1, 0, 1 };
-#endif
 
 
 /******************************************************************************************************************************
@@ -131,89 +124,13 @@ struct hash<DemPt>
 HASH_MAP_NAMESPACE_END
 #endif
 
-typedef set<DemPt>				DemPtSet;
-typedef multimap<float, DemPt>	DemPtMap;
 typedef vector<DemPt>			DemPtVector;
 
 
-inline void GetNeighbors(const DemPtSet& pts, DemPtSet& neighbors, DemPtMap& borderMap, int width, int height, const DEMGeo& elev)
-{
-	neighbors.clear();
-	for (DemPtSet::const_iterator p = pts.begin(); p != pts.end(); ++p)
-	{
-		for (int n = 0; n < DIRS_COUNT; ++n)
-		{
-			DemPt np;
-			np.x = p->x + dirs_x[n];
-			np.y = p->y + dirs_y[n];
-			if (np.x >= 0 && np.y >= 0 && np.x < width && np.y < height)
-			if (pts.count(np) == 0)
-			{
-				neighbors.insert(np);
-				float e = elev.get(np.x, np.y);
-				borderMap.insert(DemPtMap::value_type(e, np));
-
-			}
-		}
-	}
-}
-
-inline void AddPtToSet(DemPtSet& area, DemPtSet& border, DemPtMap& borderMap, const DemPtMap::iterator it, int width, int height, const DEMGeo& elev)
-{
-	DemPt	p = it->second;
-	DebugAssert(border.count(p) == 1);
-
-	area.insert(p);
-	border.erase(p);
-	borderMap.erase(it);
-	for (int n = 0; n < DIRS_COUNT; ++n)
-	{
-		DemPt np;
-		np.x = p.x + dirs_x[n];
-		np.y = p.y + dirs_y[n];
-		if (np.x >= 0 && np.y >= 0 && np.x < width && np.y < height)
-		if (area.count(np) == 0)
-		if (border.count(np) == 0)
-		{
-			float e=  elev.get(np.x, np.y);
-			border.insert(np);
-			borderMap.insert(DemPtMap::value_type(e, np));
-		}
-	}
-}
-
 /******************************************************************************************************************************
  * RIVER DETECTION
  ******************************************************************************************************************************/
 
-inline int	GetFlowDir(float e[DIRS_COUNT+1])
-{
-	float dif[DIRS_COUNT];
-	int n;
-	for (n = 0; n < DIRS_COUNT; ++n)
-	{
-		dif[n] = e[DIRS_COUNT] - e[n];
-		if (e[n] == DEM_NO_DATA) dif[n] = DEM_NO_DATA;
-	}
-
-	float best = dif[0];
-	int dir = drain_Dir0;
-	for (n = 1; n < DIRS_COUNT; ++n)
-		if (dif[n] > best) dir = drain_Dir0 + n, best = dif[n];
-	if (best <= 0.0) dir = sink_Unresolved;
-	return dir;
-}
-
-inline bool GetNext(int& x, int& y, const DEMGeo& dem)
-{
-	int code = dem(x,y);
-	if (code < drain_Dir0) return false;
-	DebugAssert(code < (drain_Dir0+DIRS_COUNT));
-	x += dirs_x[code - drain_Dir0];
-	y += dirs_y[code - drain_Dir0];
-	return true;
-}
-
 inline float LowestInRange(const DEMGeo& inDEM, int x1, int y1, int x2, int y2, int& outX, int& outY)
 {
 	float e = DEM_NO_DATA;
@@ -277,96 +194,6 @@ static void BurnLowestNearDrainPt(const DEMGeo& elev, DEMGeo& hydro_dir, double
 
 }
 
-int FixSink(int x, int y, DEMGeo& elev, DEMGeo& hydro_dir)
-{
-	DemPt		orig; orig.x = x; orig.y = y;
-	DemPtSet	sink; sink.insert(orig);
-	float		low_elev;
-	DemPt		drainPt;
-	float		orig_elev = elev(x,y);
-	int			hosed_fill = sink_Invalid;
-	int			ctr = 0;
-	DemPtSet	last_border(sink);
-	DemPtMap	border_elev;
-	GetNeighbors(sink, last_border, border_elev, elev.mWidth, elev.mHeight, elev);
-	while (1)
-	{
-		if (last_border.empty())
-			goto hosed;
-		DebugAssert(!border_elev.empty());
-
-		DemPtMap::iterator i = border_elev.begin();
-		low_elev = i->first;
-
-		++ctr;
-		if (low_elev < elev(x,y) || hydro_dir(i->second.x, i->second.y) == sink_Known)
-		{
-			drainPt = i->second;
-#if DEV
-			DemPt foo(drainPt);
-			if (GetNext(foo.x, foo.y, hydro_dir))
-				DebugAssert(sink.count(foo) == 0);
-#endif
-			goto found;
-		}
-
-		hydro_dir(i->second.x, i->second.y) = sink_Unresolved;
-		AddPtToSet(sink, last_border, border_elev, i, elev.mWidth, elev.mHeight, elev);
-
-		elev(x, y) = low_elev;
-
-		DebugAssert(low_elev >= orig_elev);
-		if ((low_elev - orig_elev) > MAX_FLOOD)
-			goto hosed;
-		if (sink.size() > MAX_AREA)
-		{
-			// BEN SEZ:: at this point our lakes are so @#$@#ing huge we probably do NOT want to fill them in -
-			// if there was a lake there, it'd be on VMAP0.
-			hosed_fill = sink_Invalid;	// sink_Lake;
-			goto hosed;
-		}
-	}
-hosed:
-
-	for (DemPtSet::iterator j = sink.begin(); j != sink.end(); ++j)
-		elev(j->x, j->y) = low_elev;
-
-	for (DemPtSet::iterator j = sink.begin(); j != sink.end(); ++j)
-		hydro_dir(j->x, j->y) = hosed_fill;
-	return ctr;
-
-found:
-
-	for (DemPtSet::iterator j = sink.begin(); j != sink.end(); ++j)
-		elev(j->x, j->y) = low_elev;
-
-	DemPtSet	ok, working;
-	working.insert(drainPt);
-
-	while (!working.empty())
-	{
-		DemPt tr = *working.begin();
-		working.erase(working.begin());
-		ok.insert(tr);
-
-		for (int n = 0; n < DIRS_COUNT; ++n)
-		{
-			DemPt	tr_n(tr);
-			tr_n.x -= dirs_x[n];
-			tr_n.y -= dirs_y[n];
-			if (sink.count(tr_n) > 0)
-			{
-				hydro_dir(tr_n.x, tr_n.y) = n+drain_Dir0;
-				sink.erase(tr_n);
-				if (ok.count(tr_n) == 0)
-					working.insert(tr_n);
-			}
-		}
-	}
-	DebugAssert(sink.empty());
-	return ctr;
-}
-
 inline float MinSlopeNear(const DEMGeo& dem, int x, int y)
 {
 	float e = dem.get(x,y);
@@ -379,35 +206,6 @@ inline float MinSlopeNear(const DEMGeo& dem, int x, int y)
 	return e;
 }
 
-inline int HydroFlowToPt(int x, int y, DEMGeo * elev, DEMGeo * dirs, DEMGeo * flows, DEMGeo * slope, int * ctr)
-{
-	(*ctr)++;
-	float sum = 1.0;
-	float slp = DEM_NO_DATA;
-	float me_elev = elev->get(x,y);
-	for (int n = 0; n < DIRS_COUNT; ++n)
-	{
-		if (dirs->get(x-dirs_x[n],y-dirs_y[n]) == (n+drain_Dir0))
-		{
-			sum += HydroFlowToPt(x-dirs_x[n],y-dirs_y[n], elev, dirs, flows, slope, ctr);
-			if (me_elev != DEM_NO_DATA)
-			{
-				float other_elev = elev->get(x-dirs_x[n],y-dirs_y[n]);
-				if (other_elev != DEM_NO_DATA)
-				{
-					float grad = other_elev - me_elev;
-					if (grad >= 0.0)
-						slp = MIN_NODATA(grad, slp);
-				}
-			}
-		}
-	}
-	(*flows)(x,y) = sum;
-	if (slp == DEM_NO_DATA) slp = 0.0;
-	(*slope)(x,y) = slp;
-	return sum;
-}
-
 static void BurnRiver(DEMGeo& dem, const Point2& p1, const Point2& p2, float v)
 {
 	double	x1 = dem.lon_to_x(p1.x());
@@ -541,7 +339,7 @@ void	BuildRiverPolygon(int x, int y, const DEMGeo& hydro_dir, const DEMGeo& hydr
 void	BuildRivers(const Pmwx& inMap, DEMGeoMap& ioDEMs, int borders[4], ProgressFunc inProg)
 {
 	if (inProg) inProg(0, 4, "Preparing elevation maps", 0.0);
-	int x, y, n, max_hydro;
+	int x, y;
 
 #if 0
 	gMeshPoints.clear();
@@ -614,57 +412,14 @@ void	BuildRivers(const Pmwx& inMap, DEMGeoMap& ioDEMs, int borders[4], ProgressF
 		}
 	}
 
-	max_hydro = elev.mWidth * elev.mHeight;
-	float e[DIRS_COUNT+1];
+	// Every pit gets filled and drained out to known water, unless it floods deeper than MAX_FLOOD or wider than MAX_AREA -
+	// at that point our lakes are so huge we probably do NOT want to fill them in; if there was a lake there, it'd be on VMAP0.
 	if (inProg) inProg(1, 4, "Calculating drainage...", 0.0);
-	for (x = 0; x < hydro_dir.mWidth; ++x)
-	{
-		if (inProg && (x % 20) == 0) inProg(1, 4, "Calculating drainage...", (float) x / (float) hydro_dir.mWidth);
-
-		for (y = 0; y < hydro_dir.mHeight; ++y)
-		{
-			if (hydro_dir(x,y) == sink_Known || hydro_dir(x,y) == sink_Invalid)
-				continue;
-			for (n = 0; n < DIRS_COUNT; ++n)
-				e[n] = elev.get(x+dirs_x[n], y + dirs_y[n]);
-			e[DIRS_COUNT] = elev.get(x  ,y  );
-			hydro_dir(x,y) = GetFlowDir(e);
-		}
-	}
+	DEMFlowDirections(elev, hydro_dir, MAX_FLOOD, MAX_AREA);
 	if (inProg) inProg(1, 4, "Calculating drainage...", 1.0);
 
-
-	if (inProg) inProg(2, 4, "Removing sinks...", 0.0);
-	int total_sink_pts = 0;
-//	map<int, int>	histo;
-	for (x = 0; x < hydro_dir.mWidth; ++x)
-	{
-		if (inProg && (x % 20) == 0) inProg(2, 4, "Removing sinks...", (float) x / (float) hydro_dir.mWidth);
-		for (y = 0; y < hydro_dir.mHeight; ++y)
-		{
-			if (hydro_dir(x,y) == sink_Unresolved)
-			{
-				int worked = FixSink(x, y, elev, hydro_dir);
-				total_sink_pts += worked;
-				worked -= (worked % 100);
-//				histo[worked]++;
-			}
-		}
-	}
-//	printf("HISTO:\n");
-//	for (map<int, int>::iterator i = histo.begin(); i != histo.end(); ++i)
-//		printf("%10d %10d\n", i->first, i->second);
-	if (inProg) inProg(2, 4, "Removing sinks...", 1.0);
-
 	if (inProg) inProg(3, 4, "Calculating Flow...", 0.0);
-	int ctr = 0;
-	for (y = 0; y < hydro_dir.mHeight; ++y)
-	{
-		if (inProg && (y % 20) == 0) inProg(3, 4, "Calculating Flow...", (float) y / (float) hydro_dir.mHeight);
-		for (x = 0; x < hydro_dir.mWidth; ++x)
-		if (hydro_dir(x,y) < drain_Dir0)
-			HydroFlowToPt(x, y, &elev, &hydro_dir, &hydro_flw, &hydro_slp, &ctr);
-	}
+	DEMFlowAccumulate(elev, hydro_dir, hydro_flw, hydro_slp);
 
 	for (y = 0; y < hydro_dir.mHeight; ++y)
 	for (x = 0; x < hydro_dir.mWidth; ++x)
@@ -716,7 +471,6 @@ void	BuildRivers(const Pmwx& inMap, DEMGeoMap& ioDEMs, int borders[4], ProgressF
 	ioDEMs[dem_HydroDirection].swap(hydro_dir);
 	ioDEMs[dem_HydroQuantity].swap(hydro_flw);
 
-	printf("Total sink points: %d\n", total_sink_pts);
 }
 
 #pragma mark -
@@ -173,22 +173,10 @@ void add_missing_water(
 	PolyRasterizer<double> raster;
 	SetupWaterRasterizer(io_map, existing_water, raster, terrain_Water);
 
-	int x, y = 0;
-	raster.StartScanline(y);
-	while (!raster.DoneScan())
-	{
-		int x1, x2;
-		while (raster.GetRange(x1, x2))
-		{
-			for (x = x1; x < x2; ++x)
-			{
-				existing_water(x,y) = 1;
-			}
-		}
-		++y;
-		if (y >= existing_water.mHeight) break;
-		raster.AdvanceScanline(y);
-	}
+	PolyRasterFill(raster, existing_water.mWidth, existing_water.mHeight, [&](int y, int x1, int x2) {
+		float * row = existing_water.mData + (size_t) y * existing_water.mWidth;
+		std::fill(row + x1, row + x2, 1.0f);
+	});
 
 	dem_erode(existing_water, 2, 1);
 	
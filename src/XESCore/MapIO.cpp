@@ -33,7 +33,9 @@
 // Ratio of operations to an update of the progress bar.
 #define	PROGRESS_RATIO	5000
 
-const int kMainMapID = 'MAP2';
+const int kMainMapID = 'MAP2';		// Old format - every coordinate is written as its exact limbs.
+const int kMainMap3ID = 'MAP3';		// Current format - coordinates are doubles, the rare inexact ones go into kExactCoordsID.
+const int kExactCoordsID = 'MPX3';
 
 template <class	T, class F>
 void WriteVector(IOWriter& writer, const T& v, F func)
@@ -323,6 +325,42 @@ void ReadPoint(IOReader& inReader, Point_2& p)
 	p = Point_2(x,y);
 }
 
+// MAP3 coordinates: a little-endian double if the coordinate is exactly a double, otherwise a quiet NaN
+// whose payload is 1 + the coordinate's index in the exact table.  Map coordinates are never NaN.
+#define	EXACT_TAG_MASK		0xFFF8000000000000ULL
+#define	EXACT_TAG			0x7FF8000000000000ULL
+
+static double	EncodeCoordinate(const NT& c, vector<NT> * exacts)
+{
+	double	d = CGAL::to_double(c);
+#if !USE_GMP
+	// There is no exact I/O for GMP numbers - such builds round to the nearest double, like the rest of the XES file.
+	if (exacts && c != NT(d))
+	{
+		exacts->push_back(c);
+		unsigned long long	bits = EXACT_TAG | (unsigned long long) exacts->size();
+		memcpy(&d, &bits, sizeof(d));
+	}
+#endif
+	EndianSwapBuffer(platform_Native, platform_LittleEndian, kSwapEight, &d);
+	return d;
+}
+
+static NT		DecodeCoordinate(double d, const vector<NT> * exacts)
+{
+	EndianSwapBuffer(platform_LittleEndian, platform_Native, kSwapEight, &d);
+	unsigned long long	bits;
+	memcpy(&bits, &d, sizeof(bits));
+	if ((bits & EXACT_TAG_MASK) == EXACT_TAG)
+	{
+		unsigned long long	idx = bits & ~EXACT_TAG_MASK;
+		if (exacts && idx > 0 && idx <= exacts->size())
+			return (*exacts)[idx-1];
+		throw "Bad exact coordinate index in map.";
+	}
+	return NT(d);
+}
+
 
 #pragma mark -
 
@@ -350,8 +388,30 @@ public:
 	IOReader *					reader;
 	IOWriter *					writer;
 	const TokenConversionMap * 	token_map;
-	PmwxFmt(IOReader * r, const TokenConversionMap * t) : reader(r), writer(NULL), token_map(t) { }
-	PmwxFmt(IOWriter * w) : reader(NULL), writer(w), token_map(NULL) { }
+	vector<NT> *				exacts;		// MAP3: inexact coordinates, referenced from the main stream.  NULL for MAP2.
+	PmwxFmt(IOReader * r, const TokenConversionMap * t, vector<NT> * e) : reader(r), writer(NULL), token_map(t), exacts(e) { }
+	PmwxFmt(IOWriter * w, vector<NT> * e) : reader(NULL), writer(w), token_map(NULL), exacts(e) { }
+
+	// MAP3 points and curves go out as one block of doubles each, so reading them back is one copy, not a
+	// virtual call per limb.
+	void write_points(const Point_2 * p, int n)
+	{
+		double	xy[4];
+		for (int i = 0; i < n; ++i)
+		{
+			xy[2*i  ] = EncodeCoordinate(p[i].x(), exacts);
+			xy[2*i+1] = EncodeCoordinate(p[i].y(), exacts);
+		}
+		writer->WriteBulk((const char *) xy, n * 2 * sizeof(double), false);
+	}
+
+	void read_points(Point_2 * p, int n)
+	{
+		double	xy[4];
+		reader->ReadBulk((char *) xy, n * 2 * sizeof(double), false);
+		for (int i = 0; i < n; ++i)
+			p[i] = Point_2(DecodeCoordinate(xy[2*i], exacts), DecodeCoordinate(xy[2*i+1], exacts));
+	}
 
 	void write_size (const char *label, Size size)
 	{
@@ -384,7 +444,7 @@ public:
 
 	virtual void write_point (const Point_2& p)
 	{
-		WritePoint(*writer, p);
+		write_points(&p, 1);
 	}
 
 	virtual void write_vertex_data (Vertex_const_handle  v)
@@ -401,11 +461,14 @@ public:
 
 	virtual void write_x_monotone_curve (const X_monotone_curve_2& cv)
 	{
-		WritePoint(*writer, cv.source());
-		WritePoint(*writer, cv.target());
-		writer->WriteInt(cv.data().size());
-		for(EdgeKey_container::const_iterator e = cv.data().begin(); e != cv.data().end(); ++e)
-			writer->WriteInt(*e);
+		Point_2	st[2] = { cv.source(), cv.target() };
+		write_points(st, 2);
+		vector<int>	keys(cv.data().begin(), cv.data().end());
+		writer->WriteInt(keys.size());
+		for(vector<int>::iterator k = keys.begin(); k != keys.end(); ++k)
+			EndianSwapBuffer(platform_Native, platform_LittleEndian, kSwapFour, &*k);
+		if(!keys.empty())
+			writer->WriteBulk((const char *) &keys[0], keys.size() * sizeof(int), false);
 	}
 
 	virtual void write_halfedge_data (Halfedge_const_handle e)
@@ -471,7 +534,10 @@ public:
 
 	virtual void read_point (Point_2& p) 
 	{
-		ReadPoint(*reader,p);
+		if (exacts)
+			read_points(&p, 1);
+		else
+			ReadPoint(*reader,p);
 	}
 
 	virtual void read_vertex_data (Vertex_handle v)
@@ -495,19 +561,37 @@ public:
 
 	virtual void read_x_monotone_curve (X_monotone_curve_2& cv) 
 	{
-		Point_2 s, t;
+		Point_2 st[2];
 		int n, v;
 		EdgeKey_container d;
-		ReadPoint(*reader,s);
-		ReadPoint(*reader,t);
-		reader->ReadInt(n);
-		while(n--)
+		if (exacts)
+		{
+			read_points(st, 2);
+			reader->ReadInt(n);
+			if(n > 0)
+			{
+				vector<int>	keys(n);
+				reader->ReadBulk((char *) &keys[0], n * sizeof(int), false);
+				for(vector<int>::iterator k = keys.begin(); k != keys.end(); ++k)
+				{
+					EndianSwapBuffer(platform_LittleEndian, platform_Native, kSwapFour, &*k);
+					d.insert(*k);
+				}
+			}
+		}
+		else
 		{
-			reader->ReadInt(v);
-			d.insert(v);
+			ReadPoint(*reader,st[0]);
+			ReadPoint(*reader,st[1]);
+			reader->ReadInt(n);
+			while(n--)
+			{
+				reader->ReadInt(v);
+				d.insert(v);
+			}
 		}
 	
-		cv = X_monotone_curve_2(Segment_2(s,t),d);
+		cv = X_monotone_curve_2(Segment_2(st[0],st[1]),d);
 	}	
 		
 	virtual void read_halfedge_data (Halfedge_handle e)
@@ -566,16 +650,24 @@ void	WriteMap(FILE * fi, const Pmwx& inMap, ProgressFunc inProgress, int atomID)
 	double	total = inMap.number_of_faces() + inMap.number_of_halfedges() + inMap.number_of_vertices();
 	int	ctr = 0;
 
+	vector<NT>	exacts;
 	{
-		StAtomWriter 	mainMap(fi, kMainMapID);
+		StAtomWriter 	mainMap(fi, kMainMap3ID);
 		FileWriter		writer(fi);
 
-		PmwxFmt	write_formatter(&writer);
+		PmwxFmt	write_formatter(&writer, &exacts);
 		
 		CGAL::Arrangement_2_writer<Pmwx>	arr_writer(inMap);
 		
 		arr_writer(write_formatter);
 	}
+	{
+		StAtomWriter 	exactCoords(fi, kExactCoordsID);
+		FileWriter		writer(fi);
+		writer.WriteInt(exacts.size());
+		for (vector<NT>::iterator e = exacts.begin(); e != exacts.end(); ++e)
+			WriteCoordinate(writer, *e);
+	}
 
 	if (inProgress) inProgress(0, 1, "Writing", 1.0);
 }
@@ -583,17 +675,33 @@ void	WriteMap(FILE * fi, const Pmwx& inMap, ProgressFunc inProgress, int atomID)
 
 void	ReadMap(XAtomContainer& container, Pmwx& inMap, ProgressFunc inProgress, int atomID, const TokenConversionMap& c)
 {
-	XAtom			meAtom, mapAtom, faceAtom, edgeAtom, vertAtom;
-	XAtomContainer	meContainer, mapContainer, faceContainer, edgeContainer, vertContainer;
+	XAtom			meAtom, mapAtom, exactAtom;
+	XAtomContainer	meContainer, mapContainer, exactContainer;
 
 	if (!container.GetNthAtomOfID(atomID, 0, meAtom)) return;
 	meAtom.GetContents(meContainer);
 
-	if (!meContainer.GetNthAtomOfID(kMainMapID, 0, mapAtom)) return;
+	vector<NT>		exacts;
+	bool			map3 = meContainer.GetNthAtomOfID(kMainMap3ID, 0, mapAtom);
+	if (map3)
+	{
+		if (meContainer.GetNthAtomOfID(kExactCoordsID, 0, exactAtom))
+		{
+			exactAtom.GetContents(exactContainer);
+			MemFileReader	readExacts(exactContainer.begin, exactContainer.end);
+			int count = 0;
+			readExacts.ReadInt(count);
+			exacts.resize(count);
+			for (vector<NT>::iterator e = exacts.begin(); e != exacts.end(); ++e)
+				ReadCoordinate(readExacts, *e);
+		}
+	}
+	else if (!meContainer.GetNthAtomOfID(kMainMapID, 0, mapAtom)) return;
+
 	mapAtom.GetContents(mapContainer);
 	MemFileReader	readMainMap(mapContainer.begin, mapContainer.end);
 	
-	PmwxFmt	read_formatter(&readMainMap, &c);
+	PmwxFmt	read_formatter(&readMainMap, &c, map3 ? &exacts : NULL);
 		
 	CGAL::Arrangement_2_reader<Pmwx>	arr_reader(inMap);
 		
@@ -50,6 +50,12 @@
 	  for each hole
 	     int number of half edges on each hole
 	     for each inner halfedge, write index
+
+	The arrangement itself is written by CGAL's Arrangement_2_writer into a 'MAP3' sub-atom.
+	Points and curve end points are stored as little-endian doubles, one block per point or curve.
+	A coordinate that is not exactly a double is stored as a quiet NaN that indexes the 'MPX3' sub-atom,
+	which holds those coordinates exactly (an int count, then the exact numbers).  Older files have a
+	'MAP2' sub-atom instead, where every coordinate is exact, and still load.
  */
 
  struct	XAtomContainer;
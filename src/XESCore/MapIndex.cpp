@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "MapIndex.h"
+#include <CGAL/Polygon_2_algorithms.h>
+
+// Once this many edits pile up - or 1/16th of the indexed items, if that is more - the next query re-indexes.
+#define REBUILD_MIN_CHANGES	256
+
+// An edge is two half-edges - we always file it under the same one.
+static Halfedge_handle	canonical(Halfedge_handle e)
+{
+	return (&*e < &*e->twin()) ? e : e->twin();
+}
+
+static Bbox2	face_bounds(Face_handle f)
+{
+	Pmwx::Ccb_halfedge_circulator circ, stop;
+	circ = stop = f->outer_ccb();
+	Bbox2	bbox(cgal2ben(circ->source()->point()));
+	do {
+		bbox += cgal2ben(circ->source()->point());
+	} while(++circ != stop);
+	return bbox;
+}
+
+static Bbox2	edge_bounds(Halfedge_handle e)
+{
+	return Bbox2(cgal2ben(e->source()->point()), cgal2ben(e->target()->point()));
+}
+
+// Where p is relative to one CCB, decided exactly by the kernel.
+static CGAL::Bounded_side	ccb_side(Pmwx::Ccb_halfedge_circulator circ, const Point_2& p)
+{
+	vector<Point_2>	pts;
+	Pmwx::Ccb_halfedge_circulator stop(circ);
+	do {
+		pts.push_back(circ->source()->point());
+	} while(++circ != stop);
+	return CGAL::bounded_side_2(pts.begin(), pts.end(), p, FastKernel());
+}
+
+/************************************************************************************************************************************************
+ * SETUP AND MAINTENANCE
+ ************************************************************************************************************************************************/
+
+MapIndex_t::MapIndex_t() : mMap(NULL), mStale(true), mIndexed(0)
+{
+}
+
+MapIndex_t::MapIndex_t(Pmwx& map) : base(map), mMap(&map), mStale(true), mIndexed(0)
+{
+	rebuild();
+}
+
+void	MapIndex_t::rebuild(void)
+{
+	mFreshFaces.clear();
+	mDeadFaces.clear();
+	mFreshEdges.clear();
+	mDeadEdges.clear();
+	mFaces.clear();
+	mEdges.clear();
+	mIndexed = 0;
+	mStale = false;
+	if(mMap == NULL)
+		return;
+
+	vector<FaceTree::item_type>	faces;
+	faces.reserve(mMap->number_of_faces());
+	for(Pmwx::Face_iterator f = mMap->faces_begin(); f != mMap->faces_end(); ++f)
+	if(!f->is_unbounded())
+		faces.push_back(FaceTree::item_type(face_bounds(f), f));
+	mFaces.insert(faces.begin(), faces.end());
+	mIndexed += faces.size();
+
+	vector<EdgeTree::item_type>	edges;
+	edges.reserve(mMap->number_of_edges());
+	for(Pmwx::Edge_iterator e = mMap->edges_begin(); e != mMap->edges_end(); ++e)
+		edges.push_back(EdgeTree::item_type(edge_bounds(e), canonical(e)));
+	mEdges.insert(edges.begin(), edges.end());
+	mIndexed += edges.size();
+}
+
+void	MapIndex_t::check_current(void)
+{
+	if(mStale)
+		rebuild();
+}
+
+// Once the side lists are too long to be worth scanning we stop keeping them - the map is re-indexed on the next
+// query anyway, so a long batch of edits (e.g. a whole processing pass) costs next to nothing.
+void	MapIndex_t::check_changes(void)
+{
+	int changes = mFreshFaces.size() + mDeadFaces.size() + mFreshEdges.size() + mDeadEdges.size();
+	if(changes > max(REBUILD_MIN_CHANGES, mIndexed / 16))
+	{
+		mStale = true;
+		mFreshFaces.clear();
+		mDeadFaces.clear();
+		mFreshEdges.clear();
+		mDeadEdges.clear();
+	}
+}
+
+void	MapIndex_t::touch_face(Face_handle f)
+{
+	if(mStale || f->is_unbounded()) return;
+	mDeadFaces.erase(f);
+	mFreshFaces.insert(f);
+	check_changes();
+}
+
+void	MapIndex_t::touch_edge(Halfedge_handle e)
+{
+	if(mStale) return;
+	e = canonical(e);
+	mDeadEdges.erase(e);
+	mFreshEdges.insert(e);
+	check_changes();
+}
+
+void	MapIndex_t::kill_face(Face_handle f)
+{
+	if(mStale) return;
+	mFreshFaces.erase(f);
+	mDeadFaces.insert(f);
+	check_changes();
+}
+
+void	MapIndex_t::kill_edge(Halfedge_handle e)
+{
+	if(mStale) return;
+	e = canonical(e);
+	mFreshEdges.erase(e);
+	mDeadEdges.insert(e);
+	check_changes();
+}
+
+void	MapIndex_t::after_attach(void)
+{
+	mMap = arrangement();
+	mStale = true;
+}
+
+void	MapIndex_t::after_detach(void)
+{
+	mMap = NULL;
+	mStale = true;
+}
+
+void	MapIndex_t::after_assign(void)			{ mStale = true; }
+void	MapIndex_t::after_clear(void)			{ mStale = true; }
+void	MapIndex_t::after_global_change(void)	{ mStale = true; }
+
+// A moved vertex drags its edges along, and with them the faces on both sides.
+void	MapIndex_t::after_modify_vertex(Vertex_handle v)
+{
+	if(mStale || v->is_isolated() || v->degree() == 0) return;
+	Pmwx::Halfedge_around_vertex_circulator circ, stop;
+	circ = stop = v->incident_halfedges();
+	do {
+		touch_edge(circ);
+		touch_face(circ->face());
+		touch_face(circ->twin()->face());
+	} while(++circ != stop);
+}
+
+void	MapIndex_t::after_create_edge(Halfedge_handle e)			{ touch_edge(e); }
+void	MapIndex_t::after_modify_edge(Halfedge_handle e)			{ touch_edge(e); }
+
+// e1 keeps its slot in the tree - its old box still covers it.
+void	MapIndex_t::after_split_edge(Halfedge_handle e1, Halfedge_handle e2)
+{
+	touch_edge(e2);
+}
+
+// We don't know which of the two CGAL keeps, so both die and the survivor comes back fresh.
+void	MapIndex_t::before_merge_edge(Halfedge_handle e1, Halfedge_handle e2, const X_monotone_curve_2& c)
+{
+	kill_edge(e1);
+	kill_edge(e2);
+}
+
+void	MapIndex_t::after_merge_edge(Halfedge_handle e)			{ touch_edge(e); }
+void	MapIndex_t::before_remove_edge(Halfedge_handle e)		{ kill_edge(e); }
+
+// f only shrinks, so its old box is still good.
+void	MapIndex_t::after_split_face(Face_handle f, Face_handle new_f, bool is_hole)
+{
+	touch_face(new_f);
+}
+
+void	MapIndex_t::before_merge_face(Face_handle f1, Face_handle f2, Halfedge_handle e)
+{
+	kill_face(f1);
+	kill_face(f2);
+}
+
+void	MapIndex_t::after_merge_face(Face_handle f)			{ touch_face(f); }
+
+void	MapIndex_t::after_split_outer_ccb(Face_handle f, Ccb_halfedge_circulator h1, Ccb_halfedge_circulator h2)
+{
+	touch_face(f);
+}
+
+void	MapIndex_t::after_merge_outer_ccb(Face_handle f, Ccb_halfedge_circulator h)
+{
+	touch_face(f);
+}
+
+/************************************************************************************************************************************************
+ * QUERIES
+ ************************************************************************************************************************************************/
+
+Face_handle	MapIndex_t::face_at_point(const Point_2& p)
+{
+	DebugAssert(mMap != NULL);
+	check_current();
+
+	Point2				pt(cgal2ben(p));
+	vector<Face_handle>	candidates;
+	faces_in_box(Bbox2(pt), candidates);
+
+	bool on_boundary = false;
+	for(vector<Face_handle>::iterator f = candidates.begin(); f != candidates.end(); ++f)
+	{
+		CGAL::Bounded_side side = ccb_side((*f)->outer_ccb(), p);
+		if(side == CGAL::ON_BOUNDARY)
+			on_boundary = true;
+		if(side != CGAL::ON_BOUNDED_SIDE)
+			continue;
+
+		// Inside the outer boundary - but a point in a hole belongs to whatever is in the hole.
+		bool in_hole = false;
+		for(Pmwx::Hole_iterator h = (*f)->holes_begin(); h != (*f)->holes_end(); ++h)
+		{
+			side = ccb_side(*h, p);
+			if(side == CGAL::ON_BOUNDARY)
+				on_boundary = true;
+			if(side != CGAL::ON_UNBOUNDED_SIDE)
+			{
+				in_hole = true;
+				break;
+			}
+		}
+		if(!in_hole)
+			return *f;
+	}
+	return on_boundary ? Face_handle() : mMap->unbounded_face();
+}
+
+void	MapIndex_t::faces_in_box(const Bbox2& box, vector<Face_handle>& out_faces)
+{
+	check_current();
+	out_faces.clear();
+
+	vector<Face_handle>	found;
+	mFaces.query_value(box, back_inserter(found));
+	for(vector<Face_handle>::iterator f = found.begin(); f != found.end(); ++f)
+	if(!skip_face(*f))
+		out_faces.push_back(*f);
+
+	for(set<Face_handle>::iterator f = mFreshFaces.begin(); f != mFreshFaces.end(); ++f)
+	if(box.overlap(face_bounds(*f)))
+		out_faces.push_back(*f);
+}
+
+void	MapIndex_t::edges_in_box(const Bbox2& box, vector<Halfedge_handle>& out_edges)
+{
+	check_current();
+	out_edges.clear();
+
+	vector<Halfedge_handle>	found;
+	mEdges.query_value(box, back_inserter(found));
+	for(vector<Halfedge_handle>::iterator e = found.begin(); e != found.end(); ++e)
+	if(!skip_edge(*e))
+		out_edges.push_back(*e);
+
+	for(set<Halfedge_handle>::iterator e = mFreshEdges.begin(); e != mFreshEdges.end(); ++e)
+	if(box.overlap(edge_bounds(*e)))
+		out_edges.push_back(*e);
+}
+
+// The closest box gives an upper bound on how far the closest edge can be; everything closer than that is
+// then in a box of that radius, and is measured for real.
+Halfedge_handle	MapIndex_t::nearest_edge(const Point2& p, double * out_dist)
+{
+	check_current();
+
+	double	bound = DBL_MAX;
+	const EdgeTree::item_type * seed = mEdges.query_nearest(p);
+	if(seed && !skip_edge(seed->second))
+		bound = Segment2(cgal2ben(seed->second->source()->point()), cgal2ben(seed->second->target()->point())).squared_distance(p);
+	for(set<Halfedge_handle>::iterator e = mFreshEdges.begin(); e != mFreshEdges.end(); ++e)
+		bound = min(bound, Segment2(cgal2ben((*e)->source()->point()), cgal2ben((*e)->target()->point())).squared_distance(p));
+
+	vector<Halfedge_handle>	candidates;
+	if(bound == DBL_MAX)
+	{
+		// The closest box belongs to a dead edge - fall back to looking at everything.
+		if(seed == NULL)
+			return Halfedge_handle();
+		edges_in_box(Bbox2(-DBL_MAX, -DBL_MAX, DBL_MAX, DBL_MAX), candidates);
+	}
+	else
+	{
+		Bbox2	search(p);
+		search.expand(sqrt(bound));
+		edges_in_box(search, candidates);
+	}
+
+	Halfedge_handle	best;
+	double			best_d2 = DBL_MAX;
+	for(vector<Halfedge_handle>::iterator e = candidates.begin(); e != candidates.end(); ++e)
+	{
+		double d2 = Segment2(cgal2ben((*e)->source()->point()), cgal2ben((*e)->target()->point())).squared_distance(p);
+		if(d2 < best_d2)
+		{
+			best_d2 = d2;
+			best = *e;
+		}
+	}
+	if(out_dist && best != Halfedge_handle())
+		*out_dist = sqrt(best_d2);
+	return best;
+}
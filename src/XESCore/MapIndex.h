@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef MapIndex_H
+#define MapIndex_H
+
+#include "MapDefs.h"
+#include "RTree2.h"
+
+/*
+
+	MapIndex - THEORY OF OPERATION
+
+	MapIndex_t is a spatial index over one Pmwx: the bounding box of every bounded face (its outer CCB) and every
+	edge goes into an RTree2.  It is an arrangement observer, so it stays valid while the map is edited.  It answers
+	face-at-point, faces/edges-in-box and nearest-edge questions - it is not a CGAL point-location model, so passes
+	that insert into the map through CGAL keep their own Locator.
+
+	RTree2 can only be bulk-loaded, so edits are kept on the side: faces and edges that are created or grow are
+	"fresh" and are checked by hand on every query; ones that go away are "dead" and are skipped when the tree
+	returns them.  Once the side lists get big compared to the tree, the index stops tracking edits and the next
+	query re-indexes the whole map - so it is cheap to leave an index attached to a map that is being rebuilt.
+
+	Dead handles are never dereferenced - they are only compared.  If CGAL hands out the memory of a dead face
+	again, the new face is fresh, and fresh wins over whatever the tree has for that address.
+
+	Face lookup is exact: the tree only nominates candidates, and the CGAL kernel decides which one contains the
+	point.  The box and nearest queries work on bounding boxes and doubles, like the other RTree2 users.
+
+	The index is not thread safe - queries may re-index, so even "read-only" use must stay on one thread.
+
+	Users: FAA_Obs's ApplyObjects (face lookup for every obstacle) and RenderFarmUI's map drawing and picking
+	(PmwxIndex_t).  That is all - the XESCore passes were looked at and still do their own thing:
+
+	- MapOverlay's MapMergePolygon and friends, and airport burn-in, hand their edges to CGAL::insert, which
+	  wants a CGAL point-location model (Locator) that can also answer "on this vertex/edge" - face_at_point
+	  can't.  Wrapping the index in that concept would be the way to share it with them; the burn passes NULL.
+	- BuildNetworkTopology and MergeNearJunctions never ask a spatial question of the map: the first walks the
+	  vertices and edges once, the second works on junctions after they have left the map.
+	- DEMToVector's locate_point and Hydro's ray_shoot and point cache are the pre-CGAL map API and are
+	  commented out or unreached; they should move to this index if they are ever revived.
+
+*/
+
+class	MapIndex_t : public CGAL::Arr_observer<Arrangement_2> {
+public:
+	typedef	CGAL::Arr_observer<Arrangement_2>	base;
+	typedef	RTree2<Face_handle,16>				FaceTree;
+	typedef	RTree2<Halfedge_handle,16>			EdgeTree;
+
+	MapIndex_t();
+	MapIndex_t(Pmwx& map);		// Attaches and indexes the map right away.
+
+	// The face whose interior contains p.  Points outside every bounded face get the unbounded face; points
+	// that sit on an edge or vertex get Face_handle(), since no one face owns them.
+	Face_handle		face_at_point(const Point_2& p);
+
+	// Every bounded face or edge whose bounding box overlaps the box.  Edges come back as one of their two
+	// half-edges; which one is arbitrary.
+	void			faces_in_box(const Bbox2& box, vector<Face_handle>& out_faces);
+	void			edges_in_box(const Bbox2& box, vector<Halfedge_handle>& out_edges);
+
+	// The edge closest to p (in degrees, not meters!), or Halfedge_handle() if the map has no edges.
+	Halfedge_handle	nearest_edge(const Point2& p, double * out_dist = NULL);
+
+	// Re-index now rather than on the next query.
+	void			rebuild(void);
+
+	// Observer hooks - these keep the fresh/dead lists up to date.
+	virtual void	after_attach(void);
+	virtual void	after_detach(void);
+	virtual void	after_assign(void);
+	virtual void	after_clear(void);
+	virtual void	after_global_change(void);
+
+	virtual void	after_modify_vertex(Vertex_handle v);
+
+	virtual void	after_create_edge(Halfedge_handle e);
+	virtual void	after_modify_edge(Halfedge_handle e);
+	virtual void	after_split_edge(Halfedge_handle e1, Halfedge_handle e2);
+	virtual void	before_merge_edge(Halfedge_handle e1, Halfedge_handle e2, const X_monotone_curve_2& c);
+	virtual void	after_merge_edge(Halfedge_handle e);
+	virtual void	before_remove_edge(Halfedge_handle e);
+
+	virtual void	after_split_face(Face_handle f, Face_handle new_f, bool is_hole);
+	virtual void	before_merge_face(Face_handle f1, Face_handle f2, Halfedge_handle e);
+	virtual void	after_merge_face(Face_handle f);
+	virtual void	after_split_outer_ccb(Face_handle f, Ccb_halfedge_circulator h1, Ccb_halfedge_circulator h2);
+	virtual void	after_merge_outer_ccb(Face_handle f, Ccb_halfedge_circulator h);
+
+private:
+
+	void			check_current(void);
+	void			check_changes(void);
+	void			touch_face(Face_handle f);
+	void			touch_edge(Halfedge_handle e);
+	void			kill_face(Face_handle f);
+	void			kill_edge(Halfedge_handle e);
+
+	bool			skip_face(Face_handle f) const { return mFreshFaces.count(f) || mDeadFaces.count(f); }
+	bool			skip_edge(Halfedge_handle e) const { return mFreshEdges.count(e) || mDeadEdges.count(e); }
+
+	Pmwx *					mMap;
+	bool					mStale;			// Whole index is out of date - rebuild before the next query.
+	int						mIndexed;		// Items in the trees as of the last rebuild.
+
+	FaceTree				mFaces;
+	EdgeTree				mEdges;
+
+	set<Face_handle>		mFreshFaces;
+	set<Face_handle>		mDeadFaces;
+	set<Halfedge_handle>	mFreshEdges;	// Edges are always keyed by their canonical half-edge.
+	set<Halfedge_handle>	mDeadEdges;
+
+	MapIndex_t(const MapIndex_t&);
+	MapIndex_t& operator=(const MapIndex_t&);
+
+};
+
+#endif /* MapIndex_H */
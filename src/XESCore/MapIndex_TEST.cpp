@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2020, Laminar Research.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "MapIndex.h"
+#include "AssertUtils.h"
+
+static void	add_segment(Pmwx& m, double x1, double y1, double x2, double y2)
+{
+	CGAL::insert(m, Curve_2(Segment_2(Point_2(x1, y1), Point_2(x2, y2)), 0));
+}
+
+static double	edge_d2(Halfedge_handle e, const Point2& p)
+{
+	return Segment2(cgal2ben(e->source()->point()), cgal2ben(e->target()->point())).squared_distance(p);
+}
+
+// The index must say p is in a bounded face that really has p inside its outer boundary.
+static Face_handle	check_face(MapIndex_t& index, double x, double y)
+{
+	Point_2		p(x, y);
+	Face_handle	f = index.face_at_point(p);
+	TEST_Run(f != Face_handle() && !f->is_unbounded());
+	if(f != Face_handle() && !f->is_unbounded())
+	{
+		Polygon_2	outer;
+		Pmwx::Ccb_halfedge_circulator circ, stop;
+		circ = stop = f->outer_ccb();
+		do {
+			outer.push_back(circ->source()->point());
+		} while(++circ != stop);
+		TEST_Run(outer.bounded_side(p) == CGAL::ON_BOUNDED_SIDE);
+	}
+	return f;
+}
+
+// nearest_edge must be as close as a brute force search over the whole map - ties may pick either edge.
+static void	check_nearest(Pmwx& m, MapIndex_t& index, const Point2& p)
+{
+	double best = DBL_MAX;
+	for(Pmwx::Edge_iterator e = m.edges_begin(); e != m.edges_end(); ++e)
+		best = min(best, edge_d2(e, p));
+
+	double			dist = -1.0;
+	Halfedge_handle	found = index.nearest_edge(p, &dist);
+	TEST_Run(found != Halfedge_handle());
+	if(found != Halfedge_handle())
+	{
+		TEST_Run(fabs(edge_d2(found, p) - best) < 1.0e-12);
+		TEST_Run(fabs(dist * dist - best) < 1.0e-12);
+	}
+}
+
+void	TEST_MapIndex(void)
+{
+	// Empty map - everything is in the unbounded face and there is no edge to find.
+	Pmwx		m;
+	MapIndex_t	index(m);
+	TEST_Run(index.face_at_point(Point_2(0, 0)) == m.unbounded_face());
+	TEST_Run(index.nearest_edge(Point2(0, 0)) == Halfedge_handle());
+
+	// A 4x4 grid of unit squares.
+	for(int n = 0; n <= 4; ++n)
+	{
+		add_segment(m, n, 0, n, 4);
+		add_segment(m, 0, n, 4, n);
+	}
+	TEST_Run(m.number_of_faces() == 17);
+
+	// Every cell is its own face, the outside is the unbounded face, and points on an edge or vertex have no face.
+	set<Face_handle>	cells;
+	for(int y = 0; y < 4; ++y)
+	for(int x = 0; x < 4; ++x)
+	{
+		Face_handle f = check_face(index, x + 0.5, y + 0.5);
+		TEST_Run(check_face(index, x + 0.1, y + 0.9) == f);
+		cells.insert(f);
+	}
+	TEST_Run(cells.size() == 16);
+	TEST_Run(index.face_at_point(Point_2(-1, -1)) == m.unbounded_face());
+	TEST_Run(index.face_at_point(Point_2(2, 5)) == m.unbounded_face());
+	TEST_Run(index.face_at_point(Point_2(1, 0.5)) == Face_handle());
+	TEST_Run(index.face_at_point(Point_2(2, 2)) == Face_handle());
+
+	check_nearest(m, index, Point2(2.5, 2.1));
+	check_nearest(m, index, Point2(-3.0, 1.7));
+	check_nearest(m, index, Point2(7.0, 9.0));
+
+	// Remove the edge between cells (1,1) and (2,1) - the two cells become one face, and the edge is gone.
+	for(Pmwx::Edge_iterator e = m.edges_begin(); e != m.edges_end(); ++e)
+	if(cgal2ben(e->source()->point()).x() == 2.0 && cgal2ben(e->target()->point()).x() == 2.0 &&
+	   min(cgal2ben(e->source()->point()).y(), cgal2ben(e->target()->point()).y()) == 1.0)
+	{
+		m.remove_edge(e);
+		break;
+	}
+	TEST_Run(m.number_of_faces() == 16);
+	TEST_Run(check_face(index, 1.5, 1.5) == check_face(index, 2.5, 1.5));
+	TEST_Run(check_face(index, 1.5, 1.5) != check_face(index, 0.5, 1.5));
+	check_nearest(m, index, Point2(2.0, 1.5));
+	check_nearest(m, index, Point2(2.1, 1.45));
+
+	// Split cell (0,0) along its diagonal - both halves are new faces, and the new edge is found.
+	add_segment(m, 0, 0, 1, 1);
+	TEST_Run(m.number_of_faces() == 17);
+	TEST_Run(check_face(index, 0.75, 0.25) != check_face(index, 0.25, 0.75));
+	TEST_Run(check_face(index, 0.75, 0.25) != check_face(index, 1.5, 0.5));
+	check_nearest(m, index, Point2(0.5, 0.45));
+
+	// Enough new edges that the index stops tracking them and re-indexes on the next query.
+	for(int n = 0; n < 300; ++n)
+		add_segment(m, 10.0 + n * 0.01, 0, 10.0 + n * 0.01, 1);
+	TEST_Run(index.face_at_point(Point_2(10.005, 0.5)) == m.unbounded_face());
+	TEST_Run(index.face_at_point(Point_2(10.0, 0.5)) == Face_handle());
+	check_face(index, 2.5, 1.5);
+	check_nearest(m, index, Point2(10.504, 0.5));
+	check_nearest(m, index, Point2(10.0, 2.0));
+	check_nearest(m, index, Point2(2.0, 1.5));
+
+	// An index built from scratch must agree with the one that followed the edits.
+	MapIndex_t	fresh(m);
+	for(int y = 0; y < 4; ++y)
+	for(int x = 0; x < 4; ++x)
+		TEST_Run(fresh.face_at_point(Point_2(x + 0.3, y + 0.6)) == index.face_at_point(Point_2(x + 0.3, y + 0.6)));
+}
@@ -34,6 +34,7 @@
 #include "NetHelpers.h"
 #include "PolyRasterUtils.h"
 #include "AptDefs.h"
+#include "AptAlgs.h"
 #include "ConfigSystem.h"
 #include "MapTopology.h"
 #include "GISTool_Globals.h"
@@ -44,6 +45,7 @@
 #include "BlockFill.h"
 #include "BlockAlgs.h"
 #include "MathUtils.h"
+#include "ParallelUtils.h"
 
 // NOTE: all that this does is propegate parks, forestparks, cemetaries and golf courses to the feature type if
 // it isn't assigned.
@@ -587,55 +589,47 @@ void kill_antennas(Pmwx& io_map, Pmwx::Face_handle f, float max_len)
 	} while (++circ != stop);
 }
 
-static void ZoneOneFace(
-				Pmwx& 				ioMap,
-				const DEMGeo&		inElev,
+// What ZoneOneFace needs from the land use, forest, park and urban density rasters under a face.  Working this out
+// only reads the DEMs and a copy of the face's boundary, so it is done for all faces up front, on all cores.
+struct	face_raster_stats_t {
+	vector<Segment2>	dem_edges;		// Face boundary in inLanduse's x/y - the edges SetupRasterizerForDEM would use.
+	Point2				any;			// Some boundary point, sampled when no DEM post falls inside the face.
+	float				count;
+	float				total_forest;
+	float				total_urban;
+	float				total_park;
+	map<int, int>		histo;
+};
+
+static void	SetupFaceRasterStats(Pmwx::Face_handle face, const DEMGeo& inLanduse, face_raster_stats_t& rs)
+{
+	set<Halfedge_handle>	all;
+	FindEdgesForFace<Pmwx>(face, all);
+	for (set<Halfedge_handle>::iterator e = all.begin(); e != all.end(); ++e)
+	if ((*e)->face() != (*e)->twin()->face())
+		rs.dem_edges.push_back(Segment2(
+			Point2(inLanduse.lon_to_x(CGAL::to_double((*e)->source()->point().x())), inLanduse.lat_to_y(CGAL::to_double((*e)->source()->point().y()))),
+			Point2(inLanduse.lon_to_x(CGAL::to_double((*e)->target()->point().x())), inLanduse.lat_to_y(CGAL::to_double((*e)->target()->point().y())))));
+	rs.any = cgal2ben(face->outer_ccb()->source()->point());
+}
+
+static void	CalcFaceRasterStats(
 				const DEMGeo& 		inLanduse,
 				const DEMGeo&		inForest,
 				const DEMGeo&		inPark,
-				const DEMGeo& 		inSlope,
-				const AptVector&	inApts,
 				const DEMGeo&		urban_density_from_lu,
-				Pmwx::Face_handle	face)
+				face_raster_stats_t& rs)
 {
-	//--------------------------------------------------------------------------------------------------------------------------------
-	// BASIC BLOCK INFO - AREA, RASTER FEATURES
-	//--------------------------------------------------------------------------------------------------------------------------------
-
-	double mfam = GetMapFaceAreaMeters(face);
-	double	max_height = 0.0;
-	set<int>	my_pt_features;
-
-	if (mfam < MAX_OBJ_SPREAD)
-	for (GISPointFeatureVector::iterator feat = face->data().mPointFeatures.begin(); feat != face->data().mPointFeatures.end(); ++feat)
-	{
-		my_pt_features.insert(feat->mFeatType);
-		if (feat->mFeatType == feat_Building)
-		{
-			if (feat->mParams.count(pf_Height))
-			{
-				max_height = max(max_height, feat->mParams[pf_Height]);
-			}
-		} else {
-			printf("Has other feature: %s\n", FetchTokenString(feat->mFeatType));
-		}
-	}
-
-	int has_water = 0;
-	int has_non_water = 0;
-	int has_train = 0;
-	int has_prim = 0;
-	int	has_non_train = 0;
-	int has_local = 0;
-	int has_non_local = 0;
-	Bbox2 face_extent;
-
 	PolyRasterizer<double>	r;
+	for (vector<Segment2>::const_iterator e = rs.dem_edges.begin(); e != rs.dem_edges.end(); ++e)
+		r.AddEdge(e->p1.x(), e->p1.y(), e->p2.x(), e->p2.y());
+	r.SortMasters();
+
 	int x, y, x1, x2;
-	y = SetupRasterizerForDEM(face, inLanduse, r);
+	y = r.masters.empty() ? 0 : floor(r.masters.front().y1);
 	r.StartScanline(y);
 	float count = 0, total_forest = 0, total_urban = 0, total_park = 0;
-	map<int, int>		histo;
+	map<int, int>&		histo(rs.histo);
 
 	while (!r.DoneScan())
 	{
@@ -654,9 +648,10 @@ static void ZoneOneFace(
 
 				total_urban += d;
 
-				if(gLandClassInfo.count(e))
+				LandClassInfoTable::const_iterator lc = gLandClassInfo.find(e);
+				if(lc != gLandClassInfo.end())
 				{
-					LandClassInfo_t& i(gLandClassInfo[e]);
+					const LandClassInfo_t& i(lc->second);
 					histo[i.category]++;
 					total_forest += i.veg_density;
 
@@ -682,7 +677,7 @@ static void ZoneOneFace(
 
 	if(count == 0)
 	{
-		Point2 any = cgal2ben(face->outer_ccb()->source()->point());
+		const Point2& any(rs.any);
 		float e = inLanduse.xy_nearest(any.x(),any.y());
 		float f = inForest.xy_nearest(any.x(),any.y());
 		float p = inPark.xy_nearest(any.x(),any.y());
@@ -691,9 +686,10 @@ static void ZoneOneFace(
 		count++;
 
 		total_urban += d;
-		if(gLandClassInfo.count(e))
+		LandClassInfoTable::const_iterator lc = gLandClassInfo.find(e);
+		if(lc != gLandClassInfo.end())
 		{
-			LandClassInfo_t& i(gLandClassInfo[e]);
+			const LandClassInfo_t& i(lc->second);
 			histo[i.category]++;
 			total_forest += i.veg_density;
 			if(p != NO_VALUE)
@@ -708,13 +704,66 @@ static void ZoneOneFace(
 
 	}
 
+	rs.count = count;
+	rs.total_forest = total_forest;
+	rs.total_urban = total_urban;
+	rs.total_park = total_park;
+}
+
+static void ZoneOneFace(
+				Pmwx& 				ioMap,
+				const DEMGeo&		inElev,
+				const DEMGeo& 		inLanduse,
+				const DEMGeo&		inForest,
+				const DEMGeo&		inPark,
+				const DEMGeo& 		inSlope,
+				const AptVector&	inApts,
+				const DEMGeo&		urban_density_from_lu,
+				const face_raster_stats_t& rs,
+				Pmwx::Face_handle	face)
+{
+	//--------------------------------------------------------------------------------------------------------------------------------
+	// BASIC BLOCK INFO - AREA, RASTER FEATURES
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	double mfam = GetMapFaceAreaMeters(face);
+	double	max_height = 0.0;
+	set<int>	my_pt_features;
+
+	if (mfam < MAX_OBJ_SPREAD)
+	for (GISPointFeatureVector::iterator feat = face->data().mPointFeatures.begin(); feat != face->data().mPointFeatures.end(); ++feat)
+	{
+		my_pt_features.insert(feat->mFeatType);
+		if (feat->mFeatType == feat_Building)
+		{
+			if (feat->mParams.count(pf_Height))
+			{
+				max_height = max(max_height, feat->mParams[pf_Height]);
+			}
+		} else {
+			printf("Has other feature: %s\n", FetchTokenString(feat->mFeatType));
+		}
+	}
+
+	int has_water = 0;
+	int has_non_water = 0;
+	int has_train = 0;
+	int has_prim = 0;
+	int	has_non_train = 0;
+	int has_local = 0;
+	int has_non_local = 0;
+	Bbox2 face_extent;
+
+	float count = rs.count, total_forest = rs.total_forest, total_urban = rs.total_urban, total_park = rs.total_park;
+	const map<int, int>& histo(rs.histo);
+
 	if(count)
 	if((total_urban / count) > 0.5)
 	if(face->number_of_holes() == 0)
 		kill_antennas(ioMap,face,  ((total_urban / count) > 0.75) ? 35.0 : 20.0);
 
 	multimap<int, int, greater<int> > histo2;
-	for(map<int,int>::iterator i = histo.begin(); i != histo.end(); ++i)
+	for(map<int,int>::const_iterator i = histo.begin(); i != histo.end(); ++i)
 		histo2.insert(multimap<int,int, greater<int> >::value_type(i->second,i->first));
 
 	multimap<int, int, greater<int> >::iterator i = histo2.begin();
@@ -772,7 +821,8 @@ static void ZoneOneFace(
 
 
 	PolyRasterizer<double>  r2;
-	y = SetupRasterizerForDEM(face, inSlope, r2);
+	int x, x1, x2;
+	int y = SetupRasterizerForDEM(face, inSlope, r2);
 	r2.StartScanline(y);
 	int scount = 0;
 	float max_slope = 0.0;
@@ -1077,6 +1127,86 @@ static void ZoneOneFace(
 }
 
 
+// How low the lowest approach path near a face passes over it, in meters AGL.  Only reads the airports, their
+// index and the elevation DEM, so any number of faces can be checked at once.
+static bool	CalcApproachRestriction(
+				const Polygon2&		me,
+				const Bbox2&		me_bounds,
+				const DEMGeo&		inElev,
+				const AptVector&	inApts,
+				const AptIndex&		inAptIndex,
+				double&				out_lowest)
+{
+	CoordTranslator2 trans;
+	CreateTranslatorForBounds(me_bounds,trans);
+
+	Point2	myloc = trans.Forward(me.centroid());
+
+	double	lowest_restrict = 9.9e9;
+	bool	got_restrict = false;
+
+	// Only airports within 30 km can restrict us - pull them from the index with a box a bit bigger than that.
+	set<int>	near_apts;
+	double		lon_scale = cos(me_bounds.centroid().y() * DEG_TO_RAD);
+	Bbox2		near_bounds(me.centroid());
+	if (lon_scale > 0.001)
+		near_bounds.expand(30000.0 * 1.01 / (DEG_TO_MTR_LAT * lon_scale), 30000.0 * 1.01 / DEG_TO_MTR_LAT);
+	else
+		near_bounds = Bbox2(-180.0, -90.0, 180.0, 90.0);
+	FindAirports(near_bounds, inAptIndex, near_apts);
+
+	for (set<int>::iterator a = near_apts.begin(); a != near_apts.end(); ++a)
+	{
+		AptVector::const_iterator apt = inApts.begin() + *a;
+		if (apt->kind_code == apt_airport)
+		if (!apt->runways.empty())
+		{
+			Point2 midp = trans.Forward(apt->runways.front().ends.midpoint());
+			double dist = myloc.squared_distance(midp);
+			if (dist < 30000.0*30000.0)
+			for (AptRunwayVector::const_iterator rwy = apt->runways.begin(); rwy != apt->runways.end(); ++rwy)
+			for(int rend = 0; rend < 2; ++rend)
+			{
+				Point2 origin = trans.Forward(rend ? rwy->ends.p2 : rwy->ends.p1);
+
+				Vector2	rwy_dir = Vector2(rwy->ends.source(), rwy->ends.target());
+				rwy_dir.normalize();
+				if(!rend) rwy_dir = -rwy_dir;				// no, really! point TO the approaching plane to measure dist to threshold.				
+				origin -= (rwy_dir * rwy->disp_mtr[rend]);	// Because we are backward above, subtract the displaced threshold - moves origin to 50ft point.
+			
+				double rwy_dir_off = rwy_dir.dot(Vector2(origin));
+			
+				Vector2 rwy_nrm = rwy_dir.perpendicular_cw();
+				double rwy_nrm_off = rwy_nrm.dot(Vector2(origin));
+
+				for(Polygon2::const_iterator pp = me.begin(); pp != me.end(); ++pp)
+				{
+					Point2 polyp = trans.Forward(*pp);
+					double signed_dist_from_threshold = rwy_dir.dot(Vector2(polyp)) - rwy_dir_off;
+					double signed_dist_offset = fabs(rwy_nrm.dot(Vector2(polyp)) - rwy_nrm_off);
+				
+					if(signed_dist_from_threshold > 0 && signed_dist_from_threshold < 18000)
+					if(signed_dist_offset < 300 || signed_dist_offset < (signed_dist_from_threshold / 16.0))
+					{
+						double dist = sqrt(polyp.squared_distance(origin));
+						double gs_elev_msl = apt->elevation_ft * FT_TO_MTR + dist / 18.0 + 15.24;	// cross at 50 feet AGL + an 18:1 (~3 degree) slope
+						double gs_elev_agl = gs_elev_msl - inElev.value_linear(pp->x(), pp->y());
+					
+						if(gs_elev_agl < 1000.0)
+						{
+							lowest_restrict = min(lowest_restrict,gs_elev_agl);
+							got_restrict = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	out_lowest = lowest_restrict;
+	return got_restrict;
+}
+
 void	ZoneManMadeAreas(
 				Pmwx& 				ioMap,
 				const DEMGeo&		inElev,
@@ -1085,6 +1215,7 @@ void	ZoneManMadeAreas(
 				const DEMGeo&		inPark,
 				const DEMGeo& 		inSlope,
 				const AptVector&	inApts,
+				const AptIndex&		inAptIndex,
 				Pmwx::Face_handle	inDebug,
 				ProgressFunc		inProg)
 {
@@ -1116,10 +1247,24 @@ void	ZoneManMadeAreas(
 	/*****************************************************************************
 	 * PASS 1 - ZONING ASSIGNMENT VIA LAD USE DATA + FEATURES
 	 *****************************************************************************/
-	for (face = ioMap.faces_begin(); face != ioMap.faces_end(); ++face, ++ctr)
+	// The raster statistics only read DEMs, so they are done for every face first, in parallel.  Everything that
+	// touches the map - including kill_antennas, which edits it - then runs face by face as before.
+	vector<Pmwx::Face_handle>	zone_faces;
+	for (face = ioMap.faces_begin(); face != ioMap.faces_end(); ++face)
 	if (!face->is_unbounded())
 	if(!face->data().IsWater())
 	if(inDebug == Pmwx::Face_handle() || face == inDebug)
+		zone_faces.push_back(face);
+
+	vector<face_raster_stats_t>	raster_stats(zone_faces.size());
+	for (int n = 0; n < zone_faces.size(); ++n)
+		SetupFaceRasterStats(zone_faces[n], inLanduse, raster_stats[n]);
+
+	parallel_for(0, zone_faces.size(), [&](int n) {
+		CalcFaceRasterStats(inLanduse, inForest, inPark, urban_density_from_lu, raster_stats[n]);
+	});
+
+	for (int n = 0; n < zone_faces.size(); ++n, ++ctr)
 	{
 		PROGRESS_CHECK(inProg, 0, 3, "Zoning terrain...", ctr, total, check)
 		ZoneOneFace(
@@ -1131,8 +1276,8 @@ void	ZoneManMadeAreas(
 					inSlope,
 					inApts,
 					urban_density_from_lu,
-		
-			face);
+					raster_stats[n],
+					zone_faces[n]);
 	}
 
 #define HEIGHT_SPREAD_FACTOR 0.5
@@ -1146,6 +1291,11 @@ void	ZoneManMadeAreas(
 
 	PROGRESS_START(inProg, 1, 3, "Checking approach paths...")
 
+	// Face outlines come out of the map one at a time; the airport checks then run on all cores and the
+	// results are written back afterwards.
+	vector<Pmwx::Face_handle>	app_faces;
+	vector<Polygon2>			app_polys;
+	vector<Bbox2>				app_bounds;
 	ctr = 0;
 	for (face = ioMap.faces_begin(); face != ioMap.faces_end(); ++face, ++ctr)
 	if (!face->is_unbounded())
@@ -1153,18 +1303,11 @@ void	ZoneManMadeAreas(
 	if (!face->data().IsWater())
 	{
 		PROGRESS_CHECK(inProg, 1, 3, "Checking approach paths...", ctr, total, check)
-//		set<Face_handle>	neighbors;
-//		//FindAdjacentFaces(face, neighbors);
-//		{
-//			neighbors.clear();
-//			set<Halfedge_handle> e;
-//			FindEdgesForFace(face, e);
-//			for (set<Halfedge_handle>::iterator he = e.begin(); he != e.end(); ++he)
-//				if ((*he)->twin()->face() != face)
-//					neighbors.insert((*he)->twin()->face());
-//		}
-		Polygon2 me;
-		Bbox2	me_bounds;
+		app_faces.push_back(face);
+		app_polys.push_back(Polygon2());
+		app_bounds.push_back(Bbox2());
+		Polygon2& me(app_polys.back());
+		Bbox2& me_bounds(app_bounds.back());
 		Pmwx::Ccb_halfedge_circulator circ, stop;
 		circ = stop = face->outer_ccb();
 		do {
@@ -1173,68 +1316,17 @@ void	ZoneManMadeAreas(
 			me_bounds += bp;
 			++circ;
 		} while (circ != stop);
+	}
 
-		CoordTranslator2 trans;
-		CreateTranslatorForBounds(me_bounds,trans);
-
-		Point2	myloc = trans.Forward(me.centroid());
-
-		double	lowest_restrict = 9.9e9;
-		bool	got_restrict = false;
-
-//		for (set<Face_handle>::iterator niter = neighbors.begin(); niter != neighbors.end(); ++niter)
-//		{
-//			max_agl = max(max_agl, (*niter)->data().mParams[af_HeightObjs] * 0.5);
-//		}
-
-		for (AptVector::const_iterator apt = inApts.begin(); apt != inApts.end(); ++apt)
-		if (apt->kind_code == apt_airport)
-		if (!apt->runways.empty())
-		{
-			Point2 midp = trans.Forward(apt->runways.front().ends.midpoint());
-			double dist = myloc.squared_distance(midp);
-			if (dist < 30000.0*30000.0)
-			for (AptRunwayVector::const_iterator rwy = apt->runways.begin(); rwy != apt->runways.end(); ++rwy)
-			for(int rend = 0; rend < 2; ++rend)
-			{
-				Point2 origin = trans.Forward(rend ? rwy->ends.p2 : rwy->ends.p1);
-
-				Vector2	rwy_dir = Vector2(rwy->ends.source(), rwy->ends.target());
-				rwy_dir.normalize();
-				if(!rend) rwy_dir = -rwy_dir;				// no, really! point TO the approaching plane to measure dist to threshold.				
-				origin -= (rwy_dir * rwy->disp_mtr[rend]);	// Because we are backward above, subtract the displaced threshold - moves origin to 50ft point.
-				
-				double rwy_dir_off = rwy_dir.dot(Vector2(origin));
-				
-				Vector2 rwy_nrm = rwy_dir.perpendicular_cw();
-				double rwy_nrm_off = rwy_nrm.dot(Vector2(origin));
+	vector<double>	app_lowest(app_faces.size());
+	vector<char>	app_restricted(app_faces.size());
+	parallel_for(0, app_faces.size(), [&](int n) {
+		app_restricted[n] = CalcApproachRestriction(app_polys[n], app_bounds[n], inElev, inApts, inAptIndex, app_lowest[n]);
+	});
 
-				for(Polygon2::iterator pp = me.begin(); pp != me.end(); ++pp)
-				{
-					Point2 polyp = trans.Forward(*pp);
-					double signed_dist_from_threshold = rwy_dir.dot(Vector2(polyp)) - rwy_dir_off;
-					double signed_dist_offset = fabs(rwy_nrm.dot(Vector2(polyp)) - rwy_nrm_off);
-					
-					if(signed_dist_from_threshold > 0 && signed_dist_from_threshold < 18000)
-					if(signed_dist_offset < 300 || signed_dist_offset < (signed_dist_from_threshold / 16.0))
-					{
-						double dist = sqrt(polyp.squared_distance(origin));
-						double gs_elev_msl = apt->elevation_ft * FT_TO_MTR + dist / 18.0 + 15.24;	// cross at 50 feet AGL + an 18:1 (~3 degree) slope
-						double gs_elev_agl = gs_elev_msl - inElev.value_linear(pp->x(), pp->y());
-						
-						if(gs_elev_agl < 1000.0)
-						{
-							lowest_restrict = min(lowest_restrict,gs_elev_agl);
-							got_restrict = true;
-						}
-					}
-				}
-			}
-		}
-
-		if(got_restrict)
-			face->data().mParams[af_HeightApproach] = lowest_restrict;
-	}
+	for (int n = 0; n < app_faces.size(); ++n)
+	if (app_restricted[n])
+		app_faces[n]->data().mParams[af_HeightApproach] = app_lowest[n];
 	PROGRESS_DONE(inProg, 1, 3, "Checking approach paths...")
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -1463,8 +1555,6 @@ inline int MIN_NOVALUE(int a, int b)
 
 struct EdgeNode_t;
 
-typedef multimap<float, EdgeNode_t *, greater<float> >	EdgeQ;
-
 struct	FaceNode_t {
 
 	FaceNode_t *			prev;
@@ -1490,7 +1580,9 @@ struct EdgeNode_t {
 	int				road_type;	// Lowest enum overlying road on this edge
 	bool			must_lock;
 	bool			must_merge;
-	EdgeQ::iterator	self;
+	float			cost;		// Merge priority while queued
+	unsigned int	seq;		// Queue order, to break cost ties first-come-first-served
+	int				heap_idx;	// Slot in the merge queue, -1 if not queued
 
 	FaceNode_t *	other(FaceNode_t * f) const { DebugAssert(f == f1 || f == f2); return (f == f1) ? f2 : f1; }
 };
@@ -1503,11 +1595,15 @@ struct edge_contains_f {
 
 struct FaceGraph_t {
 
-	FaceGraph_t() { edges = NULL; faces = NULL; }
+	FaceGraph_t() { edges = NULL; faces = NULL; queue_seq = 0; }
 
 	EdgeNode_t *	edges;
 	FaceNode_t *	faces;
-	EdgeQ			queue;
+
+	// The merge queue is a binary heap of edges, highest cost first.  Every edge knows its slot, so
+	// re-costing or deleting one is a sift instead of a search.  Ties go to the edge queued first.
+	vector<EdgeNode_t *>	queue;
+	unsigned int			queue_seq;
 
 	~FaceGraph_t() { clear(); }
 	void			clear();
@@ -1521,6 +1617,13 @@ struct FaceGraph_t {
 	void			enqueue(EdgeNode_t * en,float (* cost_func)(EdgeNode_t * en));
 	EdgeNode_t *	pop(void);
 
+private:
+	static bool		before(const EdgeNode_t * a, const EdgeNode_t * b) { return a->cost > b->cost || (a->cost == b->cost && a->seq < b->seq); }
+	void			place(EdgeNode_t * en, int idx) { queue[idx] = en; en->heap_idx = idx; }
+	void			sift_up(int idx);
+	void			sift_down(int idx);
+	void			unqueue(EdgeNode_t * en);
+
 };
 
 FaceNode_t *	FaceGraph_t::new_face()
@@ -1557,8 +1660,8 @@ void			FaceGraph_t::delete_face(FaceNode_t * f)
 
 void			FaceGraph_t::delete_edge(EdgeNode_t * e)
 {
-	if(e->self != queue.end())
-		queue.erase(e->self);
+	if(e->heap_idx != -1)
+		unqueue(e);
 
 	if(e == edges)
 		edges = e->next;
@@ -1657,17 +1760,65 @@ void			FaceGraph_t::merge(FaceNode_t * f1, FaceNode_t * f2, list<EdgeNode_t *>&
 	delete_face(f2);
 }
 
+void			FaceGraph_t::sift_up(int idx)
+{
+	EdgeNode_t * en = queue[idx];
+	while(idx > 0)
+	{
+		int parent = (idx - 1) / 2;
+		if(!before(en, queue[parent]))
+			break;
+		place(queue[parent], idx);
+		idx = parent;
+	}
+	place(en, idx);
+}
+
+void			FaceGraph_t::sift_down(int idx)
+{
+	EdgeNode_t * en = queue[idx];
+	int count = queue.size();
+	while(1)
+	{
+		int child = idx * 2 + 1;
+		if(child >= count)
+			break;
+		if(child + 1 < count && before(queue[child + 1], queue[child]))
+			++child;
+		if(!before(queue[child], en))
+			break;
+		place(queue[child], idx);
+		idx = child;
+	}
+	place(en, idx);
+}
+
+void			FaceGraph_t::unqueue(EdgeNode_t * en)
+{
+	int idx = en->heap_idx;
+	EdgeNode_t * last = queue.back();
+	queue.pop_back();
+	en->heap_idx = -1;
+	if(last != en)
+	{
+		place(last, idx);
+		sift_up(idx);
+		sift_down(last->heap_idx);
+	}
+}
+
 void			FaceGraph_t::enqueue(EdgeNode_t * en, float (* cost_func)(EdgeNode_t * en))
 {
-	if(queue.end() != en->self)
-		queue.erase(en->self);
+	if(en->heap_idx != -1)
+		unqueue(en);
 	float cost_now = cost_func(en);
 	if(cost_now >= 0.0f)
 	{
-		en->self = queue.insert(EdgeQ::value_type(cost_now,en));
+		en->cost = cost_now;
+		en->seq = queue_seq++;
+		queue.push_back(en);
+		sift_up(queue.size() - 1);
 	}
-	else
-		en->self = queue.end();
 }
 
 
@@ -1675,9 +1826,8 @@ EdgeNode_t *	FaceGraph_t::pop(void)
 {
 	if(queue.empty())
 		return NULL;
-	EdgeNode_t * ret = queue.begin()->second;
-	queue.erase(queue.begin());
-	ret->self = queue.end();
+	EdgeNode_t * ret = queue.front();
+	unqueue(ret);
 	return ret;
 }
 
@@ -1818,7 +1968,7 @@ void	ColorFaces(set<Face_handle>&	io_faces)
 				en->f2 = f2;
 				f1->edges.push_back(en);
 				f2->edges.push_back(en);
-				en->self = graph.queue.end();
+				en->heap_idx = -1;
 				en->length = 0.0f;
 				en->count = 0;
 				en->must_merge = false;
@@ -2051,7 +2201,7 @@ FacadeSpelling_t * GetFacadeRule(int zoning, int variant, double front_wall_len,
 	}
 	if(!possible.empty())
 	{
-		return possible[rand() % possible.size()];
+		return possible[block_rand() % possible.size()];
 	}
 
 	#if DEV
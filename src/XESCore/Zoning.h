@@ -257,6 +257,7 @@ void	ZoneManMadeAreas(
 				const DEMGeo&		inPark,
 				const DEMGeo& 		inSlope,
 				const AptVector&	inApts,
+				const AptIndex&		inAptIndex,
 				Pmwx::Face_handle	inDebug,
 				ProgressFunc		inProg);
 				
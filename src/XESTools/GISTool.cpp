@@ -36,6 +36,13 @@
 #include "GISTool_ImageCmds.h"
 #include "GISTool_ProcessingCmds.h"
 #include "GISTool_VectorCmds.h"
+#include "GISUtils.h"
+#include "ParallelUtils.h"
+#include <mutex>
+#if LIN || APL
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
 #if USE_CHUD
 #include <CHUD/CHUD.h>
 #endif
@@ -84,6 +91,201 @@ static int DoNoTiming(const vector<const char *>& args)		{	gTiming = 0;	return 0
 static int DoProgress(const vector<const char *>& args)		{	gProgress = ConsoleProgressFunc;	return 0;	}
 static int DoNoProgress(const vector<const char *>& args)	{	gProgress = NULL;					return 0;	}
 
+/************************************************************************************************************************
+ * MULTI-TILE DRIVER
+ ************************************************************************************************************************
+
+	-tiles runs one script over a whole list of tiles.  All of GISTool's state (gMap, gDem, gTriangulationHi, gApts...)
+	is global and CGAL's numbers can't be shared between threads, so every tile gets a GISTool process of its own - that
+	process is the tile's context.  Up to <workers> tiles run at once and each may use <mem_mb> of address space, so one
+	runaway tile fails by itself instead of taking the machine down with it.
+
+	The script is a list of commands, just like what we read from stdin; # comments out the rest of a line.  In every
+	word of it, these are replaced for each tile:
+
+		{TILE}		+42-072		{WEST}		-72			{EAST}		-71
+		{FOLDER}	+40-080		{SOUTH}		42			{NORTH}		43
+
+	The tile list has one "west south" pair per line.  Each tile's output goes to <script>.<tile>.log.  With -timing on,
+	every tile logs its command times and they are added up over all tiles at the end.
+
+ ************************************************************************************************************************/
+
+static const char *	sSelfPath = NULL;
+static string		sTimingLog;
+
+// Splits a text file into whitespace separated words, minus # comments.
+static bool	read_words(const char * path, vector<string>& words)
+{
+	FILE * fi = fopen(path, "r");
+	if (fi == NULL) return false;
+	char	line[2048];
+	while (fgets(line, sizeof(line), fi))
+	{
+		char * comment = strchr(line, '#');
+		if (comment) *comment = 0;
+		const char * sep = "\r\n \t";
+		for (char * tok = strtok(line, sep); tok; tok = strtok(NULL, sep))
+			words.push_back(tok);
+	}
+	fclose(fi);
+	return true;
+}
+
+static string	expand_tile_vars(string word, int west, int south)
+{
+	char	vals[6][16];
+	sprintf(vals[0], "%+03d%+04d", south, west);
+	sprintf(vals[1], "%+03d%+04d", latlon_bucket(south), latlon_bucket(west));
+	sprintf(vals[2], "%d", west);
+	sprintf(vals[3], "%d", south);
+	sprintf(vals[4], "%d", west + 1);
+	sprintf(vals[5], "%d", south + 1);
+	static const char * keys[6] = { "{TILE}", "{FOLDER}", "{WEST}", "{SOUTH}", "{EAST}", "{NORTH}" };
+
+	for (int k = 0; k < 6; ++k)
+	{
+		string::size_type p;
+		while ((p = word.find(keys[k])) != word.npos)
+			word.replace(p, strlen(keys[k]), vals[k]);
+	}
+	return word;
+}
+
+static int DoMemLimit(const vector<const char *>& args)
+{
+#if LIN || APL
+	struct rlimit lim;
+	lim.rlim_cur = lim.rlim_max = (rlim_t) atoi(args[0]) * 1024 * 1024;
+	if (setrlimit(RLIMIT_AS, &lim) != 0)
+	{
+		fprintf(stderr, "Unable to limit memory to %s MB.\n", args[0]);
+		return 1;
+	}
+#else
+	printf("Memory limits are not supported on this platform; ignoring -mem_limit.\n");
+#endif
+	return 0;
+}
+
+static int DoTimingLog(const vector<const char *>& args)	{	sTimingLog = args[0];	return 0;	}
+
+static void	WriteTimingLog(const string& path)
+{
+	FILE * fi = fopen(path.c_str(), "w");
+	if (fi == NULL) return;
+	const map<string, GISTool_CmdTiming_t>& timings(GISTool_GetTimings());
+	for (map<string, GISTool_CmdTiming_t>::const_iterator t = timings.begin(); t != timings.end(); ++t)
+		fprintf(fi, "%s %lf %d\n", t->first.c_str(), t->second.seconds, t->second.runs);
+	fclose(fi);
+}
+
+static void	ReadTimingLog(const string& path, map<string, GISTool_CmdTiming_t>& io_totals)
+{
+	FILE * fi = fopen(path.c_str(), "r");
+	if (fi == NULL) return;
+	char	name[256];
+	double	seconds;
+	int		runs;
+	while (fscanf(fi, "%255s %lf %d", name, &seconds, &runs) == 3)
+	{
+		io_totals[name].seconds += seconds;
+		io_totals[name].runs += runs;
+	}
+	fclose(fi);
+}
+
+struct	sort_by_seconds {
+	bool operator()(const pair<string, GISTool_CmdTiming_t>& lhs, const pair<string, GISTool_CmdTiming_t>& rhs) const
+	{
+		return lhs.second.seconds > rhs.second.seconds;
+	}
+};
+
+static int DoTiles(const vector<const char *>& args)
+{
+	int		workers = atoi(args[0]);
+	int		mem_mb = atoi(args[1]);
+	string	script_path(args[3]);
+
+	vector<string>	tile_words, script;
+	if (!read_words(args[2], tile_words) || (tile_words.size() % 2) != 0)
+	{
+		fprintf(stderr, "Unable to read tile list %s - it needs one west/south pair per tile.\n", args[2]);
+		return 1;
+	}
+	if (!read_words(args[3], script) || script.empty())
+	{
+		fprintf(stderr, "Unable to read script %s.\n", args[3]);
+		return 1;
+	}
+
+	int				tile_count = tile_words.size() / 2;
+	vector<int>		results(tile_count, 0);
+	mutex			print_lock;
+	bool			timing = gTiming;
+
+	parallel_for(0, tile_count, [&](int n) {
+		int		west = atoi(tile_words[n*2].c_str());
+		int		south = atoi(tile_words[n*2+1].c_str());
+		string	tile = expand_tile_vars("{TILE}", west, south);
+		string	log_path = script_path + "." + tile + ".log";
+
+		string	cmd = string("\"") + sSelfPath + "\"";
+		if (mem_mb > 0)
+		{
+			char	buf[32];
+			sprintf(buf, " -mem_limit %d", mem_mb);
+			cmd += buf;
+		}
+		if (timing)
+			cmd += " -timing -timing_log \"" + script_path + "." + tile + ".timing\"";
+		for (vector<string>::iterator w = script.begin(); w != script.end(); ++w)
+			cmd += " \"" + expand_tile_vars(*w, west, south) + "\"";
+		cmd += " > \"" + log_path + "\" 2>&1";
+	#if IBM
+		cmd = "\"" + cmd + "\"";		// cmd.exe strips the outer pair of quotes.
+	#endif
+
+		unsigned long long start = query_hpc();
+		int r = system(cmd.c_str());
+	#if LIN || APL
+		r = (r != -1 && WIFEXITED(r)) ? WEXITSTATUS(r) : -1;
+	#endif
+		results[n] = r;
+
+		lock_guard<mutex> lock(print_lock);
+		printf("Tile %s %s (%d) - %lf seconds, see %s.\n", tile.c_str(), r == 0 ? "done" : "FAILED", r,
+				hpc_to_microseconds(query_hpc() - start) / 1000000.0, log_path.c_str());
+	}, workers);
+
+	int failed = 0;
+	map<string, GISTool_CmdTiming_t>	totals;
+	for (int n = 0; n < tile_count; ++n)
+	{
+		if (results[n] != 0) ++failed;
+		if (timing)
+		{
+			string tile = expand_tile_vars("{TILE}", atoi(tile_words[n*2].c_str()), atoi(tile_words[n*2+1].c_str()));
+			string timing_path = script_path + "." + tile + ".timing";
+			ReadTimingLog(timing_path, totals);
+			remove(timing_path.c_str());
+		}
+	}
+
+	if (timing)
+	{
+		vector<pair<string, GISTool_CmdTiming_t> >	by_time(totals.begin(), totals.end());
+		sort(by_time.begin(), by_time.end(), sort_by_seconds());
+		printf("Command times over %d tiles:\n", tile_count);
+		for (int n = 0; n < by_time.size(); ++n)
+			printf("%-24s %12.2lf seconds in %5d runs, %10.2lf per run.\n", by_time[n].first.c_str(),
+				by_time[n].second.seconds, by_time[n].second.runs, by_time[n].second.seconds / (double) by_time[n].second.runs);
+	}
+	printf("%d of %d tiles done, %d failed.\n", tile_count - failed, tile_count, failed);
+	return failed ? 1 : 0;
+}
+
 static	GISTool_RegCmd_t		sUtilCmds[] = {
 { "-help",			0, 1, DoHelp, "Prints help info for a command.", "" },
 { "-verbose",		0, 0, DoVerbose, "Enables loggging messages.", "" },
@@ -93,6 +295,9 @@ static	GISTool_RegCmd_t		sUtilCmds[] = {
 { "-progress",		0, 0, DoProgress, "Shows progress bars", "" },
 { "-noprogress",	0, 0, DoNoProgress, "Disables progress bars", "" },
 { "-selftest",		0, 0, DoSelfTest, "Self test internal algorithms.", "" },
+{ "-tiles",			4, 4, DoTiles, "workers mem_mb tile_list script - run a script over many tiles.", "Runs the GISTool commands in the script file once per tile in the tile list, each tile in its own process.  Up to workers tiles run at once, each limited to mem_mb of memory (0 for no limit).  {TILE}, {FOLDER}, {WEST}, {SOUTH}, {EAST} and {NORTH} in the script are replaced for every tile.  With -timing, command times are added up over all tiles.\n" },
+{ "-mem_limit",		1, 1, DoMemLimit, "Limit this process to N MB of memory.", "" },
+{ "-timing_log",	1, 1, DoTimingLog, "Write command times to a file when done.", "" },
 #if USE_CHUD
 { "-chud_start",	1, 1, DoChudStart, "Start profiling", "" },
 { "-chud_stop",		0, 0, DoChudStop, "stop profiling", "" },
@@ -113,6 +318,7 @@ int	main(int argc, char * argv[])
 		CGAL::set_error_handler(CGALFailure);
 
 		int start_arg = 1;
+		sSelfPath = argv[0];
 
 		GISTool_RegisterCommands(sUtilCmds);
 
@@ -185,6 +391,8 @@ int	main(int argc, char * argv[])
 //		for(int n = 0; n < args.size(); ++n)
 //			printf("%d) '%s'\n", n,args[n]);
 		result = GISTool_ParseCommands(args);
+		if (!sTimingLog.empty())
+			WriteTimingLog(sTimingLog);
 
 #if USE_CHUD
 		if (can_profile)	chudReleaseRemoteAccess();
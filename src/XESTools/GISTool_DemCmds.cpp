@@ -976,6 +976,18 @@ static int DoSaveNormals(const vector<const char *>& args)
 	return 0;
 }
 
+#define DoRasterMemLimit_HELP \
+"Usage: -raster_mem_limit <mb> <scratch folder>\n"\
+"Between commands, the least recently used raster layers are written to compressed files in the\n"\
+"scratch folder until the ones left in memory fit in mb megabytes.  They are read back when used.\n"\
+"0 turns the limit off.\n"
+static int DoRasterMemLimit(const vector<const char *>& args)
+{
+	gDem.set_memory_limit((size_t) atoi(args[0]) * 1024 * 1024, args[1]);
+	if (gVerbose) printf("Raster layers over %s MB will spill to %s.\n", args[0], args[1]);
+	return 0;
+}
+
 static	GISTool_RegCmd_t		sDemCmds[] = {
 { "-hgt", 			1, 1, DoHGTImport, 			"Import 16-bit BE raw HGT DEM.", "" },
 { "-hgtzip", 		1, 1, DoHGTExport, 			"Export 16-bit BE raw HGT DEM.", "" },
@@ -999,6 +1011,7 @@ static	GISTool_RegCmd_t		sDemCmds[] = {
 { "-raster_merge", 4, 4, DoRasterMerge,			"Merge two raster layers.", DoRasterMerge_HELP },
 { "-raster_watershed", 3, 3, DoRasterWatershed,	"Calculate watersheds from one layer, dump in another", DoRasterWatershed_HELP },
 { "-save_normals", 1, 1, DoSaveNormals, "", "" },
+{ "-raster_mem_limit", 2, 2, DoRasterMemLimit,	"Limit memory used by raster layers.", DoRasterMemLimit_HELP },
 { "-applyoverlay",	0, 0, DoApply	,			"Use overlay.", "" },
 { 0, 0, 0, 0, 0, 0 }
 };
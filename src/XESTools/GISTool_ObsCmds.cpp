@@ -149,20 +149,13 @@ static int DoAptBulkExport(const vector<const char *>& args)
 
 		set<int>	apts;
 
-	if(step != 1)
-	{
-		for(int i = 0; i < gApts.size(); ++i)
-			apts.insert(i);
-	}
-
 	for (int y = -90; y < 90; y += step)
 	{
 		for (int x = -180; x < 180; x += step)
 		{
 			Bbox2	bounds(x, y, x+step,y+step);
 			
-			if(step == 1)
-				FindAirports(bounds, gAptIndex, apts);
+			FindAirports(bounds, gAptIndex, apts);
 
 			AptVector	aptCopy;
 			for (set<int>::iterator iter = apts.begin(); iter != apts.end(); ++iter)
@@ -373,7 +366,7 @@ static int DoAptTest(const vector<const char *>& args)
 			DebugAssert(e[0].size() == 1);
 			e[0][0]->face()->data().mTerrainType = terrain_Natural;
 			
-			ProcessAirports(one, victim, foo, bar, false, false, false, NULL);
+			ProcessAirports(one, gAptIndex, victim, foo, bar, false, false, false, NULL);
 //			if (gVerbose) printf("OK '%s' %s\n",
 //				gApts[a].icao.c_str(), gApts[a].name.c_str());
 			++ok;
@@ -106,24 +106,10 @@ void SetupRasterizerForMesh(PolyRasterizer<double>& rasterizer, CDT& ioMesh, DEM
 
 void	RasterizerFill(PolyRasterizer<double>& rasterizer, DEMGeo& ag_ok, float v)
 {
-	int y = 0;
-	rasterizer.StartScanline(y);
-	while (!rasterizer.DoneScan())
-	{
-		int x1, x2;
-		while (rasterizer.GetRange(x1, x2))
-		{
-			for(int x = x1; x < x2; ++x)
-			{
-				ag_ok(x,y) = v;
-			}
-		}
-		// Yeah we could be more clever about modulus in the Y axis, but..the rasterizer might
-		// be unhappy skipping scanlines with "events" on them.
-		++y;
-		if (y >= ag_ok.mHeight) break;
-		rasterizer.AdvanceScanline(y);
-	}
+	PolyRasterFill(rasterizer, ag_ok.mWidth, ag_ok.mHeight, [&](int y, int x1, int x2) {
+		float * row = ag_ok.mData + (size_t) y * ag_ok.mWidth;
+		std::fill(row + x1, row + x2, v);
+	});
 }
 
 static bool	LowerPriorityFeature(GISPointFeature_t& lhs, GISPointFeature_t& rhs)
@@ -281,14 +267,14 @@ static int DoCalcMesh(const vector<const char *>& args)
 static int DoBurnAirports(const vector<const char *>& args)
 {
 	if (gVerbose)	printf("Burning airports into vector map...\n");
-	ProcessAirports(gApts, gMap, gDem[dem_Elevation], gDem[dem_UrbanTransport], true, true, true, gProgress);
+	ProcessAirports(gApts, gAptIndex, gMap, gDem[dem_Elevation], gDem[dem_UrbanTransport], true, true, true, gProgress);
 	return 0;
 }
 
 static int DoZoning(const vector<const char *>& args)
 {
 	if (gVerbose)	printf("Calculating zoning info...\n");
-	ZoneManMadeAreas(gMap, gDem[dem_Elevation], gDem[dem_LandUse], gDem[dem_ForestType], gDem[dem_ParkType], gDem[dem_Slope],gApts,	Pmwx::Face_handle(), 	gProgress);
+	ZoneManMadeAreas(gMap, gDem[dem_Elevation], gDem[dem_LandUse], gDem[dem_ForestType], gDem[dem_ParkType], gDem[dem_Slope],gApts, gAptIndex,	Pmwx::Face_handle(), 	gProgress);
 	return 0;
 }
 
@@ -417,10 +403,6 @@ static int DoInstantiateObjs(const vector<const char *>& args)
 	
 	PROGRESS_START(gProgress, 0, 2, "Creating 3-d.")
 	trim_map(gMap);
-	int idx = 0;
-	int t = gMap.number_of_faces();
-	int step = t / 100;
-	if(step < 1) step = 1;
 
 	#if OPENGL_MAP
 		bool no_sel = gFaceSelection.empty();
@@ -445,23 +427,16 @@ static int DoInstantiateObjs(const vector<const char *>& args)
 	// want it all? slow?  to test?  ok...
 	//ag_ok=1;
 
-	for(Pmwx::Face_handle f = gMap.faces_begin(); f != gMap.faces_end(); ++f, ++idx)
+	vector<Pmwx::Face_handle>	blocks;
+	for(Pmwx::Face_handle f = gMap.faces_begin(); f != gMap.faces_end(); ++f)
 	if(!f->is_unbounded())
 	if(!f->data().IsWater())
 	#if OPENGL_MAP
 	if(gFaceSelection.count(f) || no_sel)
 	#endif
-	{
-//		unsigned long long before, after;
-//		Microseconds((UnsignedWide *)&before);
-		PROGRESS_CHECK(gProgress, 0, 1, "Creating 3-d.", idx, t, step);
-		process_block(f,gTriangulationHi, ag_ok, forests, forest_index);
-//		Microseconds((UnsignedWide *)&after);
-//		double elapsed = (double) (after - before) / 1000000.0;
-//		by_zone[f->data().GetZoning()] += elapsed;
-//		int ns = count_circulator(f->outer_ccb());
-//		by_sides[ns] += elapsed;
-	}
+		blocks.push_back(f);
+
+	process_blocks(blocks, gTriangulationHi, ag_ok, forests, forest_index, gProgress);
 
 	printf("Blocks: %d.  Split: %d. Forests: %d.  Parts: %d\n",  num_block_processed, num_blocks_with_split, num_forest_split, num_line_integ);
 	
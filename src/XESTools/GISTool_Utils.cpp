@@ -25,6 +25,7 @@
 #include <map>
 #include "PerfUtils.h"
 #include "GISTool_Globals.h"
+#include "DEMDefs.h"
 
 struct	GISTool_CmdInfo_t {
 	int						min_params;
@@ -36,6 +37,7 @@ struct	GISTool_CmdInfo_t {
 
 static map<string, GISTool_CmdInfo_t>		sCmds;
 static int									sSkip = 0;
+static map<string, GISTool_CmdTiming_t>		sTimings;
 
 void	GISTool_SetSkip(int n)
 {
@@ -43,6 +45,11 @@ void	GISTool_SetSkip(int n)
 	sSkip = n;
 }
 
+const map<string, GISTool_CmdTiming_t>&	GISTool_GetTimings(void)
+{
+	return sTimings;
+}
+
 void	GISTool_RegisterCommand(
 						const char *		inName,
 						int					inMinParams,
@@ -164,9 +171,18 @@ int	GISTool_ParseCommands(const vector<const char *>& args)
 				{
 					try {
 						StElapsedTime * timer = (gTiming ? new StElapsedTime(cname) : NULL);
+						unsigned long long start = query_hpc();
 						int result = cmd(cmdargs);
 						delete timer;
+						if (gTiming)
+						{
+							GISTool_CmdTiming_t& t = sTimings[cname];
+							t.seconds += hpc_to_microseconds(query_hpc() - start) / 1000000.0;
+							t.runs++;
+						}
 						if (result != 0) return result;
+						// No command holds on to a layer past its end, so this is the safe time to spill.
+						gDem.trim();
 					} catch(const char * msg) {
 						printf("Caught: %s\n", msg);
 						return 1;
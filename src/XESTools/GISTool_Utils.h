@@ -24,6 +24,8 @@
 #ifndef GISTOOL_UTILS_H
 #define GISTOOL_UTILS_H
 
+#include <map>
+
 /*
  * GISTool_Command_f
  *
@@ -70,4 +72,12 @@ int		GISTool_ParseCommands(const vector<const char *>& inArgs);
 
 void	GISTool_SetSkip(int n);
 
+// While gTiming is on, every command's run time is added up here, by command name.
+struct	GISTool_CmdTiming_t {
+	double				seconds;
+	int					runs;
+};
+
+const map<string, GISTool_CmdTiming_t>&	GISTool_GetTimings(void);
+
 #endif /* GISTOOL_UTILS_H */
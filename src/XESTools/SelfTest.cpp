@@ -24,6 +24,12 @@
 #if DEV
 void TEST_CompGeomDefs2(void);
 void TEST_MapDefs(void);
+void TEST_ObjPointPool(void);
+void TEST_RTree2(void);
+void TEST_PolyRasterUtils(void);
+void TEST_MapIndex(void);
+void TEST_DEMDefs(void);
+void TEST_DEMFlow(void);
 #endif
 
 void SelfTestAll(void)
@@ -31,6 +37,12 @@ void SelfTestAll(void)
 #if DEV
 //	TEST_CompGeomDefs2();
 //	TEST_MapDefs();
+	TEST_ObjPointPool();
+	TEST_RTree2();
+	TEST_PolyRasterUtils();
+	TEST_MapIndex();
+	TEST_DEMDefs();
+	TEST_DEMFlow();
 	printf("Self-tests completed.\n");
 #endif
 }
\ No newline at end of file
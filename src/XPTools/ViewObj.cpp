@@ -37,6 +37,7 @@
 #include "MatrixUtils.h"
 #include "trackball.h"
 #include "XObjReadWrite.h"
+#include "XObjBinCache.h"
 #include "XGUIApp.h"
 #include <set>
 #include "PlatformUtils.h"
@@ -447,7 +448,7 @@ void			XObjWin::ReceiveFiles(const vector<string>& files, int, int)
 	for (vector<string>::const_iterator i = files.begin(); i != files.end(); ++i)
 	{
 		if (HasExtNoCase(*i, ".obj")) {
-			if (XObj8Read(i->c_str(), mObj8))
+			if (XObj8ReadCached(i->c_str(), mObj8))
 			{
 				mIsObj8 = true;
 				string foo(*i);
@@ -608,6 +609,10 @@ void	XGrindFiles(const vector<string>& files)
 
 void	XGrindInit(void)
 {
+	string os_cache = GetCacheFolder();
+	if (!os_cache.empty())
+		XObjBinCache_Init(os_cache + DIR_STR "objview_obj_cache", 64);
+
 	XObjWin * win = new XObjWin(NULL);
 	
 #if IBM